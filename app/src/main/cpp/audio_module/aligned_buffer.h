@@ -0,0 +1,79 @@
+// aligned_buffer.h
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <utility>
+
+// Move-only float buffer aligned for SIMD loads/stores. Unlike std::vector,
+// resize() does not zero-fill, so converting into it touches each byte once.
+class AlignedFloatBuffer {
+public:
+    static constexpr size_t kAlignment = 64; // cache line; covers NEON/SSE/AVX
+
+    AlignedFloatBuffer() = default;
+    explicit AlignedFloatBuffer(size_t n) { resize(n); }
+    ~AlignedFloatBuffer() { std::free(data_); }
+
+    AlignedFloatBuffer(const AlignedFloatBuffer&) = delete;
+    AlignedFloatBuffer& operator=(const AlignedFloatBuffer&) = delete;
+
+    AlignedFloatBuffer(AlignedFloatBuffer&& other) noexcept
+        : data_(std::exchange(other.data_, nullptr)),
+          size_(std::exchange(other.size_, 0)),
+          capacity_(std::exchange(other.capacity_, 0)) {}
+
+    AlignedFloatBuffer& operator=(AlignedFloatBuffer&& other) noexcept {
+        if (this != &other) {
+            std::free(data_);
+            data_ = std::exchange(other.data_, nullptr);
+            size_ = std::exchange(other.size_, 0);
+            capacity_ = std::exchange(other.capacity_, 0);
+        }
+        return *this;
+    }
+
+    // Keeps the first min(size(), n) elements; new elements are uninitialized.
+    void resize(size_t n) {
+        if (n > capacity_) reallocate(n);
+        size_ = n;
+    }
+
+    // Grows capacity geometrically so repeated appends stay amortized O(1).
+    void reserve(size_t n) {
+        if (n > capacity_) reallocate(std::max(n, capacity_ + capacity_ / 2));
+    }
+
+    void clear() { size_ = 0; }
+
+    float* data() { return data_; }
+    const float* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    float& operator[](size_t i) { return data_[i]; }
+    const float& operator[](size_t i) const { return data_[i]; }
+
+    float* begin() { return data_; }
+    float* end() { return data_ + size_; }
+    const float* begin() const { return data_; }
+    const float* end() const { return data_ + size_; }
+
+private:
+    void reallocate(size_t n) {
+        void* p = nullptr;
+        if (posix_memalign(&p, kAlignment, n * sizeof(float)) != 0) {
+            throw std::bad_alloc();
+        }
+        if (size_ > 0) std::memcpy(p, data_, size_ * sizeof(float));
+        std::free(data_);
+        data_ = static_cast<float*>(p);
+        capacity_ = n;
+    }
+
+    float* data_ = nullptr;
+    size_t size_ = 0;
+    size_t capacity_ = 0;
+};
@@ -0,0 +1,192 @@
+// audio_cache.cpp
+#include "audio_cache.h"
+
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include "resampler.h"
+#include "platform/native_log.h"
+
+#define TAG "AUDIO_CACHE"
+
+namespace {
+
+struct CacheEntry {
+    AudioCacheKey key;
+    SharedAudio audio;
+    size_t bytes;
+};
+
+// Front of the list is the most recently used entry. The cache is small
+// (a handful of sessions), so lookups scan the list.
+std::mutex g_mutex;
+std::condition_variable g_load_done;
+std::list<CacheEntry> g_entries;
+std::vector<AudioCacheKey> g_loading;
+size_t g_bytes = 0;
+size_t g_budget = 256u << 20;
+
+size_t audio_bytes(const PcmAudio& audio) {
+    return audio.samples.size() * sizeof(float);
+}
+
+std::list<CacheEntry>::iterator find_locked(const AudioCacheKey& key) {
+    for (auto it = g_entries.begin(); it != g_entries.end(); ++it) {
+        if (it->key == key) return it;
+    }
+    return g_entries.end();
+}
+
+bool is_loading_locked(const AudioCacheKey& key) {
+    for (const AudioCacheKey& k : g_loading) {
+        if (k == key) return true;
+    }
+    return false;
+}
+
+void erase_loading_locked(const AudioCacheKey& key) {
+    for (auto it = g_loading.begin(); it != g_loading.end(); ++it) {
+        if (*it == key) {
+            g_loading.erase(it);
+            return;
+        }
+    }
+}
+
+// Evicted audio is returned so the caller can drop the last reference outside the lock.
+void evict_locked(std::vector<SharedAudio>& evicted) {
+    while (g_bytes > g_budget && !g_entries.empty()) {
+        CacheEntry& victim = g_entries.back();
+        LOGD(TAG, "Evicting %s (%zu bytes)", victim.key.path.c_str(), victim.bytes);
+        g_bytes -= victim.bytes;
+        evicted.push_back(std::move(victim.audio));
+        g_entries.pop_back();
+    }
+}
+
+SharedAudio insert_locked(const AudioCacheKey& key, SharedAudio audio, std::vector<SharedAudio>& evicted) {
+    auto existing = find_locked(key);
+    if (existing != g_entries.end()) {
+        g_bytes -= existing->bytes;
+        evicted.push_back(std::move(existing->audio));
+        g_entries.erase(existing);
+    }
+
+    const size_t bytes = audio_bytes(*audio);
+    if (bytes > g_budget) {
+        LOGW(TAG, "%s (%zu bytes) exceeds the cache budget; not retained", key.path.c_str(), bytes);
+        return audio;
+    }
+    g_entries.push_front(CacheEntry{key, audio, bytes});
+    g_bytes += bytes;
+    evict_locked(evicted);
+    return audio;
+}
+
+} // namespace
+
+bool audio_cache_key_for_file(const std::string& path, AudioCacheKey& key) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return false;
+    key.path = path;
+    key.size = static_cast<int64_t>(st.st_size);
+    key.mtime_ns = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+    return true;
+}
+
+SharedAudio audio_cache_lookup(const AudioCacheKey& key) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    auto it = find_locked(key);
+    if (it == g_entries.end()) return nullptr;
+    g_entries.splice(g_entries.begin(), g_entries, it);
+    return it->audio;
+}
+
+SharedAudio audio_cache_insert(const AudioCacheKey& key, PcmAudio&& audio) {
+    audio.source_path = key.path;
+    SharedAudio shared = std::make_shared<const PcmAudio>(std::move(audio));
+    std::vector<SharedAudio> evicted;
+    std::lock_guard<std::mutex> lock(g_mutex);
+    return insert_locked(key, std::move(shared), evicted);
+}
+
+PcmLoadStatus audio_cache_get_or_load(const AudioCacheKey& key, const AudioLoadFn& load, SharedAudio& out) {
+    {
+        std::unique_lock<std::mutex> lock(g_mutex);
+        for (;;) {
+            auto it = find_locked(key);
+            if (it != g_entries.end()) {
+                g_entries.splice(g_entries.begin(), g_entries, it);
+                out = it->audio;
+                LOGD(TAG, "Hit: %s", key.path.c_str());
+                return PCM_LOAD_OK;
+            }
+            if (!is_loading_locked(key)) break;
+            // another thread is decoding this file; use its result
+            g_load_done.wait(lock);
+        }
+        g_loading.push_back(key);
+    }
+
+    PcmAudio audio;
+    PcmLoadStatus status = PCM_LOAD_EMPTY;
+    try {
+        status = load(audio);
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        erase_loading_locked(key);
+        g_load_done.notify_all();
+        throw;
+    }
+
+    std::vector<SharedAudio> evicted;
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        erase_loading_locked(key);
+        if (status == PCM_LOAD_OK) {
+            audio.source_path = key.path;
+            out = insert_locked(key, std::make_shared<const PcmAudio>(std::move(audio)), evicted);
+        }
+    }
+    // waiters re-check the cache; after a failed load one of them retries
+    g_load_done.notify_all();
+    return status;
+}
+
+PcmLoadStatus audio_cache_load_file(const std::string& path, SharedAudio& out) {
+    AudioCacheKey key;
+    if (!audio_cache_key_for_file(path, key)) return PCM_LOAD_OPEN_FAILED;
+
+    return audio_cache_get_or_load(key, [&path](PcmAudio& audio) {
+        PcmAudio loaded;
+        PcmLoadStatus status = load_pcm_file(path, loaded);
+        if (status != PCM_LOAD_OK) return status;
+        PcmAudio converted;
+        const PcmAudio& mono = conform_audio(loaded, kAudioCacheSampleRate, converted);
+        audio = std::move(&mono == &loaded ? loaded : converted);
+        return PCM_LOAD_OK;
+    }, out);
+}
+
+void audio_cache_set_budget(size_t bytes) {
+    std::vector<SharedAudio> evicted;
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_budget = bytes;
+    evict_locked(evicted);
+}
+
+size_t audio_cache_bytes() {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    return g_bytes;
+}
+
+void audio_cache_clear() {
+    std::list<CacheEntry> released;
+    std::lock_guard<std::mutex> lock(g_mutex);
+    released.swap(g_entries);
+    g_bytes = 0;
+}
@@ -0,0 +1,53 @@
+// audio_cache.h
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "pcm_loader.h"
+
+// Decoded audio shared between consumers. Immutable once published; the
+// shared_ptr reference count keeps it alive while any job still uses it,
+// even after the cache has evicted it.
+typedef std::shared_ptr<const PcmAudio> SharedAudio;
+
+// Identity of a source file: the same path with a different size or mtime is
+// a different recording.
+struct AudioCacheKey {
+    std::string path;
+    int64_t size = 0;
+    int64_t mtime_ns = 0;
+
+    bool operator==(const AudioCacheKey& other) const {
+        return size == other.size && mtime_ns == other.mtime_ns && path == other.path;
+    }
+};
+
+// Fills key from stat(path). Returns false if the file does not exist.
+bool audio_cache_key_for_file(const std::string& path, AudioCacheKey& key);
+
+// Process-wide LRU cache of decoded audio with a byte budget (default 256 MiB).
+// Entries larger than the whole budget are handed out but not retained.
+SharedAudio audio_cache_lookup(const AudioCacheKey& key);
+SharedAudio audio_cache_insert(const AudioCacheKey& key, PcmAudio&& audio);
+
+// Returns the cached audio for key, or runs load() and caches its result.
+// Concurrent callers for the same key wait for a single load instead of
+// decoding twice. load() returns PCM_LOAD_OK and fills audio on success;
+// on failure nothing is cached and its status is returned.
+typedef std::function<PcmLoadStatus(PcmAudio& audio)> AudioLoadFn;
+PcmLoadStatus audio_cache_get_or_load(const AudioCacheKey& key, const AudioLoadFn& load, SharedAudio& out);
+
+// Sample rate of audio published by audio_cache_load_file: what whisper, VAD
+// and the speaker embeddings all consume.
+constexpr int kAudioCacheSampleRate = 16000;
+
+// Loads a PCM/WAV file through the cache, converted to kAudioCacheSampleRate
+// mono once, so transcription and diarization of the same file share it.
+PcmLoadStatus audio_cache_load_file(const std::string& path, SharedAudio& out);
+
+void audio_cache_set_budget(size_t bytes);
+size_t audio_cache_bytes();
+void audio_cache_clear();
@@ -0,0 +1,131 @@
+// half_float.cpp
+#include "half_float.h"
+
+#include <cstring>
+
+#if defined(__aarch64__) || \
+    ((defined(__ARM_NEON) || defined(__ARM_NEON__)) && defined(__ARM_FP16_FORMAT_IEEE) && defined(__ARM_FP) && (__ARM_FP & 2))
+#include <arm_neon.h>
+#define HALF_NEON 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define HALF_SSE2 1
+#endif
+
+// Bit patterns of the float constants the conversions use.
+static constexpr uint32_t kSignBit = 0x80000000u;
+static constexpr uint32_t kHalfOverflow = 0x47800000u;  // 65536: this and up round to infinity
+static constexpr uint32_t kHalfMinNormal = 0x38800000u; // 2^-14
+static constexpr uint32_t kSubnormalMagic = 0x3f000000u;// 0.5: adding it leaves a subnormal's bits in the mantissa
+static constexpr uint32_t kRebias = 0xc8000fffu;        // exponent 127 -> 15, plus just under half an ulp
+static constexpr uint32_t kExpandMagic = 0x77800000u;   // 2^112: exponent 15 -> 127, subnormals normalized
+
+static inline uint16_t float_to_half1(float f) {
+    uint32_t x;
+    std::memcpy(&x, &f, sizeof(x));
+    const uint32_t sign = x & kSignBit;
+    x ^= sign;
+
+    uint32_t h;
+    if (x >= kHalfOverflow) {
+        h = x > 0x7f800000u ? 0x7e00u : 0x7c00u;
+    } else if (x < kHalfMinNormal) {
+        float a, magic;
+        std::memcpy(&a, &x, sizeof(a));
+        std::memcpy(&magic, &kSubnormalMagic, sizeof(magic));
+        a += magic; // the FPU rounds to nearest even
+        std::memcpy(&h, &a, sizeof(h));
+        h -= kSubnormalMagic;
+    } else {
+        const uint32_t mant_odd = (x >> 13) & 1u;
+        h = (x + kRebias + mant_odd) >> 13;
+    }
+    return static_cast<uint16_t>(h | (sign >> 16));
+}
+
+static inline float half_to_float1(uint16_t h) {
+    const uint32_t abs = h & 0x7fffu;
+    uint32_t x = abs << 13;
+    float f, magic;
+    std::memcpy(&f, &x, sizeof(f));
+    std::memcpy(&magic, &kExpandMagic, sizeof(magic));
+    f *= magic;
+    std::memcpy(&x, &f, sizeof(x));
+    if (abs >= 0x7c00u) x |= 0x7f800000u; // infinity and NaN
+    x |= static_cast<uint32_t>(h & 0x8000u) << 16;
+    std::memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+#if defined(HALF_SSE2)
+static inline __m128i float_to_half4(__m128 f) {
+    const __m128 sign = _mm_and_ps(f, _mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(kSignBit))));
+    const __m128 absf = _mm_xor_ps(f, sign);
+    const __m128i x = _mm_castps_si128(absf);
+
+    const __m128i is_nan = _mm_castps_si128(_mm_cmpunord_ps(absf, absf));
+    const __m128i is_regular = _mm_cmpgt_epi32(_mm_set1_epi32(static_cast<int>(kHalfOverflow)), x);
+    const __m128i is_subnormal = _mm_cmpgt_epi32(_mm_set1_epi32(static_cast<int>(kHalfMinNormal)), x);
+    const __m128i inf_or_nan = _mm_or_si128(_mm_and_si128(is_nan, _mm_set1_epi32(0x0200)), _mm_set1_epi32(0x7c00));
+
+    const __m128 magic = _mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(kSubnormalMagic)));
+    const __m128i subnormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(absf, magic)), _mm_castps_si128(magic));
+
+    const __m128i mant_odd = _mm_srai_epi32(_mm_slli_epi32(x, 31 - 13), 31); // -1 where odd
+    const __m128i normal = _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(x, _mm_set1_epi32(static_cast<int>(kRebias))), mant_odd), 13);
+
+    const __m128i finite = _mm_or_si128(_mm_and_si128(is_subnormal, subnormal), _mm_andnot_si128(is_subnormal, normal));
+    const __m128i h = _mm_or_si128(_mm_and_si128(is_regular, finite), _mm_andnot_si128(is_regular, inf_or_nan));
+    // the sign shifted arithmetically keeps each lane in int16 range for the pack
+    return _mm_or_si128(h, _mm_srai_epi32(_mm_castps_si128(sign), 16));
+}
+
+static inline __m128 half_to_float4(__m128i h) {
+    const __m128i abs = _mm_and_si128(h, _mm_set1_epi32(0x7fff));
+    const __m128i sign = _mm_slli_epi32(_mm_xor_si128(h, abs), 16);
+    const __m128 scaled = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(abs, 13)),
+                                     _mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(kExpandMagic))));
+    const __m128i inf_nan = _mm_and_si128(_mm_cmpgt_epi32(abs, _mm_set1_epi32(0x7bff)), _mm_set1_epi32(0x7f800000));
+    return _mm_or_ps(scaled, _mm_castsi128_ps(_mm_or_si128(sign, inf_nan)));
+}
+#endif
+
+void float_to_half(const float* src, uint16_t* dst, size_t n) {
+    size_t i = 0;
+#if defined(HALF_NEON)
+    for (; i + 8 <= n; i += 8) {
+        const float16x8_t h = vcombine_f16(vcvt_f16_f32(vld1q_f32(src + i)), vcvt_f16_f32(vld1q_f32(src + i + 4)));
+        vst1q_u16(dst + i, vreinterpretq_u16_f16(h));
+    }
+#elif defined(HALF_SSE2)
+    for (; i + 8 <= n; i += 8) {
+        const __m128i lo = float_to_half4(_mm_loadu_ps(src + i));
+        const __m128i hi = float_to_half4(_mm_loadu_ps(src + i + 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packs_epi32(lo, hi));
+    }
+#endif
+    for (; i < n; ++i) {
+        dst[i] = float_to_half1(src[i]);
+    }
+}
+
+void half_to_float(const uint16_t* src, float* dst, size_t n) {
+    size_t i = 0;
+#if defined(HALF_NEON)
+    for (; i + 8 <= n; i += 8) {
+        const float16x8_t h = vreinterpretq_f16_u16(vld1q_u16(src + i));
+        vst1q_f32(dst + i, vcvt_f32_f16(vget_low_f16(h)));
+        vst1q_f32(dst + i + 4, vcvt_f32_f16(vget_high_f16(h)));
+    }
+#elif defined(HALF_SSE2)
+    for (; i + 8 <= n; i += 8) {
+        const __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        const __m128i zero = _mm_setzero_si128();
+        _mm_storeu_ps(dst + i, half_to_float4(_mm_unpacklo_epi16(h, zero)));
+        _mm_storeu_ps(dst + i + 4, half_to_float4(_mm_unpackhi_epi16(h, zero)));
+    }
+#endif
+    for (; i < n; ++i) {
+        dst[i] = half_to_float1(src[i]);
+    }
+}
@@ -0,0 +1,15 @@
+// half_float.h
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// IEEE 754 half precision (binary16) storage for feature buffers. NEON on ARM
+// (where the FPU converts half precision), SSE2 on x86, scalar elsewhere; all
+// paths give the same bits.
+
+// Rounds to nearest even, as ggml's fp32 -> fp16 conversion does. Values past
+// the half range become infinities, NaNs stay NaNs.
+void float_to_half(const float* src, uint16_t* dst, size_t n);
+
+// Exact.
+void half_to_float(const uint16_t* src, float* dst, size_t n);
@@ -0,0 +1,246 @@
+// mel_filterbank.cpp
+#include "mel_filterbank.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define MEL_NEON 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MEL_SSE2 1
+#endif
+
+// Bands are logged in groups of this many, through a stack buffer.
+static constexpr int kLogBatch = 16;
+
+static constexpr float kMinPower = 1e-10f;
+static constexpr float kLog10MinPower = -10.0f;
+static constexpr float kSqrt2 = 1.41421356f;
+static constexpr float kLn2 = 0.693147181f;
+static constexpr float kLog10E = 0.434294482f;
+
+SparseMelFilterbank::SparseMelFilterbank(const float* dense, int n_mel, int n_fft) : n_fft_(n_fft) {
+    bands_.reserve(n_mel);
+    for (int j = 0; j < n_mel; ++j) {
+        const float* row = dense + static_cast<size_t>(j) * n_fft;
+        int first = 0;
+        while (first < n_fft && row[first] == 0.0f) ++first;
+        int last = n_fft;
+        while (last > first && row[last - 1] == 0.0f) --last;
+
+        // pad to whole SIMD vectors, extending to the right or, at the end of
+        // the spectrum, to the left; the extra weights are zeros from the row
+        int length = last - first;
+        if (length > 0 && length % 4 != 0) {
+            length = std::min(n_fft, (length + 3) / 4 * 4);
+            first = std::min(first, n_fft - length);
+        }
+        bands_.push_back({first, length, weights_.size()});
+        weights_.insert(weights_.end(), row + first, row + first + length);
+    }
+}
+
+// n is a multiple of 4 except for very short spectra.
+static inline float band_dot(const float* power, const float* weights, int n) {
+    int k = 0;
+    float sum = 0.0f;
+#if defined(MEL_NEON)
+    float32x4_t acc = vdupq_n_f32(0.0f);
+    for (; k + 4 <= n; k += 4) {
+        acc = vmlaq_f32(acc, vld1q_f32(power + k), vld1q_f32(weights + k));
+    }
+    float32x2_t pair = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+    sum = vget_lane_f32(vpadd_f32(pair, pair), 0);
+#elif defined(MEL_SSE2)
+    __m128 acc = _mm_setzero_ps();
+    for (; k + 4 <= n; k += 4) {
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(power + k), _mm_loadu_ps(weights + k)));
+    }
+    acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+    acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+    sum = _mm_cvtss_f32(acc);
+#endif
+    for (; k < n; ++k) {
+        sum += power[k] * weights[k];
+    }
+    return sum;
+}
+
+void SparseMelFilterbank::apply_log10(const float* power, float* out, size_t out_stride) const {
+    float sums[kLogBatch];
+    const int n = n_mel();
+    for (int j0 = 0; j0 < n; j0 += kLogBatch) {
+        const int count = std::min(kLogBatch, n - j0);
+        for (int j = 0; j < count; ++j) {
+            const Band& band = bands_[j0 + j];
+            sums[j] = band_dot(power + band.begin, weights_.data() + band.offset, band.length);
+        }
+        log10_clamped(sums, count);
+        for (int j = 0; j < count; ++j) {
+            out[(j0 + j) * out_stride] = sums[j];
+        }
+    }
+}
+
+// x = m 2^e with m in [sqrt(1/2), sqrt(2)); ln m = 2 atanh(f), f = (m - 1) / (m + 1),
+// |f| < 0.172, so the series to f^9 is good to float precision.
+#if defined(MEL_NEON) || defined(MEL_SSE2)
+#if defined(MEL_NEON)
+static inline float32x4_t log10_clamped4(float32x4_t x) {
+    x = vmaxq_f32(x, vdupq_n_f32(kMinPower));
+    const uint32x4_t bits = vreinterpretq_u32_f32(x);
+    int32x4_t e = vsubq_s32(vreinterpretq_s32_u32(vshrq_n_u32(bits, 23)), vdupq_n_s32(127));
+    float32x4_t m = vreinterpretq_f32_u32(vorrq_u32(vandq_u32(bits, vdupq_n_u32(0x007fffff)), vdupq_n_u32(0x3f800000)));
+    const uint32x4_t big = vcgtq_f32(m, vdupq_n_f32(kSqrt2));
+    m = vbslq_f32(big, vmulq_n_f32(m, 0.5f), m);
+    e = vsubq_s32(e, vreinterpretq_s32_u32(big)); // big lanes are -1
+    const float32x4_t num = vsubq_f32(m, vdupq_n_f32(1.0f));
+    const float32x4_t den = vaddq_f32(m, vdupq_n_f32(1.0f));
+#if defined(__aarch64__)
+    const float32x4_t f = vdivq_f32(num, den);
+#else
+    float32x4_t inv = vrecpeq_f32(den);
+    inv = vmulq_f32(vrecpsq_f32(den, inv), inv);
+    inv = vmulq_f32(vrecpsq_f32(den, inv), inv);
+    const float32x4_t f = vmulq_f32(num, inv);
+#endif
+    const float32x4_t f2 = vmulq_f32(f, f);
+    float32x4_t p = vdupq_n_f32(2.0f / 9);
+    p = vmlaq_f32(vdupq_n_f32(2.0f / 7), p, f2);
+    p = vmlaq_f32(vdupq_n_f32(2.0f / 5), p, f2);
+    p = vmlaq_f32(vdupq_n_f32(2.0f / 3), p, f2);
+    p = vmlaq_f32(vdupq_n_f32(2.0f), p, f2);
+    const float32x4_t ln = vmlaq_n_f32(vmulq_f32(p, f), vcvtq_f32_s32(e), kLn2);
+    return vmulq_n_f32(ln, kLog10E);
+}
+#else
+static inline __m128 log10_clamped4(__m128 x) {
+    x = _mm_max_ps(x, _mm_set1_ps(kMinPower));
+    const __m128i bits = _mm_castps_si128(x);
+    __m128i e = _mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127));
+    __m128 m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007fffff)), _mm_set1_epi32(0x3f800000)));
+    const __m128 big = _mm_cmpgt_ps(m, _mm_set1_ps(kSqrt2));
+    m = _mm_or_ps(_mm_and_ps(big, _mm_mul_ps(m, _mm_set1_ps(0.5f))), _mm_andnot_ps(big, m));
+    e = _mm_sub_epi32(e, _mm_castps_si128(big)); // big lanes are -1
+    const __m128 f = _mm_div_ps(_mm_sub_ps(m, _mm_set1_ps(1.0f)), _mm_add_ps(m, _mm_set1_ps(1.0f)));
+    const __m128 f2 = _mm_mul_ps(f, f);
+    __m128 p = _mm_set1_ps(2.0f / 9);
+    p = _mm_add_ps(_mm_mul_ps(p, f2), _mm_set1_ps(2.0f / 7));
+    p = _mm_add_ps(_mm_mul_ps(p, f2), _mm_set1_ps(2.0f / 5));
+    p = _mm_add_ps(_mm_mul_ps(p, f2), _mm_set1_ps(2.0f / 3));
+    p = _mm_add_ps(_mm_mul_ps(p, f2), _mm_set1_ps(2.0f));
+    const __m128 ln = _mm_add_ps(_mm_mul_ps(p, f), _mm_mul_ps(_mm_cvtepi32_ps(e), _mm_set1_ps(kLn2)));
+    return _mm_mul_ps(ln, _mm_set1_ps(kLog10E));
+}
+#endif
+#endif
+
+void log10_clamped(float* x, size_t n) {
+    size_t i = 0;
+#if defined(MEL_NEON)
+    for (; i + 4 <= n; i += 4) {
+        vst1q_f32(x + i, log10_clamped4(vld1q_f32(x + i)));
+    }
+#elif defined(MEL_SSE2)
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(x + i, log10_clamped4(_mm_loadu_ps(x + i)));
+    }
+#endif
+    if (i < n) {
+#if defined(MEL_NEON) || defined(MEL_SSE2)
+        // the tail through the same approximation as the rest
+        float tail[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+        std::memcpy(tail, x + i, (n - i) * sizeof(float));
+#if defined(MEL_NEON)
+        vst1q_f32(tail, log10_clamped4(vld1q_f32(tail)));
+#else
+        _mm_storeu_ps(tail, log10_clamped4(_mm_loadu_ps(tail)));
+#endif
+        std::memcpy(x + i, tail, (n - i) * sizeof(float));
+#else
+        for (; i < n; ++i) {
+            x[i] = std::log10(std::max(x[i], kMinPower));
+        }
+#endif
+    }
+}
+
+float log_mel_max(const float* data, size_t n) {
+    if (n == 0) return kLog10MinPower;
+    size_t i = 0;
+    float mmax = data[0];
+#if defined(MEL_NEON)
+    float32x4_t vmax = vdupq_n_f32(data[0]);
+    for (; i + 4 <= n; i += 4) vmax = vmaxq_f32(vmax, vld1q_f32(data + i));
+    float32x2_t pair = vpmax_f32(vget_low_f32(vmax), vget_high_f32(vmax));
+    mmax = vget_lane_f32(vpmax_f32(pair, pair), 0);
+#elif defined(MEL_SSE2)
+    __m128 vmax = _mm_set1_ps(data[0]);
+    for (; i + 4 <= n; i += 4) vmax = _mm_max_ps(vmax, _mm_loadu_ps(data + i));
+    vmax = _mm_max_ps(vmax, _mm_movehl_ps(vmax, vmax));
+    vmax = _mm_max_ss(vmax, _mm_shuffle_ps(vmax, vmax, 1));
+    mmax = _mm_cvtss_f32(vmax);
+#endif
+    for (; i < n; ++i) mmax = std::max(mmax, data[i]);
+    return mmax;
+}
+
+void log_mel_scale(float* data, size_t n, float mmax) {
+    const float floor = mmax - 8.0f;
+    size_t i = 0;
+#if defined(MEL_NEON)
+    for (; i + 4 <= n; i += 4) {
+        const float32x4_t v = vmaxq_f32(vld1q_f32(data + i), vdupq_n_f32(floor));
+        vst1q_f32(data + i, vmulq_n_f32(vaddq_f32(v, vdupq_n_f32(4.0f)), 0.25f));
+    }
+#elif defined(MEL_SSE2)
+    for (; i + 4 <= n; i += 4) {
+        const __m128 v = _mm_max_ps(_mm_loadu_ps(data + i), _mm_set1_ps(floor));
+        _mm_storeu_ps(data + i, _mm_mul_ps(_mm_add_ps(v, _mm_set1_ps(4.0f)), _mm_set1_ps(0.25f)));
+    }
+#endif
+    for (; i < n; ++i) {
+        data[i] = (std::max(data[i], floor) + 4.0f) / 4.0f;
+    }
+}
+
+void log_mel_shift(float* data, size_t n) {
+    size_t i = 0;
+#if defined(MEL_NEON)
+    for (; i + 4 <= n; i += 4) {
+        vst1q_f32(data + i, vmulq_n_f32(vaddq_f32(vld1q_f32(data + i), vdupq_n_f32(4.0f)), 0.25f));
+    }
+#elif defined(MEL_SSE2)
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(data + i, _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(data + i), _mm_set1_ps(4.0f)), _mm_set1_ps(0.25f)));
+    }
+#endif
+    for (; i < n; ++i) {
+        data[i] = (data[i] + 4.0f) / 4.0f;
+    }
+}
+
+void log_mel_floor(float* data, size_t n, float mmax) {
+    const float floor = (mmax - 8.0f + 4.0f) / 4.0f;
+    size_t i = 0;
+#if defined(MEL_NEON)
+    for (; i + 4 <= n; i += 4) {
+        vst1q_f32(data + i, vmaxq_f32(vld1q_f32(data + i), vdupq_n_f32(floor)));
+    }
+#elif defined(MEL_SSE2)
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(data + i, _mm_max_ps(_mm_loadu_ps(data + i), _mm_set1_ps(floor)));
+    }
+#endif
+    for (; i < n; ++i) {
+        data[i] = std::max(data[i], floor);
+    }
+}
+
+void log_mel_normalize(float* data, size_t n) {
+    if (n == 0) return;
+    log_mel_scale(data, n, log_mel_max(data, n));
+}
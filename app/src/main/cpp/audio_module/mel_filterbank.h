@@ -0,0 +1,54 @@
+// mel_filterbank.h
+#pragma once
+#include <cstddef>
+#include <vector>
+
+// Mel filterbank in band-limited form. Each triangular filter is non-zero over
+// a few of the power spectrum's bins, so a row keeps only the span between its
+// first and last non-zero weight: 80 x 201 dense weights become about 520.
+// Rows are padded to a multiple of 4 weights for the SIMD dot product.
+class SparseMelFilterbank {
+public:
+    SparseMelFilterbank() = default;
+
+    // dense: n_mel rows of n_fft weights, as stored in the model file.
+    SparseMelFilterbank(const float* dense, int n_mel, int n_fft);
+
+    int n_mel() const { return static_cast<int>(bands_.size()); }
+    int n_fft() const { return n_fft_; }
+    size_t n_weights() const { return weights_.size(); }
+
+    // out[j * out_stride] = log10(max(sum_k power[k] w_j[k], 1e-10)) for each
+    // band j. power holds n_fft() values.
+    void apply_log10(const float* power, float* out, size_t out_stride = 1) const;
+
+private:
+    struct Band {
+        int begin;      // first bin
+        int length;     // bins, a multiple of 4 unless the spectrum is shorter
+        size_t offset;  // into weights_
+    };
+
+    int n_fft_ = 0;
+    std::vector<Band> bands_;
+    std::vector<float> weights_;
+};
+
+// log10(max(x[i], 1e-10)) in place, four values per SIMD instruction.
+void log10_clamped(float* x, size_t n);
+
+// Whisper's log-mel normalization: values are floored at the maximum minus 8
+// and mapped through (x + 4) / 4.
+void log_mel_normalize(float* data, size_t n);
+
+// The two halves of log_mel_normalize, for spectrograms normalized a window at
+// a time against the maximum of the whole recording.
+float log_mel_max(const float* data, size_t n);
+void log_mel_scale(float* data, size_t n, float mmax);
+
+// log_mel_scale split once more, for spectrograms stored before the maximum is
+// known: log_mel_shift maps x to (x + 4) / 4, and log_mel_floor later floors
+// the shifted values at what mmax - 8 maps to. Together they give the same
+// floats as log_mel_scale.
+void log_mel_shift(float* data, size_t n);
+void log_mel_floor(float* data, size_t n, float mmax);
@@ -0,0 +1,64 @@
+// pcm_convert.cpp
+#include "pcm_convert.h"
+
+#include <algorithm>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define PCM_CONVERT_NEON 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define PCM_CONVERT_SSE2 1
+#endif
+
+#include "platform/worker_pool.h"
+
+static constexpr float kS16Scale = 1.0f / 32768.0f;
+
+// Below this many samples per thread the thread start-up cost dominates.
+static constexpr size_t kMinSamplesPerThread = 1 << 20;
+
+void pcm_s16_to_f32(const int16_t* src, float* dst, size_t n) {
+    size_t i = 0;
+#if defined(PCM_CONVERT_NEON)
+    const float32x4_t scale = vdupq_n_f32(kS16Scale);
+    for (; i + 16 <= n; i += 16) {
+        int16x8_t a = vld1q_s16(src + i);
+        int16x8_t b = vld1q_s16(src + i + 8);
+        vst1q_f32(dst + i,      vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(a))),  scale));
+        vst1q_f32(dst + i + 4,  vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(a))), scale));
+        vst1q_f32(dst + i + 8,  vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(b))),  scale));
+        vst1q_f32(dst + i + 12, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(b))), scale));
+    }
+#elif defined(PCM_CONVERT_SSE2)
+    const __m128 scale = _mm_set1_ps(kS16Scale);
+    for (; i + 8 <= n; i += 8) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        // sign-extend: put each sample in the high half of a 32-bit lane, then shift arithmetic
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+        _mm_storeu_ps(dst + i,     _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+#endif
+    for (; i < n; ++i) {
+        dst[i] = static_cast<float>(src[i]) * kS16Scale;
+    }
+}
+
+void pcm_s16_to_f32_parallel(const int16_t* src, float* dst, size_t n, int n_threads) {
+    const size_t max_threads = std::max<size_t>(1, n / kMinSamplesPerThread);
+    const size_t threads = std::min<size_t>(std::max(n_threads, 1), max_threads);
+    if (threads <= 1) {
+        pcm_s16_to_f32(src, dst, n);
+        return;
+    }
+
+    // chunk boundaries on 16-sample multiples keep every chunk on the vector path
+    const size_t chunk = ((n / threads) + 15) & ~static_cast<size_t>(15);
+    worker_pool().parallel_for(static_cast<int>(threads), static_cast<int>(threads), [=](int t) {
+        const size_t begin = std::min(n, static_cast<size_t>(t) * chunk);
+        const size_t end = std::min(n, begin + chunk);
+        if (begin < end) pcm_s16_to_f32(src + begin, dst + begin, end - begin);
+    });
+}
@@ -0,0 +1,14 @@
+// pcm_convert.h
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Sample conversion kernels. NEON on ARM, SSE2 on x86, scalar elsewhere.
+// src may be unaligned; dst should be 16-byte aligned for best throughput.
+
+// Signed 16-bit PCM -> float in [-1, 1) (x / 32768, bit-identical to the scalar formula).
+void pcm_s16_to_f32(const int16_t* src, float* dst, size_t n);
+
+// Same as pcm_s16_to_f32 but splits large inputs across up to n_threads threads
+// of the shared worker pool.
+void pcm_s16_to_f32_parallel(const int16_t* src, float* dst, size_t n, int n_threads);
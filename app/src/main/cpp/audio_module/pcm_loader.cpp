@@ -0,0 +1,168 @@
+// pcm_loader.cpp
+#include "pcm_loader.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "pcm_convert.h"
+#include "platform/cpu_topology.h"
+
+// Samples are converted straight out of the mapping, which relies on the host
+// byte order matching the file (every supported ABI is little-endian).
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "pcm_loader assumes a little-endian host"
+#endif
+
+static constexpr uint16_t kWaveFormatPcm        = 0x0001;
+static constexpr uint16_t kWaveFormatIeeeFloat  = 0x0003;
+static constexpr uint16_t kWaveFormatExtensible = 0xFFFE;
+
+// Read-only mapping of a whole file, unmapped on scope exit.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return;
+        opened_ = true;
+
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* p = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                data_ = static_cast<const uint8_t*>(p);
+                size_ = static_cast<size_t>(st.st_size);
+                madvise(p, size_, MADV_SEQUENTIAL);
+            }
+        }
+        close(fd); // the mapping stays valid
+    }
+
+    ~MappedFile() {
+        if (data_ != nullptr) munmap(const_cast<uint8_t*>(data_), size_);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool opened() const { return opened_; }
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    bool opened_ = false;
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+static uint16_t read_u16le(const uint8_t* p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+static uint32_t read_u32le(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+// Locates the sample data of a RIFF/WAVE file and fills format.
+// Returns PCM_LOAD_OK with data_offset/data_size set, or an error status.
+static PcmLoadStatus parse_wav_header(const uint8_t* file, size_t file_size, PcmFormat& format,
+                                      size_t& data_offset, size_t& data_size) {
+    bool have_fmt = false;
+    size_t pos = 12; // past "RIFF" <size> "WAVE"
+    while (pos + 8 <= file_size) {
+        const uint8_t* chunk = file + pos;
+        const uint32_t chunk_size = read_u32le(chunk + 4);
+        const size_t body = pos + 8;
+
+        if (std::memcmp(chunk, "fmt ", 4) == 0) {
+            if (chunk_size < 16 || body + 16 > file_size) return PCM_LOAD_UNSUPPORTED_FORMAT;
+            uint16_t audio_format = read_u16le(file + body);
+            const uint16_t channels = read_u16le(file + body + 2);
+            const uint32_t sample_rate = read_u32le(file + body + 4);
+            const uint16_t bits = read_u16le(file + body + 14);
+            if (audio_format == kWaveFormatExtensible && chunk_size >= 26 && body + 26 <= file_size) {
+                audio_format = read_u16le(file + body + 24); // first two bytes of the sub-format GUID
+            }
+
+            if (audio_format == kWaveFormatPcm && bits == 16) {
+                format.sample_format = PCM_FORMAT_S16LE;
+            } else if (audio_format == kWaveFormatIeeeFloat && bits == 32) {
+                format.sample_format = PCM_FORMAT_F32LE;
+            } else {
+                return PCM_LOAD_UNSUPPORTED_FORMAT;
+            }
+            if (channels == 0 || sample_rate == 0) return PCM_LOAD_UNSUPPORTED_FORMAT;
+
+            format.channels = channels;
+            format.sample_rate = static_cast<int>(sample_rate);
+            format.from_header = true;
+            have_fmt = true;
+        } else if (std::memcmp(chunk, "data", 4) == 0) {
+            if (!have_fmt) return PCM_LOAD_UNSUPPORTED_FORMAT;
+            data_offset = body;
+            // A writer that was interrupted leaves the size at 0 or 0xFFFFFFFF; take the rest of the file.
+            const size_t available = file_size - body;
+            data_size = (chunk_size == 0 || chunk_size > available) ? available : chunk_size;
+            return PCM_LOAD_OK;
+        }
+
+        // a chunk past the end of the file is the last one; checked before
+        // adding, which would wrap a 32-bit size_t
+        if (chunk_size > file_size - body) break;
+        pos = body + chunk_size + (chunk_size & 1); // chunks are word aligned
+    }
+    return have_fmt ? PCM_LOAD_EMPTY : PCM_LOAD_UNSUPPORTED_FORMAT;
+}
+
+const char* pcm_sample_format_name(PcmSampleFormat format) {
+    switch (format) {
+        case PCM_FORMAT_S16LE: return "s16le";
+        case PCM_FORMAT_F32LE: return "f32le";
+    }
+    return "unknown";
+}
+
+PcmLoadStatus load_pcm_file(const std::string& path, PcmAudio& out) {
+    MappedFile file(path);
+    if (!file.opened()) {
+        return PCM_LOAD_OPEN_FAILED;
+    }
+    if (file.data() == nullptr) {
+        return PCM_LOAD_EMPTY;
+    }
+
+    PcmFormat format;
+    size_t data_offset = 0;
+    size_t data_size = file.size();
+    if (file.size() >= 12 && std::memcmp(file.data(), "RIFF", 4) == 0 && std::memcmp(file.data() + 8, "WAVE", 4) == 0) {
+        PcmLoadStatus status = parse_wav_header(file.data(), file.size(), format, data_offset, data_size);
+        if (status != PCM_LOAD_OK) return status;
+    }
+
+    const uint8_t* data = file.data() + data_offset;
+    const int n_threads = current_thread_plan().n_threads;
+
+    if (format.sample_format == PCM_FORMAT_S16LE) {
+        const size_t n_samples = data_size / sizeof(int16_t);
+        if (n_samples == 0) return PCM_LOAD_EMPTY;
+        out.samples.resize(n_samples);
+        // data_offset is even (RIFF chunks are word aligned), so the cast is properly aligned
+        pcm_s16_to_f32_parallel(reinterpret_cast<const int16_t*>(data), out.samples.data(), n_samples, n_threads);
+    } else {
+        const size_t n_samples = data_size / sizeof(float);
+        if (n_samples == 0) return PCM_LOAD_EMPTY;
+        out.samples.resize(n_samples);
+        std::memcpy(out.samples.data(), data, n_samples * sizeof(float));
+    }
+
+    // drop a trailing partial frame
+    const size_t frames = out.samples.size() / format.channels;
+    out.samples.resize(frames * format.channels);
+    if (frames == 0) return PCM_LOAD_EMPTY;
+
+    out.format = format;
+    return PCM_LOAD_OK;
+}
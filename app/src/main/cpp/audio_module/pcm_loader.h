@@ -0,0 +1,42 @@
+// pcm_loader.h
+#pragma once
+#include <string>
+
+#include "aligned_buffer.h"
+
+enum PcmLoadStatus {
+    PCM_LOAD_OK = 0,
+    PCM_LOAD_OPEN_FAILED,         // file missing or unreadable
+    PCM_LOAD_EMPTY,               // file opened but contained no complete sample
+    PCM_LOAD_UNSUPPORTED_FORMAT,  // WAV header with an encoding we cannot convert
+};
+
+enum PcmSampleFormat {
+    PCM_FORMAT_S16LE = 0,
+    PCM_FORMAT_F32LE,
+};
+
+struct PcmFormat {
+    int sample_rate = 16000;
+    int channels = 1;
+    PcmSampleFormat sample_format = PCM_FORMAT_S16LE;
+    bool from_header = false; // false: headerless raw file, the defaults above were assumed
+};
+
+// Float samples in [-1, 1), interleaved if format.channels > 1.
+struct PcmAudio {
+    AlignedFloatBuffer samples;
+    PcmFormat format;
+    std::string source_path; // file the samples came from, set by the audio cache; empty for buffers
+
+    size_t frame_count() const { return format.channels > 0 ? samples.size() / format.channels : 0; }
+    double duration_s() const { return format.sample_rate > 0 ? static_cast<double>(frame_count()) / format.sample_rate : 0.0; }
+};
+
+const char* pcm_sample_format_name(PcmSampleFormat format);
+
+// Memory-maps a PCM file and converts it to float. Accepts a RIFF/WAVE file
+// (16-bit integer or 32-bit float PCM, format taken from the header) or a
+// headerless raw file, which is treated as 16 kHz 16-bit mono as written by
+// older AudioPreprocessor versions. Long files are converted on several threads.
+PcmLoadStatus load_pcm_file(const std::string& path, PcmAudio& out);
@@ -0,0 +1,109 @@
+// pcm_stream.cpp
+#include "pcm_stream.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "pcm_convert.h"
+
+PcmStream::PcmStream(const PcmFormat& format, int target_rate, ResampleQuality quality)
+    : source_channels_(std::max(1, format.channels)),
+      bytes_per_sample_(format.sample_format == PCM_FORMAT_F32LE ? sizeof(float) : sizeof(int16_t)) {
+    audio_.format = format;
+    audio_.format.from_header = true; // described by the producer, not assumed
+    if (target_rate > 0 && (target_rate != format.sample_rate || source_channels_ != 1)) {
+        resampler_.reset(new StreamingResampler(format.sample_rate, target_rate, quality));
+        audio_.format.sample_rate = target_rate;
+        audio_.format.channels = 1;
+    }
+}
+
+// Converted samples land in staging_ when downmixing/resampling, else directly in the output.
+void PcmStream::append_s16(const int16_t* src, size_t n) {
+    AlignedFloatBuffer& dst = resampler_ ? staging_ : audio_.samples;
+    const size_t offset = dst.size();
+    dst.reserve(offset + n);
+    dst.resize(offset + n);
+    pcm_s16_to_f32(src, dst.data() + offset, n);
+}
+
+void PcmStream::append_f32(const float* src, size_t n) {
+    AlignedFloatBuffer& dst = resampler_ ? staging_ : audio_.samples;
+    const size_t offset = dst.size();
+    dst.reserve(offset + n);
+    dst.resize(offset + n);
+    std::memcpy(dst.data() + offset, src, n * sizeof(float));
+}
+
+void PcmStream::drain_staging() {
+    if (!resampler_) return;
+    const size_t channels = static_cast<size_t>(source_channels_);
+    const size_t frames = staging_.size() / channels;
+    if (frames > 0) {
+        downmix_to_mono(staging_.data(), frames, source_channels_, staging_.data());
+        resampler_->process(staging_.data(), frames, audio_.samples);
+    }
+    // keep a partial frame for the next push
+    const size_t leftover = staging_.size() - frames * channels;
+    std::memmove(staging_.data(), staging_.data() + frames * channels, leftover * sizeof(float));
+    staging_.resize(leftover);
+}
+
+void PcmStream::append_samples(const uint8_t* bytes, size_t n_samples) {
+    if (n_samples == 0) return;
+    if (bytes_per_sample_ == sizeof(float)) {
+        // memcpy does not care about alignment
+        append_f32(reinterpret_cast<const float*>(bytes), n_samples);
+        return;
+    }
+    if ((reinterpret_cast<uintptr_t>(bytes) & (alignof(int16_t) - 1)) == 0) {
+        append_s16(reinterpret_cast<const int16_t*>(bytes), n_samples);
+        return;
+    }
+    // Odd address (a split sample shifted the chunk): bounce through an aligned block.
+    int16_t block[1024];
+    while (n_samples > 0) {
+        const size_t n = n_samples < 1024 ? n_samples : 1024;
+        std::memcpy(block, bytes, n * sizeof(int16_t));
+        append_s16(block, n);
+        bytes += n * sizeof(int16_t);
+        n_samples -= n;
+    }
+}
+
+bool PcmStream::push(const void* data, size_t size) {
+    if (finished_) return false;
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+    // complete a sample split across the previous push
+    if (carry_size_ > 0) {
+        const size_t take = std::min(bytes_per_sample_ - carry_size_, size);
+        std::memcpy(carry_ + carry_size_, bytes, take);
+        carry_size_ += take;
+        bytes += take;
+        size -= take;
+        if (carry_size_ < bytes_per_sample_) return true;
+        append_samples(carry_, 1);
+        carry_size_ = 0;
+    }
+
+    const size_t n_samples = size / bytes_per_sample_;
+    append_samples(bytes, n_samples);
+    drain_staging();
+
+    carry_size_ = size - n_samples * bytes_per_sample_;
+    std::memcpy(carry_, bytes + n_samples * bytes_per_sample_, carry_size_);
+    return true;
+}
+
+PcmAudio PcmStream::finish() {
+    if (!finished_ && resampler_) {
+        drain_staging();
+        resampler_->flush(audio_.samples);
+    }
+    finished_ = true;
+    carry_size_ = 0;
+    const size_t channels = audio_.format.channels > 0 ? audio_.format.channels : 1;
+    audio_.samples.resize(audio_.samples.size() / channels * channels);
+    return std::move(audio_);
+}
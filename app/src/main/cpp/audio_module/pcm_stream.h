@@ -0,0 +1,47 @@
+// pcm_stream.h
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "pcm_loader.h"
+#include "resampler.h"
+
+// Accumulates PCM pushed in arbitrary-sized chunks (e.g. MediaCodec output
+// buffers) into one float buffer, converting as it goes. Chunks do not need to
+// end on a sample boundary; a split sample is carried into the next push.
+// Not thread-safe: push from one thread at a time.
+//
+// With a target_rate the stream downmixes to mono and resamples while pushing,
+// so only the converted audio is ever held in memory.
+class PcmStream {
+public:
+    explicit PcmStream(const PcmFormat& format, int target_rate = 0,
+                       ResampleQuality quality = resampler_default_quality());
+
+    // Converts and appends size bytes. Returns false if the stream was already finished.
+    bool push(const void* data, size_t size);
+
+    size_t sample_count() const { return audio_.samples.size(); }
+    // Format of the audio returned by finish() (mono at target_rate when converting).
+    const PcmFormat& format() const { return audio_.format; }
+
+    // Hands over the accumulated audio (dropping an incomplete trailing frame)
+    // and ends the stream.
+    PcmAudio finish();
+
+private:
+    void append_s16(const int16_t* src, size_t n);
+    void append_f32(const float* src, size_t n);
+    void append_samples(const uint8_t* bytes, size_t n_samples);
+    void drain_staging();
+
+    PcmAudio audio_;
+    int source_channels_;
+    std::unique_ptr<StreamingResampler> resampler_; // null when no conversion is needed
+    AlignedFloatBuffer staging_;                    // converted source samples awaiting downmix/resample
+    size_t bytes_per_sample_;
+    uint8_t carry_[sizeof(float)];
+    size_t carry_size_ = 0;
+    bool finished_ = false;
+};
@@ -0,0 +1,308 @@
+// real_fft.cpp
+#include "real_fft.h"
+
+#include <cassert>
+#include <cmath>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define REAL_FFT_NEON 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define REAL_FFT_SSE2 1
+#endif
+
+static constexpr double kPi = 3.14159265358979323846;
+
+namespace {
+
+// One complex value.
+struct Complex1 {
+    struct T { float re, im; };
+    static constexpr int kWidth = 1;
+
+    static T load(const float* p) { return {p[0], p[1]}; }
+    static void store(float* p, T v) { p[0] = v.re; p[1] = v.im; }
+    static T add(T a, T b) { return {a.re + b.re, a.im + b.im}; }
+    static T sub(T a, T b) { return {a.re - b.re, a.im - b.im}; }
+    static T scale(T a, float s) { return {a.re * s, a.im * s}; }
+    static T mul_neg_i(T a) { return {a.im, -a.re}; }
+    static T mul(T a, float wr, float wi) { return {a.re * wr - a.im * wi, a.re * wi + a.im * wr}; }
+};
+
+#if defined(REAL_FFT_NEON) || defined(REAL_FFT_SSE2)
+// Two adjacent complex values (re0, im0, re1, im1) in one register.
+struct Complex2 {
+#if defined(REAL_FFT_NEON)
+    using T = float32x4_t;
+    static T load(const float* p) { return vld1q_f32(p); }
+    static void store(float* p, T v) { vst1q_f32(p, v); }
+    static T add(T a, T b) { return vaddq_f32(a, b); }
+    static T sub(T a, T b) { return vsubq_f32(a, b); }
+    static T scale(T a, float s) { return vmulq_n_f32(a, s); }
+    static T swap(T a) { return vrev64q_f32(a); } // (im0, re0, im1, re1)
+    static T alternate(float even, float odd) {
+        const float v[4] = {even, odd, even, odd};
+        return vld1q_f32(v);
+    }
+    static T mul_neg_i(T a) { return vmulq_f32(swap(a), alternate(1.0f, -1.0f)); }
+    static T mul(T a, float wr, float wi) {
+#if defined(__aarch64__)
+        return vfmaq_f32(vmulq_n_f32(a, wr), swap(a), alternate(-wi, wi));
+#else
+        return vmlaq_f32(vmulq_n_f32(a, wr), swap(a), alternate(-wi, wi));
+#endif
+    }
+#else
+    using T = __m128;
+    static T load(const float* p) { return _mm_loadu_ps(p); }
+    static void store(float* p, T v) { _mm_storeu_ps(p, v); }
+    static T add(T a, T b) { return _mm_add_ps(a, b); }
+    static T sub(T a, T b) { return _mm_sub_ps(a, b); }
+    static T scale(T a, float s) { return _mm_mul_ps(a, _mm_set1_ps(s)); }
+    static T swap(T a) { return _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)); }
+    static T mul_neg_i(T a) { return _mm_mul_ps(swap(a), _mm_setr_ps(1.0f, -1.0f, 1.0f, -1.0f)); }
+    static T mul(T a, float wr, float wi) {
+        return _mm_add_ps(_mm_mul_ps(a, _mm_set1_ps(wr)), _mm_mul_ps(swap(a), _mm_setr_ps(-wi, wi, -wi, wi)));
+    }
+#endif
+    static constexpr int kWidth = 2;
+};
+#endif
+
+// Butterflies of one stage for stride positions [q0, q1). Index i of x and y
+// is complex element i, i.e. floats 2i and 2i + 1.
+//   y[q + s*(r*p + k)] = W_len^(p*k) * sum_j x[q + s*(p + j*m)] W_r^(j*k)
+template <class V>
+void radix2(const float* x, float* y, int m, int s, const float* tw, int q0, int q1) {
+    for (int p = 0; p < m; ++p) {
+        const float wr = tw[2 * p], wi = tw[2 * p + 1];
+        for (int q = q0; q < q1; q += V::kWidth) {
+            const auto a0 = V::load(x + 2 * (q + s * p));
+            const auto a1 = V::load(x + 2 * (q + s * (p + m)));
+            float* out = y + 2 * (q + s * 2 * p);
+            V::store(out, V::add(a0, a1));
+            V::store(out + 2 * s, V::mul(V::sub(a0, a1), wr, wi));
+        }
+    }
+}
+
+template <class V>
+void radix3(const float* x, float* y, int m, int s, const float* tw, int q0, int q1) {
+    const float c = -0.5f;                                // cos(2 pi / 3)
+    const float sn = static_cast<float>(std::sqrt(3.0) / 2); // sin(2 pi / 3)
+    for (int p = 0; p < m; ++p) {
+        const float* w = tw + 4 * p;
+        for (int q = q0; q < q1; q += V::kWidth) {
+            const auto a0 = V::load(x + 2 * (q + s * p));
+            const auto a1 = V::load(x + 2 * (q + s * (p + m)));
+            const auto a2 = V::load(x + 2 * (q + s * (p + 2 * m)));
+            const auto t1 = V::add(a1, a2);
+            const auto t2 = V::scale(V::mul_neg_i(V::sub(a1, a2)), sn);
+            const auto mid = V::add(a0, V::scale(t1, c));
+            float* out = y + 2 * (q + s * 3 * p);
+            V::store(out, V::add(a0, t1));
+            V::store(out + 2 * s, V::mul(V::add(mid, t2), w[0], w[1]));
+            V::store(out + 4 * s, V::mul(V::sub(mid, t2), w[2], w[3]));
+        }
+    }
+}
+
+template <class V>
+void radix4(const float* x, float* y, int m, int s, const float* tw, int q0, int q1) {
+    for (int p = 0; p < m; ++p) {
+        const float* w = tw + 6 * p;
+        for (int q = q0; q < q1; q += V::kWidth) {
+            const auto a0 = V::load(x + 2 * (q + s * p));
+            const auto a1 = V::load(x + 2 * (q + s * (p + m)));
+            const auto a2 = V::load(x + 2 * (q + s * (p + 2 * m)));
+            const auto a3 = V::load(x + 2 * (q + s * (p + 3 * m)));
+            const auto t0 = V::add(a0, a2);
+            const auto t1 = V::sub(a0, a2);
+            const auto t2 = V::add(a1, a3);
+            const auto t3 = V::mul_neg_i(V::sub(a1, a3));
+            float* out = y + 2 * (q + s * 4 * p);
+            V::store(out, V::add(t0, t2));
+            V::store(out + 2 * s, V::mul(V::add(t1, t3), w[0], w[1]));
+            V::store(out + 4 * s, V::mul(V::sub(t0, t2), w[2], w[3]));
+            V::store(out + 6 * s, V::mul(V::sub(t1, t3), w[4], w[5]));
+        }
+    }
+}
+
+template <class V>
+void radix5(const float* x, float* y, int m, int s, const float* tw, int q0, int q1) {
+    const float c1 = static_cast<float>(std::cos(2 * kPi / 5));
+    const float c2 = static_cast<float>(std::cos(4 * kPi / 5));
+    const float s1 = static_cast<float>(std::sin(2 * kPi / 5));
+    const float s2 = static_cast<float>(std::sin(4 * kPi / 5));
+    for (int p = 0; p < m; ++p) {
+        const float* w = tw + 8 * p;
+        for (int q = q0; q < q1; q += V::kWidth) {
+            const auto a0 = V::load(x + 2 * (q + s * p));
+            const auto a1 = V::load(x + 2 * (q + s * (p + m)));
+            const auto a2 = V::load(x + 2 * (q + s * (p + 2 * m)));
+            const auto a3 = V::load(x + 2 * (q + s * (p + 3 * m)));
+            const auto a4 = V::load(x + 2 * (q + s * (p + 4 * m)));
+            const auto t1 = V::add(a1, a4);
+            const auto t2 = V::add(a2, a3);
+            const auto t3 = V::mul_neg_i(V::sub(a1, a4));
+            const auto t4 = V::mul_neg_i(V::sub(a2, a3));
+            const auto m1 = V::add(a0, V::add(V::scale(t1, c1), V::scale(t2, c2)));
+            const auto m2 = V::add(a0, V::add(V::scale(t1, c2), V::scale(t2, c1)));
+            const auto n1 = V::add(V::scale(t3, s1), V::scale(t4, s2));
+            const auto n2 = V::sub(V::scale(t3, s2), V::scale(t4, s1));
+            float* out = y + 2 * (q + s * 5 * p);
+            V::store(out, V::add(a0, V::add(t1, t2)));
+            V::store(out + 2 * s, V::mul(V::add(m1, n1), w[0], w[1]));
+            V::store(out + 4 * s, V::mul(V::add(m2, n2), w[2], w[3]));
+            V::store(out + 6 * s, V::mul(V::sub(m2, n2), w[4], w[5]));
+            V::store(out + 8 * s, V::mul(V::sub(m1, n1), w[6], w[7]));
+        }
+    }
+}
+
+// Any other (prime) radix, straight from the definition; roots are W_r^t.
+void radix_any(const float* x, float* y, int r, int m, int s, const float* tw, const float* roots) {
+    for (int p = 0; p < m; ++p) {
+        for (int q = 0; q < s; ++q) {
+            for (int k = 0; k < r; ++k) {
+                float re = 0.0f, im = 0.0f;
+                for (int j = 0; j < r; ++j) {
+                    const float* a = x + 2 * (q + s * (p + j * m));
+                    const float* w = roots + 2 * ((j * k) % r);
+                    re += a[0] * w[0] - a[1] * w[1];
+                    im += a[0] * w[1] + a[1] * w[0];
+                }
+                Complex1::T b = {re, im};
+                if (k > 0) {
+                    const float* w = tw + 2 * (p * (r - 1) + k - 1);
+                    b = Complex1::mul(b, w[0], w[1]);
+                }
+                Complex1::store(y + 2 * (q + s * (r * p + k)), b);
+            }
+        }
+    }
+}
+
+template <class V>
+void run_radix(int radix, const float* x, float* y, int m, int s, const float* tw, int q0, int q1) {
+    switch (radix) {
+        case 2: radix2<V>(x, y, m, s, tw, q0, q1); break;
+        case 3: radix3<V>(x, y, m, s, tw, q0, q1); break;
+        case 4: radix4<V>(x, y, m, s, tw, q0, q1); break;
+        case 5: radix5<V>(x, y, m, s, tw, q0, q1); break;
+    }
+}
+
+void push_complex(std::vector<float>& v, double angle) {
+    v.push_back(static_cast<float>(std::cos(angle)));
+    v.push_back(static_cast<float>(std::sin(angle)));
+}
+
+} // namespace
+
+RealFft::RealFft(int n) : n_(n), half_(n / 2) {
+    assert(n >= 2 && n % 2 == 0);
+
+    // radix 4 first: fewest stages and the cheapest butterfly per point
+    std::vector<int> radices;
+    int rest = half_;
+    for (int r : {4, 2, 3, 5}) {
+        while (rest % r == 0) {
+            radices.push_back(r);
+            rest /= r;
+        }
+    }
+    for (int r = 7; rest > 1; r += 2) {
+        while (rest % r == 0) {
+            radices.push_back(r);
+            rest /= r;
+        }
+    }
+
+    int len = half_;
+    int stride = 1;
+    for (int r : radices) {
+        Stage stage;
+        stage.radix = r;
+        stage.m = len / r;
+        stage.stride = stride;
+        stage.twiddles = twiddles_.size() / 2;
+        stage.roots = roots_.size() / 2;
+        for (int p = 0; p < stage.m; ++p) {
+            for (int k = 1; k < r; ++k) {
+                push_complex(twiddles_, -2 * kPi * p * k / len);
+            }
+        }
+        if (r > 5) {
+            for (int t = 0; t < r; ++t) {
+                push_complex(roots_, -2 * kPi * t / r);
+            }
+        }
+        stages_.push_back(stage);
+        len /= r;
+        stride *= r;
+    }
+
+    for (int k = 0; k <= half_; ++k) {
+        push_complex(split_, -2 * kPi * k / n_);
+    }
+}
+
+const float* RealFft::transform(const float* in, float* a, float* b) const {
+    const float* x = in;
+    float* y = a;
+    for (const Stage& stage : stages_) {
+        const float* tw = twiddles_.data() + 2 * stage.twiddles;
+        const int s = stage.stride;
+        if (stage.radix > 5) {
+            radix_any(x, y, stage.radix, stage.m, s, tw, roots_.data() + 2 * stage.roots);
+        } else {
+#if defined(REAL_FFT_NEON) || defined(REAL_FFT_SSE2)
+            const int vectorized = s - s % Complex2::kWidth;
+            run_radix<Complex2>(stage.radix, x, y, stage.m, s, tw, 0, vectorized);
+            run_radix<Complex1>(stage.radix, x, y, stage.m, s, tw, vectorized, s);
+#else
+            run_radix<Complex1>(stage.radix, x, y, stage.m, s, tw, 0, s);
+#endif
+        }
+        x = y;
+        y = y == a ? b : a;
+    }
+    return x;
+}
+
+// With Z = FFT of z[t] = in[2t] + i in[2t + 1] (h = n/2 points), the spectra of
+// the even and odd samples are E[k] = (Z[k] + conj Z[h-k]) / 2 and
+// O[k] = -i (Z[k] - conj Z[h-k]) / 2, and X[k] = E[k] + W_n^k O[k].
+void RealFft::forward(const float* in, float* out, float* scratch) const {
+    const float* z = transform(in, scratch, scratch + n_);
+    for (int k = 0; k <= half_; ++k) {
+        const float* zk = z + 2 * (k % half_);
+        const float* zc = z + 2 * ((half_ - k) % half_);
+        const float er = 0.5f * (zk[0] + zc[0]);
+        const float ei = 0.5f * (zk[1] - zc[1]);
+        const float or_ = 0.5f * (zk[1] + zc[1]);
+        const float oi = -0.5f * (zk[0] - zc[0]);
+        const float wr = split_[2 * k], wi = split_[2 * k + 1];
+        out[2 * k] = er + wr * or_ - wi * oi;
+        out[2 * k + 1] = ei + wr * oi + wi * or_;
+    }
+}
+
+void RealFft::power(const float* in, float* out, float* scratch) const {
+    const float* z = transform(in, scratch, scratch + n_);
+    for (int k = 0; k <= half_; ++k) {
+        const float* zk = z + 2 * (k % half_);
+        const float* zc = z + 2 * ((half_ - k) % half_);
+        const float er = 0.5f * (zk[0] + zc[0]);
+        const float ei = 0.5f * (zk[1] - zc[1]);
+        const float or_ = 0.5f * (zk[1] + zc[1]);
+        const float oi = -0.5f * (zk[0] - zc[0]);
+        const float wr = split_[2 * k], wi = split_[2 * k + 1];
+        const float re = er + wr * or_ - wi * oi;
+        const float im = ei + wr * oi + wi * or_;
+        out[k] = re * re + im * im;
+    }
+}
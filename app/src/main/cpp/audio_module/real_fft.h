@@ -0,0 +1,52 @@
+// real_fft.h
+#pragma once
+#include <cstddef>
+#include <vector>
+
+// FFT of real input of even length n, e.g. one 400-sample STFT frame.
+//
+// The n real samples are read as n/2 complex ones (even samples real, odd
+// imaginary), transformed by a mixed-radix (4, 2, 3, 5, then any prime)
+// Stockham FFT, and split into the n/2 + 1 non-negative frequency bins. All
+// twiddles are computed at construction, so a transform neither allocates nor
+// calls sin/cos; 400 = 2 x 200 = 2 x (4 x 2 x 5 x 5). Stages with a stride of
+// two or more run their butterflies on two complex values per SIMD register.
+//
+// A plan is immutable and may be shared between threads; each thread passes
+// its own scratch.
+class RealFft {
+public:
+    explicit RealFft(int n);
+
+    int size() const { return n_; }
+    int bins() const { return n_ / 2 + 1; }
+
+    // Floats of scratch a transform needs.
+    size_t scratch_size() const { return static_cast<size_t>(2 * n_); }
+
+    // out: bins() complex values, interleaved (re, im). in is not modified and
+    // must not overlap out or scratch.
+    void forward(const float* in, float* out, float* scratch) const;
+
+    // out: |X[k]|^2 for the bins() frequencies.
+    void power(const float* in, float* out, float* scratch) const;
+
+private:
+    struct Stage {
+        int radix;
+        int m;                 // butterflies per stride position (sub-length / radix)
+        int stride;            // product of the radices before this stage
+        size_t twiddles;       // offset in twiddles_: W_len^(p*k), p < m, 1 <= k < radix
+        size_t roots;          // offset in roots_ (other radices): W_radix^t, t < radix
+    };
+
+    // Complex FFT of n/2 points; returns the buffer holding the result (a or b).
+    const float* transform(const float* in, float* a, float* b) const;
+
+    int n_;
+    int half_;
+    std::vector<Stage> stages_;
+    std::vector<float> twiddles_; // interleaved (re, im)
+    std::vector<float> roots_;
+    std::vector<float> split_;    // W_n^k for k <= n/2, to separate even and odd halves
+};
@@ -0,0 +1,281 @@
+// resampler.cpp
+#include "resampler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define RESAMPLER_NEON 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define RESAMPLER_SSE2 1
+#endif
+
+// Coefficient table is phases x taps; rates with a larger L (after gcd
+// reduction) get their sub-sample phase quantized to this many steps.
+static constexpr int64_t kMaxPhases = 1024;
+
+static constexpr double kPi = 3.14159265358979323846;
+
+static std::atomic<int> g_default_quality{RESAMPLE_QUALITY_BALANCED};
+
+void resampler_set_default_quality(ResampleQuality quality) {
+    g_default_quality.store(quality, std::memory_order_relaxed);
+}
+
+ResampleQuality resampler_default_quality() {
+    return static_cast<ResampleQuality>(g_default_quality.load(std::memory_order_relaxed));
+}
+
+bool resample_quality_from_name(const char* name, ResampleQuality& quality) {
+    if (name == nullptr) return false;
+    if (std::strcmp(name, "fast") == 0) { quality = RESAMPLE_QUALITY_FAST; return true; }
+    if (std::strcmp(name, "balanced") == 0) { quality = RESAMPLE_QUALITY_BALANCED; return true; }
+    if (std::strcmp(name, "high") == 0) { quality = RESAMPLE_QUALITY_HIGH; return true; }
+    return false;
+}
+
+const char* resample_quality_name(ResampleQuality quality) {
+    switch (quality) {
+        case RESAMPLE_QUALITY_FAST: return "fast";
+        case RESAMPLE_QUALITY_BALANCED: return "balanced";
+        case RESAMPLE_QUALITY_HIGH: return "high";
+    }
+    return "unknown";
+}
+
+// Zeroth-order modified Bessel function of the first kind (Kaiser window).
+static double bessel_i0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    const double q = x * x / 4.0;
+    for (int k = 1; k < 64; ++k) {
+        term *= q / (static_cast<double>(k) * k);
+        sum += term;
+        if (term < sum * 1e-12) break;
+    }
+    return sum;
+}
+
+// n is a multiple of 4. b may be unaligned.
+static inline float dot_product(const float* a, const float* b, size_t n) {
+#if defined(RESAMPLER_NEON)
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+#if defined(__aarch64__)
+        acc0 = vfmaq_f32(acc0, vld1q_f32(a + i),     vld1q_f32(b + i));
+        acc1 = vfmaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+#else
+        acc0 = vmlaq_f32(acc0, vld1q_f32(a + i),     vld1q_f32(b + i));
+        acc1 = vmlaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+#endif
+    }
+    for (; i < n; i += 4) {
+        acc0 = vmlaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+    }
+    acc0 = vaddq_f32(acc0, acc1);
+#if defined(__aarch64__)
+    return vaddvq_f32(acc0);
+#else
+    float32x2_t s = vadd_f32(vget_low_f32(acc0), vget_high_f32(acc0));
+    return vget_lane_f32(vpadd_f32(s, s), 0);
+#endif
+#elif defined(RESAMPLER_SSE2)
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_load_ps(a + i),     _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_load_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    for (; i < n; i += 4) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_load_ps(a + i), _mm_loadu_ps(b + i)));
+    }
+    acc0 = _mm_add_ps(acc0, acc1);
+    __m128 shuf = _mm_shuffle_ps(acc0, acc0, _MM_SHUFFLE(2, 3, 0, 1));
+    __m128 sums = _mm_add_ps(acc0, shuf);
+    shuf = _mm_movehl_ps(shuf, sums);
+    return _mm_cvtss_f32(_mm_add_ss(sums, shuf));
+#else
+    float acc = 0.0f;
+    for (size_t i = 0; i < n; ++i) acc += a[i] * b[i];
+    return acc;
+#endif
+}
+
+StreamingResampler::StreamingResampler(int in_rate, int out_rate, ResampleQuality quality) {
+    const int64_t g = std::gcd<int64_t, int64_t>(in_rate, out_rate);
+    up_ = out_rate / g;
+    down_ = in_rate / g;
+    taps_ = 0;
+    phases_ = 0;
+    if (passthrough()) return;
+
+    const int zero_crossings = static_cast<int>(quality);
+    const double rolloff = quality == RESAMPLE_QUALITY_FAST ? 0.90 : quality == RESAMPLE_QUALITY_HIGH ? 0.97 : 0.94;
+    const double beta = quality == RESAMPLE_QUALITY_FAST ? 6.0 : quality == RESAMPLE_QUALITY_HIGH ? 10.0 : 8.6;
+
+    // Cutoff relative to the input Nyquist rate; below 1 when decimating so the
+    // kernel also acts as the anti-aliasing low-pass.
+    const double cutoff = std::min(1.0, static_cast<double>(up_) / down_) * rolloff;
+    const double half_width = zero_crossings / cutoff; // in input samples
+    taps_ = static_cast<size_t>(2 * std::ceil(half_width));
+    taps_ = (taps_ + 3) & ~static_cast<size_t>(3);
+    phases_ = static_cast<size_t>(std::min(up_, kMaxPhases));
+
+    coeffs_.resize(phases_ * taps_);
+    const double half = static_cast<double>(taps_) / 2.0;
+    const double i0_beta = bessel_i0(beta);
+    for (size_t p = 0; p < phases_; ++p) {
+        const double frac = static_cast<double>(p) / phases_;
+        float* row = coeffs_.data() + p * taps_;
+        double sum = 0.0;
+        for (size_t k = 0; k < taps_; ++k) {
+            // distance from the output instant to input sample (base + k)
+            const double d = (static_cast<double>(k) - (half - 1.0)) - frac;
+            const double r = d / half;
+            const double window = std::fabs(r) < 1.0 ? bessel_i0(beta * std::sqrt(1.0 - r * r)) / i0_beta : 0.0;
+            const double x = kPi * cutoff * d;
+            const double sinc = std::fabs(x) < 1e-12 ? 1.0 : std::sin(x) / x;
+            const double h = cutoff * sinc * window;
+            row[k] = static_cast<float>(h);
+            sum += h;
+        }
+        // unity DC gain per phase
+        const float norm = sum != 0.0 ? static_cast<float>(1.0 / sum) : 1.0f;
+        for (size_t k = 0; k < taps_; ++k) row[k] *= norm;
+    }
+
+    // history before the first sample is silence
+    pending_.assign(taps_ / 2 - 1, 0.0f);
+}
+
+void StreamingResampler::run(AlignedFloatBuffer& out, uint64_t max_total_out) {
+    if (pending_.size() < taps_ + next_base_) return;
+
+    const size_t available = pending_.size() - taps_ - next_base_ + 1;
+    const size_t estimate = static_cast<size_t>((available * up_) / down_) + 2;
+    size_t write = out.size();
+    out.reserve(write + estimate);
+    out.resize(write + estimate);
+
+    while (next_base_ + taps_ <= pending_.size() && total_out_ < max_total_out) {
+        if (write == out.size()) {
+            out.reserve(write + estimate);
+            out.resize(write + estimate);
+        }
+        const size_t phase = static_cast<int64_t>(phases_) == up_
+                ? static_cast<size_t>(next_frac_)
+                : static_cast<size_t>((next_frac_ * static_cast<int64_t>(phases_)) / up_);
+        out[write++] = dot_product(coeffs_.data() + phase * taps_, pending_.data() + next_base_, taps_);
+        ++total_out_;
+
+        next_frac_ += down_;
+        next_base_ += static_cast<size_t>(next_frac_ / up_);
+        next_frac_ %= up_;
+    }
+    out.resize(write);
+
+    // drop input that no future output can reach
+    const size_t consumed = std::min(next_base_, pending_.size());
+    pending_.erase(pending_.begin(), pending_.begin() + consumed);
+    next_base_ -= consumed;
+}
+
+void StreamingResampler::process(const float* in, size_t n, AlignedFloatBuffer& out) {
+    total_in_ += n;
+    if (passthrough()) {
+        const size_t offset = out.size();
+        out.reserve(offset + n);
+        out.resize(offset + n);
+        std::memcpy(out.data() + offset, in, n * sizeof(float));
+        total_out_ += n;
+        return;
+    }
+    pending_.insert(pending_.end(), in, in + n);
+    run(out, UINT64_MAX);
+}
+
+void StreamingResampler::flush(AlignedFloatBuffer& out) {
+    if (passthrough()) return;
+    pending_.insert(pending_.end(), taps_ / 2, 0.0f);
+    const uint64_t expected = (total_in_ * static_cast<uint64_t>(up_) + down_ - 1) / static_cast<uint64_t>(down_);
+    run(out, expected);
+}
+
+void downmix_to_mono(const float* in, size_t frames, int channels, float* out) {
+    if (channels == 1) {
+        if (out != in) std::memcpy(out, in, frames * sizeof(float));
+        return;
+    }
+
+    size_t i = 0;
+    if (channels == 2) {
+#if defined(RESAMPLER_NEON)
+        const float32x4_t half = vdupq_n_f32(0.5f);
+        for (; i + 4 <= frames; i += 4) {
+            float32x4x2_t lr = vld2q_f32(in + 2 * i);
+            vst1q_f32(out + i, vmulq_f32(vaddq_f32(lr.val[0], lr.val[1]), half));
+        }
+#elif defined(RESAMPLER_SSE2)
+        const __m128 half = _mm_set1_ps(0.5f);
+        for (; i + 4 <= frames; i += 4) {
+            __m128 a = _mm_loadu_ps(in + 2 * i);     // L0 R0 L1 R1
+            __m128 b = _mm_loadu_ps(in + 2 * i + 4); // L2 R2 L3 R3
+            __m128 l = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+            __m128 r = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+            _mm_storeu_ps(out + i, _mm_mul_ps(_mm_add_ps(l, r), half));
+        }
+#endif
+        for (; i < frames; ++i) {
+            out[i] = 0.5f * (in[2 * i] + in[2 * i + 1]);
+        }
+        return;
+    }
+
+    const float scale = 1.0f / static_cast<float>(channels);
+    for (; i < frames; ++i) {
+        const float* frame = in + i * channels;
+        float acc = 0.0f;
+        for (int c = 0; c < channels; ++c) acc += frame[c];
+        out[i] = acc * scale;
+    }
+}
+
+const PcmAudio& conform_audio(const PcmAudio& audio, int sample_rate, PcmAudio& storage, ResampleQuality quality) {
+    const int channels = std::max(1, audio.format.channels);
+    if (audio.format.sample_rate == sample_rate && channels == 1) {
+        return audio;
+    }
+
+    storage.format = audio.format;
+    storage.format.sample_rate = sample_rate;
+    storage.format.channels = 1;
+    storage.samples.clear();
+
+    // Work in blocks so a long multi-channel file never needs a second full-size copy.
+    static constexpr size_t kBlockFrames = 1 << 15;
+    StreamingResampler resampler(audio.format.sample_rate, sample_rate, quality);
+    storage.samples.reserve(static_cast<size_t>(
+            static_cast<double>(audio.frame_count()) * sample_rate / audio.format.sample_rate) + 1);
+
+    AlignedFloatBuffer mono(channels > 1 ? kBlockFrames : 0);
+    const size_t frames = audio.frame_count();
+    for (size_t start = 0; start < frames; start += kBlockFrames) {
+        const size_t n = std::min(kBlockFrames, frames - start);
+        const float* block = audio.samples.data() + start * channels;
+        if (channels > 1) {
+            downmix_to_mono(block, n, channels, mono.data());
+            block = mono.data();
+        }
+        resampler.process(block, n, storage.samples);
+    }
+    resampler.flush(storage.samples);
+    return storage;
+}
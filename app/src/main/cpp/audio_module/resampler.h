@@ -0,0 +1,65 @@
+// resampler.h
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "aligned_buffer.h"
+#include "pcm_loader.h"
+
+// Speed/quality trade-off of the anti-aliasing filter. The value is the number
+// of sinc zero crossings on each side of the kernel; the filter length in input
+// samples grows with it (and with the decimation ratio).
+enum ResampleQuality {
+    RESAMPLE_QUALITY_FAST = 4,
+    RESAMPLE_QUALITY_BALANCED = 8,
+    RESAMPLE_QUALITY_HIGH = 16,
+};
+
+// Process-wide quality used when none is given explicitly. Defaults to BALANCED.
+void resampler_set_default_quality(ResampleQuality quality);
+ResampleQuality resampler_default_quality();
+
+// Parses "fast" / "balanced" / "high"; false if the name is unknown.
+bool resample_quality_from_name(const char* name, ResampleQuality& quality);
+const char* resample_quality_name(ResampleQuality quality);
+
+// Streaming polyphase FIR resampler for mono float audio. Input can be pushed
+// in chunks of any size; output is appended to the caller's buffer. The
+// filter is a Kaiser-windowed sinc evaluated once per phase at construction.
+class StreamingResampler {
+public:
+    StreamingResampler(int in_rate, int out_rate, ResampleQuality quality = resampler_default_quality());
+
+    // Appends the output that n new input samples make available.
+    void process(const float* in, size_t n, AlignedFloatBuffer& out);
+
+    // Drains the filter delay line. Total output is then ceil(n_in * out_rate / in_rate).
+    void flush(AlignedFloatBuffer& out);
+
+    bool passthrough() const { return up_ == down_; }
+    size_t taps() const { return taps_; }
+
+private:
+    void run(AlignedFloatBuffer& out, uint64_t max_total_out);
+
+    int64_t up_;    // L: interpolation factor (out_rate / gcd)
+    int64_t down_;  // M: decimation factor (in_rate / gcd)
+    size_t taps_;   // filter length per phase, a multiple of 4 for the SIMD kernel
+    size_t phases_; // min(L, kMaxPhases); phases beyond that are quantized
+    AlignedFloatBuffer coeffs_; // phases_ x taps_, row-major
+
+    std::vector<float> pending_; // input not yet fully consumed, preceded by the filter history
+    size_t next_base_ = 0;       // index in pending_ of the first tap of the next output
+    int64_t next_frac_ = 0;      // sub-sample position of the next output, in 1/L input samples
+    uint64_t total_in_ = 0;
+    uint64_t total_out_ = 0;
+};
+
+// Averages interleaved channels into mono. out may equal in (in-place downmix).
+void downmix_to_mono(const float* in, size_t frames, int channels, float* out);
+
+// Returns audio unchanged if it already has the given rate and one channel;
+// otherwise downmixes/resamples it into storage and returns storage.
+const PcmAudio& conform_audio(const PcmAudio& audio, int sample_rate, PcmAudio& storage,
+                              ResampleQuality quality = resampler_default_quality());
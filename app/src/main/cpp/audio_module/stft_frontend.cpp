@@ -0,0 +1,113 @@
+// stft_frontend.cpp
+#include "stft_frontend.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "mel_filterbank.h"
+#include "platform/cpu_topology.h"
+#include "platform/worker_pool.h"
+
+namespace {
+
+constexpr size_t kFramesPerTask = 500; // 5 s; the cancel flag is polled per task
+
+} // namespace
+
+const StftFrontend& StftFrontend::get() {
+    static const StftFrontend instance;
+    return instance;
+}
+
+std::vector<float> StftFrontend::hann(int length) {
+    // cosf on the double argument, like whisper's window
+    std::vector<float> window(length);
+    for (int i = 0; i < length; i++) {
+        window[i] = 0.5 * (1.0 - cosf((2.0 * M_PI * i) / length));
+    }
+    return window;
+}
+
+StftFrontend::StftFrontend() : window_(hann(kFrameSize)), window_energy_(0.0), fft_(kFrameSize) {
+    for (float w : window_) window_energy_ += static_cast<double>(w) * w;
+}
+
+void StftFrontend::frame_samples(const float* samples, int64_t first, int64_t n_samples, int64_t i, float* out) const {
+    const int64_t pad = kFrameSize / 2;
+    const int64_t offset = i * kHop; // in the padded recording
+    const float* w = window_.data();
+    if (offset >= pad && offset - pad + kFrameSize <= n_samples) {
+        const float* src = samples + (offset - pad - first);
+        for (int j = 0; j < kFrameSize; j++) {
+            out[j] = w[j] * src[j];
+        }
+        return;
+    }
+    for (int j = 0; j < kFrameSize; j++) {
+        const int64_t p = offset + j;
+        const int64_t k = p < pad ? pad - p : p - pad;
+        out[j] = k < n_samples ? w[j] * samples[k - first] : 0.0f;
+    }
+}
+
+void StftFrontend::frame_power(const float* samples, int64_t first, int64_t n_samples, int64_t i, float* power, float* scratch) const {
+    frame_samples(samples, first, n_samples, i, scratch);
+    fft_.power(scratch, power, scratch + kFrameSize);
+}
+
+float StftFrontend::energy_db(const float* power) const {
+    // sum_n x[n]^2 = (|X_0|^2 + 2 sum_{0<k<N/2} |X_k|^2 + |X_N/2|^2) / N
+    double sum = 0.0;
+    for (int k = 1; k < kBins - 1; ++k) sum += power[k];
+    sum = 2.0 * sum + power[0] + power[kBins - 1];
+    const double mean_square = sum / kFrameSize / window_energy_;
+    return 10.0f * std::log10(static_cast<float>(mean_square) + 1e-10f);
+}
+
+void StftStream::push(const float* samples, size_t n) {
+    tail_.insert(tail_.end(), samples, samples + n);
+    n_samples_ += static_cast<int64_t>(n);
+}
+
+int64_t StftStream::n_complete() const {
+    // frame i is final once samples up to i*kHop + kFrameSize/2 (and, for the
+    // reflected first frames, sample kFrameSize/2) have arrived
+    const int64_t pad = StftFrontend::kFrameSize / 2;
+    return n_samples_ > pad ? (n_samples_ - pad) / StftFrontend::kHop + 1 : 0;
+}
+
+void StftStream::frame_power(int64_t i, float* power, float* scratch) const {
+    StftFrontend::get().frame_power(tail_.data(), tail_start_, n_samples_, i, power, scratch);
+}
+
+void StftStream::release_frames_before(int64_t frame) {
+    const int64_t keep_from = std::min(n_samples_, std::max<int64_t>(0, frame * StftFrontend::kHop - StftFrontend::kFrameSize / 2));
+    if (keep_from > tail_start_) {
+        tail_.erase(tail_.begin(), tail_.begin() + (keep_from - tail_start_));
+        tail_start_ = keep_from;
+    }
+}
+
+bool analyze_spectrum(const float* samples, size_t n_samples, const SparseMelFilterbank* mel, SpectralFeatures& out,
+                      const std::atomic<bool>* cancel) {
+    const StftFrontend& stft = StftFrontend::get();
+    out.n_frames = StftFrontend::frame_count(n_samples);
+    out.energy_db.assign(out.n_frames, 0.0f);
+    out.n_mel = mel != nullptr ? mel->n_mel() : 0;
+    out.log_mel.assign(out.n_frames * out.n_mel, 0.0f);
+
+    const int n_tasks = static_cast<int>((out.n_frames + kFramesPerTask - 1) / kFramesPerTask);
+    worker_pool().parallel_for(n_tasks, current_thread_plan().n_threads, [&](int task) {
+        if (cancel != nullptr && cancel->load(std::memory_order_relaxed)) return;
+        std::vector<float> power(StftFrontend::kBins), scratch(stft.scratch_size());
+        const size_t end = std::min(out.n_frames, (task + 1) * kFramesPerTask);
+        for (size_t f = task * kFramesPerTask; f < end; ++f) {
+            stft.frame_power(samples, 0, static_cast<int64_t>(n_samples), static_cast<int64_t>(f), power.data(), scratch.data());
+            out.energy_db[f] = stft.energy_db(power.data());
+            if (out.n_mel > 0) {
+                mel->apply_log10(power.data(), out.log_mel.data() + f * out.n_mel);
+            }
+        }
+    });
+    return cancel == nullptr || !cancel->load(std::memory_order_relaxed);
+}
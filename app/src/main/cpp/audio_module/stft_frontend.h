@@ -0,0 +1,101 @@
+// stft_frontend.h
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "real_fft.h"
+
+// Short-time power spectra on whisper's frame grid: a 400-sample periodic Hann
+// window every 160 samples (25 ms every 10 ms at 16 kHz). Frame i is centred on
+// sample 160 i; the audio is reflected before its start and zero past its end.
+//
+// This is the one spectral front-end of the native code. analyze_spectrum()
+// computes each frame's spectrum once and derives the VAD's frame energies and
+// whisper's log mel frames from it; whisper's own spectrogram code reads its
+// frames from the same front-end when it is given samples.
+class StftFrontend {
+public:
+    static constexpr int kSampleRate = 16000;
+    static constexpr int kFrameSize = 400;
+    static constexpr int kHop = 160;
+    static constexpr int kBins = kFrameSize / 2 + 1;
+
+    // Process-wide instance. Immutable, so threads share it.
+    static const StftFrontend& get();
+
+    // Periodic Hann window of the given length, as torch.hann_window computes it.
+    static std::vector<float> hann(int length);
+
+    // Frames whose centre lies in n_samples of audio.
+    static size_t frame_count(size_t n_samples) { return (n_samples + kHop - 1) / kHop; }
+
+    const float* window() const { return window_.data(); }
+
+    // Floats of scratch frame_power() needs.
+    size_t scratch_size() const { return kFrameSize + fft_.scratch_size(); }
+
+    // Windowed samples of frame i of an n_samples recording. samples points at
+    // sample `first`; the frame must not reach back before it.
+    void frame_samples(const float* samples, int64_t first, int64_t n_samples, int64_t i, float* out) const;
+
+    // |X[k]|^2 of frame i, kBins values.
+    void frame_power(const float* samples, int64_t first, int64_t n_samples, int64_t i, float* power, float* scratch) const;
+
+    // Mean square of the frame's windowed samples over the window's own energy,
+    // in dB (10 log10(e + 1e-10)), from the frame's power spectrum (Parseval).
+    float energy_db(const float* power) const;
+
+private:
+    StftFrontend();
+
+    std::vector<float> window_;
+    double window_energy_; // sum of the squared window
+    RealFft fft_;
+};
+
+// The frames of audio that arrives in pieces (whisper_mel_stream). Holds only
+// the samples that frames not yet released overlap, fewer than kFrameSize once
+// the complete frames are released, so a push costs the frames it completes
+// and never the audio before them.
+class StftStream {
+public:
+    // Appends samples.
+    void push(const float* samples, size_t n);
+
+    int64_t n_samples() const { return n_samples_; }
+    size_t held_samples() const { return tail_.size(); }
+
+    // Frames whose samples have all arrived, which later pushes leave unchanged.
+    int64_t n_complete() const;
+
+    // |X[k]|^2 of frame i, as StftFrontend::frame_power gives it for the audio
+    // pushed so far. i must not be before a released frame.
+    void frame_power(int64_t i, float* power, float* scratch) const;
+
+    // Drops the samples that only frames before `frame` read.
+    void release_frames_before(int64_t frame);
+
+private:
+    int64_t n_samples_ = 0;
+    int64_t tail_start_ = 0; // index of tail_[0] in the pushed samples
+    std::vector<float> tail_;
+};
+
+class SparseMelFilterbank;
+
+// What one pass over a recording keeps of each frame's spectrum.
+struct SpectralFeatures {
+    size_t n_frames = 0;
+    std::vector<float> energy_db;   // per frame, for process_energies_for_vad
+    int n_mel = 0;
+    std::vector<float> log_mel;     // n_frames x n_mel, log10 (SparseMelFilterbank::apply_log10)
+};
+
+// Computes the spectrum of each of the frame_count(n_samples) frames of 16 kHz
+// samples once, on the worker pool, and derives the frame energies and, if mel
+// is set, the frames' log10 mel energies (whisper's spectrogram frames, given
+// whisper's filterbank) from it. Returns false if cancel became true.
+bool analyze_spectrum(const float* samples, size_t n_samples, const SparseMelFilterbank* mel, SpectralFeatures& out,
+                      const std::atomic<bool>* cancel = nullptr);
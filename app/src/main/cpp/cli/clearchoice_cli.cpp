@@ -0,0 +1,714 @@
+// clearchoice_cli.cpp
+//
+// Host-side driver for the native pipeline. Runs the same code as
+// WhisperService.transcribeFile and DiarizationService.diarizeAudio on a WAV
+// or raw PCM file and prints per-stage timings, so the pipeline can be
+// profiled with perf, valgrind and the sanitizers off-device.
+//
+//   clearchoice-cli -m ggml-tiny.en-q8.bin -f temp_audio.wav
+//   clearchoice-cli -f temp_audio.wav --mode diarize -r 5
+
+#include <algorithm>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#include "whisper/whisper.h"
+#include "audio_module/audio_cache.h"
+#include "audio_module/real_fft.h"
+#include "audio_module/resampler.h"
+#include "engine_module/cancellation.h"
+#include "engine_module/transcriber.h"
+#include "engine_module/diarizer.h"
+#include "engine_module/encoder_cache.h"
+#include "engine_module/job_scheduler.h"
+#include "engine_module/model_registry.h"
+#include "engine_module/parallel_transcriber.h"
+#include "engine_module/rtf_governor.h"
+#include "engine_module/session_pipeline.h"
+#include "engine_module/stage_timer.h"
+#include "engine_module/transcript_layout.h"
+#include "engine_module/transcription_listener.h"
+#include "engine_module/whisper_threading.h"
+#include "platform/cpu_dispatch.h"
+#include "platform/cpu_topology.h"
+#include "platform/native_log.h"
+
+#define TAG "CLEARCHOICE_CLI"
+
+// Ctrl-C cancels the running job instead of killing the process, so the model
+// and audio cache are still released on the way out.
+static CancellationToken g_cancel;
+
+struct CliOptions {
+    std::string model_path;
+    std::string audio_path;
+    bool run_transcribe = true;
+    bool run_diarize = true;
+    bool run_session = false;
+    bool run_queue = false;
+    bool bench_resample = false;
+    bool bench_fft = false;
+    bool bench_mel_stream = false;
+    bool mel_f16 = false;
+    bool compare_mel_f16 = false;
+    bool show_topology = false;
+    std::string sysfs_root = "/sys/devices/system/cpu";
+    bool live = false;
+    int repeat = 1;
+    bool verbose = false;
+    bool quiet = false;
+};
+
+static void print_usage(const char* argv0) {
+    fprintf(stderr,
+            "usage: %s -f <pcm file> [-m <model>] [options]\n"
+            "\n"
+            "  -f, --file <path>     WAV from AudioPreprocessor, or headerless 16 kHz s16le mono PCM\n"
+            "  -m, --model <path>    whisper ggml model (required for transcription)\n"
+            "      --mode <m>        transcribe | diarize | all | session | queue (default: all)\n"
+            "                        session = fused single-pass transcription + diarization\n"
+            "                        queue = r background jobs plus one foreground job on the scheduler\n"
+            "  -r, --repeat <n>      run each stage n times (default: 1)\n"
+            "      --resample-quality <q>  fast | balanced | high (default: balanced)\n"
+            "      --audio-cache-mb <n>    decoded audio cache budget, 0 disables (default: 256)\n"
+            "      --bench-resample  measure resampler throughput on synthetic audio and exit\n"
+            "      --bench-fft       time the 400-point mel FFT against the previous radix-2 code and exit\n"
+            "      --bench-mel-stream      time the mel of audio arriving in 1 s pieces, recomputed vs\n"
+            "                        incremental (needs -m), and exit\n"
+            "      --mel-f16         store full mel spectrograms (whisper_pcm_to_mel, whisper_mel_stream, the session\n"
+            "                        pipeline's) in half precision\n"
+            "      --compare-mel-f16 transcribe the file from an f32 and an f16 spectrogram, print the largest\n"
+            "                        difference in encoder input and output and whether the transcripts match, and exit\n"
+            "      --thread-policy <p>     performance | balanced | background (default: balanced)\n"
+            "      --parallel <n>    transcribe with n whisper states over silence-aligned chunks,\n"
+            "                        0 = half the thread plan (default: 1, sequential)\n"
+            "      --queue-workers <n>     scheduler workers for --mode queue, 0 = auto (default: 0)\n"
+            "      --pipeline        encode the next window on a second state while the current one decodes\n"
+            "      --audio-ctx-auto  size each window's encoder to the audio in it (256-frame buckets)\n"
+            "      --rtf <x>         hold whisper to real-time factor x by lowering decoding effort (default: 0, off)\n"
+            "      --encoder-cache   keep encoder output per window in <audio>.<model>.encoder-cache and reuse it\n"
+            "      --topology        print the CPU topology and the thread plan of each policy, then exit\n"
+            "      --sysfs-root <dir>      read the topology from <dir> instead of /sys/devices/system/cpu\n"
+            "      --live            print segments and progress while whisper runs\n"
+            "  -q, --quiet           do not print transcript / JSON output\n"
+            "  -v, --verbose         debug logging\n"
+            "  -h, --help            show this help\n",
+            argv0);
+}
+
+static bool parse_args(int argc, char** argv, CliOptions& opts) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto next = [&](const char* name) -> const char* {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "error: %s requires a value\n", name);
+                return nullptr;
+            }
+            return argv[++i];
+        };
+
+        if (arg == "-f" || arg == "--file") {
+            const char* v = next("--file"); if (!v) return false;
+            opts.audio_path = v;
+        } else if (arg == "-m" || arg == "--model") {
+            const char* v = next("--model"); if (!v) return false;
+            opts.model_path = v;
+        } else if (arg == "--mode") {
+            const char* v = next("--mode"); if (!v) return false;
+            const std::string mode = v;
+            if (mode == "transcribe") {
+                opts.run_transcribe = true; opts.run_diarize = false;
+            } else if (mode == "diarize") {
+                opts.run_transcribe = false; opts.run_diarize = true;
+            } else if (mode == "all") {
+                opts.run_transcribe = true; opts.run_diarize = true;
+            } else if (mode == "session") {
+                opts.run_transcribe = false; opts.run_diarize = false; opts.run_session = true;
+            } else if (mode == "queue") {
+                opts.run_transcribe = false; opts.run_diarize = false; opts.run_queue = true;
+            } else {
+                fprintf(stderr, "error: unknown mode '%s'\n", v);
+                return false;
+            }
+        } else if (arg == "-r" || arg == "--repeat") {
+            const char* v = next("--repeat"); if (!v) return false;
+            opts.repeat = std::max(1, atoi(v));
+        } else if (arg == "--resample-quality") {
+            const char* v = next("--resample-quality"); if (!v) return false;
+            ResampleQuality quality;
+            if (!resample_quality_from_name(v, quality)) {
+                fprintf(stderr, "error: unknown resample quality '%s'\n", v);
+                return false;
+            }
+            resampler_set_default_quality(quality);
+        } else if (arg == "--audio-cache-mb") {
+            const char* v = next("--audio-cache-mb"); if (!v) return false;
+            audio_cache_set_budget(static_cast<size_t>(std::max(0, atoi(v))) << 20);
+        } else if (arg == "--thread-policy") {
+            const char* v = next("--thread-policy"); if (!v) return false;
+            ThreadPolicy policy;
+            if (!thread_policy_from_name(v, policy)) {
+                fprintf(stderr, "error: unknown thread policy '%s'\n", v);
+                return false;
+            }
+            thread_policy_set_default(policy);
+        } else if (arg == "--parallel") {
+            const char* v = next("--parallel"); if (!v) return false;
+            parallel_transcribe_set_workers(std::max(0, atoi(v)));
+        } else if (arg == "--queue-workers") {
+            const char* v = next("--queue-workers"); if (!v) return false;
+            job_scheduler_set_workers(std::max(0, atoi(v)));
+        } else if (arg == "--pipeline") {
+            transcribe_set_encoder_pipelining(true);
+        } else if (arg == "--audio-ctx-auto") {
+            transcribe_set_audio_ctx_auto(true);
+        } else if (arg == "--rtf") {
+            const char* v = next("--rtf"); if (!v) return false;
+            rtf_governor_set_target(static_cast<float>(atof(v)));
+        } else if (arg == "--encoder-cache") {
+            encoder_cache_set_enabled(true);
+        } else if (arg == "--topology") {
+            opts.show_topology = true;
+        } else if (arg == "--sysfs-root") {
+            const char* v = next("--sysfs-root"); if (!v) return false;
+            opts.sysfs_root = v;
+        } else if (arg == "--live") {
+            opts.live = true;
+        } else if (arg == "--bench-resample") {
+            opts.bench_resample = true;
+        } else if (arg == "--bench-fft") {
+            opts.bench_fft = true;
+        } else if (arg == "--bench-mel-stream") {
+            opts.bench_mel_stream = true;
+        } else if (arg == "--mel-f16") {
+            opts.mel_f16 = true;
+            whisper_set_mel_f16(true);
+        } else if (arg == "--compare-mel-f16") {
+            opts.compare_mel_f16 = true;
+        } else if (arg == "-q" || arg == "--quiet") {
+            opts.quiet = true;
+        } else if (arg == "-v" || arg == "--verbose") {
+            opts.verbose = true;
+        } else if (arg == "-h" || arg == "--help") {
+            return false;
+        } else {
+            fprintf(stderr, "error: unknown argument '%s'\n", arg.c_str());
+            return false;
+        }
+    }
+
+    if (opts.bench_resample || opts.bench_fft || opts.show_topology) {
+        return true;
+    }
+    if (opts.bench_mel_stream) {
+        if (opts.model_path.empty()) {
+            fprintf(stderr, "error: --bench-mel-stream needs a model (-m) for its mel filters\n");
+            return false;
+        }
+        return true;
+    }
+    if (opts.audio_path.empty()) {
+        fprintf(stderr, "error: no input file given\n");
+        return false;
+    }
+    if (opts.compare_mel_f16 && opts.model_path.empty()) {
+        fprintf(stderr, "error: --compare-mel-f16 needs a model (-m)\n");
+        return false;
+    }
+    if ((opts.run_transcribe || opts.run_session || opts.run_queue) && opts.model_path.empty()) {
+        fprintf(stderr, "error: transcription needs a model (-m), or use --mode diarize\n");
+        return false;
+    }
+    return true;
+}
+
+// The CPU backend variants are built next to the executable.
+static std::string executable_dir() {
+    char buf[4096];
+    ssize_t len = readlink("/proc/self/exe", buf, sizeof(buf) - 1);
+    if (len <= 0) return "";
+    std::string path(buf, static_cast<size_t>(len));
+    size_t slash = path.find_last_of('/');
+    return slash == std::string::npos ? "" : path.substr(0, slash);
+}
+
+// Throughput of downmix + resample for the rates MediaCodec typically emits,
+// on 60 s of synthetic stereo audio pushed in decoder-sized chunks.
+static int run_bench_resample(const CliOptions& opts) {
+    static const int kInputRates[] = {44100, 48000, 22050, 8000};
+    static const ResampleQuality kQualities[] = {RESAMPLE_QUALITY_FAST, RESAMPLE_QUALITY_BALANCED, RESAMPLE_QUALITY_HIGH};
+    const int seconds = 60;
+    const size_t chunk_frames = 1024; // typical AAC decoder output buffer
+
+    printf("%-8s %-9s %5s %12s %12s\n", "in_rate", "quality", "taps", "ms", "x realtime");
+    for (int in_rate : kInputRates) {
+        const size_t frames = static_cast<size_t>(in_rate) * seconds;
+        AlignedFloatBuffer stereo(frames * 2);
+        for (size_t i = 0; i < frames; ++i) {
+            const float v = 0.25f * std::sin(2.0f * 3.14159265f * 440.0f * static_cast<float>(i) / in_rate);
+            stereo[2 * i] = v;
+            stereo[2 * i + 1] = -v;
+        }
+
+        for (ResampleQuality quality : kQualities) {
+            double best_ms = 0.0;
+            size_t taps = 0;
+            for (int run = 0; run < opts.repeat; ++run) {
+                StreamingResampler resampler(in_rate, WHISPER_SAMPLE_RATE, quality);
+                AlignedFloatBuffer mono(chunk_frames);
+                AlignedFloatBuffer out;
+                StageTimer timer;
+                for (size_t start = 0; start < frames; start += chunk_frames) {
+                    const size_t n = std::min(chunk_frames, frames - start);
+                    downmix_to_mono(stereo.data() + 2 * start, n, 2, mono.data());
+                    resampler.process(mono.data(), n, out);
+                }
+                resampler.flush(out);
+                const double ms = timer.elapsed_ms();
+                best_ms = run == 0 ? ms : std::min(best_ms, ms);
+                taps = resampler.taps();
+            }
+            printf("%-8d %-9s %5zu %12.2f %12.1f\n", in_rate, resample_quality_name(quality), taps, best_ms,
+                   seconds * 1000.0 / std::max(best_ms, 1e-3));
+        }
+    }
+    return 0;
+}
+
+// The FFT whisper.c used before RealFft: recursive radix-2, with a naive DFT
+// for odd lengths (400 -> 200 -> 100 -> 50 -> 25), kept as the --bench-fft baseline.
+struct ReferenceFft {
+    float sin_vals[WHISPER_N_FFT];
+    float cos_vals[WHISPER_N_FFT];
+
+    ReferenceFft() {
+        for (int i = 0; i < WHISPER_N_FFT; i++) {
+            const double theta = (2 * M_PI * i) / WHISPER_N_FFT;
+            sin_vals[i] = sinf(theta);
+            cos_vals[i] = cosf(theta);
+        }
+    }
+
+    void dft(const float* in, int N, float* out) const {
+        const int step = WHISPER_N_FFT / N;
+        for (int k = 0; k < N; k++) {
+            float re = 0;
+            float im = 0;
+            for (int n = 0; n < N; n++) {
+                const int idx = (k * n * step) % WHISPER_N_FFT;
+                re += in[n] * cos_vals[idx];
+                im -= in[n] * sin_vals[idx];
+            }
+            out[k * 2 + 0] = re;
+            out[k * 2 + 1] = im;
+        }
+    }
+
+    // in needs 2N floats and out 8N (scratch for the recursion)
+    void fft(float* in, int N, float* out) const {
+        if (N == 1) {
+            out[0] = in[0];
+            out[1] = 0;
+            return;
+        }
+        const int half_N = N / 2;
+        if (N - half_N * 2 == 1) {
+            dft(in, N, out);
+            return;
+        }
+        float* even = in + N;
+        for (int i = 0; i < half_N; ++i) even[i] = in[2 * i];
+        float* even_fft = out + 2 * N;
+        fft(even, half_N, even_fft);
+        float* odd = even;
+        for (int i = 0; i < half_N; ++i) odd[i] = in[2 * i + 1];
+        float* odd_fft = even_fft + N;
+        fft(odd, half_N, odd_fft);
+        const int step = WHISPER_N_FFT / N;
+        for (int k = 0; k < half_N; k++) {
+            const float re = cos_vals[k * step];
+            const float im = -sin_vals[k * step];
+            const float re_odd = odd_fft[2 * k + 0];
+            const float im_odd = odd_fft[2 * k + 1];
+            out[2 * k + 0] = even_fft[2 * k + 0] + re * re_odd - im * im_odd;
+            out[2 * k + 1] = even_fft[2 * k + 1] + re * im_odd + im * re_odd;
+            out[2 * (k + half_N) + 0] = even_fft[2 * k + 0] - re * re_odd + im * im_odd;
+            out[2 * (k + half_N) + 1] = even_fft[2 * k + 1] - re * im_odd - im * re_odd;
+        }
+    }
+};
+
+// Power spectra of the frames of 60 s of synthetic speech-band audio, as
+// log_mel_spectrogram computes them: previous code vs the RealFft plan.
+static int run_bench_fft(const CliOptions& opts) {
+    const int n = WHISPER_N_FFT;
+    const int n_frames = 60 * WHISPER_SAMPLE_RATE / WHISPER_HOP_LENGTH;
+    std::vector<float> audio(static_cast<size_t>(n_frames) * WHISPER_HOP_LENGTH + n);
+    for (size_t i = 0; i < audio.size(); ++i) {
+        const float t = static_cast<float>(i) / WHISPER_SAMPLE_RATE;
+        audio[i] = 0.3f * std::sin(2.0f * 3.14159265f * 220.0f * t) + 0.1f * std::sin(2.0f * 3.14159265f * 3170.0f * t) +
+                   0.01f * static_cast<float>((i * 2654435761u) % 1000) / 1000.0f;
+    }
+
+    ReferenceFft reference;
+    RealFft plan(n);
+    std::vector<float> in(2 * n), out(8 * n), power_ref(plan.bins()), power(plan.bins()), scratch(plan.scratch_size());
+    double best_ref_ms = 0.0, best_plan_ms = 0.0, max_rel_diff = 0.0;
+    volatile float sink = 0.0f; // keeps the spectra alive
+    for (int run = 0; run < std::max(3, opts.repeat); ++run) {
+        StageTimer ref_timer;
+        for (int f = 0; f < n_frames; ++f) {
+            std::copy(audio.begin() + f * WHISPER_HOP_LENGTH, audio.begin() + f * WHISPER_HOP_LENGTH + n, in.begin());
+            reference.fft(in.data(), n, out.data());
+            for (int k = 0; k < plan.bins(); ++k) {
+                power_ref[k] = out[2 * k] * out[2 * k] + out[2 * k + 1] * out[2 * k + 1];
+            }
+            sink = sink + power_ref[f % plan.bins()];
+        }
+        const double ref_ms = ref_timer.elapsed_ms();
+
+        StageTimer plan_timer;
+        for (int f = 0; f < n_frames; ++f) {
+            plan.power(audio.data() + f * WHISPER_HOP_LENGTH, power.data(), scratch.data());
+            sink = sink + power[f % plan.bins()];
+        }
+        const double plan_ms = plan_timer.elapsed_ms();
+        best_ref_ms = run == 0 ? ref_ms : std::min(best_ref_ms, ref_ms);
+        best_plan_ms = run == 0 ? plan_ms : std::min(best_plan_ms, plan_ms);
+    }
+
+    // the last frame of both, relative to the frame's peak
+    float peak = 0.0f;
+    for (float v : power_ref) peak = std::max(peak, v);
+    for (int k = 0; k < plan.bins(); ++k) {
+        max_rel_diff = std::max(max_rel_diff, static_cast<double>(std::fabs(power[k] - power_ref[k]) / std::max(peak, 1e-20f)));
+    }
+
+    printf("%-10s %10s %12s %10s\n", "fft", "ms", "ns/frame", "speedup");
+    printf("%-10s %10.2f %12.1f %10s\n", "radix-2", best_ref_ms, best_ref_ms * 1e6 / n_frames, "1.0x");
+    printf("%-10s %10.2f %12.1f %9.1fx\n", "real-fft", best_plan_ms, best_plan_ms * 1e6 / n_frames, best_ref_ms / std::max(best_plan_ms, 1e-6));
+    printf("%d frames of %d points, max power difference %.2e of peak\n", n_frames, n, max_rel_diff);
+    return 0;
+}
+
+// The spectrogram of audio that arrives a second at a time, e.g. from a recorder,
+// after every second: whisper_pcm_to_mel over everything so far vs a
+// whisper_mel_stream that only computes the new frames, over 3 minutes.
+static int run_bench_mel_stream(const CliOptions& opts) {
+    std::shared_ptr<WhisperModel> model = model_registry_acquire(opts.model_path);
+    PooledState state(model);
+    if (!model || !state) {
+        fprintf(stderr, "error: could not load %s\n", opts.model_path.c_str());
+        return 1;
+    }
+    whisper_context* ctx = state.context();
+
+    const int n_seconds = 180;
+    std::vector<float> audio(static_cast<size_t>(n_seconds) * WHISPER_SAMPLE_RATE);
+    for (size_t i = 0; i < audio.size(); ++i) {
+        const float t = static_cast<float>(i) / WHISPER_SAMPLE_RATE;
+        audio[i] = 0.3f * std::sin(2.0f * 3.14159265f * 220.0f * t) + 0.01f * static_cast<float>((i * 2654435761u) % 1000) / 1000.0f;
+    }
+
+    double full_ms = 0.0, full_last_ms = 0.0;
+    for (int s = 1; s <= n_seconds; ++s) {
+        StageTimer timer;
+        whisper_pcm_to_mel_with_state(ctx, state.get(), audio.data(), s * WHISPER_SAMPLE_RATE, 1);
+        full_last_ms = timer.elapsed_ms();
+        full_ms += full_last_ms;
+    }
+
+    double push_ms = 0.0, set_ms = 0.0, stream_last_ms = 0.0;
+    whisper_mel_stream* stream = whisper_mel_stream_init(ctx);
+    for (int s = 0; s < n_seconds; ++s) {
+        StageTimer push_timer;
+        whisper_mel_stream_push(stream, audio.data() + static_cast<size_t>(s) * WHISPER_SAMPLE_RATE, WHISPER_SAMPLE_RATE);
+        const double p = push_timer.elapsed_ms();
+        StageTimer set_timer;
+        whisper_mel_stream_set_state(ctx, stream, state.get());
+        const double m = set_timer.elapsed_ms();
+        push_ms += p;
+        set_ms += m;
+        stream_last_ms = p + m;
+    }
+    whisper_mel_stream_free(stream);
+
+    printf("%-12s %12s %14s\n", "mel", "total ms", "last second ms");
+    printf("%-12s %12.2f %14.2f\n", "recompute", full_ms, full_last_ms);
+    printf("%-12s %12.2f %14.2f  (push %.2f ms, set_state %.2f ms)\n", "incremental", push_ms + set_ms, stream_last_ms, push_ms, set_ms);
+    printf("%d s of audio in 1 s pieces, 1 thread, %s spectrogram\n", n_seconds, opts.mel_f16 ? "f16" : "f32");
+    return 0;
+}
+
+// --compare-mel-f16: the file transcribed from a stored spectrogram, as the
+// session pipeline does, once in f32 and once in f16. Each window's encoder
+// input and output are kept and compared.
+struct MelRun {
+    std::vector<float> encoder_input;
+    std::vector<float> encoder_output;
+    std::string transcript;
+    double ms = 0.0;
+};
+
+static bool run_mel_once(whisper_context* ctx, whisper_state* state, const PcmAudio& audio, bool f16, MelRun& run) {
+    whisper_set_mel_f16(f16);
+    const int n_samples = static_cast<int>(audio.samples.size());
+    const int n_threads = current_thread_plan().n_threads;
+
+    // the encoder input of each window whisper_full will encode
+    if (whisper_pcm_to_mel_with_state(ctx, state, audio.samples.data(), n_samples, n_threads) != 0) return false;
+    const int n_window = 2 * whisper_model_n_audio_ctx(ctx);
+    for (int offset = 0; offset < n_samples / WHISPER_HOP_LENGTH; offset += n_window) {
+        if (whisper_encode_with_state(ctx, state, offset, n_threads) != 0) return false;
+        int n_values = 0;
+        const float* input = whisper_get_encoder_input_from_state(state, &n_values);
+        run.encoder_input.insert(run.encoder_input.end(), input, input + n_values);
+    }
+
+    // the transcript, with the encoder output of every window it decoded from;
+    // whisper hands that to an encoder cache, which here never hits
+    struct whisper_full_params params = transcribe_default_params();
+    params.n_threads = n_threads;
+    params.encoder_cache_lookup = [](uint64_t, float*, size_t, void*) { return false; };
+    params.encoder_cache_store = [](uint64_t, const float* embd, size_t n_values, void* user_data) {
+        std::vector<float>* output = static_cast<std::vector<float>*>(user_data);
+        output->insert(output->end(), embd, embd + n_values);
+    };
+    params.encoder_cache_user_data = &run.encoder_output;
+
+    StageTimer timer;
+    if (whisper_pcm_to_mel_with_state(ctx, state, audio.samples.data(), n_samples, n_threads) != 0 ||
+        whisper_full_with_state(ctx, state, params, nullptr, 0) != 0) {
+        return false;
+    }
+    run.ms = timer.elapsed_ms();
+    for (int i = 0; i < whisper_full_n_segments_from_state(state); ++i) {
+        run.transcript += whisper_full_get_segment_text_from_state(state, i);
+    }
+    return true;
+}
+
+static float max_abs_difference(const std::vector<float>& a, const std::vector<float>& b) {
+    float diff = 0.0f;
+    for (size_t i = 0; i < std::min(a.size(), b.size()); ++i) diff = std::max(diff, std::fabs(a[i] - b[i]));
+    return diff;
+}
+
+static int run_compare_mel_f16(const CliOptions& opts) {
+    SharedAudio audio;
+    if (audio_cache_load_file(opts.audio_path, audio) != PCM_LOAD_OK) {
+        fprintf(stderr, "error: could not load %s\n", opts.audio_path.c_str());
+        return 1;
+    }
+    std::shared_ptr<WhisperModel> model = model_registry_acquire(opts.model_path);
+    PooledState state(model);
+    if (!model || !state) {
+        fprintf(stderr, "error: could not load %s\n", opts.model_path.c_str());
+        return 1;
+    }
+
+    MelRun f32, f16;
+    const bool ok = run_mel_once(state.context(), state.get(), *audio, false, f32) &&
+                    run_mel_once(state.context(), state.get(), *audio, true, f16);
+    whisper_set_mel_f16(opts.mel_f16);
+    if (!ok) {
+        fprintf(stderr, "error: whisper failed on %s\n", opts.audio_path.c_str());
+        return 1;
+    }
+
+    const bool same_transcript = f32.transcript == f16.transcript;
+    if (!opts.quiet) {
+        printf("f32: %s\n", f32.transcript.c_str());
+        if (!same_transcript) printf("f16: %s\n", f16.transcript.c_str());
+    }
+    printf("%-14s %14s %14s %10s\n", "spectrogram", "input values", "output values", "ms");
+    printf("%-14s %14zu %14zu %10.2f\n", "f32", f32.encoder_input.size(), f32.encoder_output.size(), f32.ms);
+    printf("%-14s %14zu %14zu %10.2f\n", "f16", f16.encoder_input.size(), f16.encoder_output.size(), f16.ms);
+    printf("max difference: encoder input %.3e\n", max_abs_difference(f32.encoder_input, f16.encoder_input));
+    if (same_transcript) {
+        // the same tokens mean the same seeks, so the windows line up
+        printf("max difference: encoder output %.3e\n", max_abs_difference(f32.encoder_output, f16.encoder_output));
+    }
+    printf("transcripts %s\n", same_transcript ? "match" : "differ");
+    return same_transcript ? 0 : 1;
+}
+
+// --topology: what the thread policies would do on this (or a fake) sysfs tree.
+static int run_show_topology(const CliOptions& opts) {
+    CpuTopology topology;
+    if (!probe_cpu_topology(opts.sysfs_root, topology)) {
+        fprintf(stderr, "error: no cpus found below %s\n", opts.sysfs_root.c_str());
+        return 1;
+    }
+    printf("topology: %s\n", describe_cpu_topology(topology).c_str());
+    for (ThreadPolicy policy : {THREAD_POLICY_PERFORMANCE, THREAD_POLICY_BALANCED, THREAD_POLICY_BACKGROUND}) {
+        ThreadPlan plan = plan_threads(topology, policy);
+        std::string cpus;
+        for (int cpu : plan.cpus) cpus += (cpus.empty() ? "" : ",") + std::to_string(cpu);
+        printf("%-11s threads %d on cpus %s\n", thread_policy_name(policy), plan.n_threads, cpus.c_str());
+    }
+    return 0;
+}
+
+// --live: echoes what the app's TranscriptionListener would receive.
+class CliTranscriptionListener : public TranscriptionListener {
+public:
+    void on_segments(const std::vector<TranscribedSegment>& segments) override {
+        for (const TranscribedSegment& s : segments) {
+            printf("[%8.2f --> %8.2f] %s\n", s.t0_ms / 1000.0, s.t1_ms / 1000.0, s.text.c_str());
+        }
+        fflush(stdout);
+    }
+    void on_progress(int percent) override {
+        fprintf(stderr, "progress: %d%%\n", percent);
+    }
+};
+
+static int run_transcribe(const CliOptions& opts) {
+    for (int run = 0; run < opts.repeat; ++run) {
+        TranscribeTimings t;
+        CliTranscriptionListener listener;
+        std::string transcript = transcribe_pcm_file(opts.model_path, opts.audio_path, &t,
+                                                     opts.live && run == 0 ? &listener : nullptr, &g_cancel);
+        if (transcript.rfind("ERROR:", 0) == 0) {
+            fprintf(stderr, "%s\n", transcript.c_str());
+            return 1;
+        }
+        if (!opts.quiet && run == 0) {
+            printf("transcript: %s\n", transcript.c_str());
+        }
+        printf("[transcribe %d/%d] model_load %9.2f ms | state_init %8.2f ms | audio_load %9.2f ms | resample %8.2f ms | vad %8.2f ms | whisper_full %9.2f ms | extract %7.2f ms\n",
+               run + 1, opts.repeat, t.model_load_ms, t.state_init_ms, t.audio_load_ms, t.resample_ms, t.vad_ms, t.whisper_full_ms, t.extract_ms);
+    }
+    return 0;
+}
+
+static int run_session(const CliOptions& opts) {
+    for (int run = 0; run < opts.repeat; ++run) {
+        SessionTimings t;
+        CliTranscriptionListener listener;
+        std::string json = transcribe_and_diarize_pcm_file(opts.model_path, opts.audio_path, &t,
+                                                           opts.live && run == 0 ? &listener : nullptr, &g_cancel);
+        if (json.rfind("{\"error\"", 0) == 0) {
+            fprintf(stderr, "%s\n", json.c_str());
+            return 1;
+        }
+        if (!opts.quiet && run == 0) {
+            printf("session: %s\n", json.c_str());
+        }
+        printf("[session %d/%d] audio_load %9.2f ms | vad %8.2f ms | model_load %9.2f ms | whisper_full %9.2f ms | embeddings %9.2f ms | clustering %7.2f ms | merge %7.2f ms | total %9.2f ms\n",
+               run + 1, opts.repeat, t.audio_load_ms, t.vad_ms, t.model_load_ms, t.whisper_full_ms, t.embedding_ms, t.clustering_ms, t.merge_ms, t.total_ms);
+    }
+    return 0;
+}
+
+// --mode queue: the app's case of a backlog of sessions and one the user opens.
+// Submits -r background jobs of the file, then a foreground one, and prints
+// how long each waited and ran.
+static int run_queue(const CliOptions& opts) {
+    SharedAudio audio;
+    if (audio_cache_load_file(opts.audio_path, audio) != PCM_LOAD_OK) {
+        fprintf(stderr, "error: could not load %s\n", opts.audio_path.c_str());
+        return 1;
+    }
+    std::vector<int64_t> ids;
+    for (int run = 0; run < opts.repeat; ++run) {
+        ids.push_back(job_scheduler_submit(opts.model_path, audio, JOB_PRIORITY_BACKGROUND));
+    }
+    ids.push_back(job_scheduler_submit(opts.model_path, audio, JOB_PRIORITY_FOREGROUND));
+
+    int rc = 0;
+    for (int64_t id : ids) {
+        job_scheduler_wait(id);
+        JobInfo info;
+        job_scheduler_status(id, info);
+        if (info.state != JOB_DONE) rc = 1;
+        std::vector<uint8_t> layout;
+        if (!opts.quiet && id == ids.back() && job_scheduler_take_result(id, layout)) {
+            printf("transcript: %s\n", transcript_layout_text(layout).c_str());
+        }
+        printf("[queue] %s\n", job_info_to_json(info).c_str());
+        job_scheduler_release(id);
+    }
+    return rc;
+}
+
+static int run_diarize(const CliOptions& opts) {
+    for (int run = 0; run < opts.repeat; ++run) {
+        DiarizeTimings t;
+        std::string json = diarize_pcm_file(opts.audio_path, &t, &g_cancel);
+        if (json.rfind("{\"error\"", 0) == 0) {
+            fprintf(stderr, "%s\n", json.c_str());
+            return 1;
+        }
+        if (!opts.quiet && run == 0) {
+            printf("diarization: %s\n", json.c_str());
+        }
+        printf("[diarize %d/%d] audio_load %9.2f ms | resample %8.2f ms | vad %9.2f ms | embeddings %9.2f ms | clustering %7.2f ms | json %7.2f ms\n",
+               run + 1, opts.repeat, t.audio_load_ms, t.resample_ms, t.vad_ms, t.embedding_ms, t.clustering_ms, t.json_ms);
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    CliOptions opts;
+    if (!parse_args(argc, argv, opts)) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    native_log_set_min_level(opts.verbose ? NATIVE_LOG_DEBUG : NATIVE_LOG_WARN);
+    if (opts.bench_resample) {
+        return run_bench_resample(opts);
+    }
+    if (opts.bench_fft) {
+        return run_bench_fft(opts);
+    }
+    if (opts.show_topology) {
+        return run_show_topology(opts);
+    }
+    if (!opts.verbose) {
+        whisper_log_set([](enum ggml_log_level, const char*, void*) {}, nullptr);
+    }
+
+    if (opts.run_transcribe || opts.run_session || opts.run_queue || opts.bench_mel_stream || opts.compare_mel_f16) {
+        std::string variant = load_best_cpu_backend(executable_dir());
+        if (variant.empty()) {
+            fprintf(stderr, "error: no ggml CPU backend could be loaded\n");
+            return 1;
+        }
+        printf("cpu backend: %s (%s)\n", variant.c_str(), describe_cpu_features(get_cpu_features()).c_str());
+        printf("thread policy: %s, %d threads\n", thread_policy_name(thread_policy_default()), current_thread_plan().n_threads);
+    }
+
+    std::signal(SIGINT, [](int) { g_cancel.cancel(); });
+
+    int rc = 0;
+    if (opts.bench_mel_stream) {
+        rc = run_bench_mel_stream(opts);
+        model_registry_release_all();
+        return rc;
+    }
+    if (opts.compare_mel_f16) {
+        rc = run_compare_mel_f16(opts);
+        model_registry_release_all();
+        audio_cache_clear();
+        return rc;
+    }
+    if (opts.run_transcribe) rc = run_transcribe(opts);
+    if (rc == 0 && opts.run_diarize) rc = run_diarize(opts);
+    if (rc == 0 && opts.run_session) rc = run_session(opts);
+    if (rc == 0 && opts.run_queue) rc = run_queue(opts);
+
+    job_scheduler_shutdown();
+    model_registry_release_all();
+    whisper_threading_release();
+    audio_cache_clear();
+    return rc;
+}
@@ -1,23 +1,25 @@
 // embedding_extractor.cpp (placeholder)
 #include "embedding_extractor.h"
-#include <cstdio> // For printf
+#include "platform/native_log.h"
+
+#define TAG "EMBEDDING_EXTRACTOR"
 
 void* init_embedding_extractor() {
-    printf("EMBEDDING_EXTRACTOR (placeholder): init_embedding_extractor called.\n");
+    LOGD(TAG, "(placeholder) init_embedding_extractor called.");
     return reinterpret_cast<void*>(new char[1]); // Dummy allocation
 }
 
-SpeakerEmbedding extract_speaker_embedding(void* embed_ctx, const float* segment_pcm, size_t segment_pcm_size, int sample_rate) {
-    printf("EMBEDDING_EXTRACTOR (placeholder): extract_speaker_embedding called for segment of size %zu at %d Hz.\n", segment_pcm_size, sample_rate);
+SpeakerEmbedding extract_speaker_embedding(void* /*embed_ctx*/, const float* /*segment_pcm*/, size_t segment_pcm_size, int sample_rate) {
+    LOGD(TAG, "(placeholder) extract_speaker_embedding called for segment of size %zu at %d Hz.", segment_pcm_size, sample_rate);
     SpeakerEmbedding se;
     // Create a dummy embedding of fixed size, e.g., 128 floats
     se.embedding.assign(128, 0.1f); // Vector of 128 floats, all initialized to 0.1f
-    printf("EMBEDDING_EXTRACTOR (placeholder): Produced dummy embedding of size %zu.\n", se.embedding.size());
+    LOGD(TAG, "(placeholder) Produced dummy embedding of size %zu.", se.embedding.size());
     return se;
 }
 
 void free_embedding_extractor(void* embed_ctx) {
-    printf("EMBEDDING_EXTRACTOR (placeholder): free_embedding_extractor called.\n");
+    LOGD(TAG, "(placeholder) free_embedding_extractor called.");
     if (embed_ctx) {
         delete[] reinterpret_cast<char*>(embed_ctx); // Free dummy allocation
     }
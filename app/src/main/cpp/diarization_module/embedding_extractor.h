@@ -1,6 +1,7 @@
 // embedding_extractor.h (placeholder)
 #pragma once
 #include <vector>
+#include <cstddef>
 #include <cstdint>
 #include "vad_engine.h" // For SpeechSegment
 
@@ -16,4 +17,5 @@ struct SpeakerEmbedding {
 
 void* init_embedding_extractor(); // Returns dummy context
 SpeakerEmbedding extract_speaker_embedding(void* embed_ctx, const float* segment_pcm, size_t segment_pcm_size, int sample_rate);
+
 void free_embedding_extractor(void* embed_ctx);
@@ -1,16 +1,18 @@
 // speaker_clusterer.cpp (placeholder)
 #include "speaker_clusterer.h"
-#include <cstdio> // For printf
+#include "platform/native_log.h"
+
+#define TAG "SPEAKER_CLUSTERER"
 
 std::vector<DiarizedSegment> cluster_speaker_embeddings(
     const std::vector<SpeechSegment>& segments,
     const std::vector<SpeakerEmbedding>& embeddings) {
-    printf("SPEAKER_CLUSTERER (placeholder): cluster_speaker_embeddings called with %zu segments and %zu embeddings.\n",
+    LOGD(TAG, "(placeholder) cluster_speaker_embeddings called with %zu segments and %zu embeddings.",
            segments.size(), embeddings.size());
 
     std::vector<DiarizedSegment> diarized_segments;
     if (segments.size() != embeddings.size()) {
-        printf("SPEAKER_CLUSTERER (placeholder): Warning - segments and embeddings count mismatch!\n");
+        LOGW(TAG, "(placeholder) Warning - segments and embeddings count mismatch!");
         // Handle error or return empty, for placeholder just proceed if segments exist
     }
 
@@ -21,6 +23,6 @@ std::vector<DiarizedSegment> cluster_speaker_embeddings(
         ds.speaker_label = (i % 2 == 0) ? "SPEAKER_00" : "SPEAKER_01";
         diarized_segments.push_back(ds);
     }
-    printf("SPEAKER_CLUSTERER (placeholder): Assigned speaker labels to %zu segments.\n", diarized_segments.size());
+    LOGD(TAG, "(placeholder) Assigned speaker labels to %zu segments.", diarized_segments.size());
     return diarized_segments;
 }
@@ -1,29 +1,106 @@
-// vad_engine.cpp (placeholder)
+// vad_engine.cpp
 #include "vad_engine.h"
-#include <cstdio> // For printf if debugging
+
+#include <algorithm>
+#include <cmath>
+
+#include "audio_module/stft_frontend.h"
+#include "platform/native_log.h"
+
+#define TAG "VAD_ENGINE"
+
+namespace {
+
+struct VadContext {
+    int hop_ms = 10;                  // StftFrontend's grid: 25 ms frames every 10 ms
+    float min_threshold_db = -50.0f;  // frames quieter than this are never speech
+    float floor_margin_db = 9.0f;     // speech must be this far above the noise floor
+    float peak_range_db = 25.0f;      // ...but never more than this below the loudest frame
+    int merge_gap_ms = 300;           // pauses shorter than this stay inside one region
+    int min_speech_ms = 250;          // shorter regions are treated as clicks/noise
+    int pad_ms = 100;                 // context kept before and after each region
+};
+
+} // namespace
 
 void* init_vad_engine() {
-    printf("VAD_ENGINE (placeholder): init_vad_engine called.\n");
-    // Return a dummy non-null pointer as context
-    return reinterpret_cast<void*>(new char[1]); // Dummy allocation
+    LOGD(TAG, "init_vad_engine called.");
+    return new VadContext();
+}
+
+std::vector<SpeechSegment> process_audio_for_vad(void* vad_ctx, const float* pcm_data, size_t pcm_data_size, int sample_rate,
+                                                 const std::atomic<bool>* cancel) {
+    std::vector<SpeechSegment> segments;
+    const auto* ctx = static_cast<const VadContext*>(vad_ctx);
+    if (ctx == nullptr || pcm_data == nullptr || sample_rate <= 0) {
+        LOGW(TAG, "process_audio_for_vad: invalid arguments.");
+        return segments;
+    }
+
+    if (sample_rate != StftFrontend::kSampleRate) {
+        LOGW(TAG, "process_audio_for_vad: %d Hz audio; the VAD reads 16 kHz.", sample_rate);
+        return segments;
+    }
+
+    // --- 1. Frame energies (dBFS) from the shared front-end's spectra ---
+    SpectralFeatures features;
+    if (!analyze_spectrum(pcm_data, pcm_data_size, nullptr, features, cancel)) {
+        LOGI(TAG, "VAD cancelled.");
+        return segments;
+    }
+
+    return process_energies_for_vad(vad_ctx, features.energy_db.data(), features.n_frames,
+                                    static_cast<int64_t>(pcm_data_size) * 1000 / sample_rate);
 }
 
-std::vector<SpeechSegment> process_audio_for_vad(void* vad_ctx, const float* pcm_data, size_t pcm_data_size, int sample_rate) {
-    printf("VAD_ENGINE (placeholder): process_audio_for_vad called with %zu samples at %d Hz.\n", pcm_data_size, sample_rate);
+std::vector<SpeechSegment> process_energies_for_vad(void* vad_ctx, const float* energy_db, size_t n_frames, int64_t total_ms) {
     std::vector<SpeechSegment> segments;
-    if (pcm_data_size > 0) { // Only generate segments if there's data
-        segments.push_back({500, 2500});    // Dummy segment 1: 0.5s to 2.5s
-        segments.push_back({2800, 4500});   // Dummy segment 2: 2.8s to 4.5s
-        segments.push_back({4800, 6000});   // Dummy segment 3: 4.8s to 6.0s
-        segments.push_back({6200, 8000});   // Dummy segment 4: 6.2s to 8.0s
+    const auto* ctx = static_cast<const VadContext*>(vad_ctx);
+    if (ctx == nullptr || energy_db == nullptr || n_frames == 0) {
+        return segments;
     }
-    printf("VAD_ENGINE (placeholder): Produced %zu dummy speech segments.\n", segments.size());
+
+    // --- 2. Threshold from the noise floor (10th percentile frame) ---
+    // Capped relative to the peak so recordings with hardly any pauses, whose
+    // "floor" is quiet speech, are not cut away.
+    std::vector<float> sorted(energy_db, energy_db + n_frames);
+    const size_t floor_index = n_frames / 10;
+    std::nth_element(sorted.begin(), sorted.begin() + floor_index, sorted.end());
+    const float peak_db = *std::max_element(energy_db, energy_db + n_frames);
+    const float threshold_db = std::max(ctx->min_threshold_db,
+                                        std::min(sorted[floor_index] + ctx->floor_margin_db, peak_db - ctx->peak_range_db));
+
+    // --- 3. Frames -> regions, bridging short gaps ---
+    const size_t merge_gap_frames = static_cast<size_t>(ctx->merge_gap_ms / ctx->hop_ms);
+    std::vector<std::pair<size_t, size_t>> regions; // [begin, end) in frames
+    for (size_t f = 0; f < n_frames; ++f) {
+        if (energy_db[f] < threshold_db) continue;
+        if (!regions.empty() && f - regions.back().second <= merge_gap_frames) {
+            regions.back().second = f + 1;
+        } else {
+            regions.emplace_back(f, f + 1);
+        }
+    }
+
+    // --- 4. Drop blips, pad, convert to ms ---
+    for (const auto& region : regions) {
+        int64_t start_ms = static_cast<int64_t>(region.first) * ctx->hop_ms;
+        int64_t end_ms = std::min(total_ms, static_cast<int64_t>(region.second) * ctx->hop_ms);
+        if (end_ms - start_ms < ctx->min_speech_ms) continue;
+        start_ms = std::max<int64_t>(0, start_ms - ctx->pad_ms);
+        end_ms = std::min(total_ms, end_ms + ctx->pad_ms);
+        if (!segments.empty() && start_ms <= segments.back().end_ms) {
+            segments.back().end_ms = end_ms; // padding made them touch
+        } else {
+            segments.push_back({start_ms, end_ms});
+        }
+    }
+
+    LOGD(TAG, "%zu frames, threshold %.1f dBFS -> %zu speech segments.", n_frames, threshold_db, segments.size());
     return segments;
 }
 
 void free_vad_engine(void* vad_ctx) {
-    printf("VAD_ENGINE (placeholder): free_vad_engine called.\n");
-    if (vad_ctx) {
-        delete[] reinterpret_cast<char*>(vad_ctx); // Free dummy allocation
-    }
+    LOGD(TAG, "free_vad_engine called.");
+    delete static_cast<VadContext*>(vad_ctx);
 }
@@ -1,6 +1,8 @@
-// vad_engine.h (placeholder)
+// vad_engine.h
 #pragma once
+#include <atomic>
 #include <vector>
+#include <cstddef>
 #include <cstdint>
 
 // Define SpeechSegment in a way that's accessible if other headers include this one first.
@@ -12,6 +14,19 @@ struct SpeechSegment {
 };
 #endif
 
-void* init_vad_engine(); // Returns dummy context
-std::vector<SpeechSegment> process_audio_for_vad(void* vad_ctx, const float* pcm_data, size_t pcm_data_size, int sample_rate);
+// Energy-based voice activity detector: frame energies are compared against a
+// threshold derived from the recording's own noise floor, then short gaps are
+// bridged, blips dropped and each region padded. Segments are sorted and do
+// not overlap. If cancel is set and becomes true mid-scan, the scan stops and
+// no segments are returned.
+//
+// Frames are those of StftFrontend: 25 ms Hann windows every 10 ms, centred on
+// the hop. process_audio_for_vad takes their energies from analyze_spectrum; a
+// caller that runs analyze_spectrum itself (for whisper's mel frames too)
+// passes its energies to process_energies_for_vad instead.
+void* init_vad_engine(); // Returns VAD context (owns its parameters)
+std::vector<SpeechSegment> process_audio_for_vad(void* vad_ctx, const float* pcm_data, size_t pcm_data_size, int sample_rate,
+                                                 const std::atomic<bool>* cancel = nullptr);
+// energy_db: one value in dBFS per 10 ms frame; total_ms: the recording's length.
+std::vector<SpeechSegment> process_energies_for_vad(void* vad_ctx, const float* energy_db, size_t n_frames, int64_t total_ms);
 void free_vad_engine(void* vad_ctx);
@@ -0,0 +1,15 @@
+// cancellation.cpp
+#include "cancellation.h"
+
+#include "whisper/whisper.h"
+
+void CancellationToken::install(struct whisper_full_params& params) const {
+    params.encoder_begin_callback = [](struct whisper_context*, struct whisper_state*, void* user_data) {
+        return !static_cast<const CancellationToken*>(user_data)->cancelled();
+    };
+    params.encoder_begin_callback_user_data = const_cast<CancellationToken*>(this);
+    params.abort_callback = [](void* user_data) {
+        return static_cast<const CancellationToken*>(user_data)->cancelled();
+    };
+    params.abort_callback_user_data = const_cast<CancellationToken*>(this);
+}
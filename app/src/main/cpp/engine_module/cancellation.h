@@ -0,0 +1,32 @@
+// cancellation.h
+#pragma once
+#include <atomic>
+
+struct whisper_full_params;
+
+// Per-job cancellation flag. cancel() may be called from any thread; the job
+// polls it at its natural step boundaries and returns early. Must outlive the
+// job it is passed to.
+class CancellationToken {
+public:
+    void cancel() { cancelled_.store(true, std::memory_order_relaxed); }
+    bool cancelled() const { return cancelled_.load(std::memory_order_relaxed); }
+    const std::atomic<bool>* flag() const { return &cancelled_; }
+
+    // encoder_begin_callback skips the encoder of the next window; abort_callback
+    // is polled by ggml between graph nodes, so a running encoder or decoder
+    // step stops early and whisper_full returns an error.
+    void install(struct whisper_full_params& params) const;
+
+private:
+    std::atomic<bool> cancelled_{false};
+};
+
+inline bool is_cancelled(const CancellationToken* token) {
+    return token != nullptr && token->cancelled();
+}
+
+// The raw flag for modules below the engine layer (VAD) that take an atomic.
+inline const std::atomic<bool>* cancellation_flag(const CancellationToken* token) {
+    return token != nullptr ? token->flag() : nullptr;
+}
@@ -0,0 +1,40 @@
+// diarizer.h
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "audio_module/pcm_loader.h"
+#include "diarization_module/embedding_extractor.h"
+#include "diarization_module/vad_engine.h"
+
+class CancellationToken;
+
+// Wall-clock milliseconds spent in each stage of diarize_pcm_file.
+struct DiarizeTimings {
+    double audio_load_ms = 0.0;   // file variant only; ~0 on an audio cache hit
+    double resample_ms = 0.0;
+    double vad_ms = 0.0;
+    double embedding_ms = 0.0;
+    double clustering_ms = 0.0;
+    double json_ms = 0.0;
+};
+
+// Runs VAD, speaker embedding extraction and clustering over a PCM/WAV file.
+// This is the code path behind DiarizationService.diarizeAudio and the
+// clearchoice-cli tool. The decoded audio goes through the audio cache, so a
+// transcription of the same file does not decode it again.
+// Returns a JSON array of speaker segments, or a JSON object {"error": ...} on failure.
+// cancel, if set, is polled during VAD and between segments; a cancelled run
+// returns {"error": "Cancelled."}.
+std::string diarize_pcm_file(const std::string& audio_path, DiarizeTimings* timings = nullptr,
+                             const CancellationToken* cancel = nullptr);
+
+// Same pipeline over audio already in memory; converted to 16 kHz mono if needed.
+std::string diarize_pcm_audio(const PcmAudio& audio, DiarizeTimings* timings = nullptr,
+                              const CancellationToken* cancel = nullptr);
+
+// One embedding per speech segment, from its samples. Stops early if cancel is set.
+std::vector<SpeakerEmbedding> embed_speech_segments(void* embed_ctx, const float* mono, size_t n_samples,
+                                                    const std::vector<SpeechSegment>& speech,
+                                                    const CancellationToken* cancel);
@@ -0,0 +1,287 @@
+// encoder_cache.cpp
+#include "encoder_cache.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "audio_module/audio_cache.h"
+#include "platform/native_log.h"
+
+#define TAG "ENCODER_CACHE"
+
+namespace {
+
+constexpr char kFileMagic[8] = {'C', 'C', 'E', 'N', 'C', 'O', 'D', 'E'};
+constexpr uint32_t kFileVersion = 2; // 1 stored half floats
+constexpr uint64_t kRecordMagic = 0x3143455243434e45ull; // "ENCCREC1"
+constexpr int64_t kPage = 4096;
+constexpr double kWindowSeconds = 30.0;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t page;
+    int64_t model_size;
+    int64_t model_mtime_ns;
+    int64_t source_size;
+    int64_t source_mtime_ns;
+};
+
+struct RecordHead {
+    uint64_t magic;
+    uint64_t key;
+    uint64_t n_values;
+    uint64_t checksum; // of the floats
+    uint8_t reserved[32];
+};
+static_assert(sizeof(RecordHead) == 64, "record head is 64 bytes");
+
+std::atomic<bool> g_enabled{false};
+
+int64_t record_bytes(uint64_t n_values) {
+    const int64_t bytes = static_cast<int64_t>(sizeof(RecordHead) + n_values * sizeof(float));
+    return (bytes + kPage - 1) / kPage * kPage;
+}
+
+uint64_t checksum(const float* data, size_t n) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        h = (h ^ word) * 0x100000001b3ull;
+    }
+    if (i < n) {
+        uint32_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        h = (h ^ word) * 0x100000001b3ull;
+    }
+    return h;
+}
+
+bool write_all(int fd, const void* data, size_t size, int64_t offset) {
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+        const ssize_t n = pwrite(fd, p, size, offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        size -= static_cast<size_t>(n);
+        offset += n;
+    }
+    return true;
+}
+
+bool read_all(int fd, void* data, size_t size, int64_t offset) {
+    char* p = static_cast<char*>(data);
+    while (size > 0) {
+        const ssize_t n = pread(fd, p, size, offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        size -= static_cast<size_t>(n);
+        offset += n;
+    }
+    return true;
+}
+
+std::string file_name(const std::string& path) {
+    const size_t slash = path.find_last_of('/');
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+} // namespace
+
+void encoder_cache_set_enabled(bool enabled) {
+    g_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool encoder_cache_enabled() {
+    return g_enabled.load(std::memory_order_relaxed);
+}
+
+std::shared_ptr<EncoderCache> EncoderCache::open(const std::string& source_path, const std::string& model_path,
+                                                 size_t max_records) {
+    const std::string path = source_path + "." + file_name(model_path) + ".encoder-cache";
+
+    // jobs on the same recording and model append to one file through one cache
+    static std::mutex open_mutex;
+    static std::unordered_map<std::string, std::weak_ptr<EncoderCache>> open_caches;
+    std::lock_guard<std::mutex> open_lock(open_mutex);
+    if (std::shared_ptr<EncoderCache> cache = open_caches[path].lock()) {
+        return cache;
+    }
+    // entries of caches that have since closed, this one's included
+    for (auto it = open_caches.begin(); it != open_caches.end();) {
+        it = it->second.expired() ? open_caches.erase(it) : std::next(it);
+    }
+
+    AudioCacheKey source, model;
+    if (!audio_cache_key_for_file(source_path, source) || !audio_cache_key_for_file(model_path, model)) {
+        return nullptr;
+    }
+    FileHeader expected{};
+    std::memcpy(expected.magic, kFileMagic, sizeof(kFileMagic));
+    expected.version = kFileVersion;
+    expected.page = static_cast<uint32_t>(kPage);
+    expected.model_size = model.size;
+    expected.model_mtime_ns = model.mtime_ns;
+    expected.source_size = source.size;
+    expected.source_mtime_ns = source.mtime_ns;
+
+    const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        LOGW(TAG, "Cannot open %s: %s", path.c_str(), strerror(errno));
+        return nullptr;
+    }
+    std::shared_ptr<EncoderCache> cache(new EncoderCache(fd, path, max_records));
+    open_caches[path] = cache;
+
+    struct stat st;
+    FileHeader header{};
+    const int64_t size = fstat(fd, &st) == 0 ? static_cast<int64_t>(st.st_size) : 0;
+    if (size < kPage || !read_all(fd, &header, sizeof(header), 0) || std::memcmp(&header, &expected, sizeof(header)) != 0) {
+        if (size > 0) LOGI(TAG, "%s is for another model or recording; starting over.", path.c_str());
+        std::vector<char> page(kPage, 0);
+        std::memcpy(page.data(), &expected, sizeof(expected));
+        if (ftruncate(fd, 0) != 0 || !write_all(fd, page.data(), page.size(), 0)) {
+            LOGW(TAG, "Cannot write %s: %s", path.c_str(), strerror(errno));
+            return nullptr;
+        }
+        cache->end_ = kPage;
+        return cache;
+    }
+
+    int64_t offset = kPage;
+    while (offset + static_cast<int64_t>(sizeof(RecordHead)) <= size) {
+        RecordHead head;
+        if (!read_all(fd, &head, sizeof(head), offset) || head.magic != kRecordMagic || head.n_values == 0 ||
+            offset + record_bytes(head.n_values) > size) {
+            break;
+        }
+        cache->records_[head.key] = Record{offset, head.n_values, head.checksum};
+        offset += record_bytes(head.n_values);
+    }
+    if (offset != size) {
+        LOGW(TAG, "%s: dropping %lld bytes of incomplete records.", path.c_str(), static_cast<long long>(size - offset));
+        if (ftruncate(fd, offset) != 0) cache->full_ = true;
+    }
+    cache->end_ = offset;
+    cache->full_ = cache->full_ || cache->records_.size() >= max_records;
+    LOGI(TAG, "%s: %zu windows cached.", path.c_str(), cache->records_.size());
+    return cache;
+}
+
+EncoderCache::EncoderCache(int fd, std::string path, size_t max_records)
+    : fd_(fd), path_(std::move(path)), max_records_(max_records) {}
+
+EncoderCache::~EncoderCache() {
+    if (hits_ + misses_ > 0) {
+        LOGI(TAG, "%d of %d windows from the cache, %d stored.", hits_, hits_ + misses_, stores_);
+    }
+    close(fd_);
+}
+
+void EncoderCache::install(struct whisper_full_params& params) {
+    params.encoder_cache_lookup = &EncoderCache::on_lookup;
+    params.encoder_cache_store = &EncoderCache::on_store;
+    params.encoder_cache_user_data = this;
+}
+
+bool EncoderCache::on_lookup(uint64_t key, float* embd, size_t n_values, void* user_data) {
+    return static_cast<EncoderCache*>(user_data)->lookup(key, embd, n_values);
+}
+
+void EncoderCache::on_store(uint64_t key, const float* embd, size_t n_values, void* user_data) {
+    static_cast<EncoderCache*>(user_data)->store(key, embd, n_values);
+}
+
+bool EncoderCache::lookup(uint64_t key, float* embd, size_t n_values) {
+    Record record{};
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = records_.find(key);
+        if (it == records_.end() || it->second.n_values != n_values) {
+            misses_++;
+            return false;
+        }
+        record = it->second;
+    }
+
+    // records are written once and never move, so no lock is needed to read one;
+    // the mapping starts at a page of the device (4 or 16 KiB)
+    const int64_t page = sysconf(_SC_PAGESIZE);
+    const int64_t start = record.offset / page * page;
+    const size_t bytes = static_cast<size_t>(record.offset - start + record_bytes(n_values));
+    void* p = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd_, start);
+    bool ok = p != MAP_FAILED;
+    if (ok) {
+        const char* head = static_cast<const char*>(p) + (record.offset - start);
+        const float* values = reinterpret_cast<const float*>(head + sizeof(RecordHead));
+        ok = checksum(values, n_values) == record.checksum;
+        if (ok) std::memcpy(embd, values, n_values * sizeof(float));
+        munmap(p, bytes);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!ok) {
+        LOGW(TAG, "%s: unreadable record at %lld; ignoring it.", path_.c_str(), static_cast<long long>(record.offset));
+        records_.erase(key);
+        misses_++;
+        return false;
+    }
+    hits_++;
+    return true;
+}
+
+void EncoderCache::store(uint64_t key, const float* embd, size_t n_values) {
+    const int64_t bytes = record_bytes(n_values);
+    int64_t offset;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (full_ || records_.count(key) != 0) return;
+        if (records_.size() >= max_records_) {
+            LOGI(TAG, "%s holds %zu windows; not storing more.", path_.c_str(), records_.size());
+            full_ = true;
+            return;
+        }
+        offset = end_;
+        end_ += bytes;
+    }
+
+    // the payload, padded to the next record, goes before the head, so a head
+    // on disk means a whole record
+    std::vector<float> values((bytes - sizeof(RecordHead)) / sizeof(float), 0.0f);
+    std::memcpy(values.data(), embd, n_values * sizeof(float));
+    RecordHead head{};
+    head.magic = kRecordMagic;
+    head.key = key;
+    head.n_values = n_values;
+    head.checksum = checksum(values.data(), n_values);
+    const bool ok = write_all(fd_, values.data(), values.size() * sizeof(float), offset + static_cast<int64_t>(sizeof(head))) &&
+                    write_all(fd_, &head, sizeof(head), offset);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!ok) {
+        LOGW(TAG, "Cannot write %s: %s; not storing more.", path_.c_str(), strerror(errno));
+        full_ = true;
+        return;
+    }
+    records_[key] = Record{offset, n_values, head.checksum};
+    stores_++;
+}
+
+std::shared_ptr<EncoderCache> encoder_cache_for(const PcmAudio& audio, const std::string& model_path) {
+    if (!encoder_cache_enabled() || audio.source_path.empty()) return nullptr;
+    const size_t windows = static_cast<size_t>(std::ceil(audio.duration_s() / kWindowSeconds));
+    return EncoderCache::open(audio.source_path, model_path, 4 * windows + 8);
+}
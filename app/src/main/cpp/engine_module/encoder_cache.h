@@ -0,0 +1,81 @@
+// encoder_cache.h
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "whisper/whisper.h"
+#include "audio_module/pcm_loader.h"
+
+// Keeps whisper's encoder output per window in a file next to the recording,
+// so transcribing it again with the same model (after changing the prompt or
+// the language, or to export it again) skips the encoder for every window it
+// has seen. On tiny and base models the encoder is most of the work.
+//
+// A window is identified by what the encoder reads: a hash of its log mel
+// frames and its audio context (whisper_full_params.encoder_cache_lookup). The
+// file, <recording>.<model file>.encoder-cache, is tied to the size and mtime
+// of both; if either changed it starts over.
+//
+// Layout: a 4 KiB header, then one page-aligned record per window: a 64-byte
+// head (key, value count, checksum) followed by the encoder output as floats,
+// so a window from the cache decodes exactly as a fresh encode would. Lookups
+// map the record rather than read it. A record cut short by a crash is dropped
+// when the file is next opened.
+
+// Off by default; each window costs 4 bytes per encoder value on disk (2.2 MiB
+// for tiny, 2.9 MiB for base).
+void encoder_cache_set_enabled(bool enabled);
+bool encoder_cache_enabled();
+
+class EncoderCache {
+public:
+    // nullptr if the file cannot be opened or created. Stores stop after
+    // max_records windows. While a cache for the file is in use, opening it
+    // again returns that cache.
+    static std::shared_ptr<EncoderCache> open(const std::string& source_path, const std::string& model_path,
+                                              size_t max_records);
+    ~EncoderCache();
+
+    EncoderCache(const EncoderCache&) = delete;
+    EncoderCache& operator=(const EncoderCache&) = delete;
+
+    // Makes whisper look windows up in the cache and store those it encodes.
+    // Any number of whisper_full calls may use it at once.
+    void install(struct whisper_full_params& params);
+
+    bool lookup(uint64_t key, float* embd, size_t n_values);
+    void store(uint64_t key, const float* embd, size_t n_values);
+
+private:
+    struct Record {
+        int64_t offset;
+        uint64_t n_values;
+        uint64_t checksum;
+    };
+
+    EncoderCache(int fd, std::string path, size_t max_records);
+
+    static bool on_lookup(uint64_t key, float* embd, size_t n_values, void* user_data);
+    static void on_store(uint64_t key, const float* embd, size_t n_values, void* user_data);
+
+    const int fd_;
+    const std::string path_;
+    const size_t max_records_;
+
+    std::mutex mutex_;
+    std::unordered_map<uint64_t, Record> records_;
+    int64_t end_ = 0;      // where the next record goes
+    bool full_ = false;    // at max_records, or a write failed
+    int hits_ = 0;
+    int misses_ = 0;
+    int stores_ = 0;
+};
+
+// Cache for transcribing audio with the model at model_path: nullptr unless
+// the cache is enabled and the audio came from a file (PcmAudio::source_path).
+// Sized for a few runs over the whole recording.
+std::shared_ptr<EncoderCache> encoder_cache_for(const PcmAudio& audio, const std::string& model_path);
@@ -0,0 +1,491 @@
+// job_scheduler.cpp
+#include "job_scheduler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include "whisper/whisper.h"
+#include "audio_module/resampler.h"
+#include "diarization_module/vad_engine.h"
+#include "engine_module/cancellation.h"
+#include "engine_module/encoder_cache.h"
+#include "engine_module/model_registry.h"
+#include "engine_module/parallel_transcriber.h"
+#include "engine_module/rtf_governor.h"
+#include "engine_module/stage_timer.h"
+#include "engine_module/transcriber.h"
+#include "engine_module/transcript_layout.h"
+#include "platform/cpu_topology.h"
+#include "platform/native_log.h"
+
+#define TAG "JOB_SCHEDULER"
+
+namespace {
+
+struct Job {
+    int64_t id = 0;
+    uint64_t order = 0;          // submit sequence, oldest first within a priority
+    std::string model_path;
+    SharedAudio audio;
+    JobPriority priority = JOB_PRIORITY_NORMAL;
+    JobState state = JOB_QUEUED;
+    CancellationToken cancel;
+    StageTimer since_submit;
+
+    // Set under mutex_ once the job is planned (JobPlan); read-only afterwards.
+    bool planning = false;
+    bool planned = false;
+    PcmAudio converted;          // storage if the audio was not 16 kHz mono
+    const PcmAudio* input = nullptr;
+    std::vector<ParallelChunk> chunks;
+    std::unique_ptr<RtfGovernor> governor; // effort of its chunks, if an RTF target is set
+    std::shared_ptr<EncoderCache> encoder_cache; // windows encoded by an earlier run, if enabled
+
+    std::vector<std::vector<uint8_t>> parts; // per chunk, in time order
+    size_t next_chunk = 0;
+    int chunks_done = 0;
+    int running = 0;             // workers planning it or running one of its chunks
+    size_t total_samples = 0;
+    size_t done_samples = 0;
+
+    std::string error;
+    std::vector<uint8_t> result;
+    JobTimings timings;
+
+    bool ended() const { return state == JOB_DONE || state == JOB_FAILED || state == JOB_CANCELLED; }
+
+    bool runnable() const {
+        if (ended() || cancel.cancelled() || !error.empty()) return false;
+        return planned ? next_chunk < chunks.size() : !planning;
+    }
+};
+
+// What planning a job produces. Built without mutex_, then moved into the Job
+// under it, so status() never sees a job half planned.
+struct JobPlan {
+    PcmAudio converted;          // storage if the audio was not 16 kHz mono
+    bool is_converted = false;   // the input is converted rather than the job's audio
+    std::vector<ParallelChunk> chunks;
+    std::shared_ptr<EncoderCache> encoder_cache;
+    double vad_ms = 0.0;
+};
+
+class Scheduler {
+public:
+    ~Scheduler() { shutdown(); }
+
+    int64_t submit(const std::string& model_path, SharedAudio audio, JobPriority priority);
+    bool status(int64_t id, JobInfo& info);
+    bool set_priority(int64_t id, JobPriority priority);
+    bool cancel(int64_t id);
+    bool take_result(int64_t id, std::vector<uint8_t>& layout);
+    void release(int64_t id);
+    bool wait(int64_t id);
+    void shutdown();
+
+private:
+    void worker_main(int n_workers);
+    std::shared_ptr<Job> pick() const;
+    static JobPlan plan(const SharedAudio& audio, const std::string& model_path, const CancellationToken& cancel);
+    void finish_if_ended(Job& job);
+
+    std::mutex mutex_;
+    std::condition_variable work_cv_;  // workers: new work or stop
+    std::condition_variable ended_cv_; // wait(): a job ended
+    std::map<int64_t, std::shared_ptr<Job>> jobs_;
+    std::vector<std::thread> workers_;
+    int64_t next_id_ = 1;
+    uint64_t next_order_ = 0;
+    bool stopping_ = false;
+};
+
+std::atomic<int> g_workers{0};
+
+Scheduler& scheduler() {
+    static Scheduler instance;
+    return instance;
+}
+
+// Highest priority first, then oldest. While a job is being planned, workers
+// wait for its chunks rather than start a window of a lower-priority job.
+// Called with mutex_ held.
+std::shared_ptr<Job> Scheduler::pick() const {
+    std::shared_ptr<Job> best;
+    int planning_priority = -1;
+    for (const auto& entry : jobs_) {
+        const std::shared_ptr<Job>& job = entry.second;
+        if (job->planning && !job->ended() && !job->cancel.cancelled()) {
+            planning_priority = std::max(planning_priority, static_cast<int>(job->priority));
+        }
+        if (!job->runnable()) continue;
+        if (!best || job->priority > best->priority || (job->priority == best->priority && job->order < best->order)) {
+            best = job;
+        }
+    }
+    if (best && best->priority < planning_priority) return nullptr;
+    return best;
+}
+
+// 16 kHz mono, VAD and chunking. Runs without mutex_ and touches no Job;
+// job.planning keeps other workers away until the plan is moved in.
+JobPlan Scheduler::plan(const SharedAudio& audio, const std::string& model_path, const CancellationToken& cancel) {
+    StageTimer timer;
+    JobPlan plan;
+    const PcmAudio& input = conform_audio(*audio, WHISPER_SAMPLE_RATE, plan.converted);
+    plan.is_converted = &input == &plan.converted;
+    void* vad_ctx = init_vad_engine();
+    std::vector<SpeechSegment> speech = process_audio_for_vad(vad_ctx, input.samples.data(), input.samples.size(),
+                                                              WHISPER_SAMPLE_RATE, cancel.flag());
+    free_vad_engine(vad_ctx);
+    plan.chunks = plan_parallel_chunks(input.samples.data(), input.samples.size(), WHISPER_SAMPLE_RATE, speech);
+    plan.encoder_cache = encoder_cache_for(*audio, model_path);
+    plan.vad_ms = timer.elapsed_ms();
+    return plan;
+}
+
+// Settles a job whose last worker has left it. Called with mutex_ held.
+void Scheduler::finish_if_ended(Job& job) {
+    if (job.ended() || job.running > 0) return;
+    if (job.cancel.cancelled()) {
+        job.state = JOB_CANCELLED;
+    } else if (!job.error.empty()) {
+        job.state = JOB_FAILED;
+    } else if (job.planned && job.chunks_done == static_cast<int>(job.chunks.size())) {
+        merge_transcript_layouts(job.parts, job.result);
+        job.state = JOB_DONE;
+    } else {
+        return;
+    }
+    job.timings.total_ms = job.since_submit.elapsed_ms();
+    LOGI(TAG, "Job %lld %s: %zu chunks, queued %.1f ms, vad %.1f ms, whisper %.1f ms, total %.1f ms, %d preemptions.",
+         static_cast<long long>(job.id), job_state_name(job.state), job.chunks.size(), job.timings.queued_ms,
+         job.timings.vad_ms, job.timings.whisper_ms, job.timings.total_ms, job.timings.preemptions);
+    // the result is all that is kept
+    job.audio.reset();
+    job.converted = PcmAudio();
+    job.input = nullptr;
+    std::vector<std::vector<uint8_t>>().swap(job.parts);
+    job.governor.reset();
+    job.encoder_cache.reset();
+    ended_cv_.notify_all();
+}
+
+void Scheduler::worker_main(int n_workers) {
+    std::shared_ptr<WhisperModel> model;
+    std::unique_ptr<PooledState> state;
+    std::shared_ptr<Job> previous;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        std::shared_ptr<Job> job = pick();
+        if (!job && !stopping_) {
+            // idle: give the state back to the pool while there is nothing to do
+            lock.unlock();
+            state.reset();
+            model.reset();
+            lock.lock();
+            work_cv_.wait(lock, [&] { return stopping_ || (job = pick()) != nullptr; });
+        }
+        if (stopping_) return;
+
+        if (previous && previous != job && previous->runnable() && previous->priority < job->priority) {
+            previous->timings.preemptions++;
+        }
+        previous = job;
+        if (job->state == JOB_QUEUED) {
+            job->state = JOB_RUNNING;
+            job->timings.queued_ms = job->since_submit.elapsed_ms();
+        }
+        job->running++;
+
+        if (!job->planned) {
+            job->planning = true;
+            // the audio and model path are fixed once submitted, and the audio is
+            // kept while a worker is on the job
+            const SharedAudio audio = job->audio;
+            const std::string model_path = job->model_path;
+            lock.unlock();
+            JobPlan plan = Scheduler::plan(audio, model_path, job->cancel);
+            lock.lock();
+            job->converted = std::move(plan.converted);
+            job->input = plan.is_converted ? &job->converted : job->audio.get();
+            job->chunks = std::move(plan.chunks);
+            job->encoder_cache = std::move(plan.encoder_cache);
+            job->timings.vad_ms = plan.vad_ms;
+            job->planning = false;
+            job->planned = true;
+            job->parts.resize(job->chunks.size());
+            if (rtf_governor_target() > 0.0f) {
+                // its chunks may run on every worker at once
+                struct whisper_full_params base = transcribe_default_params();
+                base.n_threads = std::max(1, current_thread_plan().n_threads / n_workers);
+                job->governor = std::make_unique<RtfGovernor>(rtf_governor_target(), base, n_workers);
+            }
+            for (const ParallelChunk& chunk : job->chunks) job->total_samples += chunk.end - chunk.begin;
+            job->running--;
+            finish_if_ended(*job);
+            work_cv_.notify_all(); // its chunks are up for grabs
+            continue;
+        }
+
+        const size_t c = job->next_chunk++;
+        const ParallelChunk chunk = job->chunks[c];
+        lock.unlock();
+
+        std::string error;
+        std::vector<uint8_t> part;
+        StageTimer whisper_timer;
+        if (!model || model->path() != job->model_path) {
+            state.reset();
+            model = model_registry_acquire(job->model_path);
+        }
+        if (model && !state) {
+            state = std::make_unique<PooledState>(model);
+            if (!*state) state.reset();
+        }
+        if (!model) {
+            error = "ERROR: whisper_init_from_file failed.";
+        } else if (!state) {
+            error = "ERROR: whisper_init_state failed.";
+        } else {
+            const ThreadPlan thread_plan = current_thread_plan();
+            ScopedThreadAffinity affinity(thread_plan);
+            struct whisper_full_params params = transcribe_default_params();
+            params.n_threads = std::max(1, thread_plan.n_threads / n_workers);
+            job->cancel.install(params);
+            if (job->governor) {
+                job->governor->install(params);
+            }
+            if (job->encoder_cache) {
+                job->encoder_cache->install(params);
+            }
+            const int rc = whisper_full_with_state(state->context(), state->get(), params, job->input->samples.data() + chunk.begin,
+                                                   static_cast<int>(chunk.end - chunk.begin));
+            if (!job->cancel.cancelled()) {
+                if (rc != 0) {
+                    error = "ERROR: whisper_full failed, code: " + std::to_string(rc);
+                } else {
+                    const int64_t offset_ms = static_cast<int64_t>(chunk.begin) * 1000 / WHISPER_SAMPLE_RATE;
+                    write_transcript_layout(state->context(), state->get(), part,
+                                            [offset_ms](int64_t t) { return offset_ms + t * 10; });
+                }
+            }
+        }
+        const double whisper_ms = whisper_timer.elapsed_ms();
+
+        lock.lock();
+        job->timings.whisper_ms += whisper_ms;
+        if (!error.empty()) {
+            LOGE(TAG, "Job %lld, chunk %zu: %s", static_cast<long long>(job->id), c, error.c_str());
+            if (job->error.empty()) job->error = error;
+            job->cancel.cancel(); // stops its other running chunks
+        } else if (!job->cancel.cancelled()) {
+            job->parts[c] = std::move(part);
+            job->chunks_done++;
+            job->done_samples += chunk.end - chunk.begin;
+        }
+        job->running--;
+        finish_if_ended(*job);
+    }
+}
+
+int64_t Scheduler::submit(const std::string& model_path, SharedAudio audio, JobPriority priority) {
+    auto job = std::make_shared<Job>();
+    job->model_path = model_path;
+    job->audio = std::move(audio);
+    job->priority = priority;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    job->id = next_id_++;
+    job->order = next_order_++;
+    jobs_[job->id] = job;
+    if (workers_.empty()) {
+        int n_workers = g_workers.load(std::memory_order_relaxed);
+        if (n_workers <= 0) n_workers = std::max(1, current_thread_plan().n_threads / 2);
+        LOGI(TAG, "Starting %d workers.", n_workers);
+        for (int i = 0; i < n_workers; ++i) {
+            workers_.emplace_back(&Scheduler::worker_main, this, n_workers);
+        }
+    }
+    LOGI(TAG, "Job %lld queued (%s).", static_cast<long long>(job->id), job_priority_name(priority));
+    work_cv_.notify_one();
+    return job->id;
+}
+
+bool Scheduler::status(int64_t id, JobInfo& info) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = jobs_.find(id);
+    if (it == jobs_.end()) return false;
+    const Job& job = *it->second;
+    info = JobInfo();
+    info.id = job.id;
+    info.state = job.state;
+    info.priority = job.priority;
+    info.n_chunks = static_cast<int>(job.chunks.size());
+    info.chunks_done = job.chunks_done;
+    if (job.state == JOB_DONE) {
+        info.progress = 100;
+    } else if (job.total_samples > 0) {
+        info.progress = static_cast<int>(job.done_samples * 100 / job.total_samples);
+    }
+    info.error = job.error;
+    info.timings = job.timings;
+    if (!job.ended()) info.timings.total_ms = job.since_submit.elapsed_ms();
+    return true;
+}
+
+bool Scheduler::set_priority(int64_t id, JobPriority priority) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = jobs_.find(id);
+    if (it == jobs_.end()) return false;
+    it->second->priority = priority;
+    return true;
+}
+
+bool Scheduler::cancel(int64_t id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = jobs_.find(id);
+    if (it == jobs_.end()) return false;
+    it->second->cancel.cancel();
+    finish_if_ended(*it->second);
+    return true;
+}
+
+bool Scheduler::take_result(int64_t id, std::vector<uint8_t>& layout) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = jobs_.find(id);
+    if (it == jobs_.end() || it->second->state != JOB_DONE) return false;
+    layout = std::move(it->second->result);
+    jobs_.erase(it);
+    return true;
+}
+
+void Scheduler::release(int64_t id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = jobs_.find(id);
+    if (it == jobs_.end()) return;
+    // workers still on it hold their own reference
+    it->second->cancel.cancel();
+    jobs_.erase(it);
+    ended_cv_.notify_all();
+}
+
+bool Scheduler::wait(int64_t id) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (jobs_.find(id) == jobs_.end()) return false;
+    ended_cv_.wait(lock, [&] {
+        auto it = jobs_.find(id);
+        return it == jobs_.end() || it->second->ended();
+    });
+    return true;
+}
+
+void Scheduler::shutdown() {
+    std::vector<std::thread> workers;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& entry : jobs_) entry.second->cancel.cancel();
+        stopping_ = true;
+        workers.swap(workers_);
+    }
+    work_cv_.notify_all();
+    for (std::thread& worker : workers) worker.join();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& entry : jobs_) finish_if_ended(*entry.second);
+    stopping_ = false;
+}
+
+void append_json_escaped(std::ostringstream& out, const std::string& s) {
+    for (char c : s) {
+        if (c == '"' || c == '\\') out << '\\';
+        out << c;
+    }
+}
+
+} // namespace
+
+int64_t job_scheduler_submit(const std::string& model_path, SharedAudio audio, JobPriority priority) {
+    return scheduler().submit(model_path, std::move(audio), priority);
+}
+
+bool job_scheduler_status(int64_t id, JobInfo& info) {
+    return scheduler().status(id, info);
+}
+
+bool job_scheduler_set_priority(int64_t id, JobPriority priority) {
+    return scheduler().set_priority(id, priority);
+}
+
+bool job_scheduler_cancel(int64_t id) {
+    return scheduler().cancel(id);
+}
+
+bool job_scheduler_take_result(int64_t id, std::vector<uint8_t>& layout) {
+    return scheduler().take_result(id, layout);
+}
+
+void job_scheduler_release(int64_t id) {
+    scheduler().release(id);
+}
+
+bool job_scheduler_wait(int64_t id) {
+    return scheduler().wait(id);
+}
+
+void job_scheduler_set_workers(int n_workers) {
+    g_workers.store(std::max(0, n_workers), std::memory_order_relaxed);
+}
+
+void job_scheduler_shutdown() {
+    scheduler().shutdown();
+}
+
+const char* job_state_name(JobState state) {
+    switch (state) {
+        case JOB_QUEUED: return "queued";
+        case JOB_RUNNING: return "running";
+        case JOB_DONE: return "done";
+        case JOB_FAILED: return "failed";
+        case JOB_CANCELLED: return "cancelled";
+    }
+    return "unknown";
+}
+
+const char* job_priority_name(JobPriority priority) {
+    switch (priority) {
+        case JOB_PRIORITY_BACKGROUND: return "background";
+        case JOB_PRIORITY_NORMAL: return "normal";
+        case JOB_PRIORITY_FOREGROUND: return "foreground";
+    }
+    return "unknown";
+}
+
+std::string job_info_to_json(const JobInfo& info) {
+    std::ostringstream out;
+    char times[192];
+    snprintf(times, sizeof(times), "\"queued_ms\": %.1f, \"vad_ms\": %.1f, \"whisper_ms\": %.1f, \"total_ms\": %.1f",
+             info.timings.queued_ms, info.timings.vad_ms, info.timings.whisper_ms, info.timings.total_ms);
+    out << "{\"id\": " << info.id
+        << ", \"state\": \"" << job_state_name(info.state)
+        << "\", \"priority\": \"" << job_priority_name(info.priority)
+        << "\", \"n_chunks\": " << info.n_chunks
+        << ", \"chunks_done\": " << info.chunks_done
+        << ", \"progress\": " << info.progress
+        << ", " << times
+        << ", \"preemptions\": " << info.timings.preemptions;
+    if (!info.error.empty()) {
+        out << ", \"error\": \"";
+        append_json_escaped(out, info.error);
+        out << '"';
+    }
+    out << '}';
+    return out.str();
+}
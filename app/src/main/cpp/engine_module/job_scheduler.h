@@ -0,0 +1,96 @@
+// job_scheduler.h
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "audio_module/audio_cache.h"
+
+// Queue of transcription jobs (one per session) served by a bounded pool of
+// worker threads, each leasing a whisper_state of the resident model.
+//
+// Every job is cut at silences into chunks of at most one whisper window
+// (parallel_transcriber.h), and a chunk is the unit of work: a worker always
+// takes the next chunk of the highest-priority job, oldest first within a
+// priority. A job the user is looking at therefore preempts backlog at the
+// next window boundary, and once it has more chunks than there are workers it
+// gets all of them. Chunk results are merged in time order when the last one
+// is done.
+
+// Higher values are served first; mirrored by TranscriptionScheduler.kt.
+enum JobPriority {
+    JOB_PRIORITY_BACKGROUND = 0, // queued sessions nobody is waiting for
+    JOB_PRIORITY_NORMAL = 1,
+    JOB_PRIORITY_FOREGROUND = 2, // the session on screen
+};
+
+enum JobState {
+    JOB_QUEUED = 0,    // no chunk started yet
+    JOB_RUNNING = 1,
+    JOB_DONE = 2,      // result ready, see job_scheduler_take_result
+    JOB_FAILED = 3,
+    JOB_CANCELLED = 4,
+};
+
+// Wall-clock milliseconds of one job. total_ms includes time spent waiting
+// behind other jobs; whisper_ms is summed over chunks, which may have run
+// concurrently, so it can exceed total_ms.
+struct JobTimings {
+    double queued_ms = 0.0;     // submit until the first worker picked the job up
+    double vad_ms = 0.0;        // conversion to 16 kHz mono, VAD and chunking
+    double whisper_ms = 0.0;
+    double total_ms = 0.0;      // submit until done, failed or cancelled (so far, while running)
+    int preemptions = 0;        // times a worker left the job for a higher-priority one
+};
+
+struct JobInfo {
+    int64_t id = 0;
+    JobState state = JOB_QUEUED;
+    JobPriority priority = JOB_PRIORITY_NORMAL;
+    int n_chunks = 0;           // known once the job has been planned
+    int chunks_done = 0;
+    int progress = 0;           // percent of chunk audio transcribed
+    std::string error;          // "ERROR: ..." for JOB_FAILED
+    JobTimings timings;
+};
+
+// Queues audio for transcription with the model at model_path. The audio is
+// held until the job ends. Starts the workers on first use. Returns the job
+// id (> 0).
+int64_t job_scheduler_submit(const std::string& model_path, SharedAudio audio, JobPriority priority);
+
+// False if id is unknown (never submitted or already taken/released).
+bool job_scheduler_status(int64_t id, JobInfo& info);
+
+// Reprioritizes a queued or running job, e.g. when the user opens its session.
+bool job_scheduler_set_priority(int64_t id, JobPriority priority);
+
+// Cancels a job: chunks not started are dropped and running ones stop within
+// one decoder step. The job ends as JOB_CANCELLED.
+bool job_scheduler_cancel(int64_t id);
+
+// For a JOB_DONE job, moves its result (transcript_layout.h) into layout and
+// forgets the job. False otherwise.
+bool job_scheduler_take_result(int64_t id, std::vector<uint8_t>& layout);
+
+// Forgets a job, cancelling it first if it has not ended.
+void job_scheduler_release(int64_t id);
+
+// Waits until the job has ended (done, failed or cancelled). False if unknown.
+bool job_scheduler_wait(int64_t id);
+
+// Worker threads, i.e. whisper_states in use at once; 0 (the default) picks
+// half the current thread plan's threads. The thread plan is split evenly
+// between the workers. Takes effect when the pool next starts.
+void job_scheduler_set_workers(int n_workers);
+
+// Cancels every job and stops the workers, e.g. at exit. A later submit
+// starts them again.
+void job_scheduler_shutdown();
+
+const char* job_state_name(JobState state);
+const char* job_priority_name(JobPriority priority);
+
+// {"id", "state", "priority", "n_chunks", "chunks_done", "progress", "queued_ms",
+//  "vad_ms", "whisper_ms", "total_ms", "preemptions"[, "error"]}
+std::string job_info_to_json(const JobInfo& info);
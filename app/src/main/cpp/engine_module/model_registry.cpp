@@ -0,0 +1,118 @@
+// model_registry.cpp
+#include "model_registry.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+#include "whisper/whisper.h"
+#include "engine_module/stage_timer.h"
+#include "engine_module/whisper_threading.h"
+#include "platform/native_log.h"
+
+#define TAG "MODEL_REGISTRY"
+
+static std::mutex g_registry_mutex;
+static std::unordered_map<std::string, std::shared_ptr<WhisperModel>> g_models;
+
+WhisperModel::~WhisperModel() {
+    for (whisper_state* state : idle_states_) {
+        whisper_free_state(state);
+    }
+    whisper_free(ctx_);
+    LOGI(TAG, "Freed model %s", path_.c_str());
+}
+
+whisper_state* WhisperModel::acquire_state() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!idle_states_.empty()) {
+            whisper_state* state = idle_states_.back();
+            idle_states_.pop_back();
+            peak_leased_ = std::max(peak_leased_, ++leased_);
+            return state;
+        }
+    }
+
+    StageTimer timer;
+    whisper_state* state = whisper_init_state(ctx_);
+    if (state == nullptr) {
+        LOGE(TAG, "whisper_init_state failed for %s", path_.c_str());
+        return nullptr;
+    }
+    LOGD(TAG, "Created new whisper_state in %.1f ms", timer.elapsed_ms());
+    std::lock_guard<std::mutex> lock(mutex_);
+    peak_leased_ = std::max(peak_leased_, ++leased_);
+    return state;
+}
+
+void WhisperModel::release_state(whisper_state* state) {
+    if (state == nullptr) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        leased_--;
+        if (idle_states_.size() < peak_leased_) {
+            idle_states_.push_back(state);
+            return;
+        }
+    }
+    whisper_free_state(state);
+}
+
+size_t WhisperModel::idle_state_count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return idle_states_.size();
+}
+
+PooledState::PooledState(std::shared_ptr<WhisperModel> model)
+    : model_(std::move(model)), state_(model_ ? model_->acquire_state() : nullptr) {}
+
+PooledState::~PooledState() {
+    if (model_) model_->release_state(state_);
+}
+
+std::shared_ptr<WhisperModel> model_registry_acquire(const std::string& model_path) {
+    // Loading happens under the registry lock so concurrent first calls for the
+    // same path wait for one load instead of parsing the file twice.
+    std::lock_guard<std::mutex> lock(g_registry_mutex);
+
+    auto it = g_models.find(model_path);
+    if (it != g_models.end()) {
+        return it->second;
+    }
+
+    // the CPU backend is loaded by now; from here on graphs run on the persistent threads
+    whisper_threading_install();
+
+    StageTimer timer;
+    whisper_context* ctx = whisper_init_from_file_with_params_no_state(model_path.c_str(), whisper_context_default_params());
+    if (ctx == nullptr) {
+        LOGE(TAG, "Failed to load model %s", model_path.c_str());
+        return nullptr;
+    }
+    LOGI(TAG, "Loaded model %s in %.1f ms", model_path.c_str(), timer.elapsed_ms());
+
+    std::shared_ptr<WhisperModel> model(new WhisperModel(model_path, ctx));
+    g_models.emplace(model_path, model);
+    return model;
+}
+
+bool model_registry_release(const std::string& model_path) {
+    std::shared_ptr<WhisperModel> released;
+    {
+        std::lock_guard<std::mutex> lock(g_registry_mutex);
+        auto it = g_models.find(model_path);
+        if (it == g_models.end()) return false;
+        released = std::move(it->second);
+        g_models.erase(it);
+    }
+    // freed here, outside the lock, unless a job still holds a reference
+    return true;
+}
+
+void model_registry_release_all() {
+    std::unordered_map<std::string, std::shared_ptr<WhisperModel>> released;
+    {
+        std::lock_guard<std::mutex> lock(g_registry_mutex);
+        released.swap(g_models);
+    }
+}
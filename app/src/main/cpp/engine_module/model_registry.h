@@ -0,0 +1,76 @@
+// model_registry.h
+#pragma once
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct whisper_context;
+struct whisper_state;
+
+// A whisper model loaded once (without a default state) together with a pool
+// of idle whisper_state objects. Creating a state allocates the backend
+// scheduler and compute buffers, so states are recycled rather than freed
+// after every job. Obtain instances through model_registry_acquire().
+class WhisperModel {
+public:
+    ~WhisperModel();
+
+    WhisperModel(const WhisperModel&) = delete;
+    WhisperModel& operator=(const WhisperModel&) = delete;
+
+    whisper_context* context() const { return ctx_; }
+    const std::string& path() const { return path_; }
+
+    // Returns an idle state or creates a new one; nullptr if allocation fails.
+    // Prefer PooledState, which hands the state back automatically.
+    whisper_state* acquire_state();
+    void release_state(whisper_state* state);
+
+    size_t idle_state_count() const;
+
+private:
+    friend std::shared_ptr<WhisperModel> model_registry_acquire(const std::string& model_path);
+
+    WhisperModel(std::string path, whisper_context* ctx) : path_(std::move(path)), ctx_(ctx) {}
+
+    const std::string path_;
+    whisper_context* const ctx_;
+    mutable std::mutex mutex_;
+    // Up to the most states leased at once are kept, so the next job run the
+    // same way (parallel chunk workers, scheduler workers, a speculative-encode
+    // state) finds all of its states; a release above that frees the state.
+    std::vector<whisper_state*> idle_states_;
+    size_t leased_ = 0;
+    size_t peak_leased_ = 0;
+};
+
+// Scoped lease on a pooled state. Holds a reference to the model, so the model
+// stays alive until the lease ends even if it is released from the registry.
+class PooledState {
+public:
+    explicit PooledState(std::shared_ptr<WhisperModel> model);
+    ~PooledState();
+
+    PooledState(const PooledState&) = delete;
+    PooledState& operator=(const PooledState&) = delete;
+
+    whisper_state* get() const { return state_; }
+    whisper_context* context() const { return model_->context(); }
+    explicit operator bool() const { return state_ != nullptr; }
+
+private:
+    std::shared_ptr<WhisperModel> model_;
+    whisper_state* state_;
+};
+
+// Process-wide registry of resident models, keyed by model path.
+// Loads the model on first use and returns the resident instance afterwards;
+// nullptr if the model cannot be loaded.
+std::shared_ptr<WhisperModel> model_registry_acquire(const std::string& model_path);
+
+// Drops the model from the registry. It is freed as soon as the last running
+// job using it finishes. Returns false if the path was not loaded.
+bool model_registry_release(const std::string& model_path);
+
+void model_registry_release_all();
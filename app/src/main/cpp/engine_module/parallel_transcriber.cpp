@@ -0,0 +1,226 @@
+// parallel_transcriber.cpp
+#include "parallel_transcriber.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <numeric>
+
+#include "engine_module/cancellation.h"
+#include "engine_module/model_registry.h"
+#include "engine_module/rtf_governor.h"
+#include "engine_module/transcript_layout.h"
+#include "engine_module/transcription_listener.h"
+#include "platform/cpu_topology.h"
+#include "platform/native_log.h"
+#include "platform/worker_pool.h"
+
+#define TAG "PARALLEL_TRANSCRIBER"
+
+namespace {
+
+constexpr int kCutFrameMs = 20;
+
+// Start of the 20 ms frame with the least energy in [lo, hi).
+size_t quietest_frame(const float* samples, size_t lo, size_t hi, size_t frame_len) {
+    size_t best = hi;
+    double best_energy = 0.0;
+    for (size_t f = lo; f + frame_len <= hi; f += frame_len) {
+        double energy = 0.0;
+        for (size_t i = f; i < f + frame_len; ++i) {
+            energy += static_cast<double>(samples[i]) * samples[i];
+        }
+        if (best == hi || energy < best_energy) {
+            best = f;
+            best_energy = energy;
+        }
+    }
+    return best;
+}
+
+// Segments of a layout written by write_transcript_layout.
+std::vector<TranscribedSegment> layout_segments(const std::vector<uint8_t>& layout) {
+    std::vector<TranscribedSegment> segments;
+    if (layout.size() < sizeof(TranscriptLayoutHeader)) return segments;
+    TranscriptLayoutHeader header;
+    memcpy(&header, layout.data(), sizeof(header));
+    const char* text = reinterpret_cast<const char*>(layout.data() + header.text_offset);
+    for (uint32_t i = 0; i < header.n_segments; ++i) {
+        TranscriptSegmentRecord seg;
+        memcpy(&seg, layout.data() + header.segments_offset + i * sizeof(seg), sizeof(seg));
+        segments.push_back({seg.t0_ms, seg.t1_ms, std::string(text + seg.text_offset, seg.text_bytes)});
+    }
+    return segments;
+}
+
+} // namespace
+
+std::vector<ParallelChunk> plan_parallel_chunks(const float* samples, size_t n_samples, int sample_rate,
+                                                const std::vector<SpeechSegment>& speech) {
+    std::vector<ParallelChunk> chunks;
+    if (samples == nullptr || sample_rate <= 0) return chunks;
+
+    auto to_sample = [&](int64_t ms) {
+        return std::min(n_samples, static_cast<size_t>(std::max<int64_t>(0, ms) * sample_rate / 1000));
+    };
+    const size_t max_len = to_sample(kParallelMaxChunkMs);
+    const size_t frame_len = static_cast<size_t>(sample_rate) * kCutFrameMs / 1000;
+    if (max_len == 0 || frame_len == 0) return chunks;
+
+    bool open = false;
+    ParallelChunk current;
+    for (const SpeechSegment& region : speech) {
+        size_t begin = to_sample(region.start_ms);
+        const size_t end = to_sample(region.end_ms);
+        if (end <= begin) continue;
+
+        // the next region fits: the silence between them stays inside the chunk
+        if (open && end - current.begin <= max_len) {
+            current.end = end;
+            continue;
+        }
+        if (open) chunks.push_back(current);
+
+        // a region too long for one chunk is cut where it is quietest
+        while (end - begin > max_len) {
+            const size_t cut = quietest_frame(samples, begin + max_len * 2 / 3, begin + max_len, frame_len);
+            chunks.push_back({begin, cut});
+            begin = cut;
+        }
+        current = {begin, end};
+        open = true;
+    }
+    if (open) chunks.push_back(current);
+    return chunks;
+}
+
+static std::atomic<int> g_workers{1};
+
+void parallel_transcribe_set_workers(int n_workers) {
+    g_workers.store(std::max(0, n_workers), std::memory_order_relaxed);
+}
+
+int parallel_transcribe_workers() {
+    return g_workers.load(std::memory_order_relaxed);
+}
+
+int parallel_transcribe_plan_workers(size_t n_chunks) {
+    int n_workers = parallel_transcribe_workers();
+    if (n_workers == 0) {
+        n_workers = std::max(1, current_thread_plan().n_threads / 2);
+    }
+    return static_cast<int>(std::min<size_t>(static_cast<size_t>(n_workers), n_chunks));
+}
+
+std::string run_whisper_parallel(const std::shared_ptr<WhisperModel>& model,
+                                 const float* samples,
+                                 size_t n_samples,
+                                 const std::vector<ParallelChunk>& chunks,
+                                 struct whisper_full_params params,
+                                 int n_workers,
+                                 std::vector<uint8_t>& layout,
+                                 TranscriptionListener* listener,
+                                 const CancellationToken* cancel,
+                                 RtfGovernor* governor) {
+    n_workers = std::max(1, std::min(n_workers, static_cast<int>(chunks.size())));
+
+    // longest first, so the last chunks to be picked up are short ones
+    std::vector<size_t> order(chunks.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&chunks](size_t a, size_t b) {
+        return chunks[a].end - chunks[a].begin > chunks[b].end - chunks[b].begin;
+    });
+    size_t total_samples = 0;
+    for (const ParallelChunk& chunk : chunks) total_samples += chunk.end - chunk.begin;
+
+    // chunk results are independent; whisper's own callbacks would interleave
+    params.new_segment_callback = nullptr;
+    params.progress_callback = nullptr;
+    if (cancel != nullptr) {
+        cancel->install(params);
+    }
+
+    std::vector<std::vector<uint8_t>> parts(chunks.size());
+    std::vector<bool> done(chunks.size(), false);
+    std::atomic<size_t> next_job{0};
+    std::atomic<bool> failed{false};
+    std::mutex mutex; // guards done, error, the delivery cursor and the listener
+    std::string error;
+    size_t delivered = 0;
+    size_t done_samples = 0;
+    int last_progress = -1;
+
+    auto fail = [&](const std::string& message) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (error.empty()) error = message;
+        failed.store(true);
+    };
+
+    // Marks chunk c done and hands the listener every segment that is now in
+    // time order, i.e. those of the completed prefix of chunks.
+    auto complete = [&](size_t c) {
+        std::lock_guard<std::mutex> lock(mutex);
+        done[c] = true;
+        done_samples += chunks[c].end - chunks[c].begin;
+        if (listener == nullptr) return;
+        std::vector<TranscribedSegment> ready;
+        for (; delivered < chunks.size() && done[delivered]; ++delivered) {
+            std::vector<TranscribedSegment> segments = layout_segments(parts[delivered]);
+            ready.insert(ready.end(), segments.begin(), segments.end());
+        }
+        if (!ready.empty()) listener->on_segments(ready);
+        const int progress = static_cast<int>(done_samples * 100 / std::max<size_t>(1, total_samples));
+        if (progress != last_progress) {
+            last_progress = progress;
+            listener->on_progress(progress);
+        }
+    };
+
+    auto worker = [&]() {
+        if (next_job.load() >= order.size()) return; // started after the others took every chunk
+        PooledState state(model);
+        if (!state) {
+            fail("ERROR: whisper_init_state failed.");
+            return;
+        }
+        for (size_t job = next_job.fetch_add(1); job < order.size(); job = next_job.fetch_add(1)) {
+            if (failed.load() || is_cancelled(cancel)) return;
+            const size_t c = order[job];
+            const ParallelChunk& chunk = chunks[c];
+            struct whisper_full_params chunk_params = params;
+            if (governor != nullptr) {
+                governor->install(chunk_params);
+            }
+            const int rc = whisper_full_with_state(state.context(), state.get(), chunk_params, samples + chunk.begin,
+                                                   static_cast<int>(chunk.end - chunk.begin));
+            if (is_cancelled(cancel)) return;
+            if (rc != 0) {
+                LOGE(TAG, "whisper_full failed on chunk %zu with code: %d", c, rc);
+                fail("ERROR: whisper_full failed, code: " + std::to_string(rc));
+                return;
+            }
+            const int64_t offset_ms = static_cast<int64_t>(chunk.begin) * 1000 / WHISPER_SAMPLE_RATE;
+            write_transcript_layout(state.context(), state.get(), parts[c],
+                                    [offset_ms](int64_t t) { return offset_ms + t * 10; });
+            complete(c);
+        }
+    };
+
+    LOGI(TAG, "%zu chunks (%.1f s of %.1f s) on %d workers x %d threads.", chunks.size(),
+         total_samples / static_cast<double>(WHISPER_SAMPLE_RATE), n_samples / static_cast<double>(WHISPER_SAMPLE_RATE),
+         n_workers, params.n_threads);
+
+    // the calling thread is worker 0; pool workers inherit its cpu affinity, and
+    // the chunks left to a busy pool are taken by the workers that did start
+    worker_pool().parallel_for(n_workers, n_workers, [&worker](int) { worker(); });
+
+    if (is_cancelled(cancel)) {
+        return "ERROR: Cancelled.";
+    }
+    if (!error.empty()) {
+        return error;
+    }
+    merge_transcript_layouts(parts, layout);
+    return "";
+}
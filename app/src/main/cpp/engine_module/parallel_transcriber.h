@@ -0,0 +1,64 @@
+// parallel_transcriber.h
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "whisper/whisper.h"
+#include "diarization_module/vad_engine.h"
+
+class CancellationToken;
+class RtfGovernor;
+class TranscriptionListener;
+class WhisperModel;
+
+// Parallel transcription of one recording. Instead of whisper_full_parallel's
+// n equal slices (one per thread, cut mid-word, the slice with most speech
+// finishing last), the audio is cut into many short chunks at VAD silences.
+// A fixed set of workers, each with its own pooled whisper_state, pull chunks
+// from a shared queue (longest first) until it is empty, and the results are
+// merged in time order. Silence between chunks is not transcribed.
+
+// Sample range [begin, end) of the 16 kHz input.
+struct ParallelChunk {
+    size_t begin = 0;
+    size_t end = 0;
+};
+
+// Chunks stay within one 30 s whisper window, so each is a single encode.
+constexpr int64_t kParallelMaxChunkMs = 28000;
+
+// Groups consecutive speech regions into chunks of at most kParallelMaxChunkMs,
+// cutting in the silence between regions. A region longer than that is split
+// at its quietest 20 ms frame within the last third of each chunk.
+std::vector<ParallelChunk> plan_parallel_chunks(const float* samples, size_t n_samples, int sample_rate,
+                                                const std::vector<SpeechSegment>& speech);
+
+// Workers used by transcription: 1 (the default) transcribes sequentially,
+// 0 picks half the current thread plan's threads, n > 1 uses n workers.
+// The thread plan is split evenly between the workers of a job.
+void parallel_transcribe_set_workers(int n_workers);
+int parallel_transcribe_workers();
+
+// Worker count for a job of n_chunks under the current setting and thread plan.
+int parallel_transcribe_plan_workers(size_t n_chunks);
+
+// Transcribes chunks of samples[0, n_samples) (16 kHz mono) with n_workers
+// states of model and writes the merged result to layout (transcript_layout.h,
+// times in the input audio). params.n_threads is the per-worker thread count.
+// listener gets segments in time order as the chunks before them complete, and
+// progress as the share of chunk audio done. governor, if set, picks the effort
+// of every chunk. Returns "" on success, else the "ERROR: ..." message;
+// "ERROR: Cancelled." if cancel fires.
+std::string run_whisper_parallel(const std::shared_ptr<WhisperModel>& model,
+                                 const float* samples,
+                                 size_t n_samples,
+                                 const std::vector<ParallelChunk>& chunks,
+                                 struct whisper_full_params params,
+                                 int n_workers,
+                                 std::vector<uint8_t>& layout,
+                                 TranscriptionListener* listener,
+                                 const CancellationToken* cancel,
+                                 RtfGovernor* governor = nullptr);
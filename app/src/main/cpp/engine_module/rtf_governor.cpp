@@ -0,0 +1,140 @@
+// rtf_governor.cpp
+#include "rtf_governor.h"
+
+#include <algorithm>
+#include <atomic>
+
+#include "platform/native_log.h"
+
+#define TAG "RTF_GOVERNOR"
+
+namespace {
+
+// weight of the newest window in the smoothed RTF
+constexpr double kSmoothing = 0.3;
+// under this share of the target there is room to spend more effort
+constexpr double kHeadroom = 0.7;
+// windows to wait after a step before judging it
+constexpr int kSettleWindows = 2;
+// the tail of a recording is too short to say much about speed
+constexpr int kMinWindowAudioMs = 2000;
+
+const char* const kLevelNames[RtfGovernor::kLevels + 1] = {
+    "full effort",
+    "no temperature fallback",
+    "single decoder",
+    "audio_ctx 1024",
+    "audio_ctx 768",
+};
+
+std::atomic<float> g_target_rtf{0.0f};
+
+} // namespace
+
+void rtf_governor_set_target(float rtf) {
+    g_target_rtf.store(std::max(0.0f, rtf), std::memory_order_relaxed);
+}
+
+float rtf_governor_target() {
+    return g_target_rtf.load(std::memory_order_relaxed);
+}
+
+RtfGovernor::RtfGovernor(float target_rtf, const struct whisper_full_params& base, int lanes)
+    : target_(target_rtf),
+      lanes_(std::max(1, lanes)),
+      base_threads_(std::max(1, base.n_threads)),
+      base_best_of_(base.greedy.best_of),
+      base_beam_size_(base.beam_search.beam_size),
+      base_audio_ctx_(base.audio_ctx),
+      n_threads_(base_threads_) {
+    LOGI(TAG, "Target RTF %.2f, %d lane(s) x %d threads.", target_, lanes_, base_threads_);
+}
+
+RtfGovernor::~RtfGovernor() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (n_windows_ > 0) {
+        LOGI(TAG, "%d windows, RTF %.2f (target %.2f), %d steps, ended at %s with %d threads.", n_windows_, rtf_, target_,
+             n_steps_, kLevelNames[level_], n_threads_);
+    }
+}
+
+int RtfGovernor::level() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return level_;
+}
+
+void RtfGovernor::install(struct whisper_full_params& params) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    struct whisper_window_tuning tuning;
+    tuning_locked(tuning);
+    params.n_threads = tuning.n_threads;
+    params.greedy.best_of = tuning.best_of;
+    params.beam_search.beam_size = tuning.beam_size;
+    params.audio_ctx = tuning.audio_ctx;
+    if (!tuning.allow_fallback) {
+        params.temperature_inc = 0.0f;
+    }
+    params.window_callback = on_window;
+    params.window_callback_user_data = this;
+}
+
+void RtfGovernor::tuning_locked(struct whisper_window_tuning& tuning) const {
+    tuning.n_threads = n_threads_;
+    tuning.best_of = level_ >= 2 ? 1 : base_best_of_;
+    tuning.beam_size = level_ >= 2 ? 1 : base_beam_size_;
+    tuning.audio_ctx = level_ >= 4 ? 768 : level_ >= 3 ? 1024 : base_audio_ctx_;
+    if (base_audio_ctx_ > 0) {
+        tuning.audio_ctx = std::min(tuning.audio_ctx, base_audio_ctx_);
+    }
+    tuning.allow_fallback = level_ < 1;
+}
+
+void RtfGovernor::on_window(struct whisper_context* /* ctx */, struct whisper_state* /* state */,
+                            const struct whisper_window_stats* stats, struct whisper_window_tuning* tuning, void* user_data) {
+    auto* governor = static_cast<RtfGovernor*>(user_data);
+    governor->observe(*stats);
+    std::lock_guard<std::mutex> lock(governor->mutex_);
+    governor->tuning_locked(*tuning);
+}
+
+void RtfGovernor::observe(const struct whisper_window_stats& stats) {
+    if (stats.audio_ms < kMinWindowAudioMs) return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    // concurrent lanes share the wall clock, so each counts for 1/lanes of the job
+    const double window_rtf = stats.wall_ms / stats.audio_ms / lanes_;
+    rtf_ = rtf_ < 0.0 ? window_rtf : kSmoothing * window_rtf + (1.0 - kSmoothing) * rtf_;
+    n_windows_++;
+    LOGD(TAG, "Window at %d ms: %d ms of audio in %.0f ms (encode %.0f, decode %.0f, %d fallbacks), RTF %.2f.",
+         stats.seek_ms, stats.audio_ms, stats.wall_ms, stats.encode_ms, stats.decode_ms, stats.n_fallbacks, rtf_);
+
+    if (settle_ > 0) {
+        settle_--;
+        return;
+    }
+
+    const int min_threads = std::max(1, base_threads_ / 2);
+    const int level = level_;
+    const int n_threads = n_threads_;
+    if (rtf_ > target_) {
+        // behind: threads cost no accuracy, so they come back first
+        if (n_threads_ < base_threads_) {
+            n_threads_ = base_threads_;
+        } else if (level_ < kLevels) {
+            level_++;
+        }
+    } else if (rtf_ < kHeadroom * target_) {
+        // ahead: accuracy comes back first, then threads are shed to save power
+        if (level_ > 0) {
+            level_--;
+        } else if (n_threads_ > min_threads) {
+            n_threads_--;
+        }
+    }
+    if (level_ == level && n_threads_ == n_threads) return;
+
+    n_steps_++;
+    settle_ = kSettleWindows;
+    LOGI(TAG, "RTF %.2f vs target %.2f: %s with %d threads -> %s with %d threads.", rtf_, target_, kLevelNames[level], n_threads,
+         kLevelNames[level_], n_threads_);
+}
@@ -0,0 +1,59 @@
+// rtf_governor.h
+#pragma once
+#include <mutex>
+
+#include "whisper/whisper.h"
+
+// Holds transcription to a real-time factor (wall time / audio time) target by
+// adapting decoding effort window by window, so a long session on a throttled
+// device keeps a predictable deadline instead of slowing down without bound.
+//
+// whisper reports what each window cost (whisper_full_params.window_callback).
+// While the smoothed RTF is over target the governor first gives back threads
+// it shed, then steps down the effort ladder
+//   full -> no temperature fallback -> one decoder -> audio_ctx 1024 -> audio_ctx 768
+// and while it is well under target it walks back up, shedding threads only
+// once at full effort. Every step is logged. A reduced audio context shortens
+// the windows (20.48 s at 1024, 15.36 s at 768), so no audio goes unencoded.
+
+// Target RTF, e.g. 0.5 = twice as fast as real time; 0 (the default) disables the governor.
+void rtf_governor_set_target(float rtf);
+float rtf_governor_target();
+
+class RtfGovernor {
+public:
+    // Effort steps below full; level() is in [0, kLevels].
+    static constexpr int kLevels = 4;
+
+    // base: the parameters of the job at full effort. lanes: windows of the job
+    // decoded at once (parallel workers); their RTFs add up to the job's.
+    RtfGovernor(float target_rtf, const struct whisper_full_params& base, int lanes = 1);
+    ~RtfGovernor();
+
+    // Sets params to the current effort and reports its windows to the
+    // governor. Called for every whisper_full of the job, from any thread.
+    void install(struct whisper_full_params& params);
+
+    int level() const;
+
+private:
+    static void on_window(struct whisper_context* ctx, struct whisper_state* state, const struct whisper_window_stats* stats,
+                          struct whisper_window_tuning* tuning, void* user_data);
+    void observe(const struct whisper_window_stats& stats);
+    void tuning_locked(struct whisper_window_tuning& tuning) const;
+
+    const float target_;
+    const int lanes_;
+    const int base_threads_;
+    const int base_best_of_;
+    const int base_beam_size_;
+    const int base_audio_ctx_;
+
+    mutable std::mutex mutex_;
+    int level_ = 0;
+    int n_threads_;
+    double rtf_ = -1.0;    // smoothed, < 0 until the first window
+    int settle_ = 0;       // windows to observe before the next step
+    int n_windows_ = 0;
+    int n_steps_ = 0;
+};
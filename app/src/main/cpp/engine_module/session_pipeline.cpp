@@ -0,0 +1,432 @@
+// session_pipeline.cpp
+#include "session_pipeline.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <sstream>
+
+#include "whisper/whisper.h"
+#include "audio_module/aligned_buffer.h"
+#include "audio_module/audio_cache.h"
+#include "audio_module/mel_filterbank.h"
+#include "audio_module/resampler.h"
+#include "audio_module/stft_frontend.h"
+#include "diarization_module/vad_engine.h"
+#include "diarization_module/embedding_extractor.h"
+#include "diarization_module/speaker_clusterer.h"
+#include "engine_module/cancellation.h"
+#include "engine_module/diarizer.h"
+#include "engine_module/encoder_cache.h"
+#include "engine_module/model_registry.h"
+#include "engine_module/rtf_governor.h"
+#include "engine_module/stage_timer.h"
+#include "engine_module/transcriber.h"
+#include "engine_module/transcription_listener.h"
+#include "platform/cpu_topology.h"
+#include "platform/native_log.h"
+#include "platform/worker_pool.h"
+
+#define TAG "SESSION_PIPELINE"
+
+namespace {
+
+// Silence inserted between concatenated speech regions so whisper does not
+// run words from separate regions together. A whole number of STFT hops, like
+// the regions' offsets, so the recording's frames line up with whisper's.
+constexpr size_t kRegionGapSamples = WHISPER_SAMPLE_RATE / 10;
+static_assert(kRegionGapSamples % StftFrontend::kHop == 0, "region gaps are whole hops");
+
+// A speech region as placed in the concatenated whisper input.
+struct SpeechChunk {
+    size_t compact_offset;
+    size_t source_offset;
+    size_t length;
+};
+
+struct SpeechMap {
+    AlignedFloatBuffer samples;
+    std::vector<SpeechChunk> chunks;
+
+    // Maps a position in the concatenated input back to the recording. Positions
+    // inside a gap snap to the end of the preceding region.
+    int64_t source_ms(int64_t compact_sample) const {
+        if (chunks.empty()) return 0;
+        auto it = std::upper_bound(chunks.begin(), chunks.end(), compact_sample,
+                                   [](int64_t pos, const SpeechChunk& c) { return pos < static_cast<int64_t>(c.compact_offset); });
+        const SpeechChunk& c = it == chunks.begin() ? chunks.front() : *(it - 1);
+        int64_t within = std::max<int64_t>(0, compact_sample - static_cast<int64_t>(c.compact_offset));
+        within = std::min<int64_t>(within, static_cast<int64_t>(c.length));
+        return (static_cast<int64_t>(c.source_offset) + within) * 1000 / WHISPER_SAMPLE_RATE;
+    }
+};
+
+size_t ms_to_sample(int64_t ms, size_t n_samples) {
+    return std::min(n_samples, static_cast<size_t>(std::max<int64_t>(0, ms)) * WHISPER_SAMPLE_RATE / 1000);
+}
+
+// Region [begin, end) of speech segment s, widened to whole hops: only the
+// recording's end may cut the last one short.
+std::pair<size_t, size_t> region_samples(const SpeechSegment& s, size_t n_samples) {
+    const size_t hop = StftFrontend::kHop;
+    const size_t begin = ms_to_sample(s.start_ms, n_samples) / hop * hop;
+    const size_t end = std::min(n_samples, (ms_to_sample(s.end_ms, n_samples) + hop - 1) / hop * hop);
+    return {begin, end};
+}
+
+SpeechMap build_speech_map(const AlignedFloatBuffer& mono, const std::vector<SpeechSegment>& speech) {
+    SpeechMap map;
+    size_t total = 0;
+    for (const SpeechSegment& s : speech) {
+        const std::pair<size_t, size_t> region = region_samples(s, mono.size());
+        total += region.second - region.first + kRegionGapSamples;
+    }
+    map.samples.resize(total);
+
+    size_t pos = 0;
+    for (const SpeechSegment& s : speech) {
+        const size_t begin = region_samples(s, mono.size()).first;
+        const size_t end = region_samples(s, mono.size()).second;
+        if (end <= begin) continue;
+        if (!map.chunks.empty()) {
+            std::fill(map.samples.data() + pos, map.samples.data() + pos + kRegionGapSamples, 0.0f);
+            pos += kRegionGapSamples;
+        }
+        std::copy(mono.data() + begin, mono.data() + end, map.samples.data() + pos);
+        map.chunks.push_back({pos, begin, end - begin});
+        pos += end - begin;
+    }
+    map.samples.resize(pos);
+    return map;
+}
+
+// whisper's log10 mel frames of map.samples (whisper_set_mel_frames_with_state).
+// A frame whose window lies inside one region is the recording's frame at the
+// same place, which the VAD pass computed; only frames whose window reaches
+// a gap or an end of the input get a spectrum of their own.
+std::vector<float> speech_map_mel_frames(const SpeechMap& map, const SpectralFeatures& features,
+                                         const SparseMelFilterbank& filters) {
+    const StftFrontend& stft = StftFrontend::get();
+    const int64_t hop = StftFrontend::kHop;
+    const int64_t half = StftFrontend::kFrameSize / 2;
+    const int64_t n_samples = static_cast<int64_t>(map.samples.size());
+    const int64_t n_frames = (n_samples + half) / hop + 1;
+    const size_t n_mel = static_cast<size_t>(filters.n_mel());
+
+    std::vector<float> frames(static_cast<size_t>(n_frames) * n_mel);
+    std::vector<float> power(StftFrontend::kBins), scratch(stft.scratch_size());
+    size_t chunk = 0;
+    for (int64_t i = 0; i < n_frames; ++i) {
+        const int64_t centre = i * hop;
+        while (chunk + 1 < map.chunks.size() && static_cast<int64_t>(map.chunks[chunk + 1].compact_offset) <= centre) ++chunk;
+        float* out = frames.data() + static_cast<size_t>(i) * n_mel;
+        if (!map.chunks.empty()) {
+            const SpeechChunk& c = map.chunks[chunk];
+            const int64_t begin = static_cast<int64_t>(c.compact_offset);
+            const int64_t end = begin + static_cast<int64_t>(c.length);
+            const size_t source_centre = c.source_offset + static_cast<size_t>(std::max<int64_t>(0, centre - begin));
+            if (centre - half >= begin && centre + half <= end && source_centre % hop == 0) {
+                const size_t source = source_centre / hop;
+                if (source < features.n_frames) {
+                    std::copy_n(features.log_mel.data() + source * n_mel, n_mel, out);
+                    continue;
+                }
+            }
+        }
+        stft.frame_power(map.samples.data(), 0, n_samples, i, power.data(), scratch.data());
+        filters.apply_log10(power.data(), out);
+    }
+    return frames;
+}
+
+// Embeddings + clustering for the VAD regions; runs beside whisper.
+struct SpeakerBranch {
+    std::vector<DiarizedSegment> speakers;
+    double embedding_ms = 0.0;
+    double clustering_ms = 0.0;
+
+    void run(void* embed_ctx, const AlignedFloatBuffer& mono, const std::vector<SpeechSegment>& speech,
+             const CancellationToken* cancel) {
+        StageTimer embedding_timer;
+        std::vector<SpeakerEmbedding> embeddings = embed_speech_segments(embed_ctx, mono.data(), mono.size(), speech, cancel);
+        embedding_ms = embedding_timer.elapsed_ms();
+        if (is_cancelled(cancel)) return;
+
+        StageTimer clustering_timer;
+        speakers = cluster_speaker_embeddings(speech, embeddings);
+        clustering_ms = clustering_timer.elapsed_ms();
+    }
+};
+
+// Speaker whose region overlaps [start_ms, end_ms) most; the nearest one if none overlaps.
+const std::string& attribute_speaker(const std::vector<DiarizedSegment>& speakers, int64_t start_ms, int64_t end_ms) {
+    static const std::string kUnknown = "SPEAKER_UNKNOWN";
+    const DiarizedSegment* best = nullptr;
+    int64_t best_score = INT64_MIN;
+    for (const DiarizedSegment& d : speakers) {
+        const int64_t overlap = std::min(end_ms, d.segment.end_ms) - std::max(start_ms, d.segment.start_ms);
+        // negative overlap is the distance between the two intervals
+        if (overlap > best_score) {
+            best_score = overlap;
+            best = &d;
+        }
+    }
+    return best != nullptr ? best->speaker_label : kUnknown;
+}
+
+// Java strings index UTF-16 code units: one per UTF-8 sequence, two for 4-byte ones.
+int utf16_length(const std::string& utf8) {
+    int n = 0;
+    for (unsigned char c : utf8) {
+        if ((c & 0xC0) != 0x80) ++n;
+        if (c >= 0xF0) ++n;
+    }
+    return n;
+}
+
+void append_json_string(std::ostringstream& out, const std::string& s) {
+    out << '"';
+    for (unsigned char c : s) {
+        switch (c) {
+            case '"':  out << "\\\""; break;
+            case '\\': out << "\\\\"; break;
+            case '\n': out << "\\n"; break;
+            case '\r': out << "\\r"; break;
+            case '\t': out << "\\t"; break;
+            default:
+                if (c < 0x20) {
+                    char buf[8];
+                    snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    out << buf;
+                } else {
+                    out << static_cast<char>(c);
+                }
+        }
+    }
+    out << '"';
+}
+
+} // namespace
+
+bool run_session_pipeline(const std::string& model_path,
+                          const PcmAudio& audio,
+                          SessionResult& result,
+                          std::string& error,
+                          SessionTimings* timings,
+                          TranscriptionListener* listener,
+                          const CancellationToken* cancel) {
+    SessionTimings local_timings;
+    SessionTimings& t = timings != nullptr ? *timings : local_timings;
+    StageTimer total_timer;
+
+    result = SessionResult();
+    if (audio.samples.empty()) {
+        error = "PCM audio is empty.";
+        return false;
+    }
+
+    // Every stage (and every thread started below) runs on the policy's cores
+    const ThreadPlan plan = current_thread_plan();
+    ScopedThreadAffinity affinity(plan);
+
+    // --- 1. 16 kHz mono, shared by every stage ---
+    StageTimer resample_timer;
+    PcmAudio converted;
+    const PcmAudio& mono = conform_audio(audio, WHISPER_SAMPLE_RATE, converted);
+    t.resample_ms = resample_timer.elapsed_ms();
+
+    // --- 2. Model + state before any work is started ---
+    StageTimer model_timer;
+    std::shared_ptr<WhisperModel> model = model_registry_acquire(model_path);
+    t.model_load_ms = model_timer.elapsed_ms();
+    if (!model) {
+        error = "whisper_init_from_file failed.";
+        return false;
+    }
+    StageTimer state_timer;
+    PooledState state(model);
+    t.state_init_ms = state_timer.elapsed_ms();
+    if (!state) {
+        error = "whisper_init_state failed.";
+        return false;
+    }
+
+    // --- 3. One STFT pass: the VAD's frame energies and whisper's mel frames ---
+    StageTimer vad_timer;
+    int n_mel = 0;
+    int n_fft = 0;
+    const float* mel_filters = whisper_model_mel_filters(state.context(), &n_mel, &n_fft);
+    const SparseMelFilterbank filters(mel_filters, n_mel, n_fft);
+    SpectralFeatures features;
+    std::vector<SpeechSegment> speech;
+    if (analyze_spectrum(mono.samples.data(), mono.samples.size(), &filters, features, cancellation_flag(cancel))) {
+        void* vad_ctx = init_vad_engine();
+        speech = process_energies_for_vad(vad_ctx, features.energy_db.data(), features.n_frames,
+                                          static_cast<int64_t>(mono.samples.size()) * 1000 / WHISPER_SAMPLE_RATE);
+        free_vad_engine(vad_ctx);
+    }
+    t.vad_ms = vad_timer.elapsed_ms();
+    if (is_cancelled(cancel)) {
+        error = "Cancelled.";
+        return false;
+    }
+    LOGI(TAG, "VAD: %zu speech regions in %.1f s of audio.", speech.size(), mono.duration_s());
+    if (speech.empty()) {
+        t.total_ms = total_timer.elapsed_ms();
+        return true; // nothing was said
+    }
+
+    // --- 4. whisper over the speech regions, speakers concurrently ---
+    SpeechMap map = build_speech_map(mono.samples, speech);
+
+    // the speaker branch takes one of the plan's cores, whisper the rest
+    struct whisper_full_params params = transcribe_default_params();
+    params.n_threads = std::max(1, std::min(plan.n_threads, static_cast<int>(plan.cpus.size()) - 1));
+
+    std::unique_ptr<void, void (*)(void*)> embed_ctx(init_embedding_extractor(), free_embedding_extractor);
+    SpeakerBranch speaker_branch;
+    // on a pool worker; leaving this scope, by return or exception, waits for it
+    WorkerPool::Task speaker_task = worker_pool().async([&speaker_branch, &embed_ctx, &mono, &speech, cancel]() {
+        speaker_branch.run(embed_ctx.get(), mono.samples, speech, cancel);
+    });
+
+    TranscriptionListenerBridge listener_bridge(listener, [&map](int64_t t_whisper) {
+        return map.source_ms(t_whisper * WHISPER_SAMPLE_RATE / 100);
+    });
+    listener_bridge.install(params);
+    if (cancel != nullptr) {
+        cancel->install(params);
+    }
+    std::unique_ptr<RtfGovernor> governor;
+    if (rtf_governor_target() > 0.0f) {
+        governor = std::make_unique<RtfGovernor>(rtf_governor_target(), params);
+        governor->install(params);
+    }
+    std::shared_ptr<EncoderCache> encoder_cache = encoder_cache_for(audio, model_path);
+    if (encoder_cache) {
+        encoder_cache->install(params);
+    }
+
+    StageTimer full_timer;
+    // whisper's spectrogram of the speech regions, from the frames of step 3
+    int whisper_result;
+    {
+        const std::vector<float> mel_frames = speech_map_mel_frames(map, features, filters);
+        features = SpectralFeatures();
+        whisper_result = whisper_set_mel_frames_with_state(state.context(), state.get(), mel_frames.data(),
+                                                           static_cast<int>(mel_frames.size() / n_mel),
+                                                           static_cast<int>(map.samples.size()));
+    }
+    if (whisper_result == 0) {
+        whisper_result = whisper_full_with_state(state.context(), state.get(), params, nullptr, 0);
+    }
+    t.whisper_full_ms = full_timer.elapsed_ms();
+    listener_bridge.flush();
+
+    speaker_task.wait();
+    t.embedding_ms = speaker_branch.embedding_ms;
+    t.clustering_ms = speaker_branch.clustering_ms;
+
+    // both branches poll the token, so a cancelled job gets here within one
+    // decoder step / one embedding; the state returns to the pool on exit
+    if (is_cancelled(cancel)) {
+        LOGI(TAG, "Session cancelled after %.1f ms.", total_timer.elapsed_ms());
+        error = "Cancelled.";
+        return false;
+    }
+    if (whisper_result != 0) {
+        LOGE(TAG, "whisper_full failed with code: %d", whisper_result);
+        error = "whisper_full failed, code: " + std::to_string(whisper_result);
+        return false;
+    }
+
+    // --- 5. Map segments back to the recording and attribute speakers ---
+    StageTimer merge_timer;
+    const int n_segments = whisper_full_n_segments_from_state(state.get());
+    result.segments.reserve(n_segments);
+    int char_offset = 0;
+    for (int i = 0; i < n_segments; ++i) {
+        const char* text = whisper_full_get_segment_text_from_state(state.get(), i);
+        if (text == nullptr || text[0] == '\0') continue;
+
+        // whisper timestamps are in 10 ms units
+        AttributedSegment seg;
+        seg.start_ms = map.source_ms(whisper_full_get_segment_t0_from_state(state.get(), i) * WHISPER_SAMPLE_RATE / 100);
+        seg.end_ms = map.source_ms(whisper_full_get_segment_t1_from_state(state.get(), i) * WHISPER_SAMPLE_RATE / 100);
+        seg.speaker_label = attribute_speaker(speaker_branch.speakers, seg.start_ms, seg.end_ms);
+        seg.text = text;
+        seg.start_char_offset = char_offset;
+        char_offset += utf16_length(seg.text);
+        seg.end_char_offset = char_offset;
+
+        result.transcript += seg.text;
+        result.segments.push_back(std::move(seg));
+    }
+    t.merge_ms = merge_timer.elapsed_ms();
+    t.total_ms = total_timer.elapsed_ms();
+
+    LOGI(TAG, "Session complete: %zu segments, %zu speaker regions, %zu transcript bytes.",
+         result.segments.size(), speaker_branch.speakers.size(), result.transcript.size());
+    return true;
+}
+
+std::string session_result_to_json(const SessionResult& result) {
+    std::ostringstream json;
+    json << "{\"transcript\": ";
+    append_json_string(json, result.transcript);
+    json << ", \"segments\": [";
+    for (size_t i = 0; i < result.segments.size(); ++i) {
+        const AttributedSegment& seg = result.segments[i];
+        if (i > 0) json << ", ";
+        json << "{\"speaker_label\": ";
+        append_json_string(json, seg.speaker_label);
+        json << ", \"start_time_ms\": " << seg.start_ms;
+        json << ", \"end_time_ms\": " << seg.end_ms;
+        json << ", \"start_char_offset\": " << seg.start_char_offset;
+        json << ", \"end_char_offset\": " << seg.end_char_offset;
+        json << ", \"text\": ";
+        append_json_string(json, seg.text);
+        json << "}";
+    }
+    json << "]}";
+    return json.str();
+}
+
+std::string transcribe_and_diarize_pcm_audio(const std::string& model_path,
+                                             const PcmAudio& audio,
+                                             SessionTimings* timings,
+                                             TranscriptionListener* listener,
+                                             const CancellationToken* cancel) {
+    SessionResult result;
+    std::string error;
+    if (!run_session_pipeline(model_path, audio, result, error, timings, listener, cancel)) {
+        LOGE(TAG, "Session pipeline failed: %s", error.c_str());
+        std::ostringstream json;
+        json << "{\"error\": ";
+        append_json_string(json, error);
+        json << "}";
+        return json.str();
+    }
+    return session_result_to_json(result);
+}
+
+std::string transcribe_and_diarize_pcm_file(const std::string& model_path,
+                                            const std::string& audio_path,
+                                            SessionTimings* timings,
+                                            TranscriptionListener* listener,
+                                            const CancellationToken* cancel) {
+    SessionTimings local_timings;
+    SessionTimings& t = timings != nullptr ? *timings : local_timings;
+
+    LOGI(TAG, "Audio Path (PCM): %s", audio_path.c_str());
+    StageTimer audio_timer;
+    SharedAudio audio;
+    PcmLoadStatus load_status = audio_cache_load_file(audio_path, audio);
+    t.audio_load_ms = audio_timer.elapsed_ms();
+    if (load_status != PCM_LOAD_OK) {
+        LOGE(TAG, "Failed to load audio file: %s", audio_path.c_str());
+        return load_status == PCM_LOAD_UNSUPPORTED_FORMAT ? "{\"error\": \"Unsupported PCM audio format.\"}"
+                                                          : "{\"error\": \"Failed to read PCM audio file.\"}";
+    }
+    return transcribe_and_diarize_pcm_audio(model_path, *audio, &t, listener, cancel);
+}
@@ -0,0 +1,84 @@
+// session_pipeline.h
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "audio_module/pcm_loader.h"
+
+class CancellationToken;
+class TranscriptionListener;
+
+// Wall-clock milliseconds spent in each stage of transcribe_and_diarize_*.
+// whisper_full and embedding/clustering run concurrently, so total_ms is less
+// than the sum of the stages.
+struct SessionTimings {
+    double audio_load_ms = 0.0;   // file variant only; ~0 on an audio cache hit
+    double resample_ms = 0.0;
+    double vad_ms = 0.0;          // with whisper's mel frames, from the same STFT pass
+    double model_load_ms = 0.0;
+    double state_init_ms = 0.0;
+    double whisper_full_ms = 0.0;
+    double embedding_ms = 0.0;
+    double clustering_ms = 0.0;
+    double merge_ms = 0.0;
+    double total_ms = 0.0;
+};
+
+// One whisper segment with the speaker it was attributed to. Times are in the
+// original recording; char offsets are UTF-16 offsets into the transcript, as
+// consumed by Java strings.
+struct AttributedSegment {
+    int64_t start_ms = 0;
+    int64_t end_ms = 0;
+    std::string speaker_label;
+    std::string text;
+    int start_char_offset = 0;
+    int end_char_offset = 0;
+};
+
+struct SessionResult {
+    std::string transcript;
+    std::vector<AttributedSegment> segments;
+};
+
+// Transcribes and diarizes audio in one pass: one STFT pass over the recording
+// gives the VAD its frame energies and whisper its mel frames, the speech
+// regions are concatenated for whisper_full_with_state (their spectrogram put
+// together from those frames) while speaker embeddings are extracted from the
+// same regions on a second thread, and every transcript segment is labelled
+// with the speaker whose region overlaps it most.
+// listener, if set, receives the (not yet attributed) segments as whisper
+// produces them, with times in the original recording.
+// cancel, if set, is polled by VAD, whisper and the speaker branch; a
+// cancelled run returns false with error "Cancelled.".
+// Returns false and sets error on failure.
+bool run_session_pipeline(const std::string& model_path,
+                          const PcmAudio& audio,
+                          SessionResult& result,
+                          std::string& error,
+                          SessionTimings* timings = nullptr,
+                          TranscriptionListener* listener = nullptr,
+                          const CancellationToken* cancel = nullptr);
+
+// JSON for SessionDetailFragment:
+//   {"transcript": "...", "segments": [{"speaker_label", "start_time_ms", "end_time_ms",
+//    "start_char_offset", "end_char_offset", "text"}, ...]}
+// "segments" has the speakers.json layout.
+std::string session_result_to_json(const SessionResult& result);
+
+// run_session_pipeline + session_result_to_json; on failure {"error": "..."}.
+// This is the code path behind WhisperService.transcribeAndDiarize.
+std::string transcribe_and_diarize_pcm_audio(const std::string& model_path,
+                                             const PcmAudio& audio,
+                                             SessionTimings* timings = nullptr,
+                                             TranscriptionListener* listener = nullptr,
+                                             const CancellationToken* cancel = nullptr);
+
+// Same for a PCM/WAV file, loaded through the audio cache (clearchoice-cli --mode session).
+std::string transcribe_and_diarize_pcm_file(const std::string& model_path,
+                                            const std::string& audio_path,
+                                            SessionTimings* timings = nullptr,
+                                            TranscriptionListener* listener = nullptr,
+                                            const CancellationToken* cancel = nullptr);
@@ -0,0 +1,16 @@
+// stage_timer.h
+#pragma once
+#include <chrono>
+
+// Measures one pipeline stage: construct at the start, call elapsed_ms() at the end.
+class StageTimer {
+public:
+    StageTimer() : start_(std::chrono::steady_clock::now()) {}
+
+    double elapsed_ms() const {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point start_;
+};
@@ -0,0 +1,275 @@
+// transcriber.cpp
+#include "transcriber.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "whisper/whisper.h"
+#include "audio_module/audio_cache.h"
+#include "audio_module/pcm_loader.h"
+#include "audio_module/resampler.h"
+#include "diarization_module/vad_engine.h"
+#include "engine_module/cancellation.h"
+#include "engine_module/encoder_cache.h"
+#include "engine_module/model_registry.h"
+#include "engine_module/parallel_transcriber.h"
+#include "engine_module/rtf_governor.h"
+#include "engine_module/stage_timer.h"
+#include "engine_module/transcript_layout.h"
+#include "engine_module/transcription_listener.h"
+#include "platform/cpu_topology.h"
+#include "platform/native_log.h"
+
+#define TAG "TRANSCRIBER"
+
+static std::atomic<bool> g_encoder_pipelining{false};
+static std::atomic<bool> g_audio_ctx_auto{false};
+
+void transcribe_set_encoder_pipelining(bool enabled) {
+    g_encoder_pipelining.store(enabled, std::memory_order_relaxed);
+}
+
+bool transcribe_encoder_pipelining() {
+    return g_encoder_pipelining.load(std::memory_order_relaxed);
+}
+
+void transcribe_set_audio_ctx_auto(bool enabled) {
+    g_audio_ctx_auto.store(enabled, std::memory_order_relaxed);
+}
+
+bool transcribe_audio_ctx_auto() {
+    return g_audio_ctx_auto.load(std::memory_order_relaxed);
+}
+
+struct whisper_full_params transcribe_default_params() {
+    struct whisper_full_params params = whisper_full_default_params(WHISPER_SAMPLING_GREEDY);
+    params.print_progress = false;
+    params.print_special = false;
+    params.print_realtime = false;
+    params.print_timestamps = false;
+    params.no_context = true; // states are pooled; never carry a prompt over from another job
+    params.language = "en"; // For tiny.en model
+    params.n_threads = current_thread_plan().n_threads; // see ThreadPolicy
+    params.audio_ctx_auto = transcribe_audio_ctx_auto();
+    return params;
+}
+
+// Runs whisper over audio, with a pooled state or, in parallel mode, with
+// several over silence-aligned chunks, and writes the result to layout.
+// Returns "" on success, else the "ERROR: ..." message.
+static std::string run_whisper(const std::string& model_path,
+                               const PcmAudio& audio,
+                               struct whisper_full_params params,
+                               TranscribeTimings& t,
+                               TranscriptionListener* listener,
+                               const CancellationToken* cancel,
+                               std::vector<uint8_t>& layout) {
+    LOGI(TAG, "Model Path: %s", model_path.c_str());
+    if (audio.samples.empty()) {
+        LOGE(TAG, "No audio samples to transcribe.");
+        return "ERROR: PCM audio is empty.";
+    }
+    LOGI(TAG, "Audio: %zu samples (%d Hz, %d ch, %s%s).", audio.samples.size(),
+         audio.format.sample_rate, audio.format.channels, pcm_sample_format_name(audio.format.sample_format),
+         audio.format.from_header ? "" : ", assumed");
+
+    // mel, encoder and decoder workers are started from this thread and inherit its cores
+    ScopedThreadAffinity affinity(current_thread_plan());
+
+    // whisper needs 16 kHz mono; a no-op for audio that is already converted
+    StageTimer resample_timer;
+    PcmAudio converted;
+    const PcmAudio& input = conform_audio(audio, WHISPER_SAMPLE_RATE, converted);
+    t.resample_ms = resample_timer.elapsed_ms();
+    if (&input != &audio) {
+        LOGI(TAG, "Converted to %d Hz mono (%zu samples) in %.1f ms.", WHISPER_SAMPLE_RATE, input.samples.size(), t.resample_ms);
+    }
+
+    if (is_cancelled(cancel)) {
+        LOGI(TAG, "Transcription cancelled before start.");
+        return "ERROR: Cancelled.";
+    }
+
+    // --- 1. Get the resident model and a pooled state ---
+    StageTimer model_timer;
+    std::shared_ptr<WhisperModel> model = model_registry_acquire(model_path);
+    t.model_load_ms = model_timer.elapsed_ms();
+    if (!model) {
+        LOGE(TAG, "Failed to initialize whisper context.");
+        return "ERROR: whisper_init_from_file failed.";
+    }
+
+    // windows this model encoded for the recording before are not encoded again
+    std::shared_ptr<EncoderCache> encoder_cache = encoder_cache_for(audio, model_path);
+    if (encoder_cache) {
+        encoder_cache->install(params);
+    }
+
+    // --- 2a. Parallel mode: VAD cuts the audio into chunks for several states ---
+    if (parallel_transcribe_workers() != 1) {
+        StageTimer vad_timer;
+        void* vad_ctx = init_vad_engine();
+        std::vector<SpeechSegment> speech = process_audio_for_vad(vad_ctx, input.samples.data(), input.samples.size(), WHISPER_SAMPLE_RATE,
+                                                                  cancellation_flag(cancel));
+        free_vad_engine(vad_ctx);
+        std::vector<ParallelChunk> chunks = plan_parallel_chunks(input.samples.data(), input.samples.size(), WHISPER_SAMPLE_RATE, speech);
+        t.vad_ms = vad_timer.elapsed_ms();
+
+        const int n_workers = parallel_transcribe_plan_workers(chunks.size());
+        if (n_workers > 1) {
+            params.n_threads = std::max(1, params.n_threads / n_workers);
+            std::unique_ptr<RtfGovernor> governor;
+            if (rtf_governor_target() > 0.0f) {
+                governor = std::make_unique<RtfGovernor>(rtf_governor_target(), params, n_workers);
+            }
+            StageTimer full_timer;
+            std::string error = run_whisper_parallel(model, input.samples.data(), input.samples.size(), chunks, params, n_workers, layout, listener,
+                                                     cancel, governor.get());
+            t.whisper_full_ms = full_timer.elapsed_ms();
+            if (error == "ERROR: Cancelled.") {
+                LOGI(TAG, "Transcription cancelled after %.1f ms.", t.whisper_full_ms);
+            }
+            return error;
+        }
+        LOGI(TAG, "%zu chunk(s); transcribing sequentially.", chunks.size());
+    }
+
+    StageTimer state_timer;
+    PooledState state(model);
+    if (!state) {
+        LOGE(TAG, "Failed to initialize whisper state.");
+        return "ERROR: whisper_init_state failed.";
+    }
+
+    // Encoder pipelining: a second state encodes the next window while this one
+    // decodes. The decoder is latency-bound, so it gives up half its threads.
+    std::unique_ptr<PooledState> spec_state;
+    if (transcribe_encoder_pipelining() && params.n_threads >= 2 &&
+        input.samples.size() > static_cast<size_t>(WHISPER_SAMPLE_RATE) * WHISPER_CHUNK_SIZE) {
+        spec_state = std::make_unique<PooledState>(model);
+        if (*spec_state) {
+            params.spec_encode_state = spec_state->get();
+            params.spec_encode_n_threads = params.n_threads - params.n_threads / 2;
+            params.n_threads /= 2;
+        } else {
+            LOGW(TAG, "No second whisper state for encoder pipelining; encoding in sequence.");
+        }
+    }
+    t.state_init_ms = state_timer.elapsed_ms();
+
+    LOGI(TAG, "Whisper params set. Language: %s, Threads: %d (%s)%s", params.language, params.n_threads,
+         thread_policy_name(thread_policy_default()), params.spec_encode_state != nullptr ? ", encoder pipelined" : "");
+
+    // --- 2b. Run Transcription, streaming segments to the listener if there is one ---
+    TranscriptionListenerBridge listener_bridge(listener);
+    listener_bridge.install(params);
+    if (cancel != nullptr) {
+        cancel->install(params);
+    }
+    std::unique_ptr<RtfGovernor> governor;
+    if (rtf_governor_target() > 0.0f) {
+        governor = std::make_unique<RtfGovernor>(rtf_governor_target(), params);
+        governor->install(params);
+    }
+    StageTimer full_timer;
+    int whisper_result = whisper_full_with_state(state.context(), state.get(), params, input.samples.data(), static_cast<int>(input.samples.size()));
+    t.whisper_full_ms = full_timer.elapsed_ms();
+    listener_bridge.flush();
+    // A cancelled run either fails (aborted mid-graph) or ends early with a
+    // partial result; both are reported as cancelled. The state goes back to
+    // the pool when it leaves scope.
+    if (is_cancelled(cancel)) {
+        LOGI(TAG, "Transcription cancelled after %.1f ms.", t.whisper_full_ms);
+        return "ERROR: Cancelled.";
+    }
+    if (whisper_result != 0) {
+        LOGE(TAG, "whisper_full failed with code: %d", whisper_result);
+        return "ERROR: whisper_full failed, code: " + std::to_string(whisper_result);
+    }
+    LOGI(TAG, "whisper_full completed successfully.");
+
+    // --- 3. Extract Results ---
+    StageTimer extract_timer;
+    write_transcript_layout(state.context(), state.get(), layout);
+    t.extract_ms = extract_timer.elapsed_ms();
+    return "";
+}
+
+std::string transcribe_pcm_audio(const std::string& model_path,
+                                 const PcmAudio& audio,
+                                 TranscribeTimings* timings,
+                                 TranscriptionListener* listener,
+                                 const CancellationToken* cancel) {
+    TranscribeTimings local_timings;
+    TranscribeTimings& t = timings != nullptr ? *timings : local_timings;
+
+    std::vector<uint8_t> layout;
+    std::string error = run_whisper(model_path, audio, transcribe_default_params(), t, listener, cancel, layout);
+    if (!error.empty()) {
+        return error;
+    }
+    const std::string full_transcript = transcript_layout_text(layout);
+    TranscriptLayoutHeader header;
+    memcpy(&header, layout.data(), sizeof(header));
+    const uint32_t n_segments = header.n_segments;
+    LOGI(TAG, "Number of segments: %u", n_segments);
+    // transcripts are user data; only their size goes to the log
+    LOGI(TAG, "Transcript extracted: %zu bytes.", full_transcript.size());
+
+    if (full_transcript.empty() && n_segments > 0) {
+        LOGW(TAG, "Transcription resulted in empty string despite segments present.");
+    }
+    return full_transcript;
+}
+
+std::string transcribe_pcm_audio_to_layout(const std::string& model_path,
+                                           const PcmAudio& audio,
+                                           std::vector<uint8_t>& layout,
+                                           TranscribeTimings* timings,
+                                           TranscriptionListener* listener,
+                                           const CancellationToken* cancel) {
+    TranscribeTimings local_timings;
+    TranscribeTimings& t = timings != nullptr ? *timings : local_timings;
+
+    struct whisper_full_params params = transcribe_default_params();
+    params.token_timestamps = true;
+    std::string error = run_whisper(model_path, audio, params, t, listener, cancel, layout);
+    if (error.empty()) {
+        LOGI(TAG, "Transcript layout: %zu bytes.", layout.size());
+    }
+    return error;
+}
+
+std::string transcribe_pcm_file(const std::string& model_path,
+                                const std::string& audio_path,
+                                TranscribeTimings* timings,
+                                TranscriptionListener* listener,
+                                const CancellationToken* cancel) {
+    TranscribeTimings local_timings;
+    TranscribeTimings& t = timings != nullptr ? *timings : local_timings;
+
+    LOGI(TAG, "Audio Path (PCM): %s", audio_path.c_str());
+
+    // Read Audio Data (mmap + convert to 16 kHz mono float), shared with diarization
+    StageTimer audio_timer;
+    SharedAudio audio;
+    PcmLoadStatus load_status = audio_cache_load_file(audio_path, audio);
+    t.audio_load_ms = audio_timer.elapsed_ms();
+    if (load_status == PCM_LOAD_OPEN_FAILED) {
+        LOGE(TAG, "Failed to open audio file: %s", audio_path.c_str());
+        return "ERROR: Failed to open PCM audio file.";
+    }
+    if (load_status == PCM_LOAD_EMPTY) {
+        LOGE(TAG, "Audio file was empty or failed to read: %s", audio_path.c_str());
+        return "ERROR: PCM audio file is empty or read failed.";
+    }
+    if (load_status == PCM_LOAD_UNSUPPORTED_FORMAT) {
+        LOGE(TAG, "Unsupported PCM encoding in: %s", audio_path.c_str());
+        return "ERROR: Unsupported PCM audio format.";
+    }
+
+    return transcribe_pcm_audio(model_path, *audio, &t, listener, cancel);
+}
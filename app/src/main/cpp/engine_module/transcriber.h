@@ -0,0 +1,75 @@
+// transcriber.h
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "whisper/whisper.h"
+#include "audio_module/pcm_loader.h"
+
+class CancellationToken;
+class TranscriptionListener;
+
+// Wall-clock milliseconds spent in each stage of transcribe_pcm_file.
+struct TranscribeTimings {
+    double model_load_ms = 0.0;   // ~0 once the model is resident in the registry
+    double state_init_ms = 0.0;   // ~0 when a pooled state is reused
+    double audio_load_ms = 0.0;   // file variant only; ~0 on an audio cache hit
+    double resample_ms = 0.0;     // downmix/resample to 16 kHz mono, 0 if not needed
+    double vad_ms = 0.0;          // parallel mode only: silence detection and chunking
+    double whisper_full_ms = 0.0;
+    double extract_ms = 0.0;
+};
+
+// Transcribes a PCM/WAV file. This is the code path behind
+// WhisperService.transcribeFile and the clearchoice-cli tool. The model is
+// taken from (and left resident in) the model registry; the decoded audio
+// goes through the audio cache and is reused by diarization of the same file.
+// Returns the transcript, or a message starting with "ERROR:" on failure.
+// With parallel_transcribe_set_workers() != 1, long recordings are cut at
+// silences and the chunks transcribed concurrently (parallel_transcriber.h).
+// If cancel is set, cancelling it stops whisper within one encoder/decoder step
+// and the call returns "ERROR: Cancelled.".
+std::string transcribe_pcm_file(const std::string& model_path,
+                                const std::string& audio_path,
+                                TranscribeTimings* timings = nullptr,
+                                TranscriptionListener* listener = nullptr,
+                                const CancellationToken* cancel = nullptr);
+
+// Transcribes audio that is already in memory (e.g. pushed from MediaCodec via
+// PcmStream). Audio at other rates or with several channels is converted to
+// 16 kHz mono first. Same model handling and result format as transcribe_pcm_file.
+// If listener is set, segments and progress are reported while whisper runs.
+std::string transcribe_pcm_audio(const std::string& model_path,
+                                 const PcmAudio& audio,
+                                 TranscribeTimings* timings = nullptr,
+                                 TranscriptionListener* listener = nullptr,
+                                 const CancellationToken* cancel = nullptr);
+
+// Like transcribe_pcm_audio, but writes the full result (segment and token
+// times, token ids and probabilities, text) in the binary layout described in
+// transcript_layout.h. Returns "" on success, else the "ERROR: ..." message.
+std::string transcribe_pcm_audio_to_layout(const std::string& model_path,
+                                           const PcmAudio& audio,
+                                           std::vector<uint8_t>& layout,
+                                           TranscribeTimings* timings = nullptr,
+                                           TranscriptionListener* listener = nullptr,
+                                           const CancellationToken* cancel = nullptr);
+
+// Encoder pipelining for sequential transcription of recordings longer than
+// one 30 s window (whisper_full_params.spec_encode_state): a second pooled
+// state encodes the next window while the current one decodes, and the thread
+// plan is split between them. Off by default; it pays off with 6 or more threads.
+void transcribe_set_encoder_pipelining(bool enabled);
+bool transcribe_encoder_pipelining();
+
+// Sizes the encoder of each window to the audio in it
+// (whisper_full_params.audio_ctx_auto), so a 5 s voice memo, the tail of a
+// recording or a short chunk between silences does not pay for a 30 s window.
+// Off by default.
+void transcribe_set_audio_ctx_auto(bool enabled);
+bool transcribe_audio_ctx_auto();
+
+// Decoding parameters shared by every transcription entry point: greedy,
+// English, no prompt carried over between jobs (states are pooled).
+struct whisper_full_params transcribe_default_params();
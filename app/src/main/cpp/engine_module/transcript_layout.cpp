@@ -0,0 +1,110 @@
+// transcript_layout.cpp
+#include "transcript_layout.h"
+
+#include <cstring>
+#include <string>
+
+#include "whisper/whisper.h"
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "transcript_layout writes native structs and assumes a little-endian target"
+#endif
+
+static int32_t to_ms(const TranscriptTimeMap& time_map, int64_t t) {
+    return static_cast<int32_t>(time_map ? time_map(t) : t * 10);
+}
+
+static void write_layout(const std::vector<TranscriptSegmentRecord>& segments,
+                         const std::vector<TranscriptTokenRecord>& tokens,
+                         const std::string& text,
+                         std::vector<uint8_t>& out) {
+    TranscriptLayoutHeader header;
+    header.magic = kTranscriptLayoutMagic;
+    header.version = kTranscriptLayoutVersion;
+    header.n_segments = static_cast<uint32_t>(segments.size());
+    header.n_tokens = static_cast<uint32_t>(tokens.size());
+    header.text_bytes = static_cast<uint32_t>(text.size());
+    header.segments_offset = sizeof(TranscriptLayoutHeader);
+    header.tokens_offset = header.segments_offset + header.n_segments * sizeof(TranscriptSegmentRecord);
+    header.text_offset = header.tokens_offset + header.n_tokens * sizeof(TranscriptTokenRecord);
+
+    out.resize(header.text_offset + text.size());
+    uint8_t* p = out.data();
+    memcpy(p, &header, sizeof(header));
+    if (!segments.empty()) memcpy(p + header.segments_offset, segments.data(), segments.size() * sizeof(TranscriptSegmentRecord));
+    if (!tokens.empty()) memcpy(p + header.tokens_offset, tokens.data(), tokens.size() * sizeof(TranscriptTokenRecord));
+    if (!text.empty()) memcpy(p + header.text_offset, text.data(), text.size());
+}
+
+void write_transcript_layout(struct whisper_context* ctx,
+                             struct whisper_state* state,
+                             std::vector<uint8_t>& out,
+                             const TranscriptTimeMap& time_map) {
+    const whisper_token token_eot = whisper_token_eot(ctx);
+    const int n_segments = whisper_full_n_segments_from_state(state);
+
+    std::vector<TranscriptSegmentRecord> segments(n_segments);
+    std::vector<TranscriptTokenRecord> tokens;
+    std::string text;
+
+    for (int i = 0; i < n_segments; ++i) {
+        const char* segment_text = whisper_full_get_segment_text_from_state(state, i);
+        const size_t segment_bytes = segment_text != nullptr ? strlen(segment_text) : 0;
+
+        TranscriptSegmentRecord& seg = segments[i];
+        seg.t0_ms = to_ms(time_map, whisper_full_get_segment_t0_from_state(state, i));
+        seg.t1_ms = to_ms(time_map, whisper_full_get_segment_t1_from_state(state, i));
+        seg.text_offset = static_cast<uint32_t>(text.size());
+        seg.text_bytes = static_cast<uint32_t>(segment_bytes);
+        seg.first_token = static_cast<uint32_t>(tokens.size());
+        text.append(segment_text != nullptr ? segment_text : "", segment_bytes);
+
+        const int n_tokens = whisper_full_n_tokens_from_state(state, i);
+        for (int j = 0; j < n_tokens; ++j) {
+            const whisper_token_data data = whisper_full_get_token_data_from_state(state, i, j);
+            if (data.id >= token_eot) continue; // special token
+            tokens.push_back({data.id, data.p, to_ms(time_map, data.t0), to_ms(time_map, data.t1)});
+        }
+        seg.n_tokens = static_cast<uint32_t>(tokens.size()) - seg.first_token;
+    }
+
+    write_layout(segments, tokens, text, out);
+}
+
+void merge_transcript_layouts(const std::vector<std::vector<uint8_t>>& parts, std::vector<uint8_t>& out) {
+    std::vector<TranscriptSegmentRecord> segments;
+    std::vector<TranscriptTokenRecord> tokens;
+    std::string text;
+
+    for (const std::vector<uint8_t>& part : parts) {
+        if (part.size() < sizeof(TranscriptLayoutHeader)) continue;
+        TranscriptLayoutHeader header;
+        memcpy(&header, part.data(), sizeof(header));
+
+        const uint32_t token_base = static_cast<uint32_t>(tokens.size());
+        const uint32_t text_base = static_cast<uint32_t>(text.size());
+        const size_t first_segment = segments.size();
+        segments.resize(first_segment + header.n_segments);
+        if (header.n_segments > 0) {
+            memcpy(&segments[first_segment], part.data() + header.segments_offset, header.n_segments * sizeof(TranscriptSegmentRecord));
+        }
+        for (size_t i = first_segment; i < segments.size(); ++i) {
+            segments[i].first_token += token_base;
+            segments[i].text_offset += text_base;
+        }
+        tokens.resize(token_base + header.n_tokens);
+        if (header.n_tokens > 0) {
+            memcpy(&tokens[token_base], part.data() + header.tokens_offset, header.n_tokens * sizeof(TranscriptTokenRecord));
+        }
+        text.append(reinterpret_cast<const char*>(part.data() + header.text_offset), header.text_bytes);
+    }
+    write_layout(segments, tokens, text, out);
+}
+
+std::string transcript_layout_text(const std::vector<uint8_t>& layout) {
+    if (layout.size() < sizeof(TranscriptLayoutHeader)) return "";
+    TranscriptLayoutHeader header;
+    memcpy(&header, layout.data(), sizeof(header));
+    // segments are stored in order and their texts back to back
+    return std::string(reinterpret_cast<const char*>(layout.data() + header.text_offset), header.text_bytes);
+}
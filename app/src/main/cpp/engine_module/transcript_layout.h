@@ -0,0 +1,74 @@
+// transcript_layout.h
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+struct whisper_context;
+struct whisper_state;
+
+// Binary transcription result handed to Kotlin in a direct ByteBuffer and read
+// in place by TranscriptLayout.kt (keep the two in sync). Little-endian, every
+// record 4-byte aligned:
+//
+//   TranscriptLayoutHeader
+//   TranscriptSegmentRecord[n_segments]
+//   TranscriptTokenRecord[n_tokens]      tokens of segment i are
+//                                        [first_token, first_token + n_tokens)
+//   UTF-8 text blob[text_bytes]          segment texts back to back, no separators
+//
+// Times are milliseconds in the input audio.
+
+constexpr uint32_t kTranscriptLayoutMagic = 0x52544343; // "CCTR"
+constexpr uint32_t kTranscriptLayoutVersion = 1;
+
+struct TranscriptLayoutHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t n_segments;
+    uint32_t n_tokens;
+    uint32_t text_bytes;
+    uint32_t segments_offset;
+    uint32_t tokens_offset;
+    uint32_t text_offset;
+};
+
+struct TranscriptSegmentRecord {
+    int32_t t0_ms;
+    int32_t t1_ms;
+    uint32_t text_offset;  // into the text blob
+    uint32_t text_bytes;
+    uint32_t first_token;
+    uint32_t n_tokens;
+};
+
+struct TranscriptTokenRecord {
+    int32_t id;
+    float p;
+    int32_t t0_ms;
+    int32_t t1_ms;
+};
+
+static_assert(sizeof(TranscriptLayoutHeader) == 32, "layout header size is part of the Kotlin reader");
+static_assert(sizeof(TranscriptSegmentRecord) == 24, "segment record size is part of the Kotlin reader");
+static_assert(sizeof(TranscriptTokenRecord) == 16, "token record size is part of the Kotlin reader");
+
+// Maps a whisper timestamp (10 ms units) to milliseconds in the caller's audio.
+typedef std::function<int64_t(int64_t t_whisper)> TranscriptTimeMap;
+
+// Serializes the result held in state. Special tokens (timestamps, SOT, EOT...)
+// are left out; token times need whisper_full_params.token_timestamps.
+// Without time_map, times are whisper timestamps * 10.
+void write_transcript_layout(struct whisper_context* ctx,
+                             struct whisper_state* state,
+                             std::vector<uint8_t>& out,
+                             const TranscriptTimeMap& time_map = nullptr);
+
+// Concatenates layouts written by write_transcript_layout, in the given order,
+// into one: token and text offsets are rebased onto the merged tables.
+void merge_transcript_layouts(const std::vector<std::vector<uint8_t>>& parts, std::vector<uint8_t>& out);
+
+// The segment texts of a layout back to back, i.e. the plain transcript.
+std::string transcript_layout_text(const std::vector<uint8_t>& layout);
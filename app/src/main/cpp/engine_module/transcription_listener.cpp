@@ -0,0 +1,45 @@
+// transcription_listener.cpp
+#include "transcription_listener.h"
+
+TranscriptionListenerBridge::TranscriptionListenerBridge(TranscriptionListener* listener, TranscriptTimeMap time_map)
+    : listener_(listener), time_map_(std::move(time_map)) {}
+
+void TranscriptionListenerBridge::install(struct whisper_full_params& params) {
+    if (listener_ == nullptr) return;
+    params.new_segment_callback = &TranscriptionListenerBridge::on_new_segment;
+    params.new_segment_callback_user_data = this;
+    params.progress_callback = &TranscriptionListenerBridge::on_progress;
+    params.progress_callback_user_data = this;
+}
+
+void TranscriptionListenerBridge::flush() {
+    if (listener_ == nullptr || pending_.empty()) return;
+    listener_->on_segments(pending_);
+    pending_.clear();
+    since_delivery_ = StageTimer();
+    delivered_ = true;
+}
+
+void TranscriptionListenerBridge::on_new_segment(struct whisper_context* /* ctx */, struct whisper_state* state, int n_new, void* user_data) {
+    auto* self = static_cast<TranscriptionListenerBridge*>(user_data);
+    const int n_segments = whisper_full_n_segments_from_state(state);
+    for (int i = n_segments - n_new; i < n_segments; ++i) {
+        const int64_t t0 = whisper_full_get_segment_t0_from_state(state, i);
+        const int64_t t1 = whisper_full_get_segment_t1_from_state(state, i);
+        const char* text = whisper_full_get_segment_text_from_state(state, i);
+        self->pending_.push_back({self->time_map_ ? self->time_map_(t0) : t0 * 10,
+                                  self->time_map_ ? self->time_map_(t1) : t1 * 10,
+                                  text != nullptr ? text : ""});
+    }
+    if (!self->delivered_ || self->pending_.size() >= kMaxBatchSegments ||
+        self->since_delivery_.elapsed_ms() >= kMaxBatchDelayMs) {
+        self->flush();
+    }
+}
+
+void TranscriptionListenerBridge::on_progress(struct whisper_context* /* ctx */, struct whisper_state* /* state */, int progress, void* user_data) {
+    auto* self = static_cast<TranscriptionListenerBridge*>(user_data);
+    if (progress == self->last_progress_) return;
+    self->last_progress_ = progress;
+    self->listener_->on_progress(progress);
+}
@@ -0,0 +1,54 @@
+// transcription_listener.h
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "whisper/whisper.h"
+#include "engine_module/stage_timer.h"
+#include "engine_module/transcript_layout.h"
+
+struct TranscribedSegment {
+    int64_t t0_ms;
+    int64_t t1_ms;
+    std::string text;
+};
+
+// Receives results while whisper is still running. Calls come from the thread
+// running whisper_full, in order, never concurrently for one job.
+class TranscriptionListener {
+public:
+    virtual ~TranscriptionListener() = default;
+    virtual void on_segments(const std::vector<TranscribedSegment>& segments) = 0;
+    virtual void on_progress(int percent) = 0;
+};
+
+// Connects whisper_full_params.new_segment_callback / progress_callback to a
+// listener. New segments are batched: a batch is delivered once it holds
+// kMaxBatchSegments segments or kMaxBatchDelayMs after the previous delivery
+// (the first segments go out at once), and flush() delivers the rest.
+// Progress is only forwarded when the percentage changes.
+class TranscriptionListenerBridge {
+public:
+    static constexpr size_t kMaxBatchSegments = 16;
+    static constexpr double kMaxBatchDelayMs = 250.0;
+
+    // time_map converts whisper timestamps (10 ms units) to ms in the caller's
+    // audio, e.g. when whisper runs over concatenated speech regions.
+    explicit TranscriptionListenerBridge(TranscriptionListener* listener, TranscriptTimeMap time_map = nullptr);
+
+    // No-op when the listener is null.
+    void install(struct whisper_full_params& params);
+    void flush();
+
+private:
+    static void on_new_segment(struct whisper_context* ctx, struct whisper_state* state, int n_new, void* user_data);
+    static void on_progress(struct whisper_context* ctx, struct whisper_state* state, int progress, void* user_data);
+
+    TranscriptionListener* listener_;
+    TranscriptTimeMap time_map_;
+    std::vector<TranscribedSegment> pending_;
+    StageTimer since_delivery_;
+    bool delivered_ = false;
+    int last_progress_ = -1;
+};
@@ -0,0 +1,156 @@
+// whisper_threading.cpp
+#include "whisper_threading.h"
+
+#include <mutex>
+#include <vector>
+
+#include "ggml.h"
+#include "ggml-backend.h"
+#include "whisper/whisper.h"
+#include "platform/cpu_topology.h"
+#include "platform/native_log.h"
+#include "platform/worker_pool.h"
+
+#define TAG "WHISPER_THREADING"
+
+namespace {
+
+typedef ggml_threadpool_t (*ggml_threadpool_new_t)(struct ggml_threadpool_params* params);
+typedef void (*ggml_threadpool_free_t)(ggml_threadpool_t threadpool);
+
+// States computing at once (parallel chunks, scheduler workers, speculative
+// encodes) each lease a pool; beyond this many a graph gets a disposable one.
+constexpr size_t kMaxThreadpools = 8;
+
+struct PooledThreadpool {
+    ggml_threadpool_t threadpool;
+    int n_threads;
+    ThreadPolicy policy;
+    bool leased;
+};
+
+// The persistent ggml threadpools, one per state computing at the same time.
+struct GgmlThreadpools {
+    std::mutex mutex;
+    std::vector<PooledThreadpool> pools;
+    ggml_threadpool_new_t new_fn = nullptr;
+    ggml_threadpool_free_t free_fn = nullptr;
+};
+
+GgmlThreadpools g_ggml;
+
+bool resolve_ggml_threadpool_api() {
+    if (g_ggml.new_fn != nullptr && g_ggml.free_fn != nullptr) return true;
+    ggml_backend_dev_t dev = ggml_backend_dev_by_type(GGML_BACKEND_DEVICE_TYPE_CPU);
+    ggml_backend_reg_t reg = dev != nullptr ? ggml_backend_dev_backend_reg(dev) : nullptr;
+    if (reg == nullptr) return false;
+    g_ggml.new_fn = (ggml_threadpool_new_t) ggml_backend_reg_get_proc_address(reg, "ggml_threadpool_new");
+    g_ggml.free_fn = (ggml_threadpool_free_t) ggml_backend_reg_get_proc_address(reg, "ggml_threadpool_free");
+    return g_ggml.new_fn != nullptr && g_ggml.free_fn != nullptr;
+}
+
+// Caller holds g_ggml.mutex.
+ggml_threadpool_t new_ggml_threadpool(int n_threads, ThreadPolicy policy) {
+    const ThreadPlan plan = plan_threads(get_cpu_topology(), policy);
+    struct ggml_threadpool_params params = ggml_threadpool_params_default(n_threads);
+    for (int cpu : plan.cpus) {
+        if (cpu < GGML_MAX_N_THREADS) params.cpumask[cpu] = true;
+    }
+    params.strict_cpu = false; // every thread may use every cpu of the plan
+    params.poll = 50;          // hybrid: spin between graphs of one step, then sleep
+    ggml_threadpool_t threadpool = g_ggml.new_fn(&params);
+    if (threadpool != nullptr) {
+        LOGI(TAG, "ggml threadpool %zu: %d threads (%s).", g_ggml.pools.size() + 1, n_threads,
+             thread_policy_name(policy));
+    }
+    return threadpool;
+}
+
+ggml_threadpool_t acquire_ggml_threadpool(int n_threads, void*) {
+    if (n_threads <= 0 || n_threads > GGML_MAX_N_THREADS) return nullptr;
+    const ThreadPolicy policy = thread_policy_default();
+
+    std::lock_guard<std::mutex> lock(g_ggml.mutex);
+    if (!resolve_ggml_threadpool_api()) return nullptr;
+
+    // pools pinned for another policy go as soon as they are idle
+    for (auto it = g_ggml.pools.begin(); it != g_ggml.pools.end();) {
+        if (!it->leased && it->policy != policy) {
+            g_ggml.free_fn(it->threadpool);
+            it = g_ggml.pools.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    PooledThreadpool* idle = nullptr;
+    for (PooledThreadpool& pool : g_ggml.pools) {
+        if (pool.leased || pool.policy != policy) continue;
+        if (pool.n_threads == n_threads) {
+            pool.leased = true;
+            return pool.threadpool;
+        }
+        if (idle == nullptr) idle = &pool;
+    }
+
+    if (g_ggml.pools.size() >= kMaxThreadpools) {
+        if (idle == nullptr) return nullptr;
+        // a state changed its thread count (e.g. the RTF governor shed threads)
+        g_ggml.free_fn(idle->threadpool);
+        g_ggml.pools.erase(g_ggml.pools.begin() + (idle - g_ggml.pools.data()));
+    }
+
+    ggml_threadpool_t threadpool = new_ggml_threadpool(n_threads, policy);
+    if (threadpool != nullptr) {
+        g_ggml.pools.push_back(PooledThreadpool{threadpool, n_threads, policy, true});
+    }
+    return threadpool;
+}
+
+void release_ggml_threadpool(ggml_threadpool_t threadpool, void*) {
+    std::lock_guard<std::mutex> lock(g_ggml.mutex);
+    for (PooledThreadpool& pool : g_ggml.pools) {
+        if (pool.threadpool == threadpool) {
+            pool.leased = false;
+            return;
+        }
+    }
+}
+
+void pool_parallel_for(int n_tasks, whisper_parallel_task_fn task, void* arg, void*) {
+    worker_pool().parallel_for(n_tasks, n_tasks, [task, arg](int ith) { task(ith, arg); });
+}
+
+void* pool_task_start(whisper_parallel_task_fn task, void* arg, void*) {
+    return new WorkerPool::Task(worker_pool().async([task, arg]() { task(0, arg); }));
+}
+
+void pool_task_wait(void* handle, void*) {
+    std::unique_ptr<WorkerPool::Task> task(static_cast<WorkerPool::Task*>(handle));
+    task->wait();
+}
+
+} // namespace
+
+void whisper_threading_install() {
+    whisper_set_parallel_for(pool_parallel_for, nullptr);
+    whisper_set_task_runner(pool_task_start, pool_task_wait, nullptr);
+    whisper_set_threadpool_provider(acquire_ggml_threadpool, release_ggml_threadpool, nullptr);
+}
+
+void whisper_threading_release() {
+    std::lock_guard<std::mutex> lock(g_ggml.mutex);
+    size_t in_use = 0;
+    for (auto it = g_ggml.pools.begin(); it != g_ggml.pools.end();) {
+        if (it->leased) {
+            in_use++;
+            ++it;
+        } else {
+            g_ggml.free_fn(it->threadpool);
+            it = g_ggml.pools.erase(it);
+        }
+    }
+    if (in_use > 0) {
+        LOGW(TAG, "%zu ggml threadpools are in use; not releasing them.", in_use);
+    }
+}
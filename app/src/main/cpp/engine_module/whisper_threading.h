@@ -0,0 +1,15 @@
+// whisper_threading.h
+#pragma once
+
+// Routes whisper's thread usage through the native runtime: the mel
+// spectrogram, the decoders' sampling and the speculative encode of the next
+// window run on worker_pool(), and encoder, decoder and VAD graphs borrow
+// persistent ggml threadpools (hybrid polling, pinned to the current thread
+// policy's cores) instead of starting threads for every graph. Each state
+// computing at the same time gets a pool of its own, sized to its threads.
+// Needs the ggml CPU backend to be loaded; safe to call repeatedly.
+void whisper_threading_install();
+
+// Frees the idle ggml threadpools, e.g. before backends are unloaded at exit.
+// The hooks stay installed and create new threadpools for the next graphs.
+void whisper_threading_release();
@@ -0,0 +1,194 @@
+#include <jni.h>
+#include <memory>
+#include <string>
+
+#include "jni_audio_bridge.h"
+#include "audio_module/audio_cache.h"
+#include "audio_module/pcm_stream.h"
+#include "engine_module/cancellation.h"
+#include "platform/native_log.h"
+
+#define TAG "JNI_AUDIO_BRIDGE"
+
+// android.media.AudioFormat encodings accepted by the PCM entry points
+static constexpr jint kEncodingPcm16Bit = 2; // AudioFormat.ENCODING_PCM_16BIT
+static constexpr jint kEncodingPcmFloat = 4; // AudioFormat.ENCODING_PCM_FLOAT
+
+// Helper function to convert jstring to const char*
+static const char* jstringToChar(JNIEnv* env, jstring jstr) {
+    if (jstr == nullptr) return nullptr;
+    return env->GetStringUTFChars(jstr, nullptr);
+}
+
+// Helper function to release const char* from jstring
+static void releaseJstringChars(JNIEnv* env, jstring jstr, const char* chars) {
+    if (jstr != nullptr && chars != nullptr) {
+        env->ReleaseStringUTFChars(jstr, chars);
+    }
+}
+
+// Builds the PcmFormat for an AudioFormat encoding; false if the encoding is not supported.
+bool pcmFormatFromJava(jint sampleRate, jint channels, jint encoding, PcmFormat& format) {
+    if (sampleRate <= 0 || channels <= 0) return false;
+    if (encoding == kEncodingPcm16Bit) {
+        format.sample_format = PCM_FORMAT_S16LE;
+    } else if (encoding == kEncodingPcmFloat) {
+        format.sample_format = PCM_FORMAT_F32LE;
+    } else {
+        return false;
+    }
+    format.sample_rate = sampleRate;
+    format.channels = channels;
+    return true;
+}
+
+// --- NativeJob: per-job cancellation tokens ---
+// A handle is a heap-allocated CancellationToken. Kotlin frees it with nativeRelease
+// only after the native call it was passed to has returned.
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_example_clearchoice_NativeJob_nativeCreate(
+        JNIEnv* /* env */,
+        jclass /* clazz */) {
+    return reinterpret_cast<jlong>(new CancellationToken());
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_example_clearchoice_NativeJob_nativeCancel(
+        JNIEnv* /* env */,
+        jclass /* clazz */,
+        jlong handle) {
+    auto* token = reinterpret_cast<CancellationToken*>(handle);
+    if (token != nullptr) {
+        token->cancel();
+    }
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_example_clearchoice_NativeJob_nativeRelease(
+        JNIEnv* /* env */,
+        jclass /* clazz */,
+        jlong handle) {
+    delete reinterpret_cast<CancellationToken*>(handle);
+}
+
+// --- NativeAudioCache: decoded session audio shared by transcription and diarization ---
+// Audio handles are heap-allocated SharedAudio references; every handle returned
+// here must be freed with releaseAudio. Eviction never frees audio a handle still holds.
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_example_clearchoice_NativeAudioCache_lookup(
+        JNIEnv* env,
+        jobject /* this */,
+        jstring sourcePathJ) {
+
+    const char* sourcePath_cStr = jstringToChar(env, sourcePathJ);
+    if (sourcePath_cStr == nullptr) return 0;
+    AudioCacheKey key;
+    bool exists = audio_cache_key_for_file(sourcePath_cStr, key);
+    releaseJstringChars(env, sourcePathJ, sourcePath_cStr);
+    if (!exists) return 0;
+
+    SharedAudio audio = audio_cache_lookup(key);
+    return audio ? reinterpret_cast<jlong>(new SharedAudio(std::move(audio))) : 0;
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_example_clearchoice_NativeAudioCache_pcmStreamBegin(
+        JNIEnv* /* env */,
+        jobject /* this */,
+        jint sampleRate,
+        jint channels,
+        jint encoding) {
+
+    PcmFormat format;
+    if (!pcmFormatFromJava(sampleRate, channels, encoding, format)) {
+        LOGE(TAG, "pcmStreamBegin: unsupported format (%d Hz, %d ch, encoding %d).", sampleRate, channels, encoding);
+        return 0;
+    }
+    // downmix + resample as buffers arrive, so only 16 kHz mono is kept in memory
+    return reinterpret_cast<jlong>(new PcmStream(format, kAudioCacheSampleRate));
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_example_clearchoice_NativeAudioCache_pushPcm(
+        JNIEnv* env,
+        jobject /* this */,
+        jlong streamPtr,
+        jobject pcmBufferJ,
+        jint offset,
+        jint size) {
+
+    auto* stream = reinterpret_cast<PcmStream*>(streamPtr);
+    if (stream == nullptr || pcmBufferJ == nullptr || offset < 0 || size < 0) return JNI_FALSE;
+
+    auto* pcm = static_cast<uint8_t*>(env->GetDirectBufferAddress(pcmBufferJ));
+    if (pcm == nullptr) {
+        LOGE(TAG, "pushPcm: buffer is not direct.");
+        return JNI_FALSE;
+    }
+    if (static_cast<jlong>(offset) + size > env->GetDirectBufferCapacity(pcmBufferJ)) {
+        LOGE(TAG, "pushPcm: range %d+%d exceeds buffer capacity.", offset, size);
+        return JNI_FALSE;
+    }
+    return stream->push(pcm + offset, static_cast<size_t>(size)) ? JNI_TRUE : JNI_FALSE;
+}
+
+// Ends the stream and publishes its audio in the cache under sourcePath's
+// path/size/mtime. Returns an audio handle, or 0 if nothing was decoded. The
+// stream handle must still be freed with pcmStreamRelease.
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_example_clearchoice_NativeAudioCache_pcmStreamPublish(
+        JNIEnv* env,
+        jobject /* this */,
+        jlong streamPtr,
+        jstring sourcePathJ) {
+
+    auto* stream = reinterpret_cast<PcmStream*>(streamPtr);
+    if (stream == nullptr) return 0;
+    PcmAudio audio = stream->finish();
+    if (audio.samples.empty()) {
+        LOGE(TAG, "pcmStreamPublish: no audio was decoded.");
+        return 0;
+    }
+
+    AudioCacheKey key;
+    const char* sourcePath_cStr = jstringToChar(env, sourcePathJ);
+    bool keyed = sourcePath_cStr != nullptr && audio_cache_key_for_file(sourcePath_cStr, key);
+    releaseJstringChars(env, sourcePathJ, sourcePath_cStr);
+
+    SharedAudio shared = keyed ? audio_cache_insert(key, std::move(audio))
+                               : std::make_shared<const PcmAudio>(std::move(audio));
+    return reinterpret_cast<jlong>(new SharedAudio(std::move(shared)));
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_example_clearchoice_NativeAudioCache_pcmStreamRelease(
+        JNIEnv* /* env */,
+        jobject /* this */,
+        jlong streamPtr) {
+    delete reinterpret_cast<PcmStream*>(streamPtr);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_example_clearchoice_NativeAudioCache_releaseAudio(
+        JNIEnv* /* env */,
+        jobject /* this */,
+        jlong audioPtr) {
+    delete reinterpret_cast<SharedAudio*>(audioPtr);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_example_clearchoice_NativeAudioCache_setBudgetBytes(
+        JNIEnv* /* env */,
+        jobject /* this */,
+        jlong bytes) {
+    audio_cache_set_budget(bytes > 0 ? static_cast<size_t>(bytes) : 0);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_example_clearchoice_NativeAudioCache_clear(
+        JNIEnv* /* env */,
+        jobject /* this */) {
+    audio_cache_clear();
+}
@@ -0,0 +1,13 @@
+// jni_audio_bridge.h
+#pragma once
+#include <jni.h>
+
+#include "audio_module/pcm_loader.h"
+
+// NativeJob and NativeAudioCache: cancellation tokens and decoded session audio,
+// which diarization uses as well as transcription, so they do not need the
+// whisper engine.
+
+// Builds the PcmFormat for an android.media.AudioFormat encoding; false if the
+// encoding is not supported.
+bool pcmFormatFromJava(jint sampleRate, jint channels, jint encoding, PcmFormat& format);
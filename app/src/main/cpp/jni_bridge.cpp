@@ -1,11 +1,24 @@
 #include <jni.h>
+#include <memory>
 #include <string>
 #include <vector>
-#include <android/log.h>
-#include <fstream> // For file reading
-#include <sstream> // For string building
 
-#include "whisper_cpp/whisper.h"
+#include "whisper/whisper.h"
+#include "audio_module/audio_cache.h"
+#include "audio_module/pcm_stream.h"
+#include "audio_module/resampler.h"
+#include "engine_module/cancellation.h"
+#include "engine_module/encoder_cache.h"
+#include "engine_module/model_registry.h"
+#include "engine_module/parallel_transcriber.h"
+#include "engine_module/rtf_governor.h"
+#include "engine_module/session_pipeline.h"
+#include "engine_module/transcriber.h"
+#include "jni_audio_bridge.h"
+#include "jni_transcript_layout.h"
+#include "jni_transcription_listener.h"
+#include "platform/cpu_topology.h"
+#include "platform/native_log.h"
 
 #define TAG "JNI_BRIDGE"
 
@@ -29,125 +42,304 @@ Java_com_example_clearchoice_WhisperService_transcribeFile(
         jstring modelPathJ,
         jstring audioPathJ) {
 
-    __android_log_print(ANDROID_LOG_DEBUG, TAG, "TranscribeFile JNI function called (refined).");
+    LOGD(TAG, "TranscribeFile JNI function called.");
 
     const char* modelPath_cStr = jstringToChar(env, modelPathJ);
     const char* audioPath_cStr = jstringToChar(env, audioPathJ);
 
     if (modelPath_cStr == nullptr || audioPath_cStr == nullptr) {
-        __android_log_print(ANDROID_LOG_ERROR, TAG, "Model path or audio path is null.");
+        LOGE(TAG, "Model path or audio path is null.");
         releaseJstringChars(env, modelPathJ, modelPath_cStr);
         releaseJstringChars(env, audioPathJ, audioPath_cStr);
-        // Consider returning nullptr or a specific error string that Kotlin can check
         return env->NewStringUTF("ERROR: JNI received null model or audio path.");
     }
 
-    __android_log_print(ANDROID_LOG_INFO, TAG, "Model Path: %s", modelPath_cStr);
-    __android_log_print(ANDROID_LOG_INFO, TAG, "Audio Path (PCM): %s", audioPath_cStr);
+    std::string modelPath(modelPath_cStr);
+    std::string audioPath(audioPath_cStr);
+    releaseJstringChars(env, modelPathJ, modelPath_cStr);
+    releaseJstringChars(env, audioPathJ, audioPath_cStr);
 
-    // --- 1. Initialize whisper context ---
-    // Using whisper_init_from_file as the params version is more complex for a placeholder
-    struct whisper_context *ctx = whisper_init_from_file(modelPath_cStr);
-    if (ctx == nullptr) {
-        __android_log_print(ANDROID_LOG_ERROR, TAG, "Failed to initialize whisper context.");
-        releaseJstringChars(env, modelPathJ, modelPath_cStr);
-        releaseJstringChars(env, audioPathJ, audioPath_cStr);
-        return env->NewStringUTF("ERROR: whisper_init_from_file failed.");
+    TranscribeTimings timings;
+    std::string transcript = transcribe_pcm_file(modelPath, audioPath, &timings);
+    LOGI(TAG, "Timings (ms): model %.1f, state %.1f, audio %.1f, whisper_full %.1f, extract %.1f",
+         timings.model_load_ms, timings.state_init_ms, timings.audio_load_ms, timings.whisper_full_ms, timings.extract_ms);
+
+    return env->NewStringUTF(transcript.c_str());
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_example_clearchoice_WhisperService_nativeInit(
+        JNIEnv* env,
+        jobject /* this */,
+        jstring modelPathJ) {
+
+    const char* modelPath_cStr = jstringToChar(env, modelPathJ);
+    if (modelPath_cStr == nullptr) {
+        LOGE(TAG, "nativeInit: model path is null.");
+        return JNI_FALSE;
     }
-    __android_log_print(ANDROID_LOG_INFO, TAG, "Whisper context initialized.");
+    std::string modelPath(modelPath_cStr);
+    releaseJstringChars(env, modelPathJ, modelPath_cStr);
 
-    // --- 2. Read Audio Data (PCM 16-bit mono -> float vector) ---
-    std::vector<float> pcm_data_f32;
-    std::ifstream audio_file(audioPath_cStr, std::ios::binary);
-    if (!audio_file.is_open()) {
-        __android_log_print(ANDROID_LOG_ERROR, TAG, "Failed to open audio file: %s", audioPath_cStr);
-        whisper_free(ctx);
-        releaseJstringChars(env, modelPathJ, modelPath_cStr);
-        releaseJstringChars(env, audioPathJ, audioPath_cStr);
-        return env->NewStringUTF("ERROR: Failed to open PCM audio file.");
+    // Load the model and warm one state so the first transcription starts decoding immediately
+    std::shared_ptr<WhisperModel> model = model_registry_acquire(modelPath);
+    if (!model) {
+        return JNI_FALSE;
     }
+    PooledState warm_state(model);
+    return warm_state ? JNI_TRUE : JNI_FALSE;
+}
 
-    // Read 16-bit PCM samples and convert to float
-    // This assumes the input file is indeed 16-bit mono PCM.
-    std::vector<int16_t> pcm_data_s16;
-    char buffer[2]; // 2 bytes for int16_t
-    while (audio_file.read(buffer, 2)) {
-        int16_t sample = (static_cast<unsigned char>(buffer[1]) << 8) | static_cast<unsigned char>(buffer[0]);
-        pcm_data_s16.push_back(sample);
+extern "C" JNIEXPORT void JNICALL
+Java_com_example_clearchoice_WhisperService_nativeRelease(
+        JNIEnv* env,
+        jobject /* this */,
+        jstring modelPathJ) {
+
+    const char* modelPath_cStr = jstringToChar(env, modelPathJ);
+    if (modelPath_cStr == nullptr) {
+        model_registry_release_all();
+        return;
     }
-    audio_file.close();
+    std::string modelPath(modelPath_cStr);
+    releaseJstringChars(env, modelPathJ, modelPath_cStr);
 
-    if (pcm_data_s16.empty()) {
-         __android_log_print(ANDROID_LOG_ERROR, TAG, "Audio file was empty or failed to read: %s", audioPath_cStr);
-        whisper_free(ctx);
-        releaseJstringChars(env, modelPathJ, modelPath_cStr);
-        releaseJstringChars(env, audioPathJ, audioPath_cStr);
-        return env->NewStringUTF("ERROR: PCM audio file is empty or read failed.");
+    if (!model_registry_release(modelPath)) {
+        LOGW(TAG, "nativeRelease: model %s was not loaded.", modelPath.c_str());
+    }
+}
+
+static std::string transcribeStream(JNIEnv* env, jstring modelPathJ, PcmStream& stream) {
+    const char* modelPath_cStr = jstringToChar(env, modelPathJ);
+    if (modelPath_cStr == nullptr) {
+        LOGE(TAG, "Model path is null.");
+        return "ERROR: JNI received null model path.";
+    }
+    std::string modelPath(modelPath_cStr);
+    releaseJstringChars(env, modelPathJ, modelPath_cStr);
+
+    PcmAudio audio = stream.finish();
+    TranscribeTimings timings;
+    std::string transcript = transcribe_pcm_audio(modelPath, audio, &timings);
+    LOGI(TAG, "Timings (ms): model %.1f, state %.1f, whisper_full %.1f, extract %.1f",
+         timings.model_load_ms, timings.state_init_ms, timings.whisper_full_ms, timings.extract_ms);
+    return transcript;
+}
+
+// One-shot transcription of PCM held in a direct ByteBuffer (the whole buffer;
+// pass a slice() for a sub-range). The buffer is read in place, no copy through Java.
+extern "C" JNIEXPORT jstring JNICALL
+Java_com_example_clearchoice_WhisperService_transcribePcm(
+        JNIEnv* env,
+        jobject /* this */,
+        jstring modelPathJ,
+        jobject pcmBufferJ,
+        jint sampleRate,
+        jint channels,
+        jint encoding) {
+
+    PcmFormat format;
+    if (!pcmFormatFromJava(sampleRate, channels, encoding, format)) {
+        LOGE(TAG, "transcribePcm: unsupported format (%d Hz, %d ch, encoding %d).", sampleRate, channels, encoding);
+        return env->NewStringUTF("ERROR: Unsupported PCM audio format.");
     }
 
-    pcm_data_f32.resize(pcm_data_s16.size());
-    for (size_t i = 0; i < pcm_data_s16.size(); ++i) {
-        pcm_data_f32[i] = static_cast<float>(pcm_data_s16[i]) / 32768.0f;
+    void* pcm = pcmBufferJ != nullptr ? env->GetDirectBufferAddress(pcmBufferJ) : nullptr;
+    jlong pcmSize = pcm != nullptr ? env->GetDirectBufferCapacity(pcmBufferJ) : -1;
+    if (pcm == nullptr || pcmSize <= 0) {
+        LOGE(TAG, "transcribePcm: buffer is null, empty or not direct.");
+        return env->NewStringUTF("ERROR: transcribePcm needs a non-empty direct ByteBuffer.");
     }
-    __android_log_print(ANDROID_LOG_INFO, TAG, "Read %zu PCM samples, converted to float.", pcm_data_f32.size());
 
+    PcmStream stream(format, WHISPER_SAMPLE_RATE);
+    stream.push(pcm, static_cast<size_t>(pcmSize));
+    std::string transcript = transcribeStream(env, modelPathJ, stream);
+    return env->NewStringUTF(transcript.c_str());
+}
+
+// Transcribes audio published by NativeAudioCache (a SharedAudio handle). The
+// handle stays owned by the caller, so diarization can use the same buffer.
+extern "C" JNIEXPORT jstring JNICALL
+Java_com_example_clearchoice_WhisperService_transcribeAudio(
+        JNIEnv* env,
+        jobject /* this */,
+        jstring modelPathJ,
+        jlong audioPtr) {
+
+    auto* audio = reinterpret_cast<SharedAudio*>(audioPtr);
+    if (audio == nullptr || !*audio) {
+        return env->NewStringUTF("ERROR: Invalid audio handle.");
+    }
+    const char* modelPath_cStr = jstringToChar(env, modelPathJ);
+    if (modelPath_cStr == nullptr) {
+        LOGE(TAG, "Model path is null.");
+        return env->NewStringUTF("ERROR: JNI received null model path.");
+    }
+    std::string modelPath(modelPath_cStr);
+    releaseJstringChars(env, modelPathJ, modelPath_cStr);
 
-    // --- 3. Set whisper_full_params ---
-    // Using greedy sampling strategy
-    struct whisper_full_params params = whisper_full_default_params(WHISPER_SAMPLING_GREEDY);
-    params.print_progress = false; // Disable verbose progress from C++ side in release
-    params.print_special = false;
-    params.print_realtime = false;
-    params.print_timestamps = false; // Timestamps can be extracted per segment if needed
-    params.language = "en"; // For tiny.en model
-    params.n_threads = 4; // Example, adjust based on device capabilities
-    // params.translate = false; // Default is false
-    // params.no_context = true; // If processing independent chunks
+    TranscribeTimings timings;
+    std::string transcript = transcribe_pcm_audio(modelPath, **audio, &timings);
+    LOGI(TAG, "Timings (ms): model %.1f, state %.1f, whisper_full %.1f, extract %.1f",
+         timings.model_load_ms, timings.state_init_ms, timings.whisper_full_ms, timings.extract_ms);
+    return env->NewStringUTF(transcript.c_str());
+}
 
-    __android_log_print(ANDROID_LOG_INFO, TAG, "Whisper params set. Language: %s, Threads: %d", params.language, params.n_threads);
+// Transcribes a NativeAudioCache handle into the binary layout of
+// engine_module/transcript_layout.h. The returned direct ByteBuffer wraps native
+// memory and must be freed with TranscriptLayout.close(); null on failure.
+// listenerJ (TranscriptionListener, may be null) gets segments and progress while it runs.
+// jobPtr is a NativeJob handle (0 for none); a cancelled job returns null.
+extern "C" JNIEXPORT jobject JNICALL
+Java_com_example_clearchoice_WhisperService_transcribeToLayout(
+        JNIEnv* env,
+        jobject /* this */,
+        jstring modelPathJ,
+        jlong audioPtr,
+        jobject listenerJ,
+        jlong jobPtr) {
 
-    // --- 4. Run Transcription ---
-    __android_log_print(ANDROID_LOG_INFO, TAG, "Calling whisper_full...");
-    int whisper_result = whisper_full(ctx, params, pcm_data_f32.data(), pcm_data_f32.size());
-    if (whisper_result != 0) {
-        __android_log_print(ANDROID_LOG_ERROR, TAG, "whisper_full failed with code: %d", whisper_result);
-        whisper_free(ctx);
+    auto* audio = reinterpret_cast<SharedAudio*>(audioPtr);
+    const char* modelPath_cStr = jstringToChar(env, modelPathJ);
+    if (audio == nullptr || !*audio || modelPath_cStr == nullptr) {
+        LOGE(TAG, "transcribeToLayout: invalid audio handle or null model path.");
         releaseJstringChars(env, modelPathJ, modelPath_cStr);
-        releaseJstringChars(env, audioPathJ, audioPath_cStr);
-        std::string error_msg = "ERROR: whisper_full failed, code: " + std::to_string(whisper_result);
-        return env->NewStringUTF(error_msg.c_str());
+        return nullptr;
     }
-    __android_log_print(ANDROID_LOG_INFO, TAG, "whisper_full completed successfully.");
+    std::string modelPath(modelPath_cStr);
+    releaseJstringChars(env, modelPathJ, modelPath_cStr);
 
-    // --- 5. Extract Results ---
-    std::stringstream full_transcript_ss;
-    int n_segments = whisper_full_n_segments(ctx);
-    __android_log_print(ANDROID_LOG_INFO, TAG, "Number of segments: %d", n_segments);
-    for (int i = 0; i < n_segments; ++i) {
-        const char *segment_text = whisper_full_get_segment_text(ctx, i);
-        if (segment_text) {
-            full_transcript_ss << segment_text;
-            // Add a space or newline if desired, but for plain text, direct concatenation is fine.
-            // if (i < n_segments - 1) full_transcript_ss << " ";
-        } else {
-             __android_log_print(ANDROID_LOG_WARN, TAG, "Segment %d text is null.", i);
-        }
+    TranscribeTimings timings;
+    std::vector<uint8_t> layout;
+    JniTranscriptionListener listener(env, listenerJ);
+    std::string error = transcribe_pcm_audio_to_layout(modelPath, **audio, layout, &timings,
+                                                       listenerJ != nullptr ? &listener : nullptr,
+                                                       reinterpret_cast<const CancellationToken*>(jobPtr));
+    LOGI(TAG, "Timings (ms): model %.1f, state %.1f, whisper_full %.1f, extract %.1f",
+         timings.model_load_ms, timings.state_init_ms, timings.whisper_full_ms, timings.extract_ms);
+    if (!error.empty()) {
+        LOGE(TAG, "transcribeToLayout: %s", error.c_str());
+        return nullptr;
     }
-    std::string full_transcript = full_transcript_ss.str();
-    __android_log_print(ANDROID_LOG_INFO, TAG, "Full transcript extracted: %s", full_transcript.c_str());
 
+    return transcript_layout_to_java(env, std::move(layout));
+}
 
-    // --- 6. Cleanup ---
-    whisper_free(ctx);
-    __android_log_print(ANDROID_LOG_INFO, TAG, "Whisper context freed.");
+// Transcription and diarization in one pass over a NativeAudioCache handle.
+// Returns the session_pipeline JSON ({"transcript", "segments"} or {"error"}).
+// listenerJ (TranscriptionListener, may be null) gets segments and progress while it runs.
+// jobPtr is a NativeJob handle (0 for none); a cancelled job returns {"error": "Cancelled."}.
+extern "C" JNIEXPORT jstring JNICALL
+Java_com_example_clearchoice_WhisperService_transcribeAndDiarize(
+        JNIEnv* env,
+        jobject /* this */,
+        jstring modelPathJ,
+        jlong audioPtr,
+        jobject listenerJ,
+        jlong jobPtr) {
 
+    auto* audio = reinterpret_cast<SharedAudio*>(audioPtr);
+    if (audio == nullptr || !*audio) {
+        return env->NewStringUTF("{\"error\": \"Invalid audio handle.\"}");
+    }
+    const char* modelPath_cStr = jstringToChar(env, modelPathJ);
+    if (modelPath_cStr == nullptr) {
+        LOGE(TAG, "Model path is null.");
+        return env->NewStringUTF("{\"error\": \"JNI received null model path.\"}");
+    }
+    std::string modelPath(modelPath_cStr);
     releaseJstringChars(env, modelPathJ, modelPath_cStr);
-    releaseJstringChars(env, audioPathJ, audioPath_cStr);
 
-    if (full_transcript.empty() && n_segments > 0) {
-         __android_log_print(ANDROID_LOG_WARN, TAG, "Transcription resulted in empty string despite segments present.");
-        // Potentially return a specific indicator or let it be an empty string.
+    SessionTimings timings;
+    JniTranscriptionListener listener(env, listenerJ);
+    std::string result_json = transcribe_and_diarize_pcm_audio(modelPath, **audio, &timings,
+                                                               listenerJ != nullptr ? &listener : nullptr,
+                                                               reinterpret_cast<const CancellationToken*>(jobPtr));
+    LOGI(TAG, "Timings (ms): vad %.1f, model %.1f, state %.1f, whisper_full %.1f, embeddings %.1f, clustering %.1f, merge %.1f, total %.1f",
+         timings.vad_ms, timings.model_load_ms, timings.state_init_ms, timings.whisper_full_ms,
+         timings.embedding_ms, timings.clustering_ms, timings.merge_ms, timings.total_ms);
+    return env->NewStringUTF(result_json.c_str());
+}
+
+// quality: 0 = fast, 1 = balanced (default), 2 = high
+extern "C" JNIEXPORT void JNICALL
+Java_com_example_clearchoice_WhisperService_setResampleQuality(
+        JNIEnv* /* env */,
+        jobject /* this */,
+        jint quality) {
+    static const ResampleQuality kQualities[] = {RESAMPLE_QUALITY_FAST, RESAMPLE_QUALITY_BALANCED, RESAMPLE_QUALITY_HIGH};
+    if (quality < 0 || quality > 2) {
+        LOGW(TAG, "setResampleQuality: ignoring unknown quality %d.", quality);
+        return;
+    }
+    resampler_set_default_quality(kQualities[quality]);
+}
+
+// n_workers: 1 = sequential (default), 0 = auto, n = that many whisper states
+extern "C" JNIEXPORT void JNICALL
+Java_com_example_clearchoice_WhisperService_setParallelWorkers(
+        JNIEnv* /* env */,
+        jobject /* this */,
+        jint n_workers) {
+    if (n_workers < 0) {
+        LOGW(TAG, "setParallelWorkers: ignoring negative count %d.", n_workers);
+        return;
     }
+    parallel_transcribe_set_workers(n_workers);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_example_clearchoice_WhisperService_setEncoderPipelining(
+        JNIEnv* /* env */,
+        jobject /* this */,
+        jboolean enabled) {
+    transcribe_set_encoder_pipelining(enabled == JNI_TRUE);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_example_clearchoice_WhisperService_setAudioCtxAuto(
+        JNIEnv* /* env */,
+        jobject /* this */,
+        jboolean enabled) {
+    transcribe_set_audio_ctx_auto(enabled == JNI_TRUE);
+}
 
-    return env->NewStringUTF(full_transcript.c_str());
+extern "C" JNIEXPORT void JNICALL
+Java_com_example_clearchoice_WhisperService_setMelF16(
+        JNIEnv* /* env */,
+        jobject /* this */,
+        jboolean enabled) {
+    whisper_set_mel_f16(enabled == JNI_TRUE);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_example_clearchoice_WhisperService_setEncoderCache(
+        JNIEnv* /* env */,
+        jobject /* this */,
+        jboolean enabled) {
+    encoder_cache_set_enabled(enabled == JNI_TRUE);
+}
+
+// rtf: target wall time / audio time, e.g. 0.5; 0 turns the governor off
+extern "C" JNIEXPORT void JNICALL
+Java_com_example_clearchoice_WhisperService_setRtfTarget(
+        JNIEnv* /* env */,
+        jobject /* this */,
+        jfloat rtf) {
+    rtf_governor_set_target(rtf);
+}
+
+// policy: 0 = performance, 1 = balanced (default), 2 = background
+extern "C" JNIEXPORT void JNICALL
+Java_com_example_clearchoice_WhisperService_setThreadPolicy(
+        JNIEnv* /* env */,
+        jobject /* this */,
+        jint policy) {
+    if (policy < THREAD_POLICY_PERFORMANCE || policy > THREAD_POLICY_BACKGROUND) {
+        LOGW(TAG, "setThreadPolicy: ignoring unknown policy %d.", policy);
+        return;
+    }
+    thread_policy_set_default(static_cast<ThreadPolicy>(policy));
+    LOGI(TAG, "Thread policy: %s (%s)", thread_policy_name(static_cast<ThreadPolicy>(policy)),
+         describe_cpu_topology(get_cpu_topology()).c_str());
 }
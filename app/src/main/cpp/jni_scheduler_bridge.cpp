@@ -0,0 +1,105 @@
+#include <jni.h>
+#include <string>
+#include <vector>
+
+#include "jni_transcript_layout.h"
+#include "audio_module/audio_cache.h"
+#include "engine_module/job_scheduler.h"
+#include "platform/native_log.h"
+
+#define TAG_SCHEDULER "JNI_SCHEDULER_BRIDGE"
+
+// --- TranscriptionScheduler: queued multi-session transcription ---
+// Job ids are the scheduler's; every submitted job must end in takeResult or
+// release, or its result stays in native memory.
+
+// audioPtr is a NativeAudioCache handle; the job takes its own reference, so
+// the caller may release the handle right away. Returns the job id, 0 on error.
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_example_clearchoice_TranscriptionScheduler_submit(
+        JNIEnv* env,
+        jobject /* this */,
+        jstring modelPathJ,
+        jlong audioPtr,
+        jint priority) {
+    auto* audio = reinterpret_cast<SharedAudio*>(audioPtr);
+    if (audio == nullptr || !*audio || modelPathJ == nullptr) {
+        LOGE(TAG_SCHEDULER, "submit: invalid audio handle or null model path.");
+        return 0;
+    }
+    if (priority < JOB_PRIORITY_BACKGROUND || priority > JOB_PRIORITY_FOREGROUND) {
+        LOGW(TAG_SCHEDULER, "submit: unknown priority %d, using normal.", priority);
+        priority = JOB_PRIORITY_NORMAL;
+    }
+    const char* modelPath_cStr = env->GetStringUTFChars(modelPathJ, nullptr);
+    std::string modelPath(modelPath_cStr);
+    env->ReleaseStringUTFChars(modelPathJ, modelPath_cStr);
+
+    return job_scheduler_submit(modelPath, *audio, static_cast<JobPriority>(priority));
+}
+
+// JSON from job_info_to_json, or null if the job is unknown.
+extern "C" JNIEXPORT jstring JNICALL
+Java_com_example_clearchoice_TranscriptionScheduler_status(
+        JNIEnv* env,
+        jobject /* this */,
+        jlong jobId) {
+    JobInfo info;
+    if (!job_scheduler_status(jobId, info)) {
+        return nullptr;
+    }
+    return env->NewStringUTF(job_info_to_json(info).c_str());
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_example_clearchoice_TranscriptionScheduler_setPriority(
+        JNIEnv* /* env */,
+        jobject /* this */,
+        jlong jobId,
+        jint priority) {
+    if (priority < JOB_PRIORITY_BACKGROUND || priority > JOB_PRIORITY_FOREGROUND) {
+        LOGW(TAG_SCHEDULER, "setPriority: ignoring unknown priority %d.", priority);
+        return JNI_FALSE;
+    }
+    return job_scheduler_set_priority(jobId, static_cast<JobPriority>(priority)) ? JNI_TRUE : JNI_FALSE;
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_example_clearchoice_TranscriptionScheduler_cancel(
+        JNIEnv* /* env */,
+        jobject /* this */,
+        jlong jobId) {
+    return job_scheduler_cancel(jobId) ? JNI_TRUE : JNI_FALSE;
+}
+
+// For a finished job: its result in the transcript_layout.h format as a direct
+// ByteBuffer over native memory, freed by TranscriptLayout.close(). The job is
+// forgotten. Null if the job is unknown or not done.
+extern "C" JNIEXPORT jobject JNICALL
+Java_com_example_clearchoice_TranscriptionScheduler_takeResult(
+        JNIEnv* env,
+        jobject /* this */,
+        jlong jobId) {
+    std::vector<uint8_t> layout;
+    if (!job_scheduler_take_result(jobId, layout)) {
+        return nullptr;
+    }
+    return transcript_layout_to_java(env, std::move(layout));
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_example_clearchoice_TranscriptionScheduler_release(
+        JNIEnv* /* env */,
+        jobject /* this */,
+        jlong jobId) {
+    job_scheduler_release(jobId);
+}
+
+// n_workers: 0 = auto (half the thread policy's threads)
+extern "C" JNIEXPORT void JNICALL
+Java_com_example_clearchoice_TranscriptionScheduler_setWorkers(
+        JNIEnv* /* env */,
+        jobject /* this */,
+        jint n_workers) {
+    job_scheduler_set_workers(n_workers);
+}
@@ -0,0 +1,49 @@
+#include <jni.h>
+#include <mutex>
+#include <unordered_map>
+
+#include "jni_transcript_layout.h"
+#include "platform/native_log.h"
+
+#define TAG "JNI_TRANSCRIPT_LAYOUT"
+
+// Layouts lent to Kotlin, by the address their ByteBuffer wraps. Moving a
+// vector in and out leaves its storage where it is.
+static std::mutex g_layouts_mutex;
+static std::unordered_map<const void*, std::vector<uint8_t>> g_layouts;
+
+jobject transcript_layout_to_java(JNIEnv* env, std::vector<uint8_t>&& layout) {
+    if (layout.empty()) return nullptr;
+    void* address = layout.data();
+    const jlong capacity = static_cast<jlong>(layout.size());
+    {
+        std::lock_guard<std::mutex> lock(g_layouts_mutex);
+        g_layouts.emplace(address, std::move(layout));
+    }
+    jobject buffer = env->NewDirectByteBuffer(address, capacity);
+    if (buffer == nullptr) {
+        std::lock_guard<std::mutex> lock(g_layouts_mutex);
+        g_layouts.erase(address);
+    }
+    return buffer;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_example_clearchoice_TranscriptLayout_nativeFree(
+        JNIEnv* env,
+        jobject /* this */,
+        jobject bufferJ) {
+    if (bufferJ == nullptr) return;
+    const void* address = env->GetDirectBufferAddress(bufferJ);
+    std::vector<uint8_t> layout; // freed after the lock is released
+    {
+        std::lock_guard<std::mutex> lock(g_layouts_mutex);
+        auto it = g_layouts.find(address);
+        if (it == g_layouts.end()) {
+            LOGW(TAG, "nativeFree: not a transcript layout buffer, or freed already.");
+            return;
+        }
+        layout = std::move(it->second);
+        g_layouts.erase(it);
+    }
+}
@@ -0,0 +1,11 @@
+// jni_transcript_layout.h
+#pragma once
+#include <jni.h>
+#include <cstdint>
+#include <vector>
+
+// Hands a layout written by engine_module/transcript_layout to Kotlin as a
+// direct ByteBuffer over the vector's own storage, without copying it. The
+// vector is kept until TranscriptLayout.close() calls nativeFree. Null (and
+// the layout dropped) if the buffer cannot be created.
+jobject transcript_layout_to_java(JNIEnv* env, std::vector<uint8_t>&& layout);
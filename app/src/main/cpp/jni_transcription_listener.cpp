@@ -0,0 +1,121 @@
+// jni_transcription_listener.cpp
+#include "jni_transcription_listener.h"
+
+#include "platform/native_log.h"
+
+#define TAG "JNI_LISTENER"
+
+namespace {
+
+JavaVM* g_vm = nullptr;
+jmethodID g_on_segments = nullptr; // void onSegments(int[] startMs, int[] endMs, String[] texts)
+jmethodID g_on_progress = nullptr; // void onProgress(int percent)
+jclass g_string_class = nullptr;
+
+// Attaches the current thread on first use and detaches it when the thread exits.
+struct ThreadAttachment {
+    JNIEnv* env = nullptr;
+    bool attached = false;
+
+    ~ThreadAttachment() {
+        if (attached && g_vm != nullptr) g_vm->DetachCurrentThread();
+    }
+};
+
+JNIEnv* current_env() {
+    if (g_vm == nullptr) return nullptr;
+    thread_local ThreadAttachment attachment;
+    if (attachment.env != nullptr) return attachment.env;
+
+    JNIEnv* env = nullptr;
+    jint status = g_vm->GetEnv(reinterpret_cast<void**>(&env), JNI_VERSION_1_6);
+    if (status == JNI_EDETACHED) {
+        if (g_vm->AttachCurrentThread(&env, nullptr) != JNI_OK) {
+            LOGE(TAG, "Failed to attach native thread to the VM.");
+            return nullptr;
+        }
+        attachment.attached = true;
+    } else if (status != JNI_OK) {
+        return nullptr;
+    }
+    attachment.env = env;
+    return env;
+}
+
+} // namespace
+
+void jni_transcription_listener_on_load(JavaVM* vm, JNIEnv* env) {
+    g_vm = vm;
+    jclass listener_class = env->FindClass("com/example/clearchoice/TranscriptionListener");
+    jclass string_class = env->FindClass("java/lang/String");
+    if (listener_class == nullptr || string_class == nullptr) {
+        env->ExceptionClear();
+        LOGE(TAG, "TranscriptionListener class not found; progress callbacks disabled.");
+        return;
+    }
+    g_on_segments = env->GetMethodID(listener_class, "onSegments", "([I[I[Ljava/lang/String;)V");
+    g_on_progress = env->GetMethodID(listener_class, "onProgress", "(I)V");
+    g_string_class = static_cast<jclass>(env->NewGlobalRef(string_class));
+    if (g_on_segments == nullptr || g_on_progress == nullptr) {
+        env->ExceptionClear();
+        LOGE(TAG, "TranscriptionListener methods not found; progress callbacks disabled.");
+        g_on_segments = g_on_progress = nullptr;
+    }
+    env->DeleteLocalRef(listener_class);
+    env->DeleteLocalRef(string_class);
+}
+
+JniTranscriptionListener::JniTranscriptionListener(JNIEnv* env, jobject listener) {
+    if (listener != nullptr) listener_ = env->NewGlobalRef(listener);
+    failed_ = listener_ == nullptr || g_on_segments == nullptr;
+}
+
+JniTranscriptionListener::~JniTranscriptionListener() {
+    JNIEnv* env = current_env();
+    if (env != nullptr && listener_ != nullptr) env->DeleteGlobalRef(listener_);
+}
+
+bool JniTranscriptionListener::check_exception(JNIEnv* env, const char* method) {
+    if (!env->ExceptionCheck()) return true;
+    LOGE(TAG, "TranscriptionListener.%s threw; dropping further callbacks.", method);
+    env->ExceptionDescribe();
+    env->ExceptionClear();
+    failed_ = true;
+    return false;
+}
+
+void JniTranscriptionListener::on_segments(const std::vector<TranscribedSegment>& segments) {
+    if (failed_ || segments.empty()) return;
+    JNIEnv* env = current_env();
+    if (env == nullptr) return;
+
+    const jsize n = static_cast<jsize>(segments.size());
+    if (env->PushLocalFrame(n + 4) != 0) {
+        env->ExceptionClear();
+        return;
+    }
+    std::vector<jint> start_ms(n), end_ms(n);
+    jobjectArray texts = env->NewObjectArray(n, g_string_class, nullptr);
+    jintArray starts = env->NewIntArray(n);
+    jintArray ends = env->NewIntArray(n);
+    if (texts != nullptr && starts != nullptr && ends != nullptr) {
+        for (jsize i = 0; i < n; ++i) {
+            start_ms[i] = static_cast<jint>(segments[i].t0_ms);
+            end_ms[i] = static_cast<jint>(segments[i].t1_ms);
+            env->SetObjectArrayElement(texts, i, env->NewStringUTF(segments[i].text.c_str()));
+        }
+        env->SetIntArrayRegion(starts, 0, n, start_ms.data());
+        env->SetIntArrayRegion(ends, 0, n, end_ms.data());
+        env->CallVoidMethod(listener_, g_on_segments, starts, ends, texts);
+    }
+    check_exception(env, "onSegments");
+    env->PopLocalFrame(nullptr);
+}
+
+void JniTranscriptionListener::on_progress(int percent) {
+    if (failed_) return;
+    JNIEnv* env = current_env();
+    if (env == nullptr) return;
+    env->CallVoidMethod(listener_, g_on_progress, static_cast<jint>(percent));
+    check_exception(env, "onProgress");
+}
@@ -0,0 +1,32 @@
+// jni_transcription_listener.h
+#pragma once
+#include <jni.h>
+
+#include "engine_module/transcription_listener.h"
+
+// Resolves com.example.clearchoice.TranscriptionListener and its method IDs.
+// Called from JNI_OnLoad, where FindClass sees the app's class loader.
+void jni_transcription_listener_on_load(JavaVM* vm, JNIEnv* env);
+
+// Forwards native segment/progress callbacks to a Kotlin TranscriptionListener.
+// Holds a global reference to the listener for its lifetime. Callbacks may come
+// from any native thread: a thread that is not attached to the VM is attached
+// on its first delivery and stays attached until it exits. If the listener
+// throws, the exception is logged and cleared and further deliveries are dropped.
+class JniTranscriptionListener : public TranscriptionListener {
+public:
+    JniTranscriptionListener(JNIEnv* env, jobject listener);
+    ~JniTranscriptionListener() override;
+
+    JniTranscriptionListener(const JniTranscriptionListener&) = delete;
+    JniTranscriptionListener& operator=(const JniTranscriptionListener&) = delete;
+
+    void on_segments(const std::vector<TranscribedSegment>& segments) override;
+    void on_progress(int percent) override;
+
+private:
+    bool check_exception(JNIEnv* env, const char* method);
+
+    jobject listener_ = nullptr;
+    bool failed_ = false;
+};
@@ -1,2 +1,90 @@
 #include <jni.h>
+#include <dlfcn.h>
+#include <string>
+
+#include "whisper/whisper.h"
+#include "platform/cpu_dispatch.h"
+#include "platform/native_log.h"
+#include "jni_transcription_listener.h"
+
+#define TAG_NATIVE_LIB "NATIVE_LIB"
+
+// Directory libnative-lib.so was loaded from; the CPU backend variants are packaged next to it.
+static std::string native_lib_dir() {
+    Dl_info info;
+    if (dladdr(reinterpret_cast<void*>(&native_lib_dir), &info) == 0 || info.dli_fname == nullptr) {
+        return "";
+    }
+    std::string path(info.dli_fname);
+    size_t slash = path.find_last_of('/');
+    return slash == std::string::npos ? "" : path.substr(0, slash);
+}
+
+extern "C" JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM* vm, void* /* reserved */) {
+    JNIEnv* env = nullptr;
+    if (vm->GetEnv(reinterpret_cast<void**>(&env), JNI_VERSION_1_6) != JNI_OK) {
+        return JNI_ERR;
+    }
+
+    // Pick the ggml CPU kernels for this device before any model is loaded
+    std::string variant = load_best_cpu_backend(native_lib_dir());
+    if (variant.empty()) {
+        LOGE(TAG_NATIVE_LIB, "No CPU backend available - transcription will fail.");
+    }
+    LOGI(TAG_NATIVE_LIB, "%s", whisper_print_system_info());
+
+    jni_transcription_listener_on_load(vm, env);
+
+    return JNI_VERSION_1_6;
+}
+
+// --- WhisperBridge: thin bindings over the whisper C API ---
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_example_clearchoice_WhisperBridge_whisperInitFromFile(JNIEnv* env, jobject /* this */, jstring modelPathJ) {
+    if (modelPathJ == nullptr) return 0;
+    const char* modelPath = env->GetStringUTFChars(modelPathJ, nullptr);
+    struct whisper_context* ctx = whisper_init_from_file_with_params(modelPath, whisper_context_default_params());
+    env->ReleaseStringUTFChars(modelPathJ, modelPath);
+    if (ctx == nullptr) {
+        LOGE(TAG_NATIVE_LIB, "whisperInitFromFile: failed to load model.");
+    }
+    return reinterpret_cast<jlong>(ctx);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_example_clearchoice_WhisperBridge_whisperFree(JNIEnv* /* env */, jobject /* this */, jlong ctxPtr) {
+    whisper_free(reinterpret_cast<struct whisper_context*>(ctxPtr));
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_example_clearchoice_WhisperBridge_whisperFull(JNIEnv* env, jobject /* this */, jlong ctxPtr, jfloatArray samplesJ) {
+    auto* ctx = reinterpret_cast<struct whisper_context*>(ctxPtr);
+    if (ctx == nullptr || samplesJ == nullptr) return -1;
+
+    jsize n_samples = env->GetArrayLength(samplesJ);
+    jfloat* samples = env->GetFloatArrayElements(samplesJ, nullptr);
+
+    struct whisper_full_params params = whisper_full_default_params(WHISPER_SAMPLING_GREEDY);
+    params.print_progress = false;
+    params.print_timestamps = false;
+    params.language = "en";
+
+    int result = whisper_full(ctx, params, samples, n_samples);
+
+    env->ReleaseFloatArrayElements(samplesJ, samples, JNI_ABORT); // read-only, no copy back
+    return result;
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_example_clearchoice_WhisperBridge_whisperFullNSegments(JNIEnv* /* env */, jobject /* this */, jlong ctxPtr) {
+    auto* ctx = reinterpret_cast<struct whisper_context*>(ctxPtr);
+    return ctx != nullptr ? whisper_full_n_segments(ctx) : 0;
+}
+
+extern "C" JNIEXPORT jstring JNICALL
+Java_com_example_clearchoice_WhisperBridge_whisperFullGetSegmentText(JNIEnv* env, jobject /* this */, jlong ctxPtr, jint index) {
+    auto* ctx = reinterpret_cast<struct whisper_context*>(ctxPtr);
+    if (ctx == nullptr || index < 0 || index >= whisper_full_n_segments(ctx)) return nullptr;
+    return env->NewStringUTF(whisper_full_get_segment_text(ctx, index));
 }
@@ -0,0 +1,113 @@
+// cpu_dispatch.cpp
+#include "cpu_dispatch.h"
+
+#include <unistd.h>
+
+#include "ggml-backend.h"
+#include "native_log.h"
+
+#if defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+#ifndef HWCAP_ASIMD
+#define HWCAP_ASIMD   (1 << 1)
+#endif
+#ifndef HWCAP_ASIMDHP
+#define HWCAP_ASIMDHP (1 << 10)
+#endif
+#ifndef HWCAP_ASIMDDP
+#define HWCAP_ASIMDDP (1 << 20)
+#endif
+#ifndef HWCAP2_I8MM
+#define HWCAP2_I8MM   (1 << 13)
+#endif
+#endif
+
+#define TAG_CPU_DISPATCH "CPU_DISPATCH"
+
+static CpuFeatures probe_cpu_features() {
+    CpuFeatures f;
+#if defined(__aarch64__)
+    f.neon = true; // mandatory on arm64
+#if defined(__linux__)
+    const unsigned long hwcap  = getauxval(AT_HWCAP);
+    const unsigned long hwcap2 = getauxval(AT_HWCAP2);
+    f.neon    = (hwcap & HWCAP_ASIMD) != 0;
+    f.fp16    = (hwcap & HWCAP_ASIMDHP) != 0;
+    f.dotprod = (hwcap & HWCAP_ASIMDDP) != 0;
+    f.i8mm    = (hwcap2 & HWCAP2_I8MM) != 0;
+#endif
+#elif defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    f.sse41 = __builtin_cpu_supports("sse4.1");
+    f.avx   = __builtin_cpu_supports("avx");
+    f.avx2  = __builtin_cpu_supports("avx2");
+    f.fma   = __builtin_cpu_supports("fma");
+    f.f16c  = __builtin_cpu_supports("f16c");
+#endif
+    return f;
+}
+
+const CpuFeatures& get_cpu_features() {
+    static const CpuFeatures features = probe_cpu_features();
+    return features;
+}
+
+std::string describe_cpu_features(const CpuFeatures& f) {
+    std::string s;
+    auto add = [&s](const char* name, bool on) {
+        if (!on) return;
+        if (!s.empty()) s += ' ';
+        s += name;
+    };
+    add("neon", f.neon);
+    add("dotprod", f.dotprod);
+    add("fp16", f.fp16);
+    add("i8mm", f.i8mm);
+    add("sse4.1", f.sse41);
+    add("avx", f.avx);
+    add("avx2", f.avx2);
+    add("fma", f.fma);
+    add("f16c", f.f16c);
+    return s.empty() ? "baseline" : s;
+}
+
+std::vector<std::string> cpu_backend_variant_candidates(const CpuFeatures& f) {
+    std::vector<std::string> variants;
+#if defined(__aarch64__)
+    if (f.dotprod && f.fp16 && f.i8mm) variants.push_back("armv8.6_i8mm");
+    if (f.dotprod && f.fp16)           variants.push_back("armv8.2_dotprod_fp16");
+#elif defined(__x86_64__)
+    if (f.avx2 && f.fma && f.f16c)     variants.push_back("x86_64_avx2");
+#endif
+    (void) f;
+    variants.push_back("generic");
+    return variants;
+}
+
+std::string load_best_cpu_backend(const std::string& lib_dir) {
+    if (ggml_backend_dev_by_type(GGML_BACKEND_DEVICE_TYPE_CPU) != nullptr) {
+        // already registered (static CPU backend or a previous call)
+        return "builtin";
+    }
+
+    const CpuFeatures& features = get_cpu_features();
+    LOGI(TAG_CPU_DISPATCH, "CPU features: %s", describe_cpu_features(features).c_str());
+
+    for (const std::string& variant : cpu_backend_variant_candidates(features)) {
+        const std::string file_name = "libggml-cpu-" + variant + ".so";
+
+        std::string path = file_name;
+        if (!lib_dir.empty() && access((lib_dir + "/" + file_name).c_str(), R_OK) == 0) {
+            path = lib_dir + "/" + file_name;
+        }
+
+        if (ggml_backend_load(path.c_str()) != nullptr) {
+            LOGI(TAG_CPU_DISPATCH, "Loaded CPU backend variant: %s", variant.c_str());
+            return variant;
+        }
+        LOGW(TAG_CPU_DISPATCH, "CPU backend variant %s not loadable, trying next.", variant.c_str());
+    }
+
+    LOGE(TAG_CPU_DISPATCH, "No ggml CPU backend could be loaded.");
+    return "";
+}
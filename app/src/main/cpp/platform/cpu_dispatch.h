@@ -0,0 +1,33 @@
+// cpu_dispatch.h
+#pragma once
+#include <string>
+#include <vector>
+
+// ISA extensions relevant to the inference kernels, probed once per process.
+struct CpuFeatures {
+    // arm64
+    bool neon = false;
+    bool dotprod = false; // SDOT/UDOT (armv8.2 FEAT_DotProd)
+    bool fp16 = false;    // half-precision vector arithmetic (FEAT_FP16)
+    bool i8mm = false;    // int8 matrix multiply (FEAT_I8MM)
+
+    // x86_64
+    bool sse41 = false;
+    bool avx = false;
+    bool avx2 = false;
+    bool fma = false;
+    bool f16c = false;
+};
+
+const CpuFeatures& get_cpu_features();
+std::string describe_cpu_features(const CpuFeatures& features);
+
+// Names of the ggml CPU backend variants this device can run, best first.
+// Must match CLEARCHOICE_CPU_VARIANTS in CMakeLists.txt.
+std::vector<std::string> cpu_backend_variant_candidates(const CpuFeatures& features);
+
+// Loads the best libggml-cpu-<variant>.so into the ggml backend registry.
+// lib_dir is searched first; if empty or the file is not there the bare library
+// name is handed to the dynamic linker (e.g. uncompressed libs inside the APK).
+// Returns the loaded variant name, or an empty string if no CPU backend could be loaded.
+std::string load_best_cpu_backend(const std::string& lib_dir);
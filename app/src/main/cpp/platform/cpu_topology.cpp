@@ -0,0 +1,352 @@
+// cpu_topology.cpp
+#include "cpu_topology.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <map>
+#include <thread>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+#include "native_log.h"
+
+#define TAG_CPU_TOPOLOGY "CPU_TOPOLOGY"
+
+static const char* kSysfsCpuRoot = "/sys/devices/system/cpu";
+
+static bool read_line(const std::string& path, std::string& line) {
+    FILE* f = fopen(path.c_str(), "re");
+    if (f == nullptr) return false;
+    char buf[256];
+    const bool ok = fgets(buf, sizeof(buf), f) != nullptr;
+    fclose(f);
+    if (!ok) return false;
+    line = buf;
+    while (!line.empty() && (line.back() == '\n' || line.back() == ' ')) line.pop_back();
+    return true;
+}
+
+static bool read_long(const std::string& path, long& value) {
+    std::string line;
+    if (!read_line(path, line) || line.empty()) return false;
+    char* end = nullptr;
+    value = strtol(line.c_str(), &end, 10);
+    return end != line.c_str();
+}
+
+// Kernel cpu lists: "0-3,6,8-9" (also space separated, as in related_cpus).
+static std::vector<int> parse_cpu_list(const std::string& list) {
+    std::vector<int> cpus;
+    const char* p = list.c_str();
+    while (*p != '\0') {
+        char* end = nullptr;
+        long first = strtol(p, &end, 10);
+        if (end == p) { ++p; continue; }
+        long last = first;
+        p = end;
+        if (*p == '-') {
+            last = strtol(p + 1, &end, 10);
+            p = end;
+        }
+        for (long cpu = first; cpu <= last && cpu < 4096; ++cpu) {
+            cpus.push_back(static_cast<int>(cpu));
+        }
+    }
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
+
+static std::string format_cpu_list(const std::vector<int>& cpus) {
+    std::string s;
+    for (size_t i = 0; i < cpus.size();) {
+        size_t j = i;
+        while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) ++j;
+        if (!s.empty()) s += ',';
+        s += std::to_string(cpus[i]);
+        if (j > i) s += '-' + std::to_string(cpus[j]);
+        i = j + 1;
+    }
+    return s;
+}
+
+// cpuN directories, for kernels without a "present" file.
+static std::vector<int> list_cpu_dirs(const std::string& root) {
+    std::vector<int> cpus;
+    DIR* dir = opendir(root.c_str());
+    if (dir == nullptr) return cpus;
+    while (dirent* entry = readdir(dir)) {
+        const char* name = entry->d_name;
+        if (strncmp(name, "cpu", 3) != 0 || name[3] < '0' || name[3] > '9') continue;
+        char* end = nullptr;
+        long id = strtol(name + 3, &end, 10);
+        if (*end == '\0') cpus.push_back(static_cast<int>(id));
+    }
+    closedir(dir);
+    std::sort(cpus.begin(), cpus.end());
+    return cpus;
+}
+
+int CpuTopology::online_count() const {
+    return static_cast<int>(std::count_if(cores.begin(), cores.end(), [](const CpuCore& c) { return c.online; }));
+}
+
+bool probe_cpu_topology(const std::string& sysfs_root, CpuTopology& topology) {
+    topology = CpuTopology();
+
+    std::string line;
+    std::vector<int> present = read_line(sysfs_root + "/present", line) ? parse_cpu_list(line) : list_cpu_dirs(sysfs_root);
+    if (present.empty()) {
+        return false;
+    }
+    std::vector<int> online;
+    const bool have_online = read_line(sysfs_root + "/online", line);
+    if (have_online) online = parse_cpu_list(line);
+
+    // Cores sharing a cpufreq policy form a cluster; older kernels only have
+    // topology ids. Keys are prefixed so the two kinds never collide.
+    std::map<std::string, std::vector<size_t>> groups;
+    bool have_capacity = true;
+    long fastest_khz = 0;
+    for (int id : present) {
+        const std::string dir = sysfs_root + "/cpu" + std::to_string(id);
+        CpuCore core;
+        core.id = id;
+        core.online = !have_online || std::binary_search(online.begin(), online.end(), id);
+
+        long value = 0;
+        if (read_long(dir + "/cpu_capacity", value) && value > 0) {
+            core.capacity = static_cast<int>(value);
+        } else {
+            have_capacity = false;
+        }
+        if (read_long(dir + "/cpufreq/cpuinfo_max_freq", value) && value > 0) {
+            core.max_freq_khz = value;
+            fastest_khz = std::max(fastest_khz, value);
+        }
+
+        core.smt_core = id;
+        if (read_line(dir + "/topology/thread_siblings_list", line) && !parse_cpu_list(line).empty()) {
+            core.smt_core = std::min(id, parse_cpu_list(line).front());
+        }
+
+        std::string key;
+        if (read_line(dir + "/cpufreq/related_cpus", line) && !parse_cpu_list(line).empty()) {
+            key = "policy" + std::to_string(parse_cpu_list(line).front());
+        } else if (read_long(dir + "/topology/cluster_id", value) && value >= 0) {
+            key = "cluster" + std::to_string(value);
+        } else if (read_long(dir + "/topology/physical_package_id", value) && value >= 0) {
+            key = "package" + std::to_string(value);
+        }
+        groups[key].push_back(topology.cores.size());
+        topology.cores.push_back(core);
+    }
+
+    // Without cpu_capacity the max frequency is the best speed estimate we have
+    // (it ignores IPC differences between core types, but ranks them correctly
+    // on every SoC we ship to).
+    if (!have_capacity) {
+        for (CpuCore& core : topology.cores) {
+            core.capacity = fastest_khz > 0 && core.max_freq_khz > 0
+                                ? static_cast<int>(core.max_freq_khz * 1024 / fastest_khz)
+                                : 1024;
+        }
+    }
+
+    for (const auto& group : groups) {
+        CpuCluster cluster;
+        for (size_t index : group.second) {
+            const CpuCore& core = topology.cores[index];
+            cluster.cpus.push_back(core.id);
+            cluster.capacity = std::max(cluster.capacity, core.capacity);
+            cluster.max_freq_khz = std::max(cluster.max_freq_khz, core.max_freq_khz);
+        }
+        topology.clusters.push_back(cluster);
+    }
+    std::sort(topology.clusters.begin(), topology.clusters.end(), [](const CpuCluster& a, const CpuCluster& b) {
+        if (a.capacity != b.capacity) return a.capacity < b.capacity;
+        if (a.max_freq_khz != b.max_freq_khz) return a.max_freq_khz < b.max_freq_khz;
+        return a.cpus.front() < b.cpus.front();
+    });
+    for (size_t c = 0; c < topology.clusters.size(); ++c) {
+        for (CpuCore& core : topology.cores) {
+            if (std::binary_search(topology.clusters[c].cpus.begin(), topology.clusters[c].cpus.end(), core.id)) {
+                core.cluster = static_cast<int>(c);
+            }
+        }
+    }
+    return true;
+}
+
+static CpuTopology probe_device_topology() {
+    CpuTopology topology;
+    if (probe_cpu_topology(kSysfsCpuRoot, topology)) {
+        LOGI(TAG_CPU_TOPOLOGY, "%s", describe_cpu_topology(topology).c_str());
+        return topology;
+    }
+    const int n = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    LOGW(TAG_CPU_TOPOLOGY, "sysfs cpu topology unreadable; assuming %d identical cores.", n);
+    CpuCluster cluster;
+    cluster.capacity = 1024;
+    for (int id = 0; id < n; ++id) {
+        CpuCore core;
+        core.id = id;
+        core.capacity = 1024;
+        core.smt_core = id;
+        topology.cores.push_back(core);
+        cluster.cpus.push_back(id);
+    }
+    topology.clusters.push_back(cluster);
+    return topology;
+}
+
+const CpuTopology& get_cpu_topology() {
+    static const CpuTopology topology = probe_device_topology();
+    return topology;
+}
+
+std::string describe_cpu_topology(const CpuTopology& topology) {
+    std::string s = std::to_string(topology.cores.size()) + " cpus (" + std::to_string(topology.online_count()) + " online), " +
+                    std::to_string(topology.clusters.size()) + (topology.clusters.size() == 1 ? " cluster:" : " clusters:");
+    char buf[96];
+    for (const CpuCluster& cluster : topology.clusters) {
+        snprintf(buf, sizeof(buf), " [%s] capacity %d", format_cpu_list(cluster.cpus).c_str(), cluster.capacity);
+        s += buf;
+        if (cluster.max_freq_khz > 0) {
+            snprintf(buf, sizeof(buf), " @ %.2f GHz", cluster.max_freq_khz / 1e6);
+            s += buf;
+        }
+        s += ';';
+    }
+    if (!s.empty() && s.back() == ';') s.pop_back();
+    return s;
+}
+
+static std::atomic<int> g_default_policy{THREAD_POLICY_BALANCED};
+
+void thread_policy_set_default(ThreadPolicy policy) {
+    g_default_policy.store(policy, std::memory_order_relaxed);
+}
+
+ThreadPolicy thread_policy_default() {
+    return static_cast<ThreadPolicy>(g_default_policy.load(std::memory_order_relaxed));
+}
+
+bool thread_policy_from_name(const char* name, ThreadPolicy& policy) {
+    if (name == nullptr) return false;
+    if (std::strcmp(name, "performance") == 0) { policy = THREAD_POLICY_PERFORMANCE; return true; }
+    if (std::strcmp(name, "balanced") == 0) { policy = THREAD_POLICY_BALANCED; return true; }
+    if (std::strcmp(name, "background") == 0) { policy = THREAD_POLICY_BACKGROUND; return true; }
+    return false;
+}
+
+const char* thread_policy_name(ThreadPolicy policy) {
+    switch (policy) {
+        case THREAD_POLICY_PERFORMANCE: return "performance";
+        case THREAD_POLICY_BALANCED: return "balanced";
+        case THREAD_POLICY_BACKGROUND: return "background";
+    }
+    return "unknown";
+}
+
+ThreadPlan plan_threads(const CpuTopology& topology, ThreadPolicy policy) {
+    // online cpus of clusters [first, last)
+    auto online_cpus = [&topology](size_t first, size_t last) {
+        std::vector<int> cpus;
+        for (size_t c = first; c < last && c < topology.clusters.size(); ++c) {
+            for (int id : topology.clusters[c].cpus) {
+                auto core = std::find_if(topology.cores.begin(), topology.cores.end(), [id](const CpuCore& k) { return k.id == id; });
+                if (core != topology.cores.end() && core->online) cpus.push_back(id);
+            }
+        }
+        std::sort(cpus.begin(), cpus.end());
+        return cpus;
+    };
+
+    const size_t n_clusters = topology.clusters.size();
+    // the LITTLE cluster is every cluster as slow as the slowest one
+    size_t n_little = 0;
+    if (topology.heterogeneous()) {
+        while (n_little < n_clusters && topology.clusters[n_little].capacity == topology.clusters.front().capacity) ++n_little;
+    }
+
+    ThreadPlan plan;
+    int max_threads = 4;
+    switch (policy) {
+        case THREAD_POLICY_PERFORMANCE:
+            plan.cpus = online_cpus(n_little, n_clusters);
+            max_threads = 8;
+            break;
+        case THREAD_POLICY_BALANCED: {
+            plan.cpus = online_cpus(n_little, n_clusters);
+            // leave a small prime cluster (e.g. the 1 in 1+3+4) to the UI thread
+            if (topology.heterogeneous() && n_clusters - n_little >= 2) {
+                std::vector<int> mid = online_cpus(n_little, n_clusters - 1);
+                if (mid.size() >= 2 && topology.clusters.back().cpus.size() <= 2) plan.cpus = mid;
+            }
+            max_threads = 4;
+            break;
+        }
+        case THREAD_POLICY_BACKGROUND:
+            plan.cpus = online_cpus(0, topology.heterogeneous() ? n_little : n_clusters);
+            max_threads = 2;
+            break;
+    }
+    if (plan.cpus.empty()) {
+        plan.cpus = online_cpus(0, n_clusters); // the chosen cluster is offline
+    }
+    std::vector<int> smt_cores;
+    for (int id : plan.cpus) {
+        auto core = std::find_if(topology.cores.begin(), topology.cores.end(), [id](const CpuCore& k) { return k.id == id; });
+        smt_cores.push_back(core != topology.cores.end() ? core->smt_core : id);
+    }
+    std::sort(smt_cores.begin(), smt_cores.end());
+    const int n_cores = static_cast<int>(std::unique(smt_cores.begin(), smt_cores.end()) - smt_cores.begin());
+    plan.n_threads = std::max(1, std::min(max_threads, n_cores));
+    return plan;
+}
+
+ThreadPlan current_thread_plan() {
+    return plan_threads(get_cpu_topology(), thread_policy_default());
+}
+
+ScopedThreadAffinity::ScopedThreadAffinity(const ThreadPlan& plan) {
+#if defined(__linux__)
+    if (plan.cpus.empty()) return;
+    cpu_set_t previous;
+    CPU_ZERO(&previous);
+    if (sched_getaffinity(0, sizeof(previous), &previous) != 0) return;
+    cpu_set_t wanted;
+    CPU_ZERO(&wanted);
+    for (int cpu : plan.cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) CPU_SET(cpu, &wanted);
+    }
+    if (sched_setaffinity(0, sizeof(wanted), &wanted) != 0) {
+        LOGW(TAG_CPU_TOPOLOGY, "Could not pin thread to cpus %s.", format_cpu_list(plan.cpus).c_str());
+        return;
+    }
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &previous)) previous_.push_back(cpu);
+    }
+    pinned_ = true;
+    LOGD(TAG_CPU_TOPOLOGY, "Thread pinned to cpus %s.", format_cpu_list(plan.cpus).c_str());
+#else
+    (void) plan;
+#endif
+}
+
+ScopedThreadAffinity::~ScopedThreadAffinity() {
+#if defined(__linux__)
+    if (!pinned_) return;
+    cpu_set_t previous;
+    CPU_ZERO(&previous);
+    for (int cpu : previous_) CPU_SET(cpu, &previous);
+    sched_setaffinity(0, sizeof(previous), &previous);
+#endif
+}
@@ -0,0 +1,95 @@
+// cpu_topology.h
+#pragma once
+#include <string>
+#include <vector>
+
+// One logical CPU as described by sysfs.
+struct CpuCore {
+    int id = 0;
+    bool online = true;
+    int capacity = 0;        // cpu_capacity (1024 = fastest core); derived from max_freq_khz if absent
+    long max_freq_khz = 0;   // cpufreq/cpuinfo_max_freq, 0 if unknown
+    int cluster = 0;         // index into CpuTopology::clusters
+    int smt_core = 0;        // lowest cpu of its SMT siblings (topology/thread_siblings_list); id without SMT
+};
+
+// CPUs sharing a cpufreq policy (or cluster id). Clusters are sorted by
+// capacity, slowest first, so clusters.front() is the LITTLE cluster.
+struct CpuCluster {
+    std::vector<int> cpus;
+    int capacity = 0;
+    long max_freq_khz = 0;
+};
+
+struct CpuTopology {
+    std::vector<CpuCore> cores; // present cpus, by id
+    std::vector<CpuCluster> clusters;
+
+    // true if some cores are slower than others (big.LITTLE / DynamIQ)
+    bool heterogeneous() const { return clusters.size() > 1 && clusters.front().capacity < clusters.back().capacity; }
+    int online_count() const;
+};
+
+// Reads the topology below sysfs_root (normally /sys/devices/system/cpu): the
+// present/online lists, and per cpu its cpu_capacity, cpufreq limits and the
+// cpufreq policy or topology cluster it belongs to. Missing files degrade to a
+// single homogeneous cluster. Returns false if no cpu could be found at all.
+bool probe_cpu_topology(const std::string& sysfs_root, CpuTopology& topology);
+
+// Topology of this device, probed once per process; falls back to
+// hardware_concurrency identical cores if sysfs is unreadable.
+const CpuTopology& get_cpu_topology();
+
+std::string describe_cpu_topology(const CpuTopology& topology);
+
+// How many threads inference gets and which cores they may run on.
+//   PERFORMANCE: every big core (all cores on homogeneous CPUs), up to 8 threads.
+//   BALANCED:    the big cores minus a lone prime cluster, up to 4 threads; the default.
+//   BACKGROUND:  the LITTLE cluster only, up to 2 threads.
+// Threads are never placed on the LITTLE cluster unless the policy asks for it:
+// every ggml graph step ends at a barrier, so one slow core gates them all. For
+// the same reason there is at most one thread per physical core: SMT siblings
+// share its execution units and finish a step later than a core of their own.
+enum ThreadPolicy {
+    THREAD_POLICY_PERFORMANCE = 0,
+    THREAD_POLICY_BALANCED = 1,
+    THREAD_POLICY_BACKGROUND = 2,
+};
+
+// Process-wide policy used by transcription and diarization. Defaults to BALANCED.
+void thread_policy_set_default(ThreadPolicy policy);
+ThreadPolicy thread_policy_default();
+
+// Parses "performance" / "balanced" / "background"; false if the name is unknown.
+bool thread_policy_from_name(const char* name, ThreadPolicy& policy);
+const char* thread_policy_name(ThreadPolicy policy);
+
+struct ThreadPlan {
+    int n_threads = 1;
+    std::vector<int> cpus; // allowed cpus; empty = no pinning
+};
+
+ThreadPlan plan_threads(const CpuTopology& topology, ThreadPolicy policy);
+
+// plan_threads(get_cpu_topology(), thread_policy_default())
+ThreadPlan current_thread_plan();
+
+// Pins the calling thread to plan.cpus for its lifetime and restores the
+// previous affinity afterwards. Threads started meanwhile (ggml's graph
+// workers, whisper's mel workers, the speaker branch) inherit the mask, which
+// is how the whole job ends up on the chosen cores. A no-op for an empty plan
+// or where affinity is unsupported.
+class ScopedThreadAffinity {
+public:
+    explicit ScopedThreadAffinity(const ThreadPlan& plan);
+    ~ScopedThreadAffinity();
+
+    ScopedThreadAffinity(const ScopedThreadAffinity&) = delete;
+    ScopedThreadAffinity& operator=(const ScopedThreadAffinity&) = delete;
+
+    bool pinned() const { return pinned_; }
+
+private:
+    bool pinned_ = false;
+    std::vector<int> previous_;
+};
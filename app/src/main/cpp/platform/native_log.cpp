@@ -0,0 +1,30 @@
+// native_log.cpp
+#include "native_log.h"
+
+#if !defined(__ANDROID__)
+
+#include <atomic>
+#include <mutex>
+
+static std::atomic<int> g_min_level{NATIVE_LOG_INFO};
+static std::mutex g_log_mutex;
+
+void native_log_set_min_level(NativeLogLevel level) {
+    g_min_level.store(level, std::memory_order_relaxed);
+}
+
+void native_log_print(NativeLogLevel level, const char* tag, const char* fmt, ...) {
+    if (level < g_min_level.load(std::memory_order_relaxed)) return;
+
+    static const char level_chars[] = {'D', 'I', 'W', 'E'};
+
+    std::lock_guard<std::mutex> lock(g_log_mutex); // keep lines from worker threads whole
+    fprintf(stderr, "%c/%s: ", level_chars[level], tag);
+    va_list args;
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+    fputc('\n', stderr);
+}
+
+#endif
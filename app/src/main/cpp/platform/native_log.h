@@ -0,0 +1,43 @@
+// native_log.h
+#pragma once
+
+// Logging shim so the native pipeline builds both for Android (logcat) and for
+// the host tools (stderr). Use these instead of calling __android_log_print directly.
+//
+//   LOGI(TAG, "Read %zu samples.", n);
+
+#if defined(__ANDROID__)
+
+#include <android/log.h>
+
+#define LOGD(tag, ...) __android_log_print(ANDROID_LOG_DEBUG, tag, __VA_ARGS__)
+#define LOGI(tag, ...) __android_log_print(ANDROID_LOG_INFO,  tag, __VA_ARGS__)
+#define LOGW(tag, ...) __android_log_print(ANDROID_LOG_WARN,  tag, __VA_ARGS__)
+#define LOGE(tag, ...) __android_log_print(ANDROID_LOG_ERROR, tag, __VA_ARGS__)
+
+#else
+
+#include <cstdarg>
+#include <cstdio>
+
+enum NativeLogLevel {
+    NATIVE_LOG_DEBUG = 0,
+    NATIVE_LOG_INFO  = 1,
+    NATIVE_LOG_WARN  = 2,
+    NATIVE_LOG_ERROR = 3,
+};
+
+// Messages below this level are dropped. Defaults to NATIVE_LOG_INFO.
+void native_log_set_min_level(NativeLogLevel level);
+void native_log_print(NativeLogLevel level, const char* tag, const char* fmt, ...)
+#if defined(__GNUC__)
+    __attribute__((format(printf, 3, 4)))
+#endif
+    ;
+
+#define LOGD(tag, ...) native_log_print(NATIVE_LOG_DEBUG, tag, __VA_ARGS__)
+#define LOGI(tag, ...) native_log_print(NATIVE_LOG_INFO,  tag, __VA_ARGS__)
+#define LOGW(tag, ...) native_log_print(NATIVE_LOG_WARN,  tag, __VA_ARGS__)
+#define LOGE(tag, ...) native_log_print(NATIVE_LOG_ERROR, tag, __VA_ARGS__)
+
+#endif
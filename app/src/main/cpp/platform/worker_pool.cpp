@@ -0,0 +1,219 @@
+// worker_pool.cpp
+#include "worker_pool.h"
+
+#include <algorithm>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+#include "cpu_topology.h"
+
+// Polling rounds before an idle worker parks, or a caller blocks on its job:
+// tens of microseconds, enough to bridge the gaps inside one job without
+// burning a core between jobs.
+static constexpr int kSpinIterations = 20000;
+
+static inline void cpu_relax() {
+#if defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield");
+#elif defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+static std::vector<int> caller_cpus() {
+    std::vector<int> cpus;
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) return cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+    }
+#endif
+    return cpus;
+}
+
+struct WorkerPool::Job {
+    const std::function<void(int)>* fn = nullptr;
+    std::function<void(int)> owned; // async() keeps its function here
+    int n_tasks = 0;
+    int max_helpers = 0;  // workers that may join the caller
+    int helpers = 0;      // workers that did; under jobs_mutex_
+    std::vector<int> cpus; // affinity of the submitter
+
+    std::atomic<int> next_task{0};
+    std::atomic<int> done{0};
+
+    std::mutex mutex; // guards error, and the wait for done
+    std::condition_variable finished;
+    std::exception_ptr error;
+};
+
+WorkerPool::WorkerPool(int n_workers) {
+    n_workers = std::max(0, n_workers);
+    threads_.reserve(n_workers);
+    for (int i = 0; i < n_workers; ++i) {
+        threads_.emplace_back(&WorkerPool::worker_main, this);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    stop_.store(true);
+    {
+        std::lock_guard<std::mutex> lock(park_mutex_);
+    }
+    park_cv_.notify_all();
+    for (std::thread& t : threads_) t.join();
+}
+
+void WorkerPool::run_tasks(Job& job) {
+    for (int task = job.next_task.fetch_add(1, std::memory_order_relaxed); task < job.n_tasks;
+         task = job.next_task.fetch_add(1, std::memory_order_relaxed)) {
+        try {
+            (*job.fn)(task);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(job.mutex);
+            if (!job.error) job.error = std::current_exception();
+        }
+        if (job.done.fetch_add(1, std::memory_order_acq_rel) + 1 == job.n_tasks) {
+            { std::lock_guard<std::mutex> lock(job.mutex); }
+            job.finished.notify_all();
+        }
+    }
+}
+
+void WorkerPool::wait_done(Job& job) {
+    for (int spin = 0; spin < kSpinIterations; ++spin) {
+        if (job.done.load(std::memory_order_acquire) == job.n_tasks) return;
+        cpu_relax();
+    }
+    std::unique_lock<std::mutex> lock(job.mutex);
+    job.finished.wait(lock, [&] { return job.done.load(std::memory_order_acquire) == job.n_tasks; });
+}
+
+std::shared_ptr<WorkerPool::Job> WorkerPool::claim() {
+    std::lock_guard<std::mutex> lock(jobs_mutex_);
+    for (const std::shared_ptr<Job>& job : jobs_) {
+        if (job->helpers < job->max_helpers && job->next_task.load(std::memory_order_relaxed) < job->n_tasks) {
+            job->helpers++;
+            return job;
+        }
+    }
+    return nullptr;
+}
+
+void WorkerPool::submit(const std::shared_ptr<Job>& job) {
+    job->cpus = caller_cpus();
+    {
+        std::lock_guard<std::mutex> lock(jobs_mutex_);
+        jobs_.push_back(job);
+    }
+    epoch_.fetch_add(1); // seq_cst: pairs with parked_ below
+    if (parked_.load() > 0) {
+        { std::lock_guard<std::mutex> lock(park_mutex_); }
+        park_cv_.notify_all();
+    }
+}
+
+void WorkerPool::retire(const Job* job) {
+    std::lock_guard<std::mutex> lock(jobs_mutex_);
+    jobs_.erase(std::remove_if(jobs_.begin(), jobs_.end(),
+                               [job](const std::shared_ptr<Job>& j) { return j.get() == job; }),
+                jobs_.end());
+}
+
+void WorkerPool::worker_main() {
+    std::vector<int> applied_cpus;
+    for (;;) {
+        // read before looking for work, so a job submitted after the look
+        // changes it
+        const uint64_t seen = epoch_.load(std::memory_order_acquire);
+        if (std::shared_ptr<Job> job = claim()) {
+#if defined(__linux__)
+            if (job->cpus != applied_cpus && !job->cpus.empty()) {
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                for (int cpu : job->cpus) CPU_SET(cpu, &set);
+                sched_setaffinity(0, sizeof(set), &set);
+                applied_cpus = job->cpus;
+            }
+#endif
+            run_tasks(*job);
+            continue;
+        }
+
+        for (int spin = 0; epoch_.load(std::memory_order_acquire) == seen && !stop_.load(std::memory_order_relaxed); ++spin) {
+            if (spin < kSpinIterations) {
+                cpu_relax();
+            } else {
+                std::unique_lock<std::mutex> lock(park_mutex_);
+                parked_.fetch_add(1);
+                park_cv_.wait(lock, [&] { return epoch_.load() != seen || stop_.load(); });
+                parked_.fetch_sub(1);
+                spin = 0;
+            }
+        }
+        if (stop_.load()) return;
+    }
+}
+
+void WorkerPool::parallel_for(int n_tasks, int max_threads, const std::function<void(int)>& fn) {
+    if (n_tasks <= 0) return;
+    const int n_helpers = std::min({static_cast<int>(threads_.size()), max_threads - 1, n_tasks - 1});
+    if (n_helpers <= 0) {
+        for (int task = 0; task < n_tasks; ++task) fn(task);
+        return;
+    }
+
+    auto job = std::make_shared<Job>();
+    job->fn = &fn;
+    job->n_tasks = n_tasks;
+    job->max_helpers = n_helpers;
+    submit(job);
+    run_tasks(*job);
+    retire(job.get());
+    wait_done(*job);
+    if (job->error) std::rethrow_exception(job->error);
+}
+
+WorkerPool::Task WorkerPool::async(std::function<void()> fn) {
+    auto job = std::make_shared<Job>();
+    job->owned = [fn = std::move(fn)](int) { fn(); };
+    job->fn = &job->owned;
+    job->n_tasks = 1;
+    job->max_helpers = threads_.empty() ? 0 : 1;
+    Task task;
+    task.pool_ = this;
+    task.job_ = job;
+    if (job->max_helpers > 0) submit(job);
+    return task;
+}
+
+WorkerPool::Task& WorkerPool::Task::operator=(Task&& other) noexcept {
+    if (this != &other) {
+        join();
+        pool_ = other.pool_;
+        job_ = std::move(other.job_);
+    }
+    return *this;
+}
+
+void WorkerPool::Task::join() {
+    if (!job_) return;
+    run_tasks(*job_); // no-op if a worker took it
+    pool_->retire(job_.get());
+    wait_done(*job_);
+}
+
+void WorkerPool::Task::wait() {
+    join();
+    const std::shared_ptr<Job> job = std::move(job_);
+    if (job && job->error) std::rethrow_exception(job->error);
+}
+
+WorkerPool& worker_pool() {
+    static WorkerPool pool(plan_threads(get_cpu_topology(), THREAD_POLICY_PERFORMANCE).n_threads - 1);
+    return pool;
+}
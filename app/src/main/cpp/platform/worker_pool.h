@@ -0,0 +1,93 @@
+// worker_pool.h
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent spin-then-park worker threads. Work comes as jobs: a
+// parallel_for, whose caller and up to max_threads - 1 workers pull task
+// indices from a shared counter until all are done, or an async() task, which
+// one worker runs while the caller goes on. Idle workers spin briefly
+// (back-to-back jobs such as the mel workers of consecutive windows find them
+// hot), then park on a condition variable.
+//
+// Jobs from different threads (a second whisper_state, the speaker branch)
+// run side by side, each worker taking whichever job still has tasks, and a
+// task may start jobs of its own. Nothing waits for a free worker: the caller
+// of parallel_for runs the tasks no worker took, and waiting on an async()
+// task runs it on the caller if it has not started. A busy pool makes work
+// serial, never stuck.
+//
+// Workers follow the CPU affinity of the submitting thread, so a
+// ScopedThreadAffinity around a job applies to its pool work as well.
+class WorkerPool {
+    struct Job;
+
+public:
+    // An async() task. Destroying it waits for the task as wait() does, but
+    // drops what the task threw.
+    class Task {
+    public:
+        Task() = default;
+        Task(Task&&) noexcept = default;
+        Task& operator=(Task&& other) noexcept;
+        ~Task() { join(); }
+
+        // Returns once the task has run, running it here if no worker has
+        // started it; rethrows what it threw.
+        void wait();
+
+    private:
+        friend class WorkerPool;
+        void join();
+
+        WorkerPool* pool_ = nullptr;
+        std::shared_ptr<Job> job_;
+    };
+
+    explicit WorkerPool(int n_workers);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // Threads a job can use, the caller included.
+    int max_threads() const { return static_cast<int>(threads_.size()) + 1; }
+
+    // Runs fn(task) for each task in [0, n_tasks) and returns when all are
+    // done; rethrows the first exception a task threw.
+    void parallel_for(int n_tasks, int max_threads, const std::function<void(int)>& fn);
+
+    // Starts fn on a worker and returns at once.
+    Task async(std::function<void()> fn);
+
+private:
+    void worker_main();
+    std::shared_ptr<Job> claim();
+    void submit(const std::shared_ptr<Job>& job);
+    void retire(const Job* job);
+    static void run_tasks(Job& job);
+    static void wait_done(Job& job);
+
+    std::vector<std::thread> threads_;
+
+    // Jobs with tasks no thread has taken yet.
+    std::mutex jobs_mutex_;
+    std::vector<std::shared_ptr<Job>> jobs_;
+    std::atomic<uint64_t> epoch_{0}; // bumped by every submit
+
+    std::mutex park_mutex_;
+    std::condition_variable park_cv_;
+    std::atomic<int> parked_{0};
+    std::atomic<bool> stop_{false};
+};
+
+// Process-wide pool, sized for the PERFORMANCE thread policy and created on
+// first use. Shared by every whisper_state and every stage.
+WorkerPool& worker_pool();
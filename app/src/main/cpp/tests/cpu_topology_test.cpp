@@ -0,0 +1,97 @@
+// cpu_topology_test.cpp
+// Probes the sysfs trees under tests/fixtures/sysfs and checks the thread plan
+// of each policy.
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "platform/cpu_topology.h"
+
+#ifndef SYSFS_FIXTURES
+#error "SYSFS_FIXTURES must name the directory of the sysfs fixtures"
+#endif
+
+namespace {
+
+int g_failures = 0;
+
+#define CHECK(cond)                                                        \
+    do {                                                                   \
+        if (!(cond)) {                                                     \
+            std::fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            g_failures++;                                                  \
+        }                                                                  \
+    } while (0)
+
+bool probe(const char* name, CpuTopology& topology) {
+    const bool ok = probe_cpu_topology(std::string(SYSFS_FIXTURES) + "/" + name, topology);
+    std::printf("%-10s %s\n", name, describe_cpu_topology(topology).c_str());
+    return ok;
+}
+
+void check_plan(const CpuTopology& topology, ThreadPolicy policy, int n_threads, const std::vector<int>& cpus) {
+    const ThreadPlan plan = plan_threads(topology, policy);
+    std::printf("  %-11s threads %d on %zu cpus\n", thread_policy_name(policy), plan.n_threads, plan.cpus.size());
+    CHECK(plan.n_threads == n_threads);
+    CHECK(plan.cpus == cpus);
+}
+
+// 1+3+4 phone SoC with cpu_capacity and cpufreq policies; cpu 5 is offline.
+void test_big_little() {
+    CpuTopology topology;
+    CHECK(probe("big_little", topology));
+    CHECK(topology.cores.size() == 8);
+    CHECK(topology.online_count() == 7);
+    CHECK(topology.heterogeneous());
+    CHECK(topology.clusters.size() == 3);
+    if (topology.clusters.size() == 3) {
+        CHECK((topology.clusters[0].cpus == std::vector<int>{0, 1, 2, 3}));
+        CHECK((topology.clusters[1].cpus == std::vector<int>{4, 5, 6}));
+        CHECK((topology.clusters[2].cpus == std::vector<int>{7}));
+        CHECK(topology.clusters[2].capacity == 1024);
+    }
+
+    // never the LITTLE cores, and never the offline one
+    check_plan(topology, THREAD_POLICY_PERFORMANCE, 3, {4, 6, 7});
+    // the lone prime core stays free for the UI thread
+    check_plan(topology, THREAD_POLICY_BALANCED, 2, {4, 6});
+    check_plan(topology, THREAD_POLICY_BACKGROUND, 2, {0, 1, 2, 3});
+}
+
+// 4 cores with 2 threads each (siblings n and n+4), one cpufreq policy per cpu
+// and no cpu_capacity, as on x86 laptops.
+void test_smt() {
+    CpuTopology topology;
+    CHECK(probe("smt", topology));
+    CHECK(topology.cores.size() == 8);
+    CHECK(!topology.heterogeneous());
+    for (const CpuCore& core : topology.cores) {
+        CHECK(core.capacity == 1024);
+        CHECK(core.smt_core == core.id % 4);
+    }
+
+    const std::vector<int> all = {0, 1, 2, 3, 4, 5, 6, 7};
+    // one thread per physical core
+    check_plan(topology, THREAD_POLICY_PERFORMANCE, 4, all);
+    check_plan(topology, THREAD_POLICY_BALANCED, 4, all);
+    check_plan(topology, THREAD_POLICY_BACKGROUND, 2, all);
+}
+
+void test_missing_root() {
+    CpuTopology topology;
+    CHECK(!probe_cpu_topology(std::string(SYSFS_FIXTURES) + "/none", topology));
+}
+
+} // namespace
+
+int main() {
+    test_big_little();
+    test_smt();
+    test_missing_root();
+    if (g_failures > 0) {
+        std::fprintf(stderr, "%d checks failed\n", g_failures);
+        return 1;
+    }
+    std::printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,179 @@
+// half_float_test.cpp
+// The half precision conversions against references written with frexp and
+// nearbyint: every one of the 65536 halves to float and back, and floats to
+// half at every rounding boundary of every half (the ties, one float ulp
+// either side of them, and the ends of each interval), in the SIMD blocks and
+// in the scalar tail.
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "audio_module/half_float.h"
+
+namespace {
+
+int g_failures = 0;
+
+#define CHECK(cond)                                                        \
+    do {                                                                   \
+        if (!(cond)) {                                                     \
+            std::fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            g_failures++;                                                  \
+        }                                                                  \
+    } while (0)
+
+uint32_t bits_of(float f) {
+    uint32_t x;
+    std::memcpy(&x, &f, sizeof(x));
+    return x;
+}
+
+float float_of(uint32_t x) {
+    float f;
+    std::memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+// Exact: every half is a float.
+float reference_to_float(uint16_t h) {
+    const int exponent = (h >> 10) & 0x1f;
+    const int mantissa = h & 0x3ff;
+    float f;
+    if (exponent == 0) {
+        f = std::ldexp(static_cast<float>(mantissa), -24);
+    } else if (exponent == 0x1f) {
+        f = mantissa == 0 ? INFINITY : NAN;
+    } else {
+        f = std::ldexp(static_cast<float>(1024 + mantissa), exponent - 25);
+    }
+    return (h & 0x8000) ? -f : f;
+}
+
+// Nearest half, ties to even; NaNs become the quiet NaN 0x7e00.
+uint16_t reference_to_half(float f) {
+    const uint16_t sign = std::signbit(f) ? 0x8000 : 0;
+    if (std::isnan(f)) return sign | 0x7e00;
+    if (std::isinf(f)) return sign | 0x7c00;
+    const double a = std::fabs(static_cast<double>(f));
+    if (a < 0x1p-14) {
+        // subnormal: a multiple of 2^-24, 1024 of them being the smallest normal
+        return sign | static_cast<uint16_t>(std::nearbyint(a * 0x1p24));
+    }
+    int e;
+    const double m = std::frexp(a, &e); // a = m 2^e, m in [0.5, 1)
+    double q = std::nearbyint(std::ldexp(m, 11)); // 11 significant bits
+    int exponent = e - 1;
+    if (q == 2048.0) {
+        q = 1024.0;
+        exponent++;
+    }
+    if (exponent > 15) return sign | 0x7c00;
+    return sign | static_cast<uint16_t>(((exponent + 15) << 10) | (static_cast<int>(q) - 1024));
+}
+
+// Converts in one call (SIMD blocks, then the scalar tail) and one value at a
+// time (scalar), and checks both against the reference.
+void check_to_half(const std::vector<float>& values) {
+    std::vector<uint16_t> batch(values.size());
+    float_to_half(values.data(), batch.data(), values.size());
+    size_t mismatches = 0;
+    for (size_t i = 0; i < values.size(); ++i) {
+        uint16_t single;
+        float_to_half(&values[i], &single, 1);
+        const uint16_t expected = reference_to_half(values[i]);
+        if (batch[i] != expected || single != expected) {
+            if (mismatches++ < 10) {
+                std::fprintf(stderr, "  float %08x: half %04x (batch) %04x (single), expected %04x\n", bits_of(values[i]),
+                             batch[i], single, expected);
+            }
+        }
+    }
+    std::printf("  %zu floats to half, %zu mismatches\n", values.size(), mismatches);
+    CHECK(mismatches == 0);
+}
+
+void test_all_halves() {
+    std::vector<uint16_t> halves(65536);
+    for (uint32_t h = 0; h < 65536; ++h) halves[h] = static_cast<uint16_t>(h);
+    std::vector<float> floats(halves.size());
+    half_to_float(halves.data(), floats.data(), halves.size());
+
+    size_t mismatches = 0, nans = 0;
+    for (uint32_t h = 0; h < 65536; ++h) {
+        float single;
+        half_to_float(&halves[h], &single, 1);
+        const float expected = reference_to_float(halves[h]);
+        const bool nan = std::isnan(expected);
+        nans += nan;
+        const bool same = nan ? std::isnan(floats[h]) && std::isnan(single) && std::signbit(floats[h]) == std::signbit(expected)
+                              : bits_of(floats[h]) == bits_of(expected) && bits_of(single) == bits_of(expected);
+        if (!same && mismatches++ < 10) {
+            std::fprintf(stderr, "  half %04x: float %08x (batch) %08x (single), expected %08x\n", h, bits_of(floats[h]),
+                         bits_of(single), bits_of(expected));
+        }
+    }
+    std::printf("  65536 halves to float, %zu mismatches\n", mismatches);
+    CHECK(mismatches == 0);
+    CHECK(nans == 2 * 1023);
+
+    // and back: exact for every half but the NaNs, which stay NaNs
+    std::vector<uint16_t> round_trip(halves.size());
+    float_to_half(floats.data(), round_trip.data(), floats.size());
+    size_t changed = 0;
+    for (uint32_t h = 0; h < 65536; ++h) {
+        const bool nan = ((h >> 10) & 0x1f) == 0x1f && (h & 0x3ff) != 0;
+        const bool same = nan ? (round_trip[h] & 0x7fff) == 0x7e00 && (round_trip[h] & 0x8000) == (h & 0x8000)
+                              : round_trip[h] == h;
+        changed += !same;
+    }
+    std::printf("  65536 halves round trip, %zu changed\n", changed);
+    CHECK(changed == 0);
+    check_to_half(floats);
+}
+
+// Every float whose top 19 bits (sign, exponent, the ten bits a half keeps)
+// take each of their values, with the low 13 bits at each rounding boundary.
+void test_rounding() {
+    const uint32_t lows[] = {0x0000, 0x0001, 0x0fff, 0x1000, 0x1001, 0x1ffe, 0x1fff, 0x0a5a};
+    std::vector<float> values;
+    values.reserve((1u << 19) * (sizeof(lows) / sizeof(lows[0])));
+    for (uint32_t high = 0; high < (1u << 19); ++high) {
+        for (uint32_t low : lows) values.push_back(float_of(high << 13 | low));
+    }
+    check_to_half(values);
+}
+
+// Under 2^-14 the halves are 2^-24 apart, so their ties fall at other bits:
+// each tie and a float ulp either side, for every subnormal half.
+void test_subnormal_rounding() {
+    std::vector<float> values;
+    for (int m = 0; m < 1024; ++m) {
+        const float tie = std::ldexp(static_cast<float>(2 * m + 1), -25);
+        for (float v : {tie, std::nextafter(tie, 0.0f), std::nextafter(tie, 1.0f)}) {
+            values.push_back(v);
+            values.push_back(-v);
+        }
+    }
+    // floats far below the smallest half
+    values.push_back(float_of(0x00000001u));
+    values.push_back(std::ldexp(1.0f, -26));
+    values.push_back(std::nextafter(std::ldexp(1.0f, -25), 0.0f));
+    check_to_half(values);
+}
+
+} // namespace
+
+int main() {
+    std::printf("half precision conversions against frexp/nearbyint references\n");
+    test_all_halves();
+    test_rounding();
+    test_subnormal_rounding();
+    if (g_failures > 0) {
+        std::fprintf(stderr, "%d checks failed\n", g_failures);
+        return 1;
+    }
+    std::printf("all checks passed\n");
+    return 0;
+}
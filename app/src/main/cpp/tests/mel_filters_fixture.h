@@ -0,0 +1,44 @@
+// mel_filters_fixture.h
+// Whisper's mel filterbank without a model file: librosa's Slaney-style
+// filters (librosa.filters.mel(sr=16000, n_fft=400, n_mels=n_mel)), which is
+// what the models' mel_filters tensors hold.
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// n_mel rows of 201 weights.
+inline std::vector<float> whisper_mel_filters(int n_mel) {
+    const int sample_rate = 16000;
+    const int n_fft = 201;
+
+    const double f_sp = 200.0 / 3.0;
+    const double min_log_hz = 1000.0;
+    const double min_log_mel = min_log_hz / f_sp;
+    const double logstep = std::log(6.4) / 27.0;
+    auto hz_to_mel = [&](double hz) {
+        return hz < min_log_hz ? hz / f_sp : min_log_mel + std::log(hz / min_log_hz) / logstep;
+    };
+    auto mel_to_hz = [&](double mel) {
+        return mel < min_log_mel ? mel * f_sp : min_log_hz * std::exp(logstep * (mel - min_log_mel));
+    };
+
+    // band edges, evenly spaced in mel from 0 to the Nyquist frequency
+    std::vector<double> edges(n_mel + 2);
+    const double mel_max = hz_to_mel(sample_rate / 2.0);
+    for (int i = 0; i < n_mel + 2; ++i) {
+        edges[i] = mel_to_hz(mel_max * i / (n_mel + 1));
+    }
+
+    std::vector<float> filters(static_cast<size_t>(n_mel) * n_fft);
+    for (int j = 0; j < n_mel; ++j) {
+        const double norm = 2.0 / (edges[j + 2] - edges[j]);
+        for (int k = 0; k < n_fft; ++k) {
+            const double hz = k * (sample_rate / 2.0) / (n_fft - 1);
+            const double lower = (hz - edges[j]) / (edges[j + 1] - edges[j]);
+            const double upper = (edges[j + 2] - hz) / (edges[j + 2] - edges[j + 1]);
+            filters[static_cast<size_t>(j) * n_fft + k] = static_cast<float>(norm * std::max(0.0, std::min(lower, upper)));
+        }
+    }
+    return filters;
+}
@@ -0,0 +1,138 @@
+// real_fft_test.cpp
+// RealFft against a DFT computed in double, on whisper's 400-point frames and
+// on lengths that exercise each radix (4, 2, 3, 5 and the generic prime
+// butterfly), from lengths too short for the SIMD stages to long ones.
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "audio_module/real_fft.h"
+
+namespace {
+
+// Error bound relative to the largest magnitude of the transform (of the
+// largest power for power spectra): what the mel STFT was measured at.
+constexpr double kTolerance = 4e-7;
+
+int g_failures = 0;
+
+#define CHECK(cond)                                                        \
+    do {                                                                   \
+        if (!(cond)) {                                                     \
+            std::fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            g_failures++;                                                  \
+        }                                                                  \
+    } while (0)
+
+// Deterministic uniform values in [-1, 1).
+struct Noise {
+    uint32_t state = 12345;
+    float next() {
+        state = state * 1664525u + 1013904223u;
+        return static_cast<float>(state >> 8) / static_cast<float>(1u << 23) - 1.0f;
+    }
+};
+
+// X[k] = sum_t x[t] e^(-2 pi i k t / n) for k <= n / 2, interleaved (re, im).
+std::vector<double> reference_dft(const std::vector<float>& x) {
+    const size_t n = x.size();
+    std::vector<double> out(2 * (n / 2 + 1));
+    for (size_t k = 0; k <= n / 2; ++k) {
+        double re = 0.0, im = 0.0;
+        for (size_t t = 0; t < n; ++t) {
+            // k t mod n keeps the angle small, so the reference itself is exact to ~1e-15
+            const double angle = -2.0 * M_PI * static_cast<double>((k * t) % n) / static_cast<double>(n);
+            re += x[t] * std::cos(angle);
+            im += x[t] * std::sin(angle);
+        }
+        out[2 * k] = re;
+        out[2 * k + 1] = im;
+    }
+    return out;
+}
+
+void check_size(int n, const std::vector<float>& x, const char* signal) {
+    const RealFft fft(n);
+    CHECK(fft.size() == n);
+    CHECK(fft.bins() == n / 2 + 1);
+
+    std::vector<float> out(2 * fft.bins());
+    std::vector<float> power(fft.bins());
+    std::vector<float> scratch(fft.scratch_size());
+    const std::vector<float> in(x);
+    fft.forward(x.data(), out.data(), scratch.data());
+    fft.power(x.data(), power.data(), scratch.data());
+    CHECK(in == x);
+
+    const std::vector<double> ref = reference_dft(x);
+    double peak = 0.0, peak_power = 0.0;
+    for (int k = 0; k < fft.bins(); ++k) {
+        const double p = ref[2 * k] * ref[2 * k] + ref[2 * k + 1] * ref[2 * k + 1];
+        peak = std::max(peak, std::sqrt(p));
+        peak_power = std::max(peak_power, p);
+    }
+    double err = 0.0, err_power = 0.0;
+    for (int k = 0; k < fft.bins(); ++k) {
+        err = std::max(err, std::hypot(out[2 * k] - ref[2 * k], out[2 * k + 1] - ref[2 * k + 1]));
+        const double p = ref[2 * k] * ref[2 * k] + ref[2 * k + 1] * ref[2 * k + 1];
+        err_power = std::max(err_power, std::fabs(power[k] - p));
+    }
+    std::printf("  n = %4d %-7s spectrum %.2e, power %.2e of the peak\n", n, signal, err / peak, err_power / peak_power);
+    CHECK(err <= kTolerance * peak);
+    CHECK(err_power <= kTolerance * peak_power);
+}
+
+void test_noise(int n) {
+    Noise noise;
+    std::vector<float> x(n);
+    for (float& v : x) v = noise.next();
+    check_size(n, x, "noise");
+}
+
+// A windowed tone between two bins: one strong peak and a deep floor, as in
+// voiced speech.
+void test_tone(int n) {
+    std::vector<float> x(n);
+    for (int t = 0; t < n; ++t) {
+        const double hann = 0.5 - 0.5 * std::cos(2.0 * M_PI * t / n);
+        x[t] = static_cast<float>(hann * std::sin(2.0 * M_PI * 37.3 * t / n));
+    }
+    check_size(n, x, "tone");
+}
+
+// A plan shared by threads must not keep state between transforms.
+void test_reuse() {
+    const RealFft fft(400);
+    Noise noise;
+    std::vector<float> a(400), b(400);
+    for (float& v : a) v = noise.next();
+    for (float& v : b) v = noise.next();
+    std::vector<float> scratch(fft.scratch_size());
+    std::vector<float> first(fft.bins()), again(fft.bins()), other(fft.bins());
+    fft.power(a.data(), first.data(), scratch.data());
+    fft.power(b.data(), other.data(), scratch.data());
+    fft.power(a.data(), again.data(), scratch.data());
+    CHECK(first == again);
+}
+
+} // namespace
+
+int main() {
+    // 400 = 2 x (4 x 2 x 5 x 5), whisper's frame; the rest cover radix 2, 3,
+    // the generic prime butterfly (7, 11, 13) and odd half lengths
+    const int sizes[] = {400, 2, 4, 8, 16, 6, 10, 14, 22, 30, 64, 200, 210, 286, 512, 1000};
+    std::printf("RealFft against a double DFT\n");
+    for (int n : sizes) {
+        test_noise(n);
+        test_tone(n);
+    }
+    test_reuse();
+    if (g_failures > 0) {
+        std::fprintf(stderr, "%d checks failed\n", g_failures);
+        return 1;
+    }
+    std::printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,179 @@
+// stft_stream_test.cpp
+// whisper_mel_stream computes each frame once, when a push completes it, from
+// the few samples StftStream holds, and the frames the end of the audio reaches
+// into when a spectrogram is taken. Its spectrograms equal whisper_pcm_to_mel's
+// only if those frames equal the frames of the whole recording. This checks
+// that on random chunkings of a recording, for each frame's power spectrum and
+// for its log mel energies against analyze_spectrum().
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "audio_module/mel_filterbank.h"
+#include "audio_module/stft_frontend.h"
+#include "tests/mel_filters_fixture.h"
+
+namespace {
+
+constexpr int kRate = StftFrontend::kSampleRate;
+constexpr int kBins = StftFrontend::kBins;
+
+int g_failures = 0;
+
+#define CHECK(cond)                                                        \
+    do {                                                                   \
+        if (!(cond)) {                                                     \
+            std::fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            g_failures++;                                                  \
+        }                                                                  \
+    } while (0)
+
+// Deterministic uniform values in [0, 2^24).
+struct Random {
+    uint32_t state;
+    explicit Random(uint32_t seed) : state(seed) {}
+    uint32_t next() {
+        state = state * 1664525u + 1013904223u;
+        return state >> 8;
+    }
+    float uniform() { return static_cast<float>(next()) / static_cast<float>(1u << 24); }
+};
+
+// A tone sweeping through the band over quiet noise, so that every bin of
+// every frame is different.
+std::vector<float> recording(double seconds) {
+    Random random(7);
+    std::vector<float> pcm(static_cast<size_t>(seconds * kRate));
+    double phase = 0.0;
+    for (size_t n = 0; n < pcm.size(); ++n) {
+        phase += 2.0 * M_PI * (100.0 + 7000.0 * n / pcm.size()) / kRate;
+        pcm[n] = static_cast<float>(0.3 * std::sin(phase) + 0.01 * (random.uniform() - 0.5));
+    }
+    return pcm;
+}
+
+// Pushes pcm in the given pieces, comparing each frame the stream completes
+// with the same frame of the whole recording, and at every piece the frames
+// past the complete ones with those of the audio pushed so far. Returns the
+// stream's log mel frames, the last taken at the end.
+std::vector<float> stream_log_mel(const std::vector<float>& pcm, const std::vector<size_t>& pieces,
+                                  const SparseMelFilterbank& mel) {
+    const StftFrontend& stft = StftFrontend::get();
+    std::vector<float> power(kBins), expected(kBins), scratch(stft.scratch_size());
+    const int n_mel = mel.n_mel();
+
+    StftStream stream;
+    std::vector<float> log_mel;
+    int64_t n_frames = 0;
+    size_t pushed = 0;
+    bool complete_ok = true, tail_ok = true;
+    for (size_t piece : pieces) {
+        stream.push(pcm.data() + pushed, piece);
+        pushed += piece;
+        CHECK(stream.n_samples() == static_cast<int64_t>(pushed));
+
+        const int64_t n_complete = stream.n_complete();
+        CHECK(n_complete >= n_frames);
+        for (int64_t i = n_frames; i < n_complete; ++i) {
+            stream.frame_power(i, power.data(), scratch.data());
+            stft.frame_power(pcm.data(), 0, static_cast<int64_t>(pcm.size()), i, expected.data(), scratch.data());
+            complete_ok = complete_ok && power == expected;
+            log_mel.resize((i + 1) * n_mel);
+            mel.apply_log10(power.data(), log_mel.data() + i * n_mel);
+        }
+        n_frames = std::max(n_frames, n_complete);
+        stream.release_frames_before(n_frames);
+        CHECK(stream.held_samples() < static_cast<size_t>(StftFrontend::kFrameSize));
+
+        // what a spectrogram taken now reads past the complete frames
+        for (int64_t i = n_frames; i < static_cast<int64_t>(StftFrontend::frame_count(pushed)) + 2; ++i) {
+            stream.frame_power(i, power.data(), scratch.data());
+            stft.frame_power(pcm.data(), 0, static_cast<int64_t>(pushed), i, expected.data(), scratch.data());
+            tail_ok = tail_ok && power == expected;
+        }
+    }
+    CHECK(complete_ok);
+    CHECK(tail_ok);
+    CHECK(pushed == pcm.size());
+
+    for (int64_t i = n_frames; i < static_cast<int64_t>(StftFrontend::frame_count(pcm.size())); ++i) {
+        stream.frame_power(i, power.data(), scratch.data());
+        log_mel.resize((i + 1) * n_mel);
+        mel.apply_log10(power.data(), log_mel.data() + i * n_mel);
+    }
+    return log_mel;
+}
+
+void check_chunking(const char* name, const std::vector<float>& pcm, const std::vector<size_t>& pieces,
+                    const SparseMelFilterbank& mel, const SpectralFeatures& whole) {
+    const std::vector<float> log_mel = stream_log_mel(pcm, pieces, mel);
+    std::printf("  %-12s %6zu pieces: %s\n", name, pieces.size(), log_mel == whole.log_mel ? "same frames" : "DIFFERENT");
+    CHECK(log_mel == whole.log_mel);
+}
+
+void test_chunkings() {
+    const std::vector<float> pcm = recording(3.3);
+    const std::vector<float> filters = whisper_mel_filters(80);
+    const SparseMelFilterbank mel(filters.data(), 80, kBins);
+    SpectralFeatures whole;
+    CHECK(analyze_spectrum(pcm.data(), pcm.size(), &mel, whole));
+
+    check_chunking("whole", pcm, {pcm.size()}, mel, whole);
+    // the first 0.25 s a sample at a time, across the reflected first frames
+    std::vector<size_t> samples(kRate / 4, 1);
+    samples.push_back(pcm.size() - samples.size());
+    check_chunking("by sample", pcm, samples, mel, whole);
+    std::vector<size_t> hops(pcm.size() / StftFrontend::kHop, StftFrontend::kHop);
+    hops.push_back(pcm.size() % StftFrontend::kHop);
+    check_chunking("by hop", pcm, hops, mel, whole);
+
+    // random pieces from empty to 0.75 s, with the remainder last
+    for (uint32_t seed = 1; seed <= 20; ++seed) {
+        Random random(seed);
+        const uint32_t longest = seed % 2 == 0 ? 600 : 12000;
+        std::vector<size_t> pieces;
+        size_t total = 0;
+        while (total < pcm.size()) {
+            const size_t piece = std::min<size_t>(random.next() % (longest + 1), pcm.size() - total);
+            pieces.push_back(piece);
+            total += piece;
+        }
+        char name[16];
+        std::snprintf(name, sizeof(name), "random %u", seed);
+        check_chunking(name, pcm, pieces, mel, whole);
+    }
+}
+
+// Audio shorter than a frame's half: no frame is complete, and the frames a
+// spectrogram would read still match.
+void test_short() {
+    const std::vector<float> pcm = recording(0.01);
+    StftStream stream;
+    stream.push(pcm.data(), 150);
+    CHECK(stream.n_complete() == 0);
+    stream.push(pcm.data() + 150, 10);
+    CHECK(stream.n_complete() == 0);
+    const StftFrontend& stft = StftFrontend::get();
+    std::vector<float> power(kBins), expected(kBins), scratch(stft.scratch_size());
+    for (int64_t i = 0; i < 2; ++i) {
+        stream.frame_power(i, power.data(), scratch.data());
+        stft.frame_power(pcm.data(), 0, 160, i, expected.data(), scratch.data());
+        CHECK(power == expected);
+    }
+}
+
+} // namespace
+
+int main() {
+    std::printf("StftStream frames against the whole recording's\n");
+    test_chunkings();
+    test_short();
+    if (g_failures > 0) {
+        std::fprintf(stderr, "%d checks failed\n", g_failures);
+        return 1;
+    }
+    std::printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,235 @@
+// vad_engine_test.cpp
+// The VAD reads the shared STFT front-end's frames (25 ms Hann windows every
+// 10 ms) since it stopped framing the audio itself (20 ms rectangular frames,
+// back to back). Its thresholds were tuned on the old frames, so this checks
+// that both give the same regions on synthetic recordings, and that the energy
+// path and the samples path agree.
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "audio_module/stft_frontend.h"
+#include "diarization_module/vad_engine.h"
+
+namespace {
+
+constexpr int kRate = 16000;
+constexpr int64_t kToleranceMs = 30;
+
+int g_failures = 0;
+
+#define CHECK(cond)                                                        \
+    do {                                                                   \
+        if (!(cond)) {                                                     \
+            std::fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            g_failures++;                                                  \
+        }                                                                  \
+    } while (0)
+
+// The VAD before the shared front-end: mean square of 20 ms rectangular frames,
+// and the same thresholds, merging, blip removal and padding.
+std::vector<SpeechSegment> reference_vad(const std::vector<float>& pcm) {
+    const int frame_ms = 20;
+    const float min_threshold_db = -50.0f;
+    const float floor_margin_db = 9.0f;
+    const float peak_range_db = 25.0f;
+    const int merge_gap_ms = 300;
+    const int min_speech_ms = 250;
+    const int pad_ms = 100;
+
+    std::vector<SpeechSegment> segments;
+    const size_t frame_len = kRate * frame_ms / 1000;
+    const size_t n_frames = pcm.size() / frame_len;
+    if (n_frames == 0) return segments;
+
+    std::vector<float> energy_db(n_frames);
+    for (size_t f = 0; f < n_frames; ++f) {
+        double sum = 0.0;
+        for (size_t i = 0; i < frame_len; ++i) sum += static_cast<double>(pcm[f * frame_len + i]) * pcm[f * frame_len + i];
+        energy_db[f] = 10.0f * std::log10(static_cast<float>(sum / frame_len) + 1e-10f);
+    }
+
+    std::vector<float> sorted(energy_db);
+    const size_t floor_index = n_frames / 10;
+    std::nth_element(sorted.begin(), sorted.begin() + floor_index, sorted.end());
+    const float peak_db = *std::max_element(energy_db.begin(), energy_db.end());
+    const float threshold_db = std::max(min_threshold_db, std::min(sorted[floor_index] + floor_margin_db, peak_db - peak_range_db));
+
+    const size_t merge_gap_frames = merge_gap_ms / frame_ms;
+    std::vector<std::pair<size_t, size_t>> regions;
+    for (size_t f = 0; f < n_frames; ++f) {
+        if (energy_db[f] < threshold_db) continue;
+        if (!regions.empty() && f - regions.back().second <= merge_gap_frames) {
+            regions.back().second = f + 1;
+        } else {
+            regions.emplace_back(f, f + 1);
+        }
+    }
+
+    const int64_t total_ms = static_cast<int64_t>(pcm.size()) * 1000 / kRate;
+    for (const auto& region : regions) {
+        int64_t start_ms = static_cast<int64_t>(region.first) * frame_ms;
+        int64_t end_ms = static_cast<int64_t>(region.second) * frame_ms;
+        if (end_ms - start_ms < min_speech_ms) continue;
+        start_ms = std::max<int64_t>(0, start_ms - pad_ms);
+        end_ms = std::min(total_ms, end_ms + pad_ms);
+        if (!segments.empty() && start_ms <= segments.back().end_ms) {
+            segments.back().end_ms = end_ms;
+        } else {
+            segments.push_back({start_ms, end_ms});
+        }
+    }
+    return segments;
+}
+
+// Deterministic white noise, uniform in [-1, 1).
+struct Noise {
+    uint32_t state = 12345;
+    float next() {
+        state = state * 1664525u + 1013904223u;
+        return static_cast<float>(state >> 8) / static_cast<float>(1u << 23) - 1.0f;
+    }
+};
+
+struct Recording {
+    std::vector<float> pcm;
+    Noise noise;
+
+    explicit Recording(double noise_dbfs, double seconds) : pcm(static_cast<size_t>(seconds * kRate)) {
+        // uniform noise has an RMS of 1/sqrt(3)
+        const float amp = static_cast<float>(std::pow(10.0, noise_dbfs / 20.0) * std::sqrt(3.0));
+        for (float& x : pcm) x = amp * noise.next();
+    }
+
+    // Voiced speech between start_s and end_s: a harmonic series on a wandering
+    // pitch, in syllables of about 200 ms with short dips between them, at
+    // level_dbfs RMS.
+    void speak(double start_s, double end_s, double level_dbfs, double f0) {
+        const double amp = std::pow(10.0, level_dbfs / 20.0) * 0.78; // harmonics sum to ~1.28 RMS
+        double phase = 0.0;
+        const size_t begin = static_cast<size_t>(start_s * kRate);
+        const size_t end = std::min(pcm.size(), static_cast<size_t>(end_s * kRate));
+        for (size_t n = begin; n < end; ++n) {
+            const double t = static_cast<double>(n - begin) / kRate;
+            const double pitch = f0 * (1.0 + 0.08 * std::sin(2.0 * M_PI * 0.7 * t));
+            phase += 2.0 * M_PI * pitch / kRate;
+            double voice = 0.0;
+            for (int h = 1; h <= 8; ++h) voice += std::sin(h * phase) / h;
+            // syllables: raised-cosine envelope at 5 Hz, never quite silent
+            const double syllable = 0.15 + 0.85 * std::pow(std::sin(M_PI * 5.0 * t), 2.0);
+            // 20 ms onset and offset ramps
+            const double edge = std::min({1.0, t / 0.02, (end_s - start_s - t) / 0.02});
+            pcm[n] += static_cast<float>(amp * syllable * edge * voice);
+        }
+    }
+
+    // A click: broadband, short.
+    void click(double at_s, double length_s, double level_dbfs) {
+        const float amp = static_cast<float>(std::pow(10.0, level_dbfs / 20.0) * std::sqrt(3.0));
+        const size_t begin = static_cast<size_t>(at_s * kRate);
+        const size_t end = std::min(pcm.size(), static_cast<size_t>((at_s + length_s) * kRate));
+        for (size_t n = begin; n < end; ++n) pcm[n] += amp * noise.next();
+    }
+};
+
+void print_segments(const char* label, const std::vector<SpeechSegment>& segments) {
+    std::printf("  %-9s", label);
+    for (const SpeechSegment& s : segments) {
+        std::printf(" [%lld, %lld)", static_cast<long long>(s.start_ms), static_cast<long long>(s.end_ms));
+    }
+    std::printf("\n");
+}
+
+void check_against_reference(const char* name, const Recording& recording, size_t expected_regions) {
+    void* vad = init_vad_engine();
+    const std::vector<SpeechSegment> segments = process_audio_for_vad(vad, recording.pcm.data(), recording.pcm.size(), kRate);
+
+    SpectralFeatures features;
+    CHECK(analyze_spectrum(recording.pcm.data(), recording.pcm.size(), nullptr, features));
+    const std::vector<SpeechSegment> from_energies = process_energies_for_vad(
+            vad, features.energy_db.data(), features.n_frames, static_cast<int64_t>(recording.pcm.size()) * 1000 / kRate);
+    free_vad_engine(vad);
+
+    const std::vector<SpeechSegment> reference = reference_vad(recording.pcm);
+    std::printf("%s\n", name);
+    print_segments("20 ms:", reference);
+    print_segments("stft:", segments);
+
+    CHECK(reference.size() == expected_regions);
+    CHECK(segments.size() == reference.size());
+    for (size_t i = 0; i < std::min(segments.size(), reference.size()); ++i) {
+        CHECK(std::llabs(segments[i].start_ms - reference[i].start_ms) <= kToleranceMs);
+        CHECK(std::llabs(segments[i].end_ms - reference[i].end_ms) <= kToleranceMs);
+    }
+
+    CHECK(from_energies.size() == segments.size());
+    for (size_t i = 0; i < std::min(from_energies.size(), segments.size()); ++i) {
+        CHECK(from_energies[i].start_ms == segments[i].start_ms);
+        CHECK(from_energies[i].end_ms == segments[i].end_ms);
+    }
+}
+
+// Phrases in a quiet room, separated by pauses well over the merge gap.
+void test_phrases() {
+    Recording r(-65.0, 12.0);
+    r.speak(0.8, 2.9, -22.0, 130.0);
+    r.speak(4.1, 5.3, -24.0, 130.0);
+    r.speak(7.0, 10.6, -20.0, 210.0);
+    check_against_reference("phrases", r, 3);
+}
+
+// A short pause inside a phrase is bridged; a long one is not.
+void test_pauses() {
+    Recording r(-60.0, 10.0);
+    r.speak(0.5, 2.0, -20.0, 150.0);
+    r.speak(2.15, 3.5, -20.0, 150.0); // 150 ms pause
+    r.speak(4.5, 6.0, -20.0, 150.0);  // 1 s pause
+    r.speak(6.7, 8.5, -20.0, 150.0);  // 700 ms pause
+    check_against_reference("pauses", r, 3);
+}
+
+// Street noise 16 dB under a quiet talker, and a loud talker 16 dB over the quiet one.
+void test_noise_and_levels() {
+    Recording r(-48.0, 14.0);
+    r.speak(1.0, 3.5, -24.0, 120.0);
+    r.speak(5.0, 7.0, -32.0, 220.0);
+    r.speak(9.5, 12.5, -16.0, 140.0);
+    check_against_reference("noise", r, 3);
+}
+
+// Clicks shorter than the minimum speech length are dropped.
+void test_clicks() {
+    Recording r(-62.0, 9.0);
+    r.click(1.0, 0.05, -20.0);
+    r.speak(2.5, 4.5, -22.0, 160.0);
+    r.click(6.0, 0.12, -18.0);
+    r.click(7.5, 0.03, -15.0);
+    check_against_reference("clicks", r, 1);
+}
+
+// Speech from start to end: the floor is quiet speech, and the peak cap keeps
+// the whole recording.
+void test_continuous() {
+    Recording r(-60.0, 8.0);
+    r.speak(0.0, 8.0, -20.0, 170.0);
+    check_against_reference("continuous", r, 1);
+}
+
+} // namespace
+
+int main() {
+    test_phrases();
+    test_pauses();
+    test_noise_and_levels();
+    test_clicks();
+    test_continuous();
+    if (g_failures > 0) {
+        std::fprintf(stderr, "%d checks failed\n", g_failures);
+        return 1;
+    }
+    std::printf("all checks passed\n");
+    return 0;
+}
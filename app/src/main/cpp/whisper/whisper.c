@@ -6,6 +6,10 @@
 #include "ggml-alloc.h"
 #include "ggml-backend.h"
 
+#include "audio_module/half_float.h"
+#include "audio_module/mel_filterbank.h"
+#include "audio_module/stft_frontend.h"
+
 #ifdef WHISPER_USE_COREML
 #include "coreml/whisper-encoder.h"
 #endif
@@ -155,6 +159,97 @@ static std::string format(const char * fmt, ...) {
     return std::string(buf.data(), size);
 }
 
+//
+// threading hooks (whisper_set_parallel_for / whisper_set_task_runner / whisper_set_threadpool_provider)
+//
+
+static struct {
+    std::atomic<whisper_parallel_for_fn> fn{nullptr};
+    std::atomic<void *> user_data{nullptr};
+} g_parallel_for;
+
+static struct {
+    std::atomic<whisper_task_start_fn> start{nullptr};
+    std::atomic<whisper_task_wait_fn> wait{nullptr};
+    std::atomic<void *> user_data{nullptr};
+} g_task_runner;
+
+static struct {
+    std::atomic<whisper_threadpool_acquire_fn> acquire{nullptr};
+    std::atomic<whisper_threadpool_release_fn> release{nullptr};
+    std::atomic<void *> user_data{nullptr};
+} g_threadpool_provider;
+
+typedef void (*ggml_backend_cpu_set_threadpool_t)(ggml_backend_t backend, ggml_threadpool_t threadpool);
+
+void whisper_set_parallel_for(whisper_parallel_for_fn fn, void * user_data) {
+    g_parallel_for.user_data = user_data;
+    g_parallel_for.fn = fn;
+}
+
+void whisper_set_task_runner(whisper_task_start_fn start, whisper_task_wait_fn wait, void * user_data) {
+    g_task_runner.start = nullptr;
+    g_task_runner.user_data = user_data;
+    g_task_runner.wait = wait;
+    g_task_runner.start = start;
+}
+
+// runs fn(ith) for ith in [0, n_tasks) through the parallel_for hook, or on this thread without one
+template <typename F>
+static void whisper_parallel_run(int n_tasks, const F & fn) {
+    whisper_parallel_for_fn parallel_for = g_parallel_for.fn;
+    if (parallel_for && n_tasks > 1) {
+        parallel_for(n_tasks, [](int ith, void * arg) {
+            (*(const F *) arg)(ith);
+        }, (void *) &fn, g_parallel_for.user_data);
+    } else {
+        for (int ith = 0; ith < n_tasks; ++ith) {
+            fn(ith);
+        }
+    }
+}
+
+void whisper_set_threadpool_provider(
+        whisper_threadpool_acquire_fn acquire,
+        whisper_threadpool_release_fn release,
+                               void * user_data) {
+    g_threadpool_provider.acquire = nullptr;
+    g_threadpool_provider.user_data = user_data;
+    g_threadpool_provider.release = release;
+    g_threadpool_provider.acquire = acquire;
+}
+
+// borrows the provider's threadpool for the CPU backends of one compute
+struct whisper_threadpool_lease {
+    ggml_threadpool_t threadpool = nullptr;
+    whisper_threadpool_release_fn release = nullptr;
+    void * user_data = nullptr;
+
+    explicit whisper_threadpool_lease(int n_threads) {
+        whisper_threadpool_acquire_fn acquire = g_threadpool_provider.acquire;
+        if (acquire) {
+            release   = g_threadpool_provider.release;
+            user_data = g_threadpool_provider.user_data;
+            threadpool = acquire(n_threads, user_data);
+        }
+    }
+
+    ~whisper_threadpool_lease() {
+        if (threadpool && release) {
+            release(threadpool, user_data);
+        }
+    }
+
+    // must be called for every CPU backend, also with a NULL threadpool, so a
+    // backend never keeps a pool from an earlier lease
+    void apply(ggml_backend_reg_t reg, ggml_backend_t backend) const {
+        auto * fn_set_threadpool = (ggml_backend_cpu_set_threadpool_t) ggml_backend_reg_get_proc_address(reg, "ggml_backend_cpu_set_threadpool");
+        if (fn_set_threadpool) {
+            fn_set_threadpool(backend, threadpool);
+        }
+    }
+};
+
 //
 // ggml helpers
 //
@@ -186,6 +281,8 @@ static bool ggml_graph_compute_helper(
         struct ggml_cgraph * graph,
                        int   n_threads,
                       bool   sched_reset = true) {
+    whisper_threadpool_lease lease(n_threads);
+
     for (int i = 0; i < ggml_backend_sched_get_n_backends(sched); ++i) {
         ggml_backend_t backend = ggml_backend_sched_get_backend(sched, i);
         ggml_backend_dev_t dev = ggml_backend_get_device(backend);
@@ -195,6 +292,10 @@ static bool ggml_graph_compute_helper(
         if (fn_set_n_threads) {
             fn_set_n_threads(backend, n_threads);
         }
+
+        if (reg) {
+            lease.apply(reg, backend);
+        }
     }
 
     const bool t = (ggml_backend_sched_graph_compute(sched, graph) == GGML_STATUS_SUCCESS);
@@ -449,7 +550,20 @@ struct whisper_mel {
     int n_len_org;
     int n_mel;
 
+    // n_mel x n_len, band-major; empty while the spectrogram is windowed
     std::vector<float> data;
+
+    // the same in half precision instead of data (whisper_set_mel_f16), shifted
+    // by log_mel_shift but not yet floored: the encoder floors what it reads
+    // against max (-INFINITY: the values are final)
+    std::vector<ggml_fp16_t> data_f16;
+
+    // windowed (see log_mel_spectrogram_windowed): the caller's samples, from
+    // which frames are computed a window at a time, and the log10 maximum
+    // they are normalized against
+    const float * samples   = nullptr;
+    int           n_samples = 0;
+    float         max       = 0.0f;
 };
 
 struct whisper_filters {
@@ -457,6 +571,9 @@ struct whisper_filters {
     int32_t n_fft;
 
     std::vector<float> data;
+
+    // data without the zeros outside each triangle, built at load time
+    SparseMelFilterbank sparse;
 };
 
 struct whisper_vocab {
@@ -913,6 +1030,7 @@ struct whisper_state {
 
     // helpers for GPU offloading
     std::vector<float> inp_mel;
+    std::vector<float> embd_cached; // encoder output to or from the encoder output cache
     std::vector<float> inp_mask;
 
     // decode output (2-dimensional array: [n_tokens][n_vocab])
@@ -1601,6 +1719,10 @@ static bool whisper_model_load(struct whisper_model_loader * loader, whisper_con
         filters.data.resize(filters.n_mel * filters.n_fft);
         loader->read(loader->context, filters.data.data(), filters.data.size() * sizeof(float));
         BYTESWAP_FILTERS(filters);
+
+        filters.sparse = SparseMelFilterbank(filters.data.data(), filters.n_mel, filters.n_fft);
+        WHISPER_LOG_INFO("%s: mel filters   = %d x %d, %zu of %zu weights non-zero\n", __func__,
+                filters.n_mel, filters.n_fft, filters.sparse.n_weights(), filters.data.size());
     }
 
     // load vocab
@@ -2363,6 +2485,31 @@ static struct ggml_cgraph * whisper_build_graph_cross(
     return gf;
 }
 
+static void log_mel_spectrogram_window(
+              whisper_state & wstate,
+        const whisper_mel & mel,
+              const int   i0,
+              const int   i1,
+              const int   n_threads,
+              const whisper_filters & filters,
+              float * dst,
+              const size_t dst_stride);
+
+// key of the encoder output cache: the encoder input's bits and the seed (the audio context)
+static uint64_t whisper_hash_floats(const float * data, size_t n, uint64_t seed) {
+    uint64_t h = 0x9e3779b97f4a7c15ull ^ (seed * 0xff51afd7ed558ccdull) ^ n;
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t bits;
+        memcpy(&bits, data + i, sizeof(bits));
+        h = (h ^ bits) * 0x100000001b3ull;
+        h ^= h >> 32;
+    }
+    // splitmix64 finalizer
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+    return h ^ (h >> 31);
+}
+
 // evaluate the encoder with the given state
 //
 // given audio recording (more specifically, its log mel spectrogram), runs forward pass of the encoder
@@ -2372,6 +2519,8 @@ static struct ggml_cgraph * whisper_build_graph_cross(
 //   - wstate:     the state of the encoder
 //   - n_threads:  number of threads to use
 //   - mel_offset: offset in the mel spectrogram (i.e. audio offset)
+//   - mel_src:    spectrogram to read instead of wstate.mel (speculative encode on a second state)
+//   - cache:      the whisper_full parameters with the encoder output cache callbacks, if any
 //
 static bool whisper_encode_internal(
         whisper_context & wctx,
@@ -2379,13 +2528,32 @@ static bool whisper_encode_internal(
               const int   mel_offset,
               const int   n_threads,
     ggml_abort_callback   abort_callback,
-                   void * abort_callback_data) {
+                   void * abort_callback_data,
+     const whisper_mel  * mel_src = nullptr,
+const whisper_full_params * cache = nullptr) {
     const int64_t t_start_us = ggml_time_us();
 
+    if (cache && (!cache->encoder_cache_lookup || whisper_encode_external(wstate))) {
+        cache = nullptr;
+    }
+
+    uint64_t cache_key = 0;
+    bool     cache_hit = false;
+
     // conv
     {
         auto & sched = wstate.sched_conv.sched;
 
+        {
+            const auto & mel_inp = mel_src ? *mel_src : wstate.mel;
+            const size_t n_values = (size_t) mel_inp.n_mel*mel_inp.n_len;
+
+            if (!mel_inp.samples && (n_values == 0 || (mel_inp.data.size() < n_values && mel_inp.data_f16.size() < n_values))) {
+                WHISPER_LOG_ERROR("%s: no mel spectrogram to encode (n_len = %d)\n", __func__, mel_inp.n_len);
+                return false;
+            }
+        }
+
         ggml_cgraph * gf = whisper_build_graph_conv(wctx, wstate);
 
         if (!ggml_backend_sched_alloc_graph(sched, gf)) {
@@ -2397,7 +2565,7 @@ static bool whisper_encode_internal(
 
         // set the input
         {
-            const auto & mel_inp = wstate.mel;
+            const auto & mel_inp = mel_src ? *mel_src : wstate.mel;
             const int n_ctx      = wstate.exp_n_audio_ctx > 0 ? wstate.exp_n_audio_ctx : wctx.model.hparams.n_audio_ctx;
 
             assert(mel->type == GGML_TYPE_F32);
@@ -2411,16 +2579,35 @@ static bool whisper_encode_internal(
             const int i0 = std::min(mel_offset,           mel_inp.n_len);
             const int i1 = std::min(mel_offset + 2*n_ctx, mel_inp.n_len);
 
-            for (int j = 0; j < mel_inp.n_mel; ++j) {
-                for (int i = i0; i < i1; ++i) {
-                    dst[j*2*n_ctx + (i - i0)] = mel_inp.data[j*mel_inp.n_len + i];
+            if (mel_inp.samples) {
+                log_mel_spectrogram_window(wstate, mel_inp, i0, i1, n_threads, wctx.model.filters, dst, 2*n_ctx);
+            } else if (!mel_inp.data_f16.empty()) {
+                for (int j = 0; j < mel_inp.n_mel; ++j) {
+                    half_to_float(mel_inp.data_f16.data() + (size_t) j*mel_inp.n_len + i0, dst + j*2*n_ctx, i1 - i0);
+                    log_mel_floor(dst + j*2*n_ctx, i1 - i0, mel_inp.max);
+                }
+            } else {
+                for (int j = 0; j < mel_inp.n_mel; ++j) {
+                    for (int i = i0; i < i1; ++i) {
+                        dst[j*2*n_ctx + (i - i0)] = mel_inp.data[j*mel_inp.n_len + i];
+                    }
                 }
             }
 
             ggml_backend_tensor_set(mel, wstate.inp_mel.data(), 0, ggml_nelements(mel)*sizeof(float));
         }
 
-        if (!whisper_encode_external(wstate)) {
+        if (cache) {
+            const int n_ctx = wstate.exp_n_audio_ctx > 0 ? wstate.exp_n_audio_ctx : wctx.model.hparams.n_audio_ctx;
+            wstate.embd_cached.resize((size_t) n_ctx*wctx.model.hparams.n_audio_state);
+
+            cache_key = whisper_hash_floats(wstate.inp_mel.data(), wstate.inp_mel.size(), n_ctx);
+            cache_hit = cache->encoder_cache_lookup(cache_key, wstate.embd_cached.data(), wstate.embd_cached.size(), cache->encoder_cache_user_data);
+        }
+
+        if (cache_hit) {
+            // the encoder output is known; the conv graph's only consumer is the encoder graph
+        } else if (!whisper_encode_external(wstate)) {
             if (!ggml_graph_compute_helper(sched, gf, n_threads)) {
                 return false;
             }
@@ -2444,8 +2631,23 @@ static bool whisper_encode_internal(
             return false;
         }
 
-        if (!ggml_graph_compute_helper(sched, gf, n_threads)) {
-            return false;
+        // on a cache hit the graph is allocated but not computed, so the cross graph finds
+        // the cached output in embd_enc
+        if (cache) {
+            WHISPER_ASSERT((size_t) ggml_nelements(wstate.embd_enc) == wstate.embd_cached.size());
+        }
+
+        if (cache_hit) {
+            ggml_backend_tensor_set(wstate.embd_enc, wstate.embd_cached.data(), 0, ggml_nbytes(wstate.embd_enc));
+        } else {
+            if (!ggml_graph_compute_helper(sched, gf, n_threads)) {
+                return false;
+            }
+
+            if (cache && cache->encoder_cache_store) {
+                ggml_backend_tensor_get(wstate.embd_enc, wstate.embd_cached.data(), 0, ggml_nbytes(wstate.embd_enc));
+                cache->encoder_cache_store(cache_key, wstate.embd_cached.data(), wstate.embd_cached.size(), cache->encoder_cache_user_data);
+            }
         }
     }
 
@@ -3010,175 +3212,107 @@ static std::string to_timestamp(int64_t t, bool comma = false) {
     return std::string(buf);
 }
 
-#define SIN_COS_N_COUNT WHISPER_N_FFT
-namespace {
-struct whisper_global_cache {
-    // In FFT, we frequently use sine and cosine operations with the same values.
-    // We can use precalculated values to speed up the process.
-    float sin_vals[SIN_COS_N_COUNT];
-    float cos_vals[SIN_COS_N_COUNT];
+// log10 mel frames [i0, i1) of mel.samples: band j of frame i goes to
+// out[j*out_stride + (i - i0)]. Without out, only their maximum is kept, in *max_out.
+static void log_mel_spectrogram_worker_thread(int ith, int n_threads, const whisper_mel & mel,
+                                              int i0, int i1, const whisper_filters & filters,
+                                              float * out, size_t out_stride, float * max_out) {
+    // frame i of the spectrogram is frame i of the shared STFT front-end
+    const StftFrontend & stft = StftFrontend::get();
+    const int frame_size = WHISPER_N_FFT;
+    const int frame_step = WHISPER_HOP_LENGTH;
+    const int n_samples  = mel.n_samples + frame_size / 2; // end of the audio in the padded recording
 
-    // Hann window (Use cosf to eliminate difference)
-    // ref: https://pytorch.org/docs/stable/generated/torch.hann_window.html
-    // ref: https://github.com/openai/whisper/blob/main/whisper/audio.py#L147
-    float hann_window[WHISPER_N_FFT];
-
-    whisper_global_cache() {
-        fill_sin_cos_table();
-        fill_hann_window(sizeof(hann_window)/sizeof(hann_window[0]), true, hann_window);
-    }
+    std::vector<float> fft_out(StftFrontend::kBins);
+    std::vector<float> fft_scratch(stft.scratch_size());
+    std::vector<float> bands(out ? 0 : mel.n_mel);
 
-    void fill_sin_cos_table() {
-        for (int i = 0; i < SIN_COS_N_COUNT; i++) {
-            double theta = (2 * M_PI * i) / SIN_COS_N_COUNT;
-            sin_vals[i] = sinf(theta);
-            cos_vals[i] = cosf(theta);
-        }
-    }
+    float mmax = -INFINITY;
 
-    void fill_hann_window(int length, bool periodic, float * output) {
-        int offset = -1;
-        if (periodic) {
-            offset = 0;
-        }
-        for (int i = 0; i < length; i++) {
-            output[i] = 0.5 * (1.0 - cosf((2.0 * M_PI * i) / (length + offset)));
-        }
-    }
-} global_cache;
-}
+    // make sure n_fft == 1 + (WHISPER_N_FFT / 2), bin_0 to bin_nyquist
+    assert(filters.n_fft == 1 + (frame_size / 2));
 
-// naive Discrete Fourier Transform
-// input is real-valued
-// output is complex-valued
-static void dft(const float* in, int N, float* out) {
-    const int sin_cos_step = SIN_COS_N_COUNT / N;
+    int i = i0 + ith;
 
-    for (int k = 0; k < N; k++) {
-        float re = 0;
-        float im = 0;
+    // calculate FFT only when the frame reaches the audio
+    for (; i < std::min(n_samples / frame_step + 1, i1); i += n_threads) {
+        // Hann window and FFT, modulus^2 of the n_fft non-negative frequencies
+        stft.frame_power(mel.samples, 0, mel.n_samples, i, fft_out.data(), fft_scratch.data());
 
-        for (int n = 0; n < N; n++) {
-            int idx = (k * n * sin_cos_step) % (SIN_COS_N_COUNT); // t = 2*M_PI*k*n/N
-            re += in[n]*global_cache.cos_vals[idx]; // cos(t)
-            im -= in[n]*global_cache.sin_vals[idx]; // sin(t)
+        // mel spectrogram: the band-limited filters, then log10 of each band
+        if (out) {
+            filters.sparse.apply_log10(fft_out.data(), out + (i - i0), out_stride);
+        } else {
+            filters.sparse.apply_log10(fft_out.data(), bands.data());
+            mmax = std::max(mmax, log_mel_max(bands.data(), bands.size()));
         }
-
-        out[k*2 + 0] = re;
-        out[k*2 + 1] = im;
-    }
-}
-
-// Cooley-Tukey FFT
-// poor man's implementation - use something better
-// input is real-valued
-// output is complex-valued
-static void fft(float* in, int N, float* out) {
-    if (N == 1) {
-        out[0] = in[0];
-        out[1] = 0;
-        return;
-    }
-
-    const int half_N = N / 2;
-    if (N - half_N*2 == 1) {
-        dft(in, N, out);
-        return;
     }
 
-    float* even = in + N;
-    for (int i = 0; i < half_N; ++i) {
-        even[i]= in[2*i];
+    // Otherwise fft_out are all zero
+    const float sum = log10(1e-10);
+    if (i < i1) {
+        mmax = std::max(mmax, sum);
     }
-    float* even_fft = out + 2 * N;
-    fft(even, half_N, even_fft);
-
-    float* odd = even;
-    for (int i = 0; i < half_N; ++i) {
-        odd[i] = in[2*i + 1];
+    for (; out && i < i1; i += n_threads) {
+        for (int j = 0; j < mel.n_mel; j++) {
+            out[j * out_stride + (i - i0)] = sum;
+        }
     }
-    float* odd_fft = even_fft + N;
-    fft(odd, half_N, odd_fft);
-
-    const int sin_cos_step = SIN_COS_N_COUNT / N;
-    for (int k = 0; k < half_N; k++) {
-        int idx = k * sin_cos_step; // t = 2*M_PI*k/N
-        float re = global_cache.cos_vals[idx]; // cos(t)
-        float im = -global_cache.sin_vals[idx]; // sin(t)
-
-        float re_odd = odd_fft[2*k + 0];
-        float im_odd = odd_fft[2*k + 1];
 
-        out[2*k + 0] = even_fft[2*k + 0] + re*re_odd - im*im_odd;
-        out[2*k + 1] = even_fft[2*k + 1] + re*im_odd + im*re_odd;
-
-        out[2*(k + half_N) + 0] = even_fft[2*k + 0] - re*re_odd + im*im_odd;
-        out[2*(k + half_N) + 1] = even_fft[2*k + 1] - re*im_odd - im*re_odd;
+    if (max_out) {
+        *max_out = mmax;
     }
 }
 
-static void log_mel_spectrogram_worker_thread(int ith, const float * hann, const std::vector<float> & samples,
-                                              int n_samples, int frame_size, int frame_step, int n_threads,
-                                              const whisper_filters & filters, whisper_mel & mel) {
-    std::vector<float> fft_in(frame_size * 2, 0.0);
-    std::vector<float> fft_out(frame_size * 2 * 2 * 2);
+// runs the workers over frames [i0, i1) on n_threads threads; returns the frames' maximum
+static float log_mel_spectrogram_frames(const whisper_mel & mel, int i0, int i1, int n_threads,
+                                        const whisper_filters & filters, float * out, size_t out_stride) {
+    n_threads = std::max(1, std::min(n_threads, i1 - i0));
+    std::vector<float> maxes(n_threads, -INFINITY);
 
-    int n_fft = filters.n_fft;
-    int i = ith;
+    whisper_parallel_run(n_threads, [&](int ith) {
+        log_mel_spectrogram_worker_thread(ith, n_threads, mel, i0, i1, filters, out, out_stride, maxes.data() + ith);
+    });
 
-    // make sure n_fft == 1 + (WHISPER_N_FFT / 2), bin_0 to bin_nyquist
-    assert(n_fft == 1 + (frame_size / 2));
+    return *std::max_element(maxes.begin(), maxes.end());
+}
 
-    // calculate FFT only when fft_in are not all zero
-    for (; i < std::min(n_samples / frame_step + 1, mel.n_len); i += n_threads) {
-        const int offset = i * frame_step;
+// sizes the spectrogram of n_samples samples and points it at them
+static void log_mel_spectrogram_init(whisper_mel & mel, const float * samples, int n_samples, int n_mel) {
+    const int64_t frame_size  = WHISPER_N_FFT;
+    const int64_t frame_step  = WHISPER_HOP_LENGTH;
+    const int64_t stage_1_pad = WHISPER_SAMPLE_RATE * 30;
+    const int64_t stage_2_pad = frame_size / 2;
 
-        // apply Hann window (~10% faster)
-        for (int j = 0; j < std::min(frame_size, n_samples - offset); j++) {
-            fft_in[j] = hann[j] * samples[offset + j];
-        }
+    mel.n_mel     = n_mel;
+    // https://github.com/pytorch/pytorch/blob/main/aten/src/ATen/native/SpectralOps.cpp#L936
+    // Calculate number of frames + remove the last frame
+    mel.n_len     = (n_samples + stage_1_pad + 2 * stage_2_pad - frame_size) / frame_step;
+    // Calculate semi-padded sample length to ensure compatibility
+    mel.n_len_org = 1 + (n_samples + stage_2_pad - frame_size) / frame_step;
 
-        // fill the rest with zeros
-        if (n_samples - offset < frame_size) {
-            std::fill(fft_in.begin() + (n_samples - offset), fft_in.end(), 0.0);
-        }
+    mel.samples   = samples;
+    mel.n_samples = n_samples;
+    mel.max       = 0.0f;
+}
 
-        // FFT
-        fft(fft_in.data(), frame_size, fft_out.data());
+static std::atomic<bool> g_mel_f16{false};
 
-        // Calculate modulus^2 of complex numbers
-        // Use pow(fft_out[2 * j + 0], 2) + pow(fft_out[2 * j + 1], 2) causes inference quality problem? Interesting.
-        for (int j = 0; j < n_fft; j++) {
-            fft_out[j] = (fft_out[2 * j + 0] * fft_out[2 * j + 0] + fft_out[2 * j + 1] * fft_out[2 * j + 1]);
-        }
-
-        // mel spectrogram
-        for (int j = 0; j < mel.n_mel; j++) {
-            double sum = 0.0;
-            // unroll loop (suggested by GH user @lunixbochs)
-            int k = 0;
-            for (k = 0; k < n_fft - 3; k += 4) {
-                sum +=
-                        fft_out[k + 0] * filters.data[j * n_fft + k + 0] +
-                        fft_out[k + 1] * filters.data[j * n_fft + k + 1] +
-                        fft_out[k + 2] * filters.data[j * n_fft + k + 2] +
-                        fft_out[k + 3] * filters.data[j * n_fft + k + 3];
-            }
-            // handle n_fft remainder
-            for (; k < n_fft; k++) {
-                sum += fft_out[k] * filters.data[j * n_fft + k];
-            }
-            sum = log10(std::max(sum, 1e-10));
-            mel.data[j * mel.n_len + i] = sum;
-        }
-    }
+void whisper_set_mel_f16(bool enable) {
+    g_mel_f16.store(enable, std::memory_order_relaxed);
+}
 
-    // Otherwise fft_out are all zero
-    double sum = log10(1e-10);
-    for (; i < mel.n_len; i += n_threads) {
-        for (int j = 0; j < mel.n_mel; j++) {
-            mel.data[j * mel.n_len + i] = sum;
-        }
+// storage for the full spectrogram, in half precision or not; frees the other
+static void whisper_mel_alloc(whisper_mel & mel, bool f16) {
+    const size_t n = (size_t) mel.n_mel * mel.n_len;
+    if (f16) {
+        mel.data.clear();
+        mel.data.shrink_to_fit();
+        mel.data_f16.resize(n);
+    } else {
+        mel.data_f16.clear();
+        mel.data_f16.shrink_to_fit();
+        mel.data.resize(n);
     }
 }
 
@@ -3197,72 +3331,44 @@ static bool log_mel_spectrogram(
               whisper_mel & mel) {
     const int64_t t_start_us = ggml_time_us();
 
-    // Hann window
     WHISPER_ASSERT(frame_size == WHISPER_N_FFT && "Unsupported frame_size");
-    const float * hann = global_cache.hann_window;
-
-    // Calculate the length of padding
-    int64_t stage_1_pad = WHISPER_SAMPLE_RATE * 30;
-    int64_t stage_2_pad = frame_size / 2;
-
-    // Initialize a vector and copy data from C array to it.
-    std::vector<float> samples_padded;
-    samples_padded.resize(n_samples + stage_1_pad + stage_2_pad * 2);
-    std::copy(samples, samples + n_samples, samples_padded.begin() + stage_2_pad);
+    WHISPER_ASSERT(frame_step == WHISPER_HOP_LENGTH && "Unsupported frame_step");
 
-    // pad 30 seconds of zeros at the end of audio (480,000 samples) + reflective pad 200 samples at the end of audio
-    std::fill(samples_padded.begin() + n_samples + stage_2_pad, samples_padded.begin() + n_samples + stage_1_pad + 2 * stage_2_pad, 0);
+    log_mel_spectrogram_init(mel, samples, n_samples, n_mel);
+    const bool f16 = g_mel_f16.load(std::memory_order_relaxed);
+    whisper_mel_alloc(mel, f16);
 
-    // reflective pad 200 samples at the beginning of audio
-    std::reverse_copy(samples + 1, samples + 1 + stage_2_pad, samples_padded.begin());
-
-    mel.n_mel     = n_mel;
-    // https://github.com/pytorch/pytorch/blob/main/aten/src/ATen/native/SpectralOps.cpp#L936
-    // Calculate number of frames + remove the last frame
-    mel.n_len     = (samples_padded.size() - frame_size) / frame_step;
-    // Calculate semi-padded sample length to ensure compatibility
-    mel.n_len_org = 1 + (n_samples + stage_2_pad - frame_size) / frame_step;
-    mel.data.resize(mel.n_mel * mel.n_len);
+    if (!f16) {
+        log_mel_spectrogram_frames(mel, 0, mel.n_len, n_threads, filters, mel.data.data(), mel.n_len);
 
-    {
-        std::vector<std::thread> workers(n_threads - 1);
-        for (int iw = 0; iw < n_threads - 1; ++iw) {
-            workers[iw] = std::thread(
-                    log_mel_spectrogram_worker_thread, iw + 1, hann, std::cref(samples_padded),
-                    n_samples + stage_2_pad, frame_size, frame_step, n_threads,
-                    std::cref(filters), std::ref(mel));
-        }
-
-        // main thread
-        log_mel_spectrogram_worker_thread(0, hann, samples_padded, n_samples + stage_2_pad, frame_size, frame_step, n_threads, filters, mel);
-
-        for (int iw = 0; iw < n_threads - 1; ++iw) {
-            workers[iw].join();
-        }
-    }
-
-    // clamping and normalization
-    double mmax = -1e20;
-    for (int i = 0; i < mel.n_mel*mel.n_len; i++) {
-        if (mel.data[i] > mmax) {
-            mmax = mel.data[i];
+        // clamping and normalization
+        log_mel_normalize(mel.data.data(), mel.data.size());
+    } else {
+        // through a float block of one encoder window at a time
+        const int n_block = std::min(mel.n_len, 100*WHISPER_CHUNK_SIZE);
+        std::vector<float> block((size_t) n_mel * n_block);
+
+        float mmax = -INFINITY;
+        for (int i0 = 0; i0 < mel.n_len; i0 += n_block) {
+            const int n = std::min(n_block, mel.n_len - i0);
+            log_mel_spectrogram_frames(mel, i0, i0 + n, n_threads, filters, block.data(), n);
+            mmax = std::max(mmax, log_mel_max(block.data(), (size_t) n_mel * n));
+            log_mel_shift(block.data(), (size_t) n_mel * n);
+            for (int j = 0; j < n_mel; ++j) {
+                float_to_half(block.data() + (size_t) j * n, mel.data_f16.data() + (size_t) j * mel.n_len + i0, n);
+            }
         }
+        mel.max = mmax;
     }
 
-    mmax -= 8.0;
-
-    for (int i = 0; i < mel.n_mel*mel.n_len; i++) {
-        if (mel.data[i] < mmax) {
-            mel.data[i] = mmax;
-        }
-
-        mel.data[i] = (mel.data[i] + 4.0)/4.0;
-    }
+    // the spectrogram no longer needs the samples
+    mel.samples   = nullptr;
+    mel.n_samples = 0;
 
     wstate.t_mel_us += ggml_time_us() - t_start_us;
 
     // Dump log_mel_spectrogram
-    if (debug) {
+    if (debug && !mel.data.empty()) {
         std::ofstream outFile("log_mel_spectrogram.json");
         outFile << "[";
         for (uint64_t i = 0; i < mel.data.size() - 1; i++) {
@@ -3275,6 +3381,55 @@ static bool log_mel_spectrogram(
     return true;
 }
 
+// The spectrogram of a long recording is hundreds of MB (3 h: 80 bands x 1.08M
+// frames of floats, plus a padded copy of the audio twice that). Windowed, it
+// keeps a pointer to the samples and computes each encoder window's frames when
+// the window is encoded; a first pass over the recording only finds the maximum
+// that normalization needs, so the frames are exactly those of the full version.
+// The samples must outlive the spectrogram's use.
+static bool log_mel_spectrogram_windowed(
+              whisper_state & wstate,
+              const float * samples,
+              const int   n_samples,
+              const int   n_mel,
+              const int   n_threads,
+              const whisper_filters & filters,
+              whisper_mel & mel) {
+    const int64_t t_start_us = ggml_time_us();
+
+    log_mel_spectrogram_init(mel, samples, n_samples, n_mel);
+    mel.data.clear();
+    mel.data.shrink_to_fit();
+    mel.data_f16.clear();
+    mel.data_f16.shrink_to_fit();
+
+    mel.max = log_mel_spectrogram_frames(mel, 0, mel.n_len, n_threads, filters, nullptr, 0);
+
+    wstate.t_mel_us += ggml_time_us() - t_start_us;
+
+    return true;
+}
+
+// frames [i0, i1) of a windowed spectrogram, normalized, band j at dst[j*dst_stride]
+static void log_mel_spectrogram_window(
+              whisper_state & wstate,
+        const whisper_mel & mel,
+              const int   i0,
+              const int   i1,
+              const int   n_threads,
+              const whisper_filters & filters,
+              float * dst,
+              const size_t dst_stride) {
+    const int64_t t_start_us = ggml_time_us();
+
+    log_mel_spectrogram_frames(mel, i0, i1, n_threads, filters, dst, dst_stride);
+    for (int j = 0; j < mel.n_mel; ++j) {
+        log_mel_scale(dst + j * dst_stride, i1 - i0, mel.max);
+    }
+
+    wstate.t_mel_us += ggml_time_us() - t_start_us;
+}
+
 // split text into tokens
 //
 // ref: https://github.com/openai/gpt-2/blob/a74da5d99abaaba920de8131d64da2862a8f213b/src/encoder.py#L53
@@ -3901,6 +4056,18 @@ int whisper_pcm_to_mel(struct whisper_context * ctx, const float * samples, int
     return whisper_pcm_to_mel_with_state(ctx, ctx->state, samples, n_samples, n_threads);
 }
 
+// a full spectrogram of n_mel x n_len frames, n_len_org of them audio; data is left to the caller
+static void whisper_mel_set_size(whisper_mel & mel, int n_len, int n_len_org, int n_mel, bool f16) {
+    mel.n_len     = n_len;
+    mel.n_len_org = n_len_org;
+    mel.n_mel     = n_mel;
+    mel.samples   = nullptr;
+    mel.n_samples = 0;
+    mel.max       = -INFINITY;
+
+    whisper_mel_alloc(mel, f16);
+}
+
 int whisper_set_mel_with_state(
         struct whisper_context * ctx,
           struct whisper_state * state,
@@ -3912,12 +4079,14 @@ int whisper_set_mel_with_state(
         return -1;
     }
 
-    state->mel.n_len     = n_len;
-    state->mel.n_len_org = n_len;
-    state->mel.n_mel     = n_mel;
-
-    state->mel.data.resize(n_len*n_mel);
-    memcpy(state->mel.data.data(), data, n_len*n_mel*sizeof(float));
+    const bool f16 = g_mel_f16.load(std::memory_order_relaxed);
+    whisper_mel & mel = state->mel;
+    whisper_mel_set_size(mel, n_len, n_len, n_mel, f16);
+    if (!f16) {
+        memcpy(mel.data.data(), data, n_len*n_mel*sizeof(float));
+    } else {
+        float_to_half(data, mel.data_f16.data(), mel.data_f16.size());
+    }
 
     return 0;
 }
@@ -3930,6 +4099,213 @@ int whisper_set_mel(
     return whisper_set_mel_with_state(ctx, ctx->state, data, n_len, n_mel);
 }
 
+const float * whisper_model_mel_filters(struct whisper_context * ctx, int * n_mel, int * n_fft) {
+    *n_mel = ctx->model.filters.n_mel;
+    *n_fft = ctx->model.filters.n_fft;
+    return ctx->model.filters.data.data();
+}
+
+int whisper_set_mel_frames_with_state(
+        struct whisper_context * ctx,
+          struct whisper_state * state,
+                   const float * frames,
+                           int   n_frames,
+                           int   n_samples) {
+    const int64_t t_start_us = ggml_time_us();
+
+    const int n_mel = ctx->model.filters.n_mel;
+    const int64_t pad = WHISPER_N_FFT / 2;
+    if (n_samples <= 0) {
+        WHISPER_LOG_ERROR("%s: no samples\n", __func__);
+        return -1;
+    }
+
+    // sized as log_mel_spectrogram_init does
+    const int n_len     = (n_samples + WHISPER_SAMPLE_RATE * 30 + 2 * pad - WHISPER_N_FFT) / WHISPER_HOP_LENGTH;
+    const int n_len_org = 1 + (n_samples + pad - WHISPER_N_FFT) / WHISPER_HOP_LENGTH;
+    const int n_audio   = (n_samples + pad) / WHISPER_HOP_LENGTH + 1;
+    if (n_frames != n_audio) {
+        WHISPER_LOG_ERROR("%s: %d frames for %d samples (expected %d)\n", __func__, n_frames, n_samples, n_audio);
+        return -1;
+    }
+
+    const bool f16 = g_mel_f16.load(std::memory_order_relaxed);
+    whisper_mel & mel = state->mel;
+    whisper_mel_set_size(mel, n_len, n_len_org, n_mel, f16);
+
+    // the frames past the audio are silence, as log_mel_spectrogram_frames fills them
+    const int n_copy = std::min(n_audio, n_len);
+    float mmax = log_mel_max(frames, (size_t) n_copy * n_mel);
+    if (n_copy < n_len) {
+        mmax = std::max(mmax, (float) log10(1e-10));
+    }
+
+    std::vector<float> band(n_len, (float) log10(1e-10));
+    for (int j = 0; j < n_mel; ++j) {
+        for (int i = 0; i < n_copy; ++i) {
+            band[i] = frames[(size_t) i * n_mel + j];
+        }
+        std::fill(band.begin() + n_copy, band.end(), (float) log10(1e-10));
+        if (f16) {
+            log_mel_shift(band.data(), n_len);
+            float_to_half(band.data(), mel.data_f16.data() + (size_t) j * n_len, n_len);
+        } else {
+            std::copy(band.begin(), band.end(), mel.data.begin() + (size_t) j * n_len);
+        }
+    }
+
+    if (f16) {
+        mel.max = mmax;
+    } else {
+        log_mel_scale(mel.data.data(), mel.data.size(), mmax);
+    }
+
+    state->t_mel_us += ggml_time_us() - t_start_us;
+
+    return 0;
+}
+
+struct whisper_mel_stream {
+    const whisper_filters * filters;
+    bool f16;                  // frames and the spectrograms set from them in half precision
+
+    StftStream stft;           // the pushed samples the next frames overlap
+
+    // the completed frames, n_mel per frame: log10 mel, or with f16 the same
+    // through log_mel_shift
+    int64_t n_frames = 0;
+    std::vector<float> frames;
+    std::vector<ggml_fp16_t> frames_f16;
+    float max = -INFINITY;     // of the log10 mel of the frames
+
+    std::vector<float> fft_out;
+    std::vector<float> fft_scratch;
+};
+
+// log10 mel of frame i into out[0..n_mel), from the pushed samples still held
+static void whisper_mel_stream_frame(whisper_mel_stream & stream, int64_t i, float * out) {
+    stream.stft.frame_power(i, stream.fft_out.data(), stream.fft_scratch.data());
+    stream.filters->sparse.apply_log10(stream.fft_out.data(), out);
+}
+
+struct whisper_mel_stream * whisper_mel_stream_init(struct whisper_context * ctx) {
+    whisper_mel_stream * stream = new whisper_mel_stream;
+
+    stream->filters = &ctx->model.filters;
+    stream->f16     = g_mel_f16.load(std::memory_order_relaxed);
+    stream->fft_out.resize(StftFrontend::kBins);
+    stream->fft_scratch.resize(StftFrontend::get().scratch_size());
+
+    return stream;
+}
+
+void whisper_mel_stream_free(struct whisper_mel_stream * stream) {
+    delete stream;
+}
+
+int whisper_mel_stream_push(struct whisper_mel_stream * stream, const float * samples, int n_samples) {
+    const int n_mel = stream->filters->n_mel;
+
+    if (n_samples > 0) {
+        stream->stft.push(samples, n_samples);
+    }
+
+    const int64_t n_complete = stream->stft.n_complete();
+    if (n_complete > stream->n_frames) {
+        std::vector<float> frame(n_mel);
+        if (stream->f16) {
+            stream->frames_f16.resize(n_complete * n_mel);
+        } else {
+            stream->frames.resize(n_complete * n_mel);
+        }
+        for (int64_t i = stream->n_frames; i < n_complete; ++i) {
+            float * out = stream->f16 ? frame.data() : stream->frames.data() + i * n_mel;
+            whisper_mel_stream_frame(*stream, i, out);
+            stream->max = std::max(stream->max, log_mel_max(out, n_mel));
+            if (stream->f16) {
+                log_mel_shift(out, n_mel);
+                float_to_half(out, stream->frames_f16.data() + i * n_mel, n_mel);
+            }
+        }
+        stream->n_frames = n_complete;
+        stream->stft.release_frames_before(n_complete);
+    }
+
+    return (int) stream->n_frames;
+}
+
+int whisper_mel_stream_set_state(struct whisper_context * ctx, struct whisper_mel_stream * stream, struct whisper_state * state) {
+    const int64_t t_start_us = ggml_time_us();
+
+    const int n_mel = stream->filters->n_mel;
+    if (n_mel != ctx->model.filters.n_mel) {
+        WHISPER_LOG_ERROR("%s: the stream belongs to a model with %d mel bands (expected %d)\n", __func__, n_mel, ctx->model.filters.n_mel);
+        return -1;
+    }
+    if (stream->stft.n_samples() == 0) {
+        WHISPER_LOG_ERROR("%s: no samples were pushed\n", __func__);
+        return -1;
+    }
+
+    // sized as log_mel_spectrogram_init does
+    const int64_t n_samples = stream->stft.n_samples();
+    const int64_t pad       = WHISPER_N_FFT / 2;
+    const int n_len     = (n_samples + WHISPER_SAMPLE_RATE * 30 + 2 * pad - WHISPER_N_FFT) / WHISPER_HOP_LENGTH;
+    const int n_len_org = 1 + (n_samples + pad - WHISPER_N_FFT) / WHISPER_HOP_LENGTH;
+
+    whisper_mel & mel = state->mel;
+    whisper_mel_set_size(mel, n_len, n_len_org, n_mel, stream->f16);
+
+    // completed frames, then the frames the end of the audio reaches into (these
+    // change with the next push), then the zero padding
+    const int n_complete = (int) stream->n_frames;
+    const int n_audio    = std::min<int>(n_len, (n_samples + pad) / WHISPER_HOP_LENGTH + 1);
+    float mmax = stream->max;
+
+    std::vector<float> frame(n_mel);
+    std::vector<ggml_fp16_t> frame_f16(n_mel);
+    for (int i = 0; i < n_len; ++i) {
+        const float * src = frame.data();
+        const ggml_fp16_t * src_f16 = frame_f16.data();
+        if (i < n_complete) {
+            if (stream->f16) {
+                src_f16 = stream->frames_f16.data() + (size_t) i * n_mel;
+            } else {
+                src = stream->frames.data() + (size_t) i * n_mel;
+            }
+        } else if (i < n_audio) {
+            whisper_mel_stream_frame(*stream, i, frame.data());
+            mmax = std::max(mmax, log_mel_max(frame.data(), n_mel));
+        } else if (i == n_audio) {
+            std::fill(frame.begin(), frame.end(), log10(1e-10));
+            mmax = std::max(mmax, frame[0]);
+        }
+        if (stream->f16) {
+            if (i >= n_complete && i <= n_audio) {
+                log_mel_shift(frame.data(), n_mel);
+                float_to_half(frame.data(), frame_f16.data(), n_mel);
+            }
+            for (int j = 0; j < n_mel; ++j) {
+                mel.data_f16[(size_t) j * n_len + i] = src_f16[j];
+            }
+        } else {
+            for (int j = 0; j < n_mel; ++j) {
+                mel.data[(size_t) j * n_len + i] = src[j];
+            }
+        }
+    }
+
+    if (stream->f16) {
+        mel.max = mmax;
+    } else {
+        log_mel_scale(mel.data.data(), mel.data.size(), mmax);
+    }
+
+    state->t_mel_us += ggml_time_us() - t_start_us;
+
+    return 0;
+}
+
 int whisper_encode_with_state(struct whisper_context * ctx, struct whisper_state * state, int offset, int n_threads) {
     if (!whisper_encode_internal(*ctx, *state, offset, n_threads, nullptr, nullptr)) {
         WHISPER_LOG_ERROR("%s: failed to eval\n", __func__);
@@ -3948,6 +4324,13 @@ int whisper_encode(struct whisper_context * ctx, int offset, int n_threads) {
     return 0;
 }
 
+const float * whisper_get_encoder_input_from_state(struct whisper_state * state, int * n_values) {
+    if (n_values) {
+        *n_values = (int) state->inp_mel.size();
+    }
+    return state->inp_mel.empty() ? nullptr : state->inp_mel.data();
+}
+
 int whisper_decode_with_state(struct whisper_context * ctx, struct whisper_state * state, const whisper_token * tokens, int n_tokens, int n_past, int n_threads) {
     whisper_batch_prep_legacy(state->batch, tokens, n_tokens, n_past, 0);
 
@@ -5938,6 +6321,10 @@ struct whisper_full_params whisper_full_default_params(enum whisper_sampling_str
 
         /*.debug_mode        =*/ false,
         /*.audio_ctx         =*/ 0,
+        /*.audio_ctx_auto    =*/ false,
+
+        /*.spec_encode_state     =*/ nullptr,
+        /*.spec_encode_n_threads =*/ 0,
 
         /*.tdrz_enable       =*/ false,
 
@@ -5987,6 +6374,13 @@ struct whisper_full_params whisper_full_default_params(enum whisper_sampling_str
         /*.logits_filter_callback           =*/ nullptr,
         /*.logits_filter_callback_user_data =*/ nullptr,
 
+        /*.window_callback           =*/ nullptr,
+        /*.window_callback_user_data =*/ nullptr,
+
+        /*.encoder_cache_lookup    =*/ nullptr,
+        /*.encoder_cache_store     =*/ nullptr,
+        /*.encoder_cache_user_data =*/ nullptr,
+
         /*.grammar_rules   =*/ nullptr,
         /*.n_grammar_rules =*/ 0,
         /*.i_start_rule    =*/ 0,
@@ -6792,6 +7186,57 @@ static bool whisper_vad(
     return true;
 }
 
+// [EXPERIMENTAL] encoder pipelining
+// the speculative encode of the next window on whisper_full_params.spec_encode_state
+struct whisper_spec_encode {
+    void * task = nullptr; // on the task runner
+
+    int  seek      = -1; // window being encoded, -1 if none
+    int  audio_ctx = 0;  // its audio context
+    bool ok        = false;
+
+    int n_used      = 0;
+    int n_discarded = 0;
+
+    whisper_context           * ctx       = nullptr;
+    whisper_state             * state     = nullptr;
+    const whisper_full_params * params    = nullptr;
+    int                         n_threads = 0;
+
+    void start() {
+        task = g_task_runner.start.load()([](int, void * arg) {
+            whisper_spec_encode & spec = *(whisper_spec_encode *) arg;
+            spec.ok = whisper_encode_internal(*spec.ctx, *spec.params->spec_encode_state, spec.seek, spec.n_threads,
+                    spec.params->abort_callback, spec.params->abort_callback_user_data, &spec.state->mel, spec.params);
+        }, this, g_task_runner.user_data);
+    }
+
+    void wait() {
+        if (task) {
+            g_task_runner.wait.load()(task, g_task_runner.user_data);
+            task = nullptr;
+        }
+    }
+
+    ~whisper_spec_encode() {
+        wait();
+    }
+};
+
+// audio_ctx_auto: the audio context for a window of n_frames mel frames (2 per encoder frame) with a
+// margin, rounded up to a bucket. The buckets match the 256-frame padding of the cross-attention cache,
+// and a handful of sizes keeps the graph allocations reusable. 0 = the full context
+static int whisper_window_audio_ctx(const whisper_context & ctx, int n_frames, int audio_ctx_max) {
+    const int n_bucket = 256;
+    const int n_margin = 64; // 1.28 s
+
+    const int n_max  = audio_ctx_max > 0 ? audio_ctx_max : ctx.model.hparams.n_audio_ctx;
+    const int n_need = (std::min(n_frames, 100*WHISPER_CHUNK_SIZE) + 1)/2 + n_margin;
+    const int n_ctx  = GGML_PAD(n_need, n_bucket);
+
+    return n_ctx < n_max ? n_ctx : audio_ctx_max;
+}
+
 int whisper_full_with_state(
         struct whisper_context * ctx,
           struct whisper_state * state,
@@ -6803,9 +7248,23 @@ int whisper_full_with_state(
 
     result_all.clear();
 
+    // the spectrogram is computed a window at a time from samples, which are
+    // only valid for this call; once they are gone the state holds no mel
+    struct mel_samples_guard {
+        whisper_mel & mel;
+        ~mel_samples_guard() {
+            if (mel.samples) {
+                mel.n_len     = 0;
+                mel.n_len_org = 0;
+            }
+            mel.samples   = nullptr;
+            mel.n_samples = 0;
+        }
+    } mel_guard = { state->mel };
+
     if (n_samples > 0) {
         // compute log mel spectrogram
-        if (whisper_pcm_to_mel_with_state(ctx, state, samples, n_samples, params.n_threads) != 0) {
+        if (!log_mel_spectrogram_windowed(*state, samples, n_samples, ctx->model.filters.n_mel, params.n_threads, ctx->model.filters, state->mel)) {
             WHISPER_LOG_ERROR("%s: failed to compute log mel spectrogram\n", __func__);
             return -2;
         }
@@ -6937,6 +7396,19 @@ int whisper_full_with_state(
     }
     state->exp_n_audio_ctx = params.audio_ctx;
 
+    if (params.spec_encode_state == state) {
+        params.spec_encode_state = nullptr;
+    }
+    if (params.spec_encode_state && !g_task_runner.start) {
+        WHISPER_LOG_WARN("%s: no task runner installed, speculative encoding is off\n", __func__);
+        params.spec_encode_state = nullptr;
+    }
+    if (params.spec_encode_state) {
+        params.spec_encode_state->exp_n_audio_ctx = params.audio_ctx;
+    }
+
+    const int n_threads_spec = params.spec_encode_n_threads > 0 ? params.spec_encode_n_threads : params.n_threads;
+
     // these tokens determine the task that will be performed
     std::vector<whisper_token> prompt_init = { whisper_token_sot(ctx), };
 
@@ -6982,6 +7454,17 @@ int whisper_full_with_state(
     std::vector<std::vector<beam_candidate>> bc_per_dec(n_decoders);
     std::vector<beam_candidate> beam_candidates;
 
+    whisper_spec_encode spec;
+
+    // effort of the next window, lowered or raised by params.window_callback
+    whisper_window_tuning tuning = {
+        /*.n_threads      =*/ params.n_threads,
+        /*.best_of        =*/ params.greedy.best_of,
+        /*.beam_size      =*/ params.beam_search.beam_size,
+        /*.audio_ctx      =*/ params.audio_ctx,
+        /*.allow_fallback =*/ true,
+    };
+
     // main loop
     while (true) {
         if (params.progress_callback) {
@@ -7003,10 +7486,56 @@ int whisper_full_with_state(
             }
         }
 
-        // encode audio features starting at offset seek
-        if (!whisper_encode_internal(*ctx, *state, seek, params.n_threads, params.abort_callback, params.abort_callback_user_data)) {
-            WHISPER_LOG_ERROR("%s: failed to encode\n", __func__);
-            return -6;
+        // an encode that was not speculated uses the speculation threads too
+        const int n_threads_encode = params.n_threads + (params.spec_encode_state ? n_threads_spec : 0);
+
+        const int64_t t_window_start_us = ggml_time_us();
+        const int64_t t_encode_start_us = state->t_encode_us;
+        const int64_t t_decode_start_us = state->t_decode_us + state->t_batchd_us + state->t_prompt_us;
+        const int     n_fail_start      = state->n_fail_p + state->n_fail_h;
+
+        if (params.audio_ctx_auto) {
+            state->exp_n_audio_ctx = whisper_window_audio_ctx(*ctx, seek_end - seek, tuning.audio_ctx);
+            WHISPER_LOG_DEBUG("%s: seek = %d, audio_ctx = %d\n", __func__, seek, state->exp_n_audio_ctx);
+        }
+
+        // a reduced audio context (audio_ctx, audio_ctx_auto, the window callback) encodes only the
+        // first 2*audio_ctx frames of the window, so the window never moves further than that:
+        // the frames after them would be skipped without ever being encoded
+        const int seek_delta_max = std::min(100*WHISPER_CHUNK_SIZE,
+                2*(state->exp_n_audio_ctx > 0 ? state->exp_n_audio_ctx : whisper_n_audio_ctx(ctx)));
+
+        // encode audio features starting at offset seek, unless the speculative encode got this window:
+        // its cross-attention KV cache is all the decoder needs, so the two states swap caches
+        const bool spec_hit = spec.seek == seek && spec.audio_ctx == state->exp_n_audio_ctx;
+        spec.wait();
+        if (spec_hit && spec.ok) {
+            std::swap(state->kv_cross, params.spec_encode_state->kv_cross);
+            spec.n_used++;
+        } else {
+            if (spec.seek >= 0) {
+                spec.n_discarded++;
+            }
+            if (!whisper_encode_internal(*ctx, *state, seek, n_threads_encode, params.abort_callback, params.abort_callback_user_data, nullptr, &params)) {
+                WHISPER_LOG_ERROR("%s: failed to encode\n", __func__);
+                return -6;
+            }
+        }
+        spec.seek = -1;
+
+        // encode the next full window while this one is decoded
+        if (params.spec_encode_state && seek + seek_delta_max + delta_min < seek_end) {
+            spec.seek   = seek + seek_delta_max;
+            spec.ok     = false;
+            if (params.audio_ctx_auto) {
+                params.spec_encode_state->exp_n_audio_ctx = whisper_window_audio_ctx(*ctx, seek_end - spec.seek, tuning.audio_ctx);
+            }
+            spec.audio_ctx = params.spec_encode_state->exp_n_audio_ctx;
+            spec.ctx       = ctx;
+            spec.state     = state;
+            spec.params    = &params;
+            spec.n_threads = n_threads_spec;
+            spec.start();
         }
 
         // if there is a very short audio segment left to process, we remove any past prompt since it tends
@@ -7017,7 +7546,9 @@ int whisper_full_with_state(
 
         int best_decoder_id = 0;
 
-        for (int it = 0; it < (int) temperatures.size(); ++it) {
+        const int n_temperatures = tuning.allow_fallback ? (int) temperatures.size() : 1;
+
+        for (int it = 0; it < n_temperatures; ++it) {
             const float t_cur = temperatures[it];
 
             int n_decoders_cur = 1;
@@ -7055,7 +7586,7 @@ int whisper_full_with_state(
                 decoder.sequence.entropy          = 0.0;
                 decoder.sequence.score            = -INFINITY;
 
-                decoder.seek_delta = 100*WHISPER_CHUNK_SIZE;
+                decoder.seek_delta = seek_delta_max;
 
                 decoder.failed    = false;
                 decoder.completed = false;
@@ -7209,21 +7740,7 @@ int whisper_full_with_state(
 
                     const int n_threads = std::min(params.n_threads, n_decoders_cur);
 
-                    if (n_threads == 1) {
-                        process();
-                    } else {
-                        std::vector<std::thread> threads(n_threads - 1);
-
-                        for (int t = 0; t < n_threads - 1; ++t) {
-                            threads[t] = std::thread(process);
-                        }
-
-                        process();
-
-                        for (int t = 0; t < n_threads - 1; ++t) {
-                            threads[t].join();
-                        }
-                    }
+                    whisper_parallel_run(n_threads, [&](int) { process(); });
                 }
 
                 beam_candidates.clear();
@@ -7353,7 +7870,7 @@ int whisper_full_with_state(
 
                             if (params.single_segment || params.no_timestamps) {
                                 result_len = i + 1;
-                                seek_delta = 100*WHISPER_CHUNK_SIZE;
+                                seek_delta = seek_delta_max;
                             }
 
                             WHISPER_LOG_DEBUG("%s: decoder %d completed\n", __func__, j);
@@ -7363,7 +7880,7 @@ int whisper_full_with_state(
 
                         // TESTS: if no tensors are loaded, it means we are running tests
                         if (ctx->model.n_loaded == 0) {
-                            seek_delta = 100*WHISPER_CHUNK_SIZE;
+                            seek_delta = seek_delta_max;
                             completed = true;
                             continue;
                         }
@@ -7371,7 +7888,7 @@ int whisper_full_with_state(
 
                     // sometimes, the decoding can get stuck in a repetition loop
                     // this is an attempt to mitigate such cases - we flag the decoding as failed and use a fallback strategy
-                    if (i == n_max - 1 && (result_len == 0 || seek_delta < 100*WHISPER_CHUNK_SIZE/2)) {
+                    if (i == n_max - 1 && (result_len == 0 || seek_delta < seek_delta_max/2)) {
                         WHISPER_LOG_DEBUG("%s: decoder %d: failed due to repetition loop\n", __func__, j);
                         failed = true;
                         continue;
@@ -7459,21 +7976,7 @@ int whisper_full_with_state(
 
                         const int n_threads = std::min(params.n_threads, n_decoders_cur);
 
-                        if (n_threads == 1) {
-                            process();
-                        } else {
-                            std::vector<std::thread> threads(n_threads - 1);
-
-                            for (int t = 0; t < n_threads - 1; ++t) {
-                                threads[t] = std::thread(process);
-                            }
-
-                            process();
-
-                            for (int t = 0; t < n_threads - 1; ++t) {
-                                threads[t].join();
-                            }
-                        }
+                        whisper_parallel_run(n_threads, [&](int) { process(); });
                     }
 
                     state->t_sample_us += ggml_time_us() - t_start_sample_us;
@@ -7521,7 +8024,7 @@ int whisper_full_with_state(
             // was the decoding successful for the current temperature?
             // do fallback only if:
             // - we are not at the last temperature
-            if (it != (int) temperatures.size() - 1) {
+            if (it != n_temperatures - 1) {
                 const auto & decoder = state->decoders[best_decoder_id];
 
                 if (decoder.failed ||
@@ -7680,7 +8183,7 @@ int whisper_full_with_state(
             {
                 const int n_segments = state->result_all.size() - n_segments_before;
                 if (ctx->params.dtw_token_timestamps && n_segments) {
-                    const int n_frames = std::min(std::min(WHISPER_CHUNK_SIZE * 100, seek_delta), seek_end - seek);
+                    const int n_frames = std::min(std::min(seek_delta_max, seek_delta), seek_end - seek);
                     whisper_exp_compute_token_level_timestamps_dtw(
                             ctx, state, params, result_all.size() - n_segments, n_segments, seek, n_frames, 7, params.n_threads);
                     if (params.new_segment_callback) {
@@ -7697,16 +8200,63 @@ int whisper_full_with_state(
                 tokens_cur[tokens_cur.size() - 1].id > whisper_token_beg(ctx);
             if (single_timestamp_ending) {
                 WHISPER_LOG_DEBUG("single timestamp ending - skip entire chunk\n");
-                seek_delta = std::min(seek_end - seek, WHISPER_CHUNK_SIZE * 100);
+                seek_delta = std::min(seek_end - seek, seek_delta_max);
+            }
+
+            // a timestamp past the encoded frames cannot have been heard
+            if (seek_delta > seek_delta_max) {
+                WHISPER_LOG_DEBUG("%s: seek_delta = %d past the encoded %d frames\n", __func__, seek_delta, seek_delta_max);
+                seek_delta = seek_delta_max;
             }
 
             // update audio window
             seek += seek_delta;
 
             WHISPER_LOG_DEBUG("seek = %d, seek_delta = %d\n", seek, seek_delta);
+
+            if (params.window_callback) {
+                whisper_window_stats stats;
+                stats.seek_ms     = 10*(seek - seek_delta);
+                stats.audio_ms    = 10*seek_delta;
+                stats.wall_ms     = 1e-3f*(ggml_time_us() - t_window_start_us);
+                stats.encode_ms   = 1e-3f*(state->t_encode_us - t_encode_start_us);
+                stats.decode_ms   = 1e-3f*(state->t_decode_us + state->t_batchd_us + state->t_prompt_us - t_decode_start_us);
+                stats.n_fallbacks = state->n_fail_p + state->n_fail_h - n_fail_start;
+
+                const int audio_ctx_prev = tuning.audio_ctx;
+                params.window_callback(ctx, state, &stats, &tuning, params.window_callback_user_data);
+
+                // the decoders were set up for the initial counts
+                tuning.n_threads = std::max(1, tuning.n_threads);
+                tuning.best_of   = std::max(1, std::min(tuning.best_of,   n_decoders));
+                tuning.beam_size = std::max(1, std::min(tuning.beam_size, n_decoders));
+                tuning.audio_ctx = std::max(0, std::min(tuning.audio_ctx, whisper_n_audio_ctx(ctx)));
+
+                params.n_threads             = tuning.n_threads;
+                params.greedy.best_of        = tuning.best_of;
+                params.beam_search.beam_size = tuning.beam_size;
+
+                if (tuning.audio_ctx != audio_ctx_prev) {
+                    // a speculative encode of the next window used the old context size
+                    spec.wait();
+                    if (spec.seek >= 0) {
+                        spec.n_discarded++;
+                        spec.seek = -1;
+                    }
+                    state->exp_n_audio_ctx = tuning.audio_ctx;
+                    if (params.spec_encode_state) {
+                        params.spec_encode_state->exp_n_audio_ctx = tuning.audio_ctx;
+                    }
+                }
+            }
         }
     }
 
+    if (params.spec_encode_state) {
+        spec.wait();
+        WHISPER_LOG_INFO("%s: speculative encodes: %d used, %d discarded\n", __func__, spec.n_used, spec.n_discarded + (spec.seek >= 0 ? 1 : 0));
+    }
+
     return 0;
 }
 
@@ -7787,6 +8337,8 @@ int whisper_full_parallel(
         params_cur.progress_callback = nullptr;
         params_cur.progress_callback_user_data = nullptr;
 
+        params_cur.spec_encode_state = nullptr; // one per state would be needed
+
         workers[i] = std::thread(whisper_full_with_state, ctx, states[i], std::move(params_cur), samples + start_samples, n_samples_cur);
     }
 
@@ -301,6 +301,51 @@ extern "C" {
                                int   n_len,
                                int   n_mel);
 
+    // The model's mel filterbank: *n_mel rows of *n_fft weights over the power
+    // spectrum of a WHISPER_N_FFT-point frame. For callers that compute the
+    // frames' spectra themselves (see whisper_set_mel_frames_with_state).
+    WHISPER_API const float * whisper_model_mel_filters(struct whisper_context * ctx, int * n_mel, int * n_fft);
+
+    // Sets the spectrogram of n_samples of 16 kHz audio from its log10 mel frames,
+    // n_mel values per frame: the filterbank applied to the power spectrum of
+    // each Hann-windowed WHISPER_N_FFT-sample frame, every WHISPER_HOP_LENGTH
+    // samples and centred on it, reflected before the start and zero past the end.
+    // n_frames must be (n_samples + WHISPER_N_FFT/2) / WHISPER_HOP_LENGTH + 1, the
+    // frames that reach the audio. Padding and normalization are as in
+    // whisper_pcm_to_mel_with_state, which gives the same spectrogram from the
+    // samples; transcribe it with whisper_full_with_state(..., nullptr, 0).
+    // Returns 0 on success
+    WHISPER_API int whisper_set_mel_frames_with_state(
+            struct whisper_context * ctx,
+              struct whisper_state * state,
+                       const float * frames,
+                               int   n_frames,
+                               int   n_samples);
+
+    // Log mel spectrogram of audio that arrives in pieces, e.g. from a recorder.
+    // A push computes only the frames its samples complete and keeps the STFT
+    // overlap for the next one, so each piece costs in proportion to its length.
+    // whisper_mel_stream_set_state puts the spectrogram of everything pushed so far
+    // into a state, the same as whisper_pcm_to_mel_with_state on all the samples;
+    // transcribe it with whisper_full_with_state(..., nullptr, 0).
+    // The context must outlive the stream. Not thread-safe.
+    struct whisper_mel_stream;
+
+    WHISPER_API struct whisper_mel_stream * whisper_mel_stream_init(struct whisper_context * ctx);
+    WHISPER_API void whisper_mel_stream_free(struct whisper_mel_stream * stream);
+
+    // Appends 16 kHz mono samples. Returns the number of completed frames
+    WHISPER_API int whisper_mel_stream_push(
+            struct whisper_mel_stream * stream,
+                          const float * samples,
+                                  int   n_samples);
+
+    // Returns 0 on success
+    WHISPER_API int whisper_mel_stream_set_state(
+            struct whisper_context * ctx,
+        struct whisper_mel_stream * stream,
+              struct whisper_state * state);
+
     // Run the Whisper encoder on the log mel spectrogram stored inside the default state in the provided whisper context.
     // Make sure to call whisper_pcm_to_mel() or whisper_set_mel() first.
     // offset can be used to specify the offset of the first frame in the spectrogram.
@@ -316,6 +361,11 @@ extern "C" {
                                int   offset,
                                int   n_threads);
 
+    // What the last encode on the state read: its window of the log mel spectrogram,
+    // scaled and padded as the encoder sees it, n_mels x 2*n_audio_ctx floats, band-major.
+    // nullptr before the first encode.
+    WHISPER_API const float * whisper_get_encoder_input_from_state(struct whisper_state * state, int * n_values);
+
     // Run the Whisper decoder to obtain the logits and probabilities for the next token.
     // Make sure to call whisper_encode() first.
     // tokens + n_tokens is the provided context for the decoder.
@@ -468,6 +518,46 @@ extern "C" {
     // If it returns false, the computation is aborted
     typedef bool (*whisper_encoder_begin_callback)(struct whisper_context * ctx, struct whisper_state * state, void * user_data);
 
+    // Cost of one decoded window, see whisper_window_callback
+    struct whisper_window_stats {
+        int   seek_ms;      // start of the window in the input
+        int   audio_ms;     // audio the decoder advanced over
+        float wall_ms;      // encode + decode, wall clock
+        float encode_ms;    // 0 if a speculative encode was used
+        float decode_ms;    // decoder passes, prompt and batched ones included
+        int   n_fallbacks;  // temperature fallbacks and failed decoders
+    };
+
+    // Decoding effort for the windows that follow, see whisper_window_callback.
+    // best_of and beam_size cannot exceed the decoders the call started with.
+    struct whisper_window_tuning {
+        int  n_threads;
+        int  best_of;
+        int  beam_size;
+        int  audio_ctx;      // 0 = full
+        bool allow_fallback; // false: decode at the first temperature only
+    };
+
+    // Window callback
+    // If not NULL, called after each window is decoded with what it cost; may change
+    // the effort of the remaining windows through tuning
+    typedef void (*whisper_window_callback)(
+            struct whisper_context * ctx,
+              struct whisper_state * state,
+ const struct whisper_window_stats * stats,
+      struct whisper_window_tuning * tuning,
+                              void * user_data);
+
+    // Encoder output cache
+    // If not NULL, called before a window is encoded with a 64-bit hash of the encoder's
+    // input (the window's normalized log mel frames and its audio context). Returning true
+    // means embd now holds the encoder output for that input, n_values floats, and the
+    // conv and encoder graphs are skipped; only the cross-attention projection runs.
+    typedef bool (*whisper_encoder_cache_lookup_callback)(uint64_t key, float * embd, size_t n_values, void * user_data);
+
+    // If not NULL, called with the output of every window the encoder computed
+    typedef void (*whisper_encoder_cache_store_callback)(uint64_t key, const float * embd, size_t n_values, void * user_data);
+
     // Logits filter callback
     // Can be used to modify the logits before sampling
     // If not NULL, called after applying temperature to logits
@@ -510,7 +600,17 @@ extern "C" {
         // [EXPERIMENTAL] speed-up techniques
         // note: these can significantly reduce the quality of the output
         bool debug_mode;        // enable debug_mode provides extra info (eg. Dump log_mel)
-        int  audio_ctx;         // overwrite the audio context size (0 = use default)
+        int  audio_ctx;         // overwrite the audio context size (0 = use default); a window then covers
+                                // 2*audio_ctx frames (audio_ctx/50 s) instead of 30 s
+        bool audio_ctx_auto;    // size the audio context of each window to the audio in it, rounded up to a
+                                // multiple of 256 (5.12 s); audio_ctx, if set, is the upper bound
+
+        // [EXPERIMENTAL] encoder pipelining
+        // while a window is decoded, spec_encode_state (a second state of the same context) encodes the
+        // next full window on spec_encode_n_threads more threads; it is used if the decoder advances by
+        // exactly one window and discarded otherwise. An encode that was not speculated uses both thread counts
+        struct whisper_state * spec_encode_state;
+        int  spec_encode_n_threads;
 
         // [EXPERIMENTAL] [TDRZ] tinydiarize
         bool tdrz_enable;       // enable tinydiarize speaker turn detection
@@ -575,6 +675,16 @@ extern "C" {
         whisper_logits_filter_callback logits_filter_callback;
         void * logits_filter_callback_user_data;
 
+        // called after each window is decoded
+        whisper_window_callback window_callback;
+        void * window_callback_user_data;
+
+        // encoder output cache; with spec_encode_state the callbacks are also
+        // called from the thread of the speculative encode
+        whisper_encoder_cache_lookup_callback encoder_cache_lookup;
+        whisper_encoder_cache_store_callback  encoder_cache_store;
+        void * encoder_cache_user_data;
+
         const whisper_grammar_element ** grammar_rules;
         size_t                           n_grammar_rules;
         size_t                           i_start_rule;
@@ -717,6 +827,49 @@ extern "C" {
 
     ////////////////////////////////////////////////////////////////////////////
 
+    // Process-wide threading hooks, so the embedding runtime can keep its
+    // threads alive between jobs instead of creating them per graph / per call.
+
+    // Runs task(ith, arg) for ith in [0, n_tasks) and returns when all are done.
+    typedef void (*whisper_parallel_task_fn)(int ith, void * arg);
+    typedef void (*whisper_parallel_for_fn)(int n_tasks, whisper_parallel_task_fn task, void * arg, void * user_data);
+
+    // Used by the mel spectrogram and the decoders' sampling. Without one (NULL)
+    // they run on the calling thread.
+    WHISPER_API void whisper_set_parallel_for(whisper_parallel_for_fn fn, void * user_data);
+
+    // Starts task(0, arg) on another thread and returns a handle to pass to wait,
+    // which returns once the task has run (running it itself if it has not started).
+    typedef void * (*whisper_task_start_fn)(whisper_parallel_task_fn task, void * arg, void * user_data);
+    typedef void (*whisper_task_wait_fn)(void * handle, void * user_data);
+
+    // Runs the speculative encode of the next window (spec_encode_state), which
+    // is off without one (NULL).
+    WHISPER_API void whisper_set_task_runner(whisper_task_start_fn start, whisper_task_wait_fn wait, void * user_data);
+
+    // Lends a persistent ggml CPU threadpool of at least n_threads threads for
+    // one graph compute (encoder, decoder and VAD graphs); release is called
+    // after the compute. States computing at the same time each need a pool of
+    // their own. acquire may return NULL, in which case ggml uses a disposable
+    // threadpool for that graph.
+    typedef struct ggml_threadpool * (*whisper_threadpool_acquire_fn)(int n_threads, void * user_data);
+    typedef void (*whisper_threadpool_release_fn)(struct ggml_threadpool * threadpool, void * user_data);
+
+    WHISPER_API void whisper_set_threadpool_provider(
+            whisper_threadpool_acquire_fn acquire,
+            whisper_threadpool_release_fn release,
+                                   void * user_data);
+
+    // Process-wide storage of full spectrograms (whisper_pcm_to_mel, whisper_set_mel,
+    // whisper_set_mel_frames_with_state, whisper_mel_stream) in half precision, which halves their memory. The encoder
+    // converts each window back to float; models with f16 convolution weights round
+    // their input to half precision anyway. whisper_full on samples computes its
+    // spectrogram a window at a time and stores none, so it is not affected.
+    // A stream keeps the setting it was created with.
+    WHISPER_API void whisper_set_mel_f16(bool enable);
+
+    ////////////////////////////////////////////////////////////////////////////
+
     // Temporary helpers needed for exposing ggml interface
 
     WHISPER_API int          whisper_bench_memcpy          (int n_threads);
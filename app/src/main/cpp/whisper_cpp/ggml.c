@@ -1,38 +0,0 @@
-// Minimal placeholder ggml.c for whisper.cpp compilation
-#include "ggml.h"
-#include <stdio.h> // For printf
-#include <stdlib.h> // For malloc/free if used
-
-// Example implementation of a placeholder function
-struct ggml_context * ggml_init(struct ggml_init_params params) {
-    // In a real ggml library, params would be used to manage memory.
-    printf("GGML.C: ggml_init called (placeholder)\n");
-    struct ggml_context* ctx = (struct ggml_context*)malloc(sizeof(struct ggml_context));
-    if (!ctx) {
-        return NULL;
-    }
-    // initialize context fields using provided parameters
-    ctx->mem_buffer = params.mem_buffer;
-    ctx->mem_size   = params.mem_size;
-    // ignore params.no_alloc in this simplified placeholder
-    return ctx;
-}
-
-void ggml_free(struct ggml_context * ctx) {
-    printf("GGML.C: ggml_free called (placeholder)\n");
-    if (ctx) {
-        free(ctx);
-    }
-}
-
-// Add implementations for any other functions declared in ggml.h
-// that whisper.cpp might call. These will mostly be stubs.
-// For example:
-// struct ggml_tensor * ggml_new_tensor_1d(struct ggml_context * ctx, enum ggml_type type, int64_t ne0) {
-//     printf("GGML.C: ggml_new_tensor_1d called (placeholder)\n");
-//     // Allocate and return a dummy tensor
-//     return NULL; // Placeholder
-// }
-
-// This file would contain the actual low-level tensor operations in a real ggml library.
-// For this subtask, it's primarily to satisfy the linker for whisper.cpp.
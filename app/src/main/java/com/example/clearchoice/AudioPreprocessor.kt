@@ -1,6 +1,7 @@
 package com.example.clearchoice
 
 import android.content.Context
+import android.media.AudioFormat
 import android.media.MediaCodec
 import android.media.MediaExtractor
 import android.media.MediaFormat
@@ -8,7 +9,9 @@ import android.util.Log
 import java.io.File
 import java.io.FileOutputStream
 import java.io.IOException
+import java.io.RandomAccessFile
 import java.nio.ByteBuffer
+import java.nio.ByteOrder
 
 class AudioPreprocessor {
 
@@ -17,19 +20,28 @@ class AudioPreprocessor {
         private const val TARGET_SAMPLE_RATE = 16000
         private const val TARGET_CHANNEL_COUNT = 1 // Mono
         private const val TIMEOUT_US = 10000L
+        private const val WAV_HEADER_SIZE = 44
+    }
+
+    /** Receives decoded PCM from [decode]. Returning false from either call aborts decoding. */
+    interface PcmSink {
+        /** Called once, before the first [onPcm], with the decoder's actual output format. */
+        fun onFormat(sampleRate: Int, channelCount: Int, pcmEncoding: Int): Boolean
+
+        /**
+         * Called for every decoded output buffer. [buffer] is MediaCodec's buffer (normally direct)
+         * and is only valid for the duration of the call; the PCM is at [offset] until offset + [size].
+         */
+        fun onPcm(buffer: ByteBuffer, offset: Int, size: Int): Boolean
     }
 
     /**
-     * Preprocesses an input audio file to raw PCM format (16kHz, 16-bit, mono).
+     * Decodes the audio track of [inputFile] with MediaCodec and hands the raw PCM to [sink]
+     * buffer by buffer, without touching the filesystem.
      *
-     * @param context Context (not used currently but good practice).
-     * @param inputFile The input audio file (e.g., audio.mp4).
-     * @param outputFile The file where the raw PCM data should be written.
-     * @return True if preprocessing was successful, false otherwise.
+     * @return True if the whole track was decoded and accepted by the sink, false otherwise.
      */
-    fun preprocessAudio(context: Context, inputFile: File, outputFile: File): Boolean {
-        Log.d(TAG, "Starting preprocessing for: ${inputFile.absolutePath} -> ${outputFile.absolutePath}")
-
+    fun decode(inputFile: File, sink: PcmSink): Boolean {
         if (!inputFile.exists()) {
             Log.e(TAG, "Input file does not exist: ${inputFile.absolutePath}")
             return false
@@ -37,7 +49,6 @@ class AudioPreprocessor {
 
         var mediaExtractor: MediaExtractor? = null
         var mediaCodec: MediaCodec? = null
-        var fos: FileOutputStream? = null
 
         try {
             mediaExtractor = MediaExtractor()
@@ -63,34 +74,18 @@ class AudioPreprocessor {
             mediaExtractor.selectTrack(audioTrackIndex)
             val mimeType = inputFormat.getString(MediaFormat.KEY_MIME) ?: "audio/mp4a-latm" // Default if null
 
-            // --- Configure MediaCodec for desired output format if possible ---
-            // We want 16kHz mono. MediaCodec might not always be able to output this directly.
-            // The actual output format will be available in MediaCodec.getOutputFormat() after configuration.
-            val outputFormat = MediaFormat.createAudioFormat(
-                MediaFormat.MIMETYPE_AUDIO_RAW, // We want raw PCM
-                TARGET_SAMPLE_RATE,
-                TARGET_CHANNEL_COUNT
-            )
-            // It's important to set KEY_PCM_ENCODING if creating a format for an encoder,
-            // but for a decoder outputting raw audio, the system determines this.
-            // We'll check the actual output format later.
-            // outputFormat.setInteger(MediaFormat.KEY_PCM_ENCODING, AudioFormat.ENCODING_PCM_16BIT);
-
-
+            // The decoder outputs raw PCM in whatever rate/channel layout the stream has;
+            // the actual format is reported to the sink and converted natively.
             mediaCodec = MediaCodec.createDecoderByType(mimeType)
-            // Try to configure with inputFormat. The decoder will output raw PCM.
             mediaCodec.configure(inputFormat, null, null, 0)
             mediaCodec.start()
 
-            fos = FileOutputStream(outputFile)
             val bufferInfo = MediaCodec.BufferInfo()
             var allInputEOS = false
             var allOutputEOS = false
+            var formatReported = false
 
             Log.d(TAG, "Initial input format: $inputFormat")
-            // Actual output format from the decoder
-            var actualOutputFormat: MediaFormat? = null
-
 
             while (!allOutputEOS) {
                 // Feed input data
@@ -122,64 +117,46 @@ class AudioPreprocessor {
                     if (bufferInfo.size > 0) {
                         val outputBuffer = mediaCodec.getOutputBuffer(outputBufferIndex)
                         if (outputBuffer != null) {
-                            // At this point, outputBuffer contains raw PCM data.
-                            // We need to check its format (sample rate, channel count, bit depth)
-                            // and convert if necessary.
-                            if (actualOutputFormat == null) {
-                                actualOutputFormat = mediaCodec.getOutputFormat()
-                                Log.d(TAG, "Actual output format from MediaCodec: $actualOutputFormat")
-                                // TODO: Check actualOutputFormat's sample rate, channel count, and PCM encoding.
-                                // If not TARGET_SAMPLE_RATE or TARGET_CHANNEL_COUNT or 16-bit, resampling/mixing is needed.
-                                // This is the complex part. For this subtask, we'll write what we get and log.
-                                // If actualOutputFormat.getInteger(MediaFormat.KEY_SAMPLE_RATE) != TARGET_SAMPLE_RATE etc.
+                            if (!formatReported) {
+                                if (!reportFormat(mediaCodec.outputFormat, sink)) {
+                                    mediaCodec.releaseOutputBuffer(outputBufferIndex, false)
+                                    return false
+                                }
+                                formatReported = true
+                            }
+                            if (!sink.onPcm(outputBuffer, bufferInfo.offset, bufferInfo.size)) {
+                                Log.e(TAG, "PCM sink rejected decoded buffer.")
+                                mediaCodec.releaseOutputBuffer(outputBufferIndex, false)
+                                return false
                             }
-
-                            val pcmChunk = ByteArray(bufferInfo.size)
-                            outputBuffer.get(pcmChunk)
-                            outputBuffer.clear() // Needed for older APIs? Or just position reset.
-                            fos.write(pcmChunk)
                         }
                     }
                     mediaCodec.releaseOutputBuffer(outputBufferIndex, false)
                 } else if (outputBufferIndex == MediaCodec.INFO_OUTPUT_FORMAT_CHANGED) {
-                    actualOutputFormat = mediaCodec.getOutputFormat()
-                    Log.d(TAG, "Output format changed to: $actualOutputFormat")
-                    // This is where we'd get the definitive format of the raw PCM output.
+                    Log.d(TAG, "Output format changed to: ${mediaCodec.outputFormat}")
+                    if (formatReported) {
+                        Log.w(TAG, "Decoder changed format mid-stream; keeping the format reported first.")
+                    }
                 } else if (outputBufferIndex == MediaCodec.INFO_TRY_AGAIN_LATER) {
                     // No output available yet
                 }
             }
 
-            if (actualOutputFormat != null) {
-                val finalSampleRate = actualOutputFormat.getInteger(MediaFormat.KEY_SAMPLE_RATE)
-                val finalChannelCount = actualOutputFormat.getInteger(MediaFormat.KEY_CHANNEL_COUNT)
-                // Assuming default is 16-bit (ENCODING_PCM_16BIT) for raw audio from MediaCodec.
-                // This might need explicit checking via MediaFormat.KEY_PCM_ENCODING if available.
-                 Log.i(TAG, "Final PCM data characteristics: Sample Rate: $finalSampleRate, Channels: $finalChannelCount (Assumed 16-bit)")
-                if (finalSampleRate != TARGET_SAMPLE_RATE || finalChannelCount != TARGET_CHANNEL_COUNT) {
-                    Log.w(TAG, "PCM output properties ($finalSampleRate Hz, $finalChannelCount ch) " +
-                               "do not match target ($TARGET_SAMPLE_RATE Hz, $TARGET_CHANNEL_COUNT ch). " +
-                               "Resampling/mixing would be needed for optimal whisper.cpp performance.")
-                    // For this subtask, we proceed with the data as-is.
-                    // Real whisper.cpp might handle some resampling, or it might fail/perform poorly.
-                }
-            } else {
-                 Log.w(TAG, "Could not determine actual output format. PCM data might not be as expected.")
+            if (!formatReported) {
+                Log.e(TAG, "Decoder produced no audio.")
+                return false
             }
-
-
-            Log.d(TAG, "Successfully preprocessed audio to: ${outputFile.absolutePath}")
             return true
 
         } catch (e: IOException) {
-            Log.e(TAG, "IOException during preprocessing", e)
+            Log.e(TAG, "IOException during decoding", e)
             return false
         } catch (e: IllegalStateException) {
-            Log.e(TAG, "IllegalStateException during preprocessing (MediaCodec state issue?)", e)
+            Log.e(TAG, "IllegalStateException during decoding (MediaCodec state issue?)", e)
             return false
         } catch (e: Exception) {
             // Catch any other unexpected errors
-            Log.e(TAG, "Unexpected error during preprocessing", e)
+            Log.e(TAG, "Unexpected error during decoding", e)
             return false
         }
         finally {
@@ -192,9 +169,125 @@ class AudioPreprocessor {
             try {
                 mediaCodec?.release()
             } catch (e: Exception) { Log.e(TAG, "Error releasing MediaCodec", e) }
-            try {
-                fos?.close()
-            } catch (e: IOException) { Log.e(TAG, "Error closing FileOutputStream", e) }
+        }
+    }
+
+    private fun reportFormat(outputFormat: MediaFormat, sink: PcmSink): Boolean {
+        val sampleRate = outputFormat.getInteger(MediaFormat.KEY_SAMPLE_RATE)
+        val channelCount = outputFormat.getInteger(MediaFormat.KEY_CHANNEL_COUNT)
+        // Decoders output 16-bit PCM unless they report another encoding
+        val pcmEncoding = if (outputFormat.containsKey(MediaFormat.KEY_PCM_ENCODING)) {
+            outputFormat.getInteger(MediaFormat.KEY_PCM_ENCODING)
+        } else {
+            AudioFormat.ENCODING_PCM_16BIT
+        }
+        Log.i(TAG, "Decoded PCM characteristics: Sample Rate: $sampleRate, Channels: $channelCount, Encoding: $pcmEncoding")
+        if (sampleRate != TARGET_SAMPLE_RATE || channelCount != TARGET_CHANNEL_COUNT) {
+            Log.d(TAG, "PCM is $sampleRate Hz, $channelCount ch; native code converts to $TARGET_SAMPLE_RATE Hz mono.")
+        }
+        return sink.onFormat(sampleRate, channelCount, pcmEncoding)
+    }
+
+    /**
+     * Preprocesses an input audio file to a PCM WAV file.
+     *
+     * The WAV header records the format the decoder actually produced (sample rate,
+     * channel count, 16-bit or float samples), so the native loader does not have to
+     * assume 16kHz 16-bit mono. Prefer [decode] with a native PCM stream when the
+     * file itself is not needed.
+     *
+     * @param context Context (not used currently but good practice).
+     * @param inputFile The input audio file (e.g., audio.mp4).
+     * @param outputFile The file where the WAV data should be written.
+     * @return True if preprocessing was successful, false otherwise.
+     */
+    fun preprocessAudio(context: Context, inputFile: File, outputFile: File): Boolean {
+        Log.d(TAG, "Starting preprocessing for: ${inputFile.absolutePath} -> ${outputFile.absolutePath}")
+
+        try {
+            FileOutputStream(outputFile).use { fos ->
+                val channel = fos.channel
+                fos.write(ByteArray(WAV_HEADER_SIZE)) // placeholder, patched once the format and size are known
+                var pcmBytesWritten = 0L
+                var wavSampleRate = TARGET_SAMPLE_RATE
+                var wavChannelCount = TARGET_CHANNEL_COUNT
+                var wavPcmEncoding = AudioFormat.ENCODING_PCM_16BIT
+
+                val decoded = decode(inputFile, object : PcmSink {
+                    override fun onFormat(sampleRate: Int, channelCount: Int, pcmEncoding: Int): Boolean {
+                        wavSampleRate = sampleRate
+                        wavChannelCount = channelCount
+                        wavPcmEncoding = pcmEncoding
+                        return true
+                    }
+
+                    override fun onPcm(buffer: ByteBuffer, offset: Int, size: Int): Boolean {
+                        buffer.limit(offset + size)
+                        buffer.position(offset)
+                        while (buffer.hasRemaining()) {
+                            channel.write(buffer)
+                        }
+                        pcmBytesWritten += size
+                        return true
+                    }
+                })
+                if (!decoded) {
+                    return false
+                }
+                fos.flush()
+                if (!writeWavHeader(outputFile, wavSampleRate, wavChannelCount, wavPcmEncoding, pcmBytesWritten)) {
+                    return false
+                }
+            }
+        } catch (e: IOException) {
+            Log.e(TAG, "IOException during preprocessing", e)
+            return false
+        }
+
+        Log.d(TAG, "Successfully preprocessed audio to: ${outputFile.absolutePath}")
+        return true
+    }
+
+    /**
+     * Overwrites the placeholder at the start of [file] with a canonical 44-byte WAV header.
+     * Only 16-bit integer and 32-bit float PCM are written; other encodings are rejected.
+     */
+    private fun writeWavHeader(file: File, sampleRate: Int, channelCount: Int, pcmEncoding: Int, dataSize: Long): Boolean {
+        val (formatTag, bitsPerSample) = when (pcmEncoding) {
+            AudioFormat.ENCODING_PCM_16BIT -> Pair(1, 16)
+            AudioFormat.ENCODING_PCM_FLOAT -> Pair(3, 32)
+            else -> {
+                Log.e(TAG, "Unsupported decoder PCM encoding: $pcmEncoding")
+                return false
+            }
+        }
+        val blockAlign = channelCount * bitsPerSample / 8
+        val dataSize32 = dataSize.coerceAtMost(0xFFFFFFFFL - 36).toInt()
+
+        val header = ByteBuffer.allocate(WAV_HEADER_SIZE).order(ByteOrder.LITTLE_ENDIAN)
+        header.put("RIFF".toByteArray(Charsets.US_ASCII))
+        header.putInt(36 + dataSize32)
+        header.put("WAVE".toByteArray(Charsets.US_ASCII))
+        header.put("fmt ".toByteArray(Charsets.US_ASCII))
+        header.putInt(16)
+        header.putShort(formatTag.toShort())
+        header.putShort(channelCount.toShort())
+        header.putInt(sampleRate)
+        header.putInt(sampleRate * blockAlign)
+        header.putShort(blockAlign.toShort())
+        header.putShort(bitsPerSample.toShort())
+        header.put("data".toByteArray(Charsets.US_ASCII))
+        header.putInt(dataSize32)
+
+        return try {
+            RandomAccessFile(file, "rw").use { raf ->
+                raf.seek(0)
+                raf.write(header.array())
+            }
+            true
+        } catch (e: IOException) {
+            Log.e(TAG, "Failed to write WAV header", e)
+            false
         }
     }
 }
@@ -6,6 +6,8 @@ import java.io.File
 
 class DiarizationService {
 
+    private val audioPreprocessor = AudioPreprocessor()
+
     init {
         try {
             System.loadLibrary("native-lib") // Assumes jni_diarization_bridge.cpp is part of native-lib
@@ -24,48 +26,59 @@ class DiarizationService {
      */
     private external fun diarizeAudio(audioPath: String): String?
 
+    /** Same as [diarizeAudio] over a [NativeAudioCache] handle, which stays owned by the caller. */
+    private external fun diarizeDecodedAudio(audioPtr: Long, jobPtr: Long): String?
+
     /**
      * Orchestrates the diarization process.
-     * For this placeholder version, it directly calls the native method.
-     * A real implementation might involve audio preprocessing if the native engine requires a specific format.
+     * The audio is decoded through [NativeAudioCache], so when the session was just
+     * transcribed the already-decoded 16kHz mono buffer is reused.
      *
      * @param context The application context.
      * @param sessionFolder The folder where output files (like speakers.json) might be stored.
      * @param audioFile The input audio file (e.g., audio.mp4).
+     * @param job Cancels decoding and the native pass; a cancelled run yields `{"error": "Cancelled."}` or null.
      * @param callback Invoked with the diarization result (JSON string) or null on failure.
      */
     fun runDiarization(
         context: Context, // Not used in placeholder but good for consistency
         sessionFolder: File, // Not used directly by native placeholder but good for consistency
         audioFile: File,
+        job: NativeJob? = null,
         callback: (diarizationJson: String?) -> Unit
     ) {
         Log.d(TAG, "Starting diarization process for audio: ${audioFile.name}")
 
-        // Step 1: (Optional) Audio Preprocessing
-        // If the native diarization engine required a specific audio format (e.g., raw PCM),
-        // preprocessing would happen here, similar to WhisperService.
-        // For this placeholder, we assume the native function can handle the input audioPath directly
-        // or that it's a placeholder that doesn't actually process audio.
-        Log.d(TAG, "Audio preprocessing for diarization skipped for placeholder.")
+        // Step 1: Decode audio natively, or reuse it if transcription already decoded this file
+        val audioPtr = try {
+            NativeAudioCache.acquire(audioFile, audioPreprocessor, job)
+        } catch (e: UnsatisfiedLinkError) {
+            Log.e(TAG, "Native method call failed (UnsatisfiedLinkError). Is native-lib loaded?", e)
+            0L
+        }
+        if (audioPtr == 0L) {
+            Log.e(TAG, "Audio decoding failed. Aborting diarization.")
+            callback(null)
+            return
+        }
 
         // Step 2: Call native JNI function for diarization
         var diarizationResult: String? = null
         try {
-            Log.d(TAG, "Calling native diarizeAudio function with path: ${audioFile.absolutePath}")
-            diarizationResult = diarizeAudio(audioFile.absolutePath)
-            Log.i(TAG, "Native diarization returned: $diarizationResult")
+            Log.d(TAG, "Calling native diarizeDecodedAudio function for: ${audioFile.absolutePath}")
+            diarizationResult = diarizeDecodedAudio(audioPtr, job?.nativeHandle ?: 0L)
+            Log.i(TAG, "Native diarization returned ${diarizationResult?.length ?: 0} characters")
         } catch (e: UnsatisfiedLinkError) {
             Log.e(TAG, "Native method call failed (UnsatisfiedLinkError). Is native-lib loaded and function signature correct?", e)
             diarizationResult = "Error: Native library link error for diarization."
         } catch (e: Exception) {
-            Log.e(TAG, "Exception during native diarizeAudio call", e)
+            Log.e(TAG, "Exception during native diarizeDecodedAudio call", e)
             diarizationResult = "Error: Exception during diarization native call."
+        } finally {
+            // Step 3: Drop our reference; the audio stays cached until evicted
+            NativeAudioCache.releaseAudio(audioPtr)
         }
 
-        // Step 3: (Optional) Clean up temporary files if any were created.
-        // Not applicable for this placeholder.
-
         // Step 4: Invoke callback with the result
         callback(diarizationResult)
     }
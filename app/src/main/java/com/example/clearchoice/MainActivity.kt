@@ -93,6 +93,15 @@ class MainActivity : AppCompatActivity() {
         outState.putBoolean("uiSetupDone", uiSetupDone)
     }
 
+    override fun onDestroy() {
+        if (isFinishing) {
+            // The whisper model and decoded session audio stay resident across sessions; free them when the app is closed
+            WhisperService().release(applicationContext)
+            NativeAudioCache.clear()
+        }
+        super.onDestroy()
+    }
+
 
     private fun showBiometricPrompt() {
         val callback = object : BiometricPrompt.AuthenticationCallback() {
@@ -0,0 +1,110 @@
+package com.example.clearchoice
+
+import android.util.Log
+import java.io.File
+import java.nio.ByteBuffer
+import java.util.concurrent.ConcurrentHashMap
+
+/**
+ * Process-wide cache of decoded session audio, held natively as 16kHz mono float.
+ *
+ * Entries are keyed by file path, size and modification time and evicted LRU once
+ * the memory budget is exceeded. Transcription and diarization of the same session
+ * both go through [acquire], so the audio is decoded and converted once.
+ */
+object NativeAudioCache {
+
+    private const val TAG = "NativeAudioCache"
+
+    init {
+        try {
+            System.loadLibrary("native-lib")
+        } catch (e: UnsatisfiedLinkError) {
+            Log.e(TAG, "Failed to load native-lib", e)
+        }
+    }
+
+    // Audio handles are native references to the decoded buffer; free each with releaseAudio.
+    private external fun lookup(sourcePath: String): Long
+    private external fun pcmStreamBegin(sampleRate: Int, channels: Int, encoding: Int): Long
+    private external fun pushPcm(streamPtr: Long, pcm: ByteBuffer, offset: Int, size: Int): Boolean
+    private external fun pcmStreamPublish(streamPtr: Long, sourcePath: String): Long
+    private external fun pcmStreamRelease(streamPtr: Long)
+
+    /** Frees a handle returned by [acquire]. The audio stays cached until evicted. */
+    external fun releaseAudio(audioPtr: Long)
+
+    /** Memory budget for cached audio (default 256 MiB); 0 disables caching. */
+    external fun setBudgetBytes(bytes: Long)
+
+    /** Drops all cached audio; handles still held stay valid. */
+    external fun clear()
+
+    // Callers decoding the same file wait for each other instead of decoding twice
+    private val decodeLocks = ConcurrentHashMap<String, Any>()
+
+    /** Feeds decoder output buffers into a native PCM stream. */
+    private class NativePcmSink(private val job: NativeJob?) : AudioPreprocessor.PcmSink {
+        var streamPtr = 0L
+            private set
+        private var scratch: ByteBuffer? = null
+
+        override fun onFormat(sampleRate: Int, channelCount: Int, pcmEncoding: Int): Boolean {
+            streamPtr = pcmStreamBegin(sampleRate, channelCount, pcmEncoding)
+            return streamPtr != 0L
+        }
+
+        override fun onPcm(buffer: ByteBuffer, offset: Int, size: Int): Boolean {
+            if (job?.isCancelled == true) {
+                return false // stops the decoder; nothing is published
+            }
+            if (buffer.isDirect) {
+                return pushPcm(streamPtr, buffer, offset, size)
+            }
+            // Heap buffers cannot be read natively; copy through a reusable direct buffer
+            val direct = scratch?.takeIf { it.capacity() >= size } ?: ByteBuffer.allocateDirect(size).also { scratch = it }
+            direct.clear()
+            val src = buffer.duplicate()
+            src.limit(offset + size)
+            src.position(offset)
+            direct.put(src)
+            return pushPcm(streamPtr, direct, 0, size)
+        }
+
+        fun release() {
+            if (streamPtr != 0L) {
+                pcmStreamRelease(streamPtr)
+                streamPtr = 0L
+            }
+        }
+    }
+
+    /**
+     * Returns a handle to the decoded audio of [audioFile], decoding it with
+     * [preprocessor] only if it is not cached yet. Returns 0 on failure or if [job] is
+     * cancelled while decoding.
+     */
+    fun acquire(audioFile: File, preprocessor: AudioPreprocessor, job: NativeJob? = null): Long {
+        val path = audioFile.absolutePath
+        val lock = decodeLocks.getOrPut(path) { Any() }
+        synchronized(lock) {
+            val cached = lookup(path)
+            if (cached != 0L) {
+                Log.d(TAG, "Reusing decoded audio for ${audioFile.name}")
+                return cached
+            }
+
+            Log.d(TAG, "Decoding ${audioFile.name} into native PCM stream...")
+            val sink = NativePcmSink(job)
+            try {
+                if (!preprocessor.decode(audioFile, sink) || sink.streamPtr == 0L) {
+                    Log.e(TAG, "Audio decoding failed for ${audioFile.name}")
+                    return 0L
+                }
+                return pcmStreamPublish(sink.streamPtr, path)
+            } finally {
+                sink.release()
+            }
+        }
+    }
+}
@@ -0,0 +1,73 @@
+package com.example.clearchoice
+
+import android.util.Log
+import java.io.Closeable
+import java.util.Collections
+import java.util.concurrent.ConcurrentHashMap
+
+/**
+ * Cancellation token for one native transcription or diarization job
+ * (engine_module/cancellation.h).
+ *
+ * Pass it to a WhisperService / DiarizationService call; [cancel] may then be called
+ * from any thread and the native job stops within one decoder step, returning an
+ * error instead of a result. [close] the job once the call has returned.
+ */
+class NativeJob : Closeable {
+
+    private var handle: Long = nativeCreate()
+
+    @Volatile
+    var isCancelled = false
+        private set
+
+    init {
+        active.add(this)
+    }
+
+    /** Native token for the JNI calls; 0 once closed. */
+    internal val nativeHandle: Long
+        @Synchronized get() = handle
+
+    @Synchronized
+    fun cancel() {
+        if (isCancelled) return
+        isCancelled = true
+        if (handle != 0L) {
+            Log.d(TAG, "Cancelling native job")
+            nativeCancel(handle)
+        }
+    }
+
+    @Synchronized
+    override fun close() {
+        active.remove(this)
+        if (handle != 0L) {
+            nativeRelease(handle)
+            handle = 0L
+        }
+    }
+
+    companion object {
+        private const val TAG = "NativeJob"
+
+        private val active: MutableSet<NativeJob> = Collections.newSetFromMap(ConcurrentHashMap())
+
+        init {
+            try {
+                System.loadLibrary("native-lib")
+            } catch (e: UnsatisfiedLinkError) {
+                Log.e(TAG, "Failed to load native-lib", e)
+            }
+        }
+
+        @JvmStatic private external fun nativeCreate(): Long
+        @JvmStatic private external fun nativeCancel(handle: Long)
+        @JvmStatic private external fun nativeRelease(handle: Long)
+
+        /** Cancels every job that has not been closed yet, e.g. when a new recording starts. */
+        fun cancelAll() {
+            active.toList().forEach { it.cancel() }
+        }
+    }
+}
@@ -63,6 +63,8 @@ class RecordFragment : Fragment() {
                     buttonRecord.text = getString(R.string.record_button_stop)
                     textViewStatus.text = getString(R.string.record_status_recording)
                     Log.d(TAG, "Simulated recording started.")
+                    // Background transcription would compete with the recorder for CPU
+                    NativeJob.cancelAll()
                     // Actual recording logic will be added later
                 } else {
                     requestRecordAudioPermission()
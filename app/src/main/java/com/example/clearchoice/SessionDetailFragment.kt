@@ -60,6 +60,8 @@ class SessionDetailFragment : Fragment() {
     private lateinit var diarizationService: DiarizationService
     private lateinit var exportService: ExportService
     private var currentSessionFolderFile: File? = null
+    // Native transcription/diarization runs of this screen; cancelled when the view goes away
+    private val nativeJobs = mutableSetOf<NativeJob>()
 
     private val speakerColors = listOf(
         Color.parseColor("#1F77B4"), Color.parseColor("#FF7F0E"),
@@ -337,9 +339,10 @@ class SessionDetailFragment : Fragment() {
         textViewDiarizationStatus.text = getString(R.string.session_detail_diarization_status_in_progress)
         listOf(buttonTranscribe, buttonRedact, buttonExport).forEach { it.isEnabled = false }
         viewLifecycleOwner.lifecycleScope.launch {
+            val job = NativeJob().also { nativeJobs.add(it) }
             var diarizationJson: String? = null
             try {
-                withContext(Dispatchers.IO) { diarizationService.runDiarization(requireContext(), currentSessionFolderFile!!, audioFile) { result -> diarizationJson = result } }
+                withContext(Dispatchers.IO) { diarizationService.runDiarization(requireContext(), currentSessionFolderFile!!, audioFile, job) { result -> diarizationJson = result } }
                 if (diarizationJson != null && diarizationJson!!.isNotBlank() && !diarizationJson!!.startsWith("Error:")) {
                     val successWriting = currentSessionFolderFile?.let { sessionManager.writeFileContent(it, SessionManager.SPEAKERS_FILE_NAME, diarizationJson!!) } ?: false
                     if(successWriting) {
@@ -356,7 +359,10 @@ class SessionDetailFragment : Fragment() {
             } catch (e: Exception) {
                 textViewDiarizationStatus.text = getString(R.string.session_detail_diarization_status_error_exception)
                 updateMetadata(hasDiarization = false)
-            } finally { val currentMeta = readMetadataForCurrentSession(); updateAllButtonStates(currentMeta) }
+            } finally {
+                nativeJobs.remove(job); job.close()
+                val currentMeta = readMetadataForCurrentSession(); updateAllButtonStates(currentMeta)
+            }
         }
     }
     private fun handleRedaction() { /* ... same, but use SessionManager constants for filenames ... */
@@ -391,23 +397,65 @@ class SessionDetailFragment : Fragment() {
         listOf(buttonRedact, buttonDiarize, buttonExport).forEach { it.isEnabled = false }
         textViewRedactionStatus.text = getString(R.string.session_detail_redaction_status_needs_transcript)
         textViewDiarizationStatus.text = getString(R.string.session_detail_diarization_status_transcription_in_progress)
+        textViewTranscriptionStatus.text = getString(R.string.session_detail_transcription_status_in_progress)
+        textViewTranscript.text = "" // filled live by LiveTranscriptListener
 
         viewLifecycleOwner.lifecycleScope.launch {
-            var transcriptResult: String? = null
+            val job = NativeJob().also { nativeJobs.add(it) }
+            var sessionJson: String? = null
             try {
-                withContext(Dispatchers.IO) { whisperService.runTranscription(requireContext(), currentSessionFolderFile!!, audioFile) { transcript -> transcriptResult = transcript } }
-                if (transcriptResult != null && transcriptResult!!.isNotBlank() && !transcriptResult!!.startsWith("Error:")) {
-                    val successWriting = saveTranscriptToFile(transcriptResult!!) // saveTranscriptToFile uses SessionManager constant
-                    if(successWriting) updateMetadata(hasTranscript = true, hasRedacted = false)
+                // One native pass produces both the transcript and the speaker segments
+                val liveTranscript = LiveTranscriptListener()
+                withContext(Dispatchers.IO) { whisperService.runTranscriptionWithSpeakers(requireContext(), currentSessionFolderFile!!, audioFile, { result -> sessionJson = result }, liveTranscript, job) }
+                val session = sessionJson?.let { parseSessionResult(it) }
+                if (session != null && session.first.isNotBlank()) {
+                    val successWriting = saveTranscriptToFile(session.first) // saveTranscriptToFile uses SessionManager constant
+                    val speakersWritten = successWriting && currentSessionFolderFile?.let { sessionManager.writeFileContent(it, SessionManager.SPEAKERS_FILE_NAME, session.second) } == true
+                    if(successWriting) updateMetadata(hasTranscript = true, hasRedacted = false, hasDiarization = speakersWritten)
                     else updateMetadata(hasTranscript = false, hasRedacted = false, hasDiarization = readMetadataForCurrentSession()?.has_diarization ?: false)
                 } else {
                     updateMetadata(hasTranscript = false, hasRedacted = false, hasDiarization = readMetadataForCurrentSession()?.has_diarization ?: false)
                 }
             } catch (e: Exception) {
                 updateMetadata(hasTranscript = false, hasRedacted = false, hasDiarization = readMetadataForCurrentSession()?.has_diarization ?: false)
-            } finally { buttonTranscribe.isEnabled = true } // updateMetadata calls displayTranscript which calls updateAllButtonStates
+            } finally {
+                nativeJobs.remove(job); job.close()
+                buttonTranscribe.isEnabled = true // updateMetadata calls displayTranscript which calls updateAllButtonStates
+            }
         }
     }
+    /**
+     * Shows segments in the transcript view as native code produces them, so the first
+     * lines appear within seconds. The final (speaker-coloured) transcript replaces them.
+     */
+    private inner class LiveTranscriptListener : TranscriptionListener {
+        override fun onSegments(startMs: IntArray, endMs: IntArray, texts: Array<String>) {
+            val text = texts.joinToString("")
+            textViewTranscript.post {
+                if (!isAdded) return@post
+                scrollViewTranscript.visibility = View.VISIBLE
+                textViewTranscript.append(text)
+            }
+        }
+
+        override fun onProgress(percent: Int) {
+            textViewTranscriptionStatus.post {
+                if (isAdded) textViewTranscriptionStatus.text = getString(R.string.session_detail_transcription_status_progress, percent)
+            }
+        }
+    }
+    /** Splits the native session JSON into (transcript, speakers.json content); null on error. */
+    private fun parseSessionResult(sessionJson: String): Pair<String, String>? {
+        return try {
+            val json = JSONObject(sessionJson)
+            if (json.has("error")) {
+                Log.e(TAG, "Native session pipeline failed: ${json.getString("error")}")
+                null
+            } else {
+                Pair(json.getString("transcript"), json.getJSONArray("segments").toString())
+            }
+        } catch (e: Exception) { Log.e(TAG, "Error parsing native session result", e); null }
+    }
     private fun saveTranscriptToFile(transcript: String) : Boolean {
          return currentSessionFolderFile?.let { folder ->
             sessionManager.writeFileContent(folder, SessionManager.TRANSCRIPT_FILE_NAME, transcript)
@@ -427,6 +475,11 @@ class SessionDetailFragment : Fragment() {
     private fun startPlayback() { /* ... same ... */ }
     private fun stopPlayback() { /* ... same ... */ }
     private fun releaseMediaPlayer() { /* ... same ... */ }
+    override fun onDestroyView() {
+        // Stop native work nobody will see; each run closes its job when the call returns
+        nativeJobs.forEach { it.cancel() }
+        super.onDestroyView()
+    }
     override fun onStop() { super.onStop(); if (isPlaying) { stopPlayback() } else { releaseMediaPlayer() } }
 
     companion object {
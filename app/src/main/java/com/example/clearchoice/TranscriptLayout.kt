@@ -0,0 +1,104 @@
+package com.example.clearchoice
+
+import java.io.Closeable
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+
+/**
+ * Zero-copy reader over the binary transcription result written by native code
+ * (engine_module/transcript_layout.h - keep the two in sync).
+ *
+ * The buffer wraps native memory: values are read in place and text is decoded
+ * only when asked for. [close] frees the native memory; the reader must not be
+ * used afterwards.
+ */
+class TranscriptLayout internal constructor(buffer: ByteBuffer) : Closeable {
+
+    private var buffer: ByteBuffer? = buffer.order(ByteOrder.LITTLE_ENDIAN)
+
+    val segmentCount: Int
+    val tokenCount: Int
+    private val textBytes: Int
+    private val segmentsOffset: Int
+    private val tokensOffset: Int
+    private val textOffset: Int
+
+    init {
+        require(buffer.isDirect && buffer.capacity() >= HEADER_SIZE) { "Not a transcript layout buffer" }
+        val b = buf()
+        segmentCount = b.getInt(8)
+        tokenCount = b.getInt(12)
+        textBytes = b.getInt(16)
+        segmentsOffset = b.getInt(20)
+        tokensOffset = b.getInt(24)
+        textOffset = b.getInt(28)
+        val problem = when {
+            b.getInt(0) != MAGIC -> "Bad transcript layout magic"
+            b.getInt(4) != VERSION -> "Unsupported transcript layout version ${b.getInt(4)}"
+            textOffset.toLong() + textBytes > b.capacity() -> "Truncated transcript layout"
+            else -> null
+        }
+        if (problem != null) {
+            close()
+            throw IllegalArgumentException(problem)
+        }
+    }
+
+    private external fun nativeFree(buffer: ByteBuffer)
+
+    private fun buf(): ByteBuffer = buffer ?: throw IllegalStateException("TranscriptLayout is closed")
+
+    private fun segment(i: Int): Int {
+        if (i !in 0 until segmentCount) throw IndexOutOfBoundsException("segment $i of $segmentCount")
+        return segmentsOffset + i * SEGMENT_SIZE
+    }
+
+    private fun token(i: Int): Int {
+        if (i !in 0 until tokenCount) throw IndexOutOfBoundsException("token $i of $tokenCount")
+        return tokensOffset + i * TOKEN_SIZE
+    }
+
+    fun segmentStartMs(i: Int): Int = buf().getInt(segment(i))
+    fun segmentEndMs(i: Int): Int = buf().getInt(segment(i) + 4)
+
+    /** Byte range of segment [i] within the UTF-8 text blob. */
+    fun segmentTextOffset(i: Int): Int = buf().getInt(segment(i) + 8)
+    fun segmentTextBytes(i: Int): Int = buf().getInt(segment(i) + 12)
+
+    /** Indices of the (non-special) tokens of segment [i]. */
+    fun segmentTokens(i: Int): IntRange {
+        val first = buf().getInt(segment(i) + 16)
+        return first until first + buf().getInt(segment(i) + 20)
+    }
+
+    fun segmentText(i: Int): String = decode(segmentTextOffset(i), segmentTextBytes(i))
+
+    fun tokenId(i: Int): Int = buf().getInt(token(i))
+    fun tokenProbability(i: Int): Float = buf().getFloat(token(i) + 4)
+    fun tokenStartMs(i: Int): Int = buf().getInt(token(i) + 8)
+    fun tokenEndMs(i: Int): Int = buf().getInt(token(i) + 12)
+
+    /** The whole transcript: all segment texts back to back. */
+    val text: String
+        get() = decode(0, textBytes)
+
+    private fun decode(offset: Int, length: Int): String {
+        val slice = buf().duplicate()
+        slice.limit(textOffset + offset + length)
+        slice.position(textOffset + offset)
+        return Charsets.UTF_8.decode(slice).toString()
+    }
+
+    override fun close() {
+        buffer?.let { nativeFree(it) }
+        buffer = null
+    }
+
+    companion object {
+        private const val MAGIC = 0x52544343 // "CCTR"
+        private const val VERSION = 1
+        private const val HEADER_SIZE = 32
+        private const val SEGMENT_SIZE = 24
+        private const val TOKEN_SIZE = 16
+    }
+}
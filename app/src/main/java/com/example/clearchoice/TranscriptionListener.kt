@@ -0,0 +1,16 @@
+package com.example.clearchoice
+
+/**
+ * Receives transcription results while native code is still running.
+ *
+ * Called on the transcription worker thread, never concurrently; post to the main
+ * thread before touching views. Segments arrive in batches and in order; times are
+ * milliseconds in the recording. Exceptions thrown here stop further callbacks for
+ * the job but do not fail it.
+ */
+interface TranscriptionListener {
+    fun onSegments(startMs: IntArray, endMs: IntArray, texts: Array<String>)
+
+    /** Whisper's progress through the audio, 0..100. */
+    fun onProgress(percent: Int)
+}
@@ -0,0 +1,97 @@
+package com.example.clearchoice
+
+import android.util.Log
+import java.nio.ByteBuffer
+import org.json.JSONException
+import org.json.JSONObject
+
+/**
+ * Native queue of transcription jobs, one per session (engine_module/job_scheduler.h).
+ *
+ * Jobs are served by a few native workers a window at a time, highest [priority][PRIORITY_FOREGROUND]
+ * first, so raising the priority of the session on screen makes it overtake queued
+ * background sessions at the next window boundary. Submit through
+ * WhisperService.submitTranscription; every job must end in [takeResult] or [release].
+ */
+object TranscriptionScheduler {
+
+    private const val TAG = "TranscriptionScheduler"
+
+    const val PRIORITY_BACKGROUND = 0
+    const val PRIORITY_NORMAL = 1
+    const val PRIORITY_FOREGROUND = 2
+
+    init {
+        try {
+            System.loadLibrary("native-lib")
+        } catch (e: UnsatisfiedLinkError) {
+            Log.e(TAG, "Failed to load native-lib", e)
+        }
+    }
+
+    /** Snapshot of a job; times are wall-clock milliseconds. */
+    data class Status(
+        val id: Long,
+        val state: String, // "queued", "running", "done", "failed" or "cancelled"
+        val priority: String,
+        val chunks: Int,
+        val chunksDone: Int,
+        val progress: Int,
+        val queuedMs: Double,
+        val vadMs: Double,
+        val whisperMs: Double,
+        val totalMs: Double,
+        val preemptions: Int,
+        val error: String?
+    ) {
+        val isEnded: Boolean get() = state == "done" || state == "failed" || state == "cancelled"
+    }
+
+    // audioPtr is a NativeAudioCache handle; the job keeps its own reference.
+    internal external fun submit(modelPath: String, audioPtr: Long, priority: Int): Long
+    private external fun status(jobId: Long): String?
+    private external fun takeResult(jobId: Long): ByteBuffer?
+
+    /** Reprioritizes a queued or running job. False if the job is unknown. */
+    external fun setPriority(jobId: Long, priority: Int): Boolean
+
+    /** Stops a job at the next decoder step; it ends as "cancelled". */
+    external fun cancel(jobId: Long): Boolean
+
+    /** Forgets a job without taking its result, cancelling it if still running. */
+    external fun release(jobId: Long)
+
+    /** Native workers (whisper states in use at once); 0 = auto. Applies when the pool next starts. */
+    external fun setWorkers(workers: Int)
+
+    /** The job's current status, or null if it is unknown (taken or released). */
+    fun getStatus(jobId: Long): Status? {
+        val json = status(jobId) ?: return null
+        return try {
+            val o = JSONObject(json)
+            Status(
+                id = o.getLong("id"),
+                state = o.getString("state"),
+                priority = o.getString("priority"),
+                chunks = o.getInt("n_chunks"),
+                chunksDone = o.getInt("chunks_done"),
+                progress = o.getInt("progress"),
+                queuedMs = o.getDouble("queued_ms"),
+                vadMs = o.getDouble("vad_ms"),
+                whisperMs = o.getDouble("whisper_ms"),
+                totalMs = o.getDouble("total_ms"),
+                preemptions = o.getInt("preemptions"),
+                error = if (o.has("error")) o.getString("error") else null
+            )
+        } catch (e: JSONException) {
+            Log.e(TAG, "Malformed job status: $json", e)
+            null
+        }
+    }
+
+    /**
+     * The result of a "done" job, which is then forgotten; null if the job is unknown
+     * or not done. The caller must close it.
+     */
+    fun takeLayout(jobId: Long): TranscriptLayout? = takeResult(jobId)?.let { TranscriptLayout(it) }
+}
@@ -5,6 +5,7 @@ import android.util.Log
 import java.io.File
 import java.io.FileOutputStream
 import java.io.IOException
+import java.nio.ByteBuffer
 
 class WhisperService {
 
@@ -22,6 +23,104 @@ class WhisperService {
 
     private external fun transcribeFile(modelPath: String, audioPath: String): String?
 
+    // PCM entry points: encoding is an android.media.AudioFormat ENCODING_PCM_16BIT / ENCODING_PCM_FLOAT
+    // constant. Buffers must be direct; native code reads them in place.
+    private external fun transcribePcm(modelPath: String, pcm: ByteBuffer, sampleRate: Int, channels: Int, encoding: Int): String?
+    // audioPtr is a NativeAudioCache handle; it stays owned by the caller.
+    private external fun transcribeAudio(modelPath: String, audioPtr: Long): String?
+    // listener (may be null) receives segments and progress while native code runs
+    private external fun transcribeAndDiarize(modelPath: String, audioPtr: Long, listener: TranscriptionListener?, jobPtr: Long): String?
+    // Result in the binary layout read by TranscriptLayout; null on failure
+    private external fun transcribeToLayout(modelPath: String, audioPtr: Long, listener: TranscriptionListener?, jobPtr: Long): ByteBuffer?
+
+    /**
+     * Native resampler quality used when decoded audio is not 16kHz mono:
+     * [RESAMPLE_FAST], [RESAMPLE_BALANCED] (default) or [RESAMPLE_HIGH].
+     */
+    external fun setResampleQuality(quality: Int)
+
+    /**
+     * Which cores native transcription and diarization run on:
+     * [THREAD_POLICY_PERFORMANCE] (all big cores), [THREAD_POLICY_BALANCED] (default)
+     * or [THREAD_POLICY_BACKGROUND] (LITTLE cores only, for work nobody is waiting on).
+     */
+    external fun setThreadPolicy(policy: Int)
+
+    /**
+     * How many whisper states transcribe one recording at once. 1 (default)
+     * transcribes sequentially; with more, the recording is cut at silences and
+     * the chunks are shared out between the workers, skipping the silence between
+     * them. [PARALLEL_WORKERS_AUTO] uses half the thread policy's threads.
+     */
+    external fun setParallelWorkers(workers: Int)
+
+    /**
+     * Encodes the next 30 s window on a second whisper state while the current
+     * one decodes. Off by default; worth it on devices with 6 or more big cores.
+     */
+    external fun setEncoderPipelining(enabled: Boolean)
+
+    /**
+     * Sizes the encoder of every window to the audio it holds instead of a full
+     * 30 s, so short voice memos and the last window of a recording encode in a
+     * fraction of the time. Off by default.
+     */
+    external fun setAudioCtxAuto(enabled: Boolean)
+
+    /**
+     * Keeps the log mel spectrogram of a transcribeAndDiarize session in half
+     * precision, which halves its memory: about 58 MB instead of 115 MB per hour of
+     * speech. Transcription of a single file computes its spectrogram a window at
+     * a time and is not affected. Off by default; `clearchoice-cli --compare-mel-f16`
+     * shows what it changes on a recording.
+     */
+    external fun setMelF16(enabled: Boolean)
+
+    /**
+     * Keeps the encoder output of every 30 s window in a file next to the session
+     * audio (`<audio>.<model>.encoder-cache`), so transcribing the same recording
+     * again with the same model, e.g. with another prompt or language, skips the
+     * encoder for the windows it has already seen. Off by default; about 3 MB
+     * per window with the base model.
+     */
+    external fun setEncoderCache(enabled: Boolean)
+
+    /**
+     * Holds transcription to [rtf] seconds of work per second of audio (e.g. 0.5),
+     * adapting decoding effort window by window: when the device falls behind it gives
+     * up temperature fallback, extra decoders and then audio context; when well ahead
+     * it restores them and then sheds threads. 0 (the default) always decodes at full effort.
+     */
+    external fun setRtfTarget(rtf: Float)
+
+    // The native model registry keeps a model resident (with a pool of decoding
+    // states) from nativeInit until nativeRelease; transcribeFile reuses it.
+    private external fun nativeInit(modelPath: String): Boolean
+    private external fun nativeRelease(modelPath: String)
+
+    /**
+     * Loads the model into native memory ahead of the first transcription.
+     * Safe to call repeatedly; later calls return immediately.
+     */
+    fun init(context: Context): Boolean {
+        val modelPath = getModelPath(context) ?: return false
+        return try {
+            nativeInit(modelPath).also { Log.d(TAG, "nativeInit($modelPath) -> $it") }
+        } catch (e: UnsatisfiedLinkError) {
+            Log.e(TAG, "nativeInit failed (UnsatisfiedLinkError). Is native-lib loaded?", e)
+            false
+        }
+    }
+
+    /** Frees the resident model. The next transcription loads it again. */
+    fun release(context: Context) {
+        try {
+            nativeRelease(File(context.filesDir, MODEL_NAME).absolutePath)
+        } catch (e: UnsatisfiedLinkError) {
+            Log.e(TAG, "nativeRelease failed (UnsatisfiedLinkError). Is native-lib loaded?", e)
+        }
+    }
+
     private fun getModelPath(context: Context): String? {
         val modelFile = File(context.filesDir, MODEL_NAME)
         if (modelFile.exists()) {
@@ -44,70 +143,171 @@ class WhisperService {
         }
     }
 
+    /**
+     * Transcribes PCM that is already in memory, e.g. from a recorder, without going
+     * through a file. [pcm] must be a direct buffer; all of it is read.
+     */
+    fun transcribeBuffer(context: Context, pcm: ByteBuffer, sampleRate: Int, channels: Int, encoding: Int): String? {
+        val modelPath = getModelPath(context) ?: return null
+        return try {
+            transcribePcm(modelPath, pcm, sampleRate, channels, encoding)
+        } catch (e: UnsatisfiedLinkError) {
+            Log.e(TAG, "Native method call failed (UnsatisfiedLinkError). Is native-lib loaded?", e)
+            null
+        }
+    }
+
+    /**
+     * Transcribes [audioFile] and returns the full result (segment and token timings,
+     * token ids and probabilities) as a [TranscriptLayout], or null on failure or if
+     * [job] was cancelled. The caller must close it.
+     */
+    fun transcribeDetailed(context: Context, audioFile: File, listener: TranscriptionListener? = null, job: NativeJob? = null): TranscriptLayout? {
+        var layoutBuffer: ByteBuffer? = null
+        runOnSessionAudio(context, audioFile, job) { modelPath, audioPtr, jobPtr ->
+            layoutBuffer = transcribeToLayout(modelPath, audioPtr, listener, jobPtr)
+            null
+        }
+        return layoutBuffer?.let { TranscriptLayout(it) }
+    }
+
+    /**
+     * Queues [audioFile] on the native TranscriptionScheduler and returns the job id, or 0
+     * if the model or the audio could not be loaded. Poll TranscriptionScheduler.getStatus
+     * and collect the result with TranscriptionScheduler.takeLayout.
+     */
+    fun submitTranscription(context: Context, audioFile: File, priority: Int = TranscriptionScheduler.PRIORITY_NORMAL): Long {
+        val modelPath = getModelPath(context) ?: return 0L
+        if (!init(context)) {
+            Log.e(TAG, "Failed to load model natively. Not queueing ${audioFile.name}.")
+            return 0L
+        }
+        return try {
+            val audioPtr = NativeAudioCache.acquire(audioFile, audioPreprocessor)
+            if (audioPtr == 0L) {
+                Log.e(TAG, "Audio decoding failed. Not queueing ${audioFile.name}.")
+                return 0L
+            }
+            try {
+                TranscriptionScheduler.submit(modelPath, audioPtr, priority)
+            } finally {
+                // the job holds its own reference to the audio
+                NativeAudioCache.releaseAudio(audioPtr)
+            }
+        } catch (e: UnsatisfiedLinkError) {
+            Log.e(TAG, "Native method call failed (UnsatisfiedLinkError). Is native-lib loaded?", e)
+            0L
+        }
+    }
+
     fun runTranscription(
         context: Context,
-        sessionFolder: File, // Used for storing temp PCM and potentially transcript
+        sessionFolder: File, // Session the audio belongs to (logging only)
         audioFile: File,     // Input audio.mp4
-        callback: (transcript: String?) -> Unit
+        callback: (transcript: String?) -> Unit,
+        listener: TranscriptionListener? = null, // Partial segments while transcribing
+        job: NativeJob? = null // Cancels the native run; the callback then gets null
     ) {
         Log.d(TAG, "Starting transcription process for audio: ${audioFile.name} in session: ${sessionFolder.name}")
+        val transcript = runOnSessionAudio(context, audioFile, job) { modelPath, audioPtr, jobPtr ->
+            Log.d(TAG, "Calling native transcribeToLayout function...")
+            transcribeToLayout(modelPath, audioPtr, listener, jobPtr)?.let { buffer ->
+                TranscriptLayout(buffer).use { layout ->
+                    Log.i(TAG, "Native transcription returned ${layout.segmentCount} segments, ${layout.tokenCount} tokens")
+                    layout.text
+                }
+            }
+        }
+        callback(transcript)
+    }
 
+    /**
+     * Transcribes and diarizes [audioFile] in a single native pass (VAD once, whisper and
+     * speaker embeddings concurrently), which is faster than [runTranscription] followed
+     * by DiarizationService.runDiarization.
+     *
+     * The callback receives JSON of the form
+     * `{"transcript": "...", "segments": [...]}` where "segments" has the speakers.json
+     * layout with char offsets into "transcript", `{"error": "..."}`, or null on failure.
+     * A cancelled [job] yields `{"error": "Cancelled."}`.
+     */
+    fun runTranscriptionWithSpeakers(
+        context: Context,
+        sessionFolder: File, // Session the audio belongs to (logging only)
+        audioFile: File,     // Input audio.mp4
+        callback: (sessionJson: String?) -> Unit,
+        listener: TranscriptionListener? = null, // Partial segments while transcribing
+        job: NativeJob? = null // Cancels the native run
+    ) {
+        Log.d(TAG, "Starting transcription + diarization for audio: ${audioFile.name} in session: ${sessionFolder.name}")
+        val sessionJson = runOnSessionAudio(context, audioFile, job) { modelPath, audioPtr, jobPtr ->
+            Log.d(TAG, "Calling native transcribeAndDiarize function...")
+            transcribeAndDiarize(modelPath, audioPtr, listener, jobPtr)
+        }
+        callback(sessionJson)
+    }
+
+    /**
+     * Loads the model, decodes [audioFile] (or reuses its cached decode) and runs [nativeCall]
+     * on it. Returns the native result, an "Error: ..." string if the call threw, or null
+     * if the model or the audio could not be loaded or [job] was cancelled while decoding.
+     */
+    private fun runOnSessionAudio(
+        context: Context,
+        audioFile: File,
+        job: NativeJob?,
+        nativeCall: (modelPath: String, audioPtr: Long, jobPtr: Long) -> String?
+    ): String? {
         val modelPath = getModelPath(context)
         if (modelPath == null) {
             Log.e(TAG, "Model path is null. Aborting transcription.")
-            callback(null)
-            return
+            return null
         }
         Log.d(TAG, "Using model at: $modelPath")
-
-        val tempPcmFile = File(sessionFolder, TEMP_PCM_FILE_NAME)
-
-        // Step 1: Preprocess audio (convert to PCM)
-        Log.d(TAG, "Preprocessing audio...")
-        val preprocessingSuccess = audioPreprocessor.preprocessAudio(context, audioFile, tempPcmFile)
-
-        if (!preprocessingSuccess) {
-            Log.e(TAG, "Audio preprocessing failed. Aborting transcription.")
-            callback(null)
-            // Clean up temp PCM file if it was created partially or is empty
-            if (tempPcmFile.exists()) {
-                tempPcmFile.delete()
-            }
-            return
+        if (!init(context)) {
+            Log.e(TAG, "Failed to load model natively. Aborting transcription.")
+            return null
         }
-        Log.d(TAG, "Audio preprocessing succeeded. PCM at: ${tempPcmFile.absolutePath}")
 
-        // Step 2: Call native JNI function for transcription
-        var transcript: String? = null
-        try {
-            Log.d(TAG, "Calling native transcribeFile function...")
-            transcript = transcribeFile(modelPath, tempPcmFile.absolutePath)
-            Log.i(TAG, "Native transcription returned: $transcript")
+        // Step 1: Decode audio natively, or reuse it if diarization already decoded this file
+        val audioPtr = try {
+            NativeAudioCache.acquire(audioFile, audioPreprocessor, job)
         } catch (e: UnsatisfiedLinkError) {
             Log.e(TAG, "Native method call failed (UnsatisfiedLinkError). Is native-lib loaded?", e)
-            transcript = "Error: Native library link error."
-        } catch (e: Exception) {
-            Log.e(TAG, "Exception during native transcribeFile call", e)
-            transcript = "Error: Exception during transcription native call."
+            0L
         }
-
-
-        // Step 3: Clean up temporary PCM file
-        if (tempPcmFile.exists()) {
-            if (tempPcmFile.delete()) {
-                Log.d(TAG, "Temporary PCM file deleted: ${tempPcmFile.name}")
-            } else {
-                Log.w(TAG, "Failed to delete temporary PCM file: ${tempPcmFile.name}")
-            }
+        if (audioPtr == 0L) {
+            Log.e(TAG, if (job?.isCancelled == true) "Cancelled while decoding audio." else "Audio decoding failed. Aborting transcription.")
+            return null
         }
 
-        // Step 4: Invoke callback with the result
-        callback(transcript)
+        // Step 2: Run the native pass over the decoded PCM
+        return try {
+            nativeCall(modelPath, audioPtr, job?.nativeHandle ?: 0L)
+        } catch (e: UnsatisfiedLinkError) {
+            Log.e(TAG, "Native method call failed (UnsatisfiedLinkError). Is native-lib loaded?", e)
+            "Error: Native library link error."
+        } catch (e: Exception) {
+            Log.e(TAG, "Exception during native transcription call", e)
+            "Error: Exception during transcription native call."
+        } finally {
+            // Step 3: Drop our reference; the audio stays cached for diarization
+            NativeAudioCache.releaseAudio(audioPtr)
+        }
     }
 
     companion object {
         private const val TAG = "WhisperService"
         private const val MODEL_NAME = "ggml-tiny.en-q8.bin" // Ensure this matches the assets file
-        private const val TEMP_PCM_FILE_NAME = "temp_audio.pcm"
+
+        const val RESAMPLE_FAST = 0
+        const val RESAMPLE_BALANCED = 1
+        const val RESAMPLE_HIGH = 2
+
+        const val THREAD_POLICY_PERFORMANCE = 0
+        const val THREAD_POLICY_BALANCED = 1
+        const val THREAD_POLICY_BACKGROUND = 2
+
+        const val PARALLEL_WORKERS_AUTO = 0
     }
 }